@@ -0,0 +1,207 @@
+//Per call cost of the blocking socket calls with the asio path (the default) and with the fast path
+//(setFastPathEnabled()), on loopback. Linux only.
+//
+//"ready" times calls that find the socket ready: datagrams / bytes are queued before receive() / read() and the
+//socket buffers have room for send() / write(). "waiting" times a ping pong between two threads, so that every
+//receive() / read() has to wait for the peer's send() / write(). It reports the round trip, i.e. two waiting calls
+//and two sends per iteration.
+//
+//Build from the repository root, e.g.:
+//g++ -O2 -DBOOST_BIND_GLOBAL_PLACEHOLDERS -IInterruptibleBlockingSockets -IInterruptibleBlockingSocketAcceptors Benchmarks/SocketFastPathBenchmark.cpp
+//    InterruptibleBlockingSockets/*.cpp InterruptibleBlockingSocketAcceptors/*.cpp -lboost_thread -lboost_system -lpthread
+
+//System includes
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPSocket.h"
+#include "InterruptibleBlockingTCPSocket.h"
+#include "InterruptibleBlockingTCPAcceptor.h"
+
+using namespace std;
+
+namespace
+{
+    const uint16_t UDP_PORT_A = 47101;
+    const uint16_t UDP_PORT_B = 47102;
+    const uint16_t TCP_PORT = 47103;
+
+    const uint32_t MESSAGE_SIZE_B = 64;
+    //Calls per timed batch on a ready socket. Small enough for the queued datagrams to fit the receive buffer.
+    const uint32_t BATCH_SIZE = 100;
+    const uint32_t N_BATCHES = 2000;
+    const uint32_t N_ROUND_TRIPS = 20000;
+
+    int64_t getTime_ns()
+    {
+        return (boost::posix_time::microsec_clock::universal_time() - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1))).total_nanoseconds();
+    }
+
+    void printResult(const string &strCall, bool bFastPath, const string &strCase, int64_t i64Elapsed_ns, uint32_t u32NCalls)
+    {
+        cout << setw(10) << left << strCall << setw(10) << (bFastPath ? "fast path" : "asio") << setw(9) << strCase
+             << setw(10) << right << fixed << setprecision(0) << (double)i64Elapsed_ns / u32NCalls << " ns" << endl;
+    }
+
+    //Answers every message until it reads one starting with 'q'
+    void udpEchoThreadFunction(cInterruptibleBlockingUDPSocket *pSocket)
+    {
+        char chaBuffer[MESSAGE_SIZE_B];
+
+        while(pSocket->receive(chaBuffer, sizeof(chaBuffer), 1000) && chaBuffer[0] != 'q')
+            pSocket->send(chaBuffer, MESSAGE_SIZE_B);
+    }
+
+    void tcpEchoThreadFunction(cInterruptibleBlockingTCPSocket *pSocket)
+    {
+        char chaBuffer[MESSAGE_SIZE_B];
+
+        while(pSocket->read(chaBuffer, sizeof(chaBuffer), 1000) && chaBuffer[0] != 'q')
+            pSocket->write(chaBuffer, MESSAGE_SIZE_B);
+    }
+
+    //Keeps the receiving side of the write benchmark drained
+    void tcpDrainThreadFunction(cInterruptibleBlockingTCPSocket *pSocket, uint64_t u64NBytes)
+    {
+        vector<char> vcBuffer(BATCH_SIZE * MESSAGE_SIZE_B);
+
+        while(u64NBytes)
+        {
+            uint32_t u32NBytes = min<uint64_t>(u64NBytes, vcBuffer.size());
+
+            if(!pSocket->read(&vcBuffer[0], u32NBytes, 1000))
+                return;
+
+            u64NBytes -= u32NBytes;
+        }
+    }
+
+    void benchmarkUDP(bool bFastPath)
+    {
+        cInterruptibleBlockingUDPSocket oSocketA("A");
+        cInterruptibleBlockingUDPSocket oSocketB("B");
+
+        oSocketA.openBindAndConnect("127.0.0.1", UDP_PORT_A, "127.0.0.1", UDP_PORT_B);
+        oSocketB.openBindAndConnect("127.0.0.1", UDP_PORT_B, "127.0.0.1", UDP_PORT_A);
+
+        oSocketA.setFastPathEnabled(bFastPath);
+        oSocketB.setFastPathEnabled(bFastPath);
+
+        char chaBuffer[MESSAGE_SIZE_B] = {0};
+        int64_t i64SendTime_ns = 0;
+        int64_t i64ReceiveTime_ns = 0;
+
+        for(uint32_t u32BatchNo = 0; u32BatchNo < N_BATCHES; u32BatchNo++)
+        {
+            int64_t i64Start_ns = getTime_ns();
+            for(uint32_t u32CallNo = 0; u32CallNo < BATCH_SIZE; u32CallNo++)
+                oSocketA.send(chaBuffer, MESSAGE_SIZE_B, 1000);
+            i64SendTime_ns += getTime_ns() - i64Start_ns;
+
+            i64Start_ns = getTime_ns();
+            for(uint32_t u32CallNo = 0; u32CallNo < BATCH_SIZE; u32CallNo++)
+                oSocketB.receive(chaBuffer, MESSAGE_SIZE_B, 1000);
+            i64ReceiveTime_ns += getTime_ns() - i64Start_ns;
+        }
+
+        printResult("send()", bFastPath, "ready", i64SendTime_ns, N_BATCHES * BATCH_SIZE);
+        printResult("receive()", bFastPath, "ready", i64ReceiveTime_ns, N_BATCHES * BATCH_SIZE);
+
+        boost::thread oEchoThread(boost::bind(&udpEchoThreadFunction, &oSocketB));
+
+        int64_t i64Start_ns = getTime_ns();
+        for(uint32_t u32RoundTripNo = 0; u32RoundTripNo < N_ROUND_TRIPS; u32RoundTripNo++)
+        {
+            chaBuffer[0] = 'p';
+            oSocketA.send(chaBuffer, MESSAGE_SIZE_B, 1000);
+            oSocketA.receive(chaBuffer, MESSAGE_SIZE_B, 1000);
+        }
+        printResult("ping pong", bFastPath, "waiting", getTime_ns() - i64Start_ns, N_ROUND_TRIPS);
+
+        chaBuffer[0] = 'q';
+        oSocketA.send(chaBuffer, MESSAGE_SIZE_B, 1000);
+        oEchoThread.join();
+    }
+
+    void benchmarkTCP(bool bFastPath)
+    {
+        cInterruptibleBlockingTCPAcceptor oAcceptor("127.0.0.1", TCP_PORT, "acceptor");
+        cInterruptibleBlockingTCPSocket oSocketA("A");
+        cInterruptibleBlockingTCPSocket oSocketB("B");
+
+        boost::thread oConnectThread(boost::bind(&cInterruptibleBlockingTCPSocket::openAndConnect, &oSocketA, string("127.0.0.1"), TCP_PORT, 1000));
+        string strPeerAddress;
+        oAcceptor.accept(oSocketB, strPeerAddress, 1000);
+        oConnectThread.join();
+
+        oSocketA.setFastPathEnabled(bFastPath);
+        oSocketB.setFastPathEnabled(bFastPath);
+
+        char chaBuffer[MESSAGE_SIZE_B] = {0};
+
+        //Writes into a drained connection
+        boost::thread oDrainThread(boost::bind(&tcpDrainThreadFunction, &oSocketB, (uint64_t)N_BATCHES * BATCH_SIZE * MESSAGE_SIZE_B));
+
+        int64_t i64Start_ns = getTime_ns();
+        for(uint32_t u32CallNo = 0; u32CallNo < N_BATCHES * BATCH_SIZE; u32CallNo++)
+            oSocketA.write(chaBuffer, MESSAGE_SIZE_B, 1000);
+        printResult("write()", bFastPath, "ready", getTime_ns() - i64Start_ns, N_BATCHES * BATCH_SIZE);
+
+        oDrainThread.join();
+
+        //Reads of data already queued
+        vector<char> vcBatch(BATCH_SIZE * MESSAGE_SIZE_B);
+        int64_t i64ReadTime_ns = 0;
+
+        for(uint32_t u32BatchNo = 0; u32BatchNo < N_BATCHES; u32BatchNo++)
+        {
+            oSocketA.write(&vcBatch[0], vcBatch.size(), 1000);
+
+            //Let all of it arrive
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+
+            i64Start_ns = getTime_ns();
+            for(uint32_t u32CallNo = 0; u32CallNo < BATCH_SIZE; u32CallNo++)
+                oSocketB.read(chaBuffer, MESSAGE_SIZE_B, 1000);
+            i64ReadTime_ns += getTime_ns() - i64Start_ns;
+        }
+
+        printResult("read()", bFastPath, "ready", i64ReadTime_ns, N_BATCHES * BATCH_SIZE);
+
+        boost::thread oEchoThread(boost::bind(&tcpEchoThreadFunction, &oSocketB));
+
+        i64Start_ns = getTime_ns();
+        for(uint32_t u32RoundTripNo = 0; u32RoundTripNo < N_ROUND_TRIPS; u32RoundTripNo++)
+        {
+            chaBuffer[0] = 'p';
+            oSocketA.write(chaBuffer, MESSAGE_SIZE_B, 1000);
+            oSocketA.read(chaBuffer, MESSAGE_SIZE_B, 1000);
+        }
+        printResult("ping pong", bFastPath, "waiting", getTime_ns() - i64Start_ns, N_ROUND_TRIPS);
+
+        chaBuffer[0] = 'q';
+        oSocketA.write(chaBuffer, MESSAGE_SIZE_B, 1000);
+        oEchoThread.join();
+    }
+}
+
+int main()
+{
+    for(uint32_t u32ModeNo = 0; u32ModeNo < 2; u32ModeNo++)
+    {
+        benchmarkUDP(u32ModeNo == 1);
+        benchmarkTCP(u32ModeNo == 1);
+    }
+
+    return 0;
+}
@@ -1,22 +1,48 @@
 
 //System includes
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 //Library includes
 #ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
 #include <boost/bind.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #endif
 
 //Local includes
 #include "InterruptibleBlockingTCPAcceptor.h"
+#include "../InterruptibleBlockingSockets/AwaitableDeadline.h"
 
 using namespace std;
 
 cInterruptibleBlockingTCPAcceptor::cInterruptibleBlockingTCPAcceptor(const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
+    m_oAcceptor(m_oIOService),
+    m_oTimer(m_oIOService),
+    m_oWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingTCPAcceptor::cancelIO, this)),
+    m_bError(true),
+    m_strName(strName)
+{
+
+}
+
+cInterruptibleBlockingTCPAcceptor::cInterruptibleBlockingTCPAcceptor(boost::asio::io_service &oIOService, const string &strName) :
+    m_oIOService(oIOService),
     m_oAcceptor(m_oIOService),
     m_oTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWaiter(m_oIOService, true, boost::bind(&cInterruptibleBlockingTCPAcceptor::cancelIO, this)),
     m_bError(true),
     m_strName(strName)
 {
@@ -24,25 +50,47 @@ cInterruptibleBlockingTCPAcceptor::cInterruptibleBlockingTCPAcceptor(const strin
 }
 
 cInterruptibleBlockingTCPAcceptor::cInterruptibleBlockingTCPAcceptor(const string &strLocalInterface, uint16_t u16Port, const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
     m_oAcceptor(m_oIOService),
     m_oTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingTCPAcceptor::cancelIO, this)),
     m_bError(true),
     m_strName(strName)
 {
     openAndListen(strLocalInterface, u16Port);
 }
 
-void cInterruptibleBlockingTCPAcceptor::openAndListen(const string &strLocalInterface, uint16_t u16Port)
+void cInterruptibleBlockingTCPAcceptor::openAndListen(const string &strLocalInterface, uint16_t u16Port, bool bReusePort, int32_t i32Backlog)
 {
     m_oAcceptor.open(boost::asio::ip::tcp::v4()); //Use only IPv4
     m_oAcceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true)); //Set Listening socket to reuse address.
+
+    if(bReusePort)
+    {
+#ifdef SO_REUSEPORT
+        m_oAcceptor.set_option( boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true) );
+#else
+        cout << "cInterruptibleBlockingTCPAcceptor::openAndListen(): SO_REUSEPORT is not supported on this platform." << endl;
+#endif
+    }
+
     m_oAcceptor.bind(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string(strLocalInterface), u16Port));
-    m_oAcceptor.listen();
+    m_oAcceptor.listen(i32Backlog);
 }
 
 void cInterruptibleBlockingTCPAcceptor::close()
 {
+#ifdef __linux__
+    //The kernel holds the listening socket open while a multishot accept is armed. Connections it accepted but no
+    //accept() took yet are closed.
+    if(m_pIOUring)
+    {
+        m_pIOUring->cancel();
+        m_pIOUring->stopMultishot();
+    }
+#endif
+
     //If the socket is open close it
     if(m_oAcceptor.is_open())
     {
@@ -60,28 +108,51 @@ bool cInterruptibleBlockingTCPAcceptor::isOpen()
 
 bool cInterruptibleBlockingTCPAcceptor::accept(cInterruptibleBlockingTCPSocket &oSocket, string &strPeerAddress, uint32_t u32Timeout_ms)
 {
+#ifdef __linux__
+    if(m_pIOUring)
+    {
+        int iFD;
+        m_oLastError = m_pIOUring->accept(m_oAcceptor.native_handle(), iFD, cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms));
+
+        if(!m_oLastError && !oSocket.attachDescriptor(iFD))
+        {
+            ::close(iFD);
+            m_oLastError = boost::asio::error::bad_descriptor;
+        }
+
+        m_bError = m_oLastError ? true : false;
+        strPeerAddress = m_bError ? string("") : oSocket.getPeerAddress();
+
+        return !m_bError;
+    }
+#endif
+
     //Necessary after a timeout:
-    m_oAcceptor.get_io_service().reset();
+    m_oWaiter.begin();
     boost::asio::ip::tcp::endpoint oPeerEndpoint;
 
+    //Reported if a cancel stops the io_service before the handler runs
+    m_bError = true;
+    m_oLastError = boost::asio::error::operation_aborted;
+
     //Asynchronously accept socket connections
     m_oAcceptor.async_accept(*oSocket.getBoostSocketPointer(), oPeerEndpoint,
-            boost::bind(&cInterruptibleBlockingTCPAcceptor::callback_complete,
-                this,
-                boost::asio::placeholders::error ) );
+            m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPAcceptor::callback_complete,
+                               this,
+                               boost::asio::placeholders::error )) );
 
     // Setup a deadline time to implement our timeout.
     if(u32Timeout_ms)
     {
         m_oTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
 
-        m_oTimer.async_wait( boost::bind(&cInterruptibleBlockingTCPAcceptor::callback_timeOut,
-                    this, boost::asio::placeholders::error) );
+        m_oTimer.async_wait( m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPAcceptor::callback_timeOut,
+                                   this, boost::asio::placeholders::error)) );
     }
 
     // This will block until a new connection has been accepted
     // or until the it is cancelled.
-    m_oAcceptor.get_io_service().run();
+    m_oWaiter.wait();
 
     if(m_bError)
         strPeerAddress = string("");
@@ -97,6 +168,53 @@ bool cInterruptibleBlockingTCPAcceptor::accept(boost::shared_ptr<cInterruptibleB
     return accept(*pSocket.get(), strPeerAddress, u32Timeout_ms);
 }
 
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+boost::asio::awaitable<bool> cInterruptibleBlockingTCPAcceptor::asyncAccept(cInterruptibleBlockingTCPSocket &oSocket, string &strPeerAddress,
+                                                                            uint32_t u32Timeout_ms, cCancellationToken *pToken)
+{
+    m_bError = true;
+    strPeerAddress = string("");
+
+    if(m_pOwnedIOService)
+    {
+        cout << "cInterruptibleBlockingTCPAcceptor::asyncAccept(): Coroutine calls need an acceptor on a shared io_service" << endl;
+        m_oLastError = boost::asio::error::operation_not_supported;
+        co_return false;
+    }
+
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
+
+    boost::asio::ip::tcp::endpoint oPeerEndpoint;
+    boost::system::error_code oError = oDeadline.getStopError();
+
+    //Accepts without blocking and waits on the io_service while there is nothing to accept
+    while(!oError)
+    {
+        boost::system::error_code oModeError;
+        bool bNonBlocking = m_oAcceptor.non_blocking();
+        m_oAcceptor.non_blocking(true, oModeError);
+
+        m_oAcceptor.accept(*oSocket.getBoostSocketPointer(), oPeerEndpoint, oError);
+
+        m_oAcceptor.non_blocking(bNonBlocking, oModeError);
+
+        if(oError != boost::asio::error::would_block)
+            break;
+
+        co_await m_oAsyncAcceptReadiness.asyncWait(m_oAcceptor, boost::asio::socket_base::wait_read, oDeadline,
+                                                   boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+    }
+
+    m_bError = oError ? true : false;
+    m_oLastError = oError;
+
+    if(!m_bError)
+        strPeerAddress = getEndpointHostAddress(oPeerEndpoint);
+
+    co_return !m_bError;
+}
+#endif
+
 void cInterruptibleBlockingTCPAcceptor::callback_complete(const boost::system::error_code& oError)
 {
     m_bError = true;
@@ -124,17 +242,74 @@ void cInterruptibleBlockingTCPAcceptor::callback_timeOut(const boost::system::er
 }
 
 void cInterruptibleBlockingTCPAcceptor::cancelCurrrentOperations()
+{
+    m_oResolver.cancelCurrrentOperations();
+
+#ifdef __linux__
+    if(m_pIOUring)
+        m_pIOUring->cancel();
+#endif
+
+    m_oWaiter.cancel();
+}
+
+bool cInterruptibleBlockingTCPAcceptor::setIOUringEnabled(bool bEnabled)
+{
+#ifdef __linux__
+    if(bEnabled && !m_pIOUring)
+    {
+        if(!cIOUring::isSupported())
+        {
+            cout << "cInterruptibleBlockingTCPAcceptor::setIOUringEnabled(): io_uring is not available, keeping the current path." << endl;
+            return false;
+        }
+
+        m_pIOUring.reset(new cIOUring);
+
+        if(!m_pIOUring->isOpen())
+        {
+            cout << "cInterruptibleBlockingTCPAcceptor::setIOUringEnabled(): Failed to set up the ring, keeping the current path." << endl;
+
+            m_pIOUring.reset();
+            return false;
+        }
+    }
+    else if(!bEnabled)
+    {
+        m_pIOUring.reset();
+    }
+
+    return true;
+#else
+    cout << "cInterruptibleBlockingTCPAcceptor::setIOUringEnabled(): io_uring is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingTCPAcceptor::isIOUringEnabled() const
+{
+#ifdef __linux__
+    return m_pIOUring.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+void cInterruptibleBlockingTCPAcceptor::cancelIO()
 {
     m_oTimer.cancel();
     m_oAcceptor.cancel();
 }
 
-boost::asio::ip::tcp::endpoint cInterruptibleBlockingTCPAcceptor::createEndpoint(string strHostAddress, uint16_t u16Port)
+boost::asio::ip::tcp::endpoint cInterruptibleBlockingTCPAcceptor::createEndpoint(string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms)
 {
-    stringstream oSS;
-    oSS << u16Port;
+    boost::asio::ip::address oAddress;
+
+    //Throw on failure as the synchronous resolver used to
+    if(!m_oResolver.resolve(strHostAddress, oAddress, u32Timeout_ms))
+        throw boost::system::system_error(m_oResolver.getLastError());
 
-    return *m_oResolver.resolve(boost::asio::ip::tcp::resolver::query(boost::asio::ip::tcp::v4(), strHostAddress, oSS.str()));
+    return boost::asio::ip::tcp::endpoint(oAddress, u16Port);
 }
 
 string cInterruptibleBlockingTCPAcceptor::getEndpointHostAddress(boost::asio::ip::tcp::endpoint oEndPoint)
@@ -147,6 +322,49 @@ uint16_t cInterruptibleBlockingTCPAcceptor::getEndpointPort(boost::asio::ip::tcp
     return oEndPoint.port();
 }
 
+bool cInterruptibleBlockingTCPAcceptor::getListenQueueLength(uint32_t &u32NQueued, uint32_t &u32Backlog)
+{
+#ifdef __linux__
+    //For a listening socket the kernel reports the accept queue in these two fields
+    struct tcp_info oInfo;
+    socklen_t iInfoLength = sizeof(oInfo);
+
+    if(!m_oAcceptor.is_open() || getsockopt(m_oAcceptor.native_handle(), IPPROTO_TCP, TCP_INFO, &oInfo, &iInfoLength))
+        return false;
+
+    u32NQueued = oInfo.tcpi_unacked;
+    u32Backlog = oInfo.tcpi_sacked;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t cInterruptibleBlockingTCPAcceptor::getNSystemListenOverflows()
+{
+    //TcpExt counters are a line of names followed by a line of values
+    ifstream oNetstat("/proc/net/netstat");
+    string strNames, strValues;
+
+    while(getline(oNetstat, strNames) && getline(oNetstat, strValues))
+    {
+        if(strNames.compare(0, 7, "TcpExt:"))
+            continue;
+
+        istringstream oNames(strNames), oValues(strValues);
+        string strName, strValue;
+
+        while(oNames >> strName && oValues >> strValue)
+        {
+            if(strName == "ListenOverflows")
+                return strtoull(strValue.c_str(), NULL, 10);
+        }
+    }
+
+    return 0;
+}
+
 boost::asio::ip::tcp::endpoint cInterruptibleBlockingTCPAcceptor::getLocalEndpoint()
 {
     return m_oAcceptor.local_endpoint();
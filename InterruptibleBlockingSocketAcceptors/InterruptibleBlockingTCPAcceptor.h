@@ -23,22 +23,36 @@ typedef unsigned __int64 uint64_t;
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #endif
 
 //Local includes
 #include "../InterruptibleBlockingSockets/InterruptibleBlockingTCPSocket.h"
+#include "../InterruptibleBlockingSockets/InterruptibleBlockingResolver.h"
+#include "../InterruptibleBlockingSockets/BlockingOperationWaiter.h"
+#include "../InterruptibleBlockingSockets/AsyncReadinessWaiter.h"
 
 class cInterruptibleBlockingTCPAcceptor
 {
 private:
+    //Private io_service. Not created when the acceptor uses a shared one.
+    boost::scoped_ptr<boost::asio::io_service> m_pOwnedIOService;
+
     //The serial port and io service for the port
-    boost::asio::io_service         m_oIOService;
+    boost::asio::io_service         &m_oIOService;
     boost::asio::ip::tcp::acceptor  m_oAcceptor;
 
     //Timer for deterining timeouts
     boost::asio::deadline_timer     m_oTimer;
 
-    boost::asio::ip::tcp::resolver  m_oResolver;
+    //Runs (or waits for) the asynchronous accept behind each blocking call
+    cBlockingOperationWaiter        m_oWaiter;
+
+    //Readiness wait of asyncAccept()
+    cAsyncReadinessWaiter           m_oAsyncAcceptReadiness;
+
+    //Cached, interruptible host name resolution for createEndpoint()
+    cInterruptibleBlockingResolver  m_oResolver;
 
     //Flag for determining read errors
     bool                            m_bError;
@@ -47,6 +61,11 @@ private:
     uint32_t                        m_u32NBytesLastTransferred;
     boost::system::error_code       m_oLastError;
 
+#ifdef __linux__
+    //Only exists while the io_uring backend is enabled
+    boost::scoped_ptr<cIOUring>     m_pIOUring;
+#endif
+
     //Optional label for this socket. May be useful for debugging.
     std::string                     m_strName;
 
@@ -54,11 +73,19 @@ private:
     void                            callback_complete(const boost::system::error_code& oError);
     void                            callback_timeOut(const boost::system::error_code& oError);
 
+    //Abort the accept in progress (see cBlockingOperationWaiter)
+    void                            cancelIO();
+
 public:
     cInterruptibleBlockingTCPAcceptor(const std::string &strName = "");
+    //Uses an externally owned io_service, which the owner must keep running. See cInterruptibleBlockingTCPSocket.
+    cInterruptibleBlockingTCPAcceptor(boost::asio::io_service &oIOService, const std::string &strName = "");
     cInterruptibleBlockingTCPAcceptor(const std::string &strLocalInterface, uint16_t u16LocalPort, const std::string &strName = "");
 
-    void                            openAndListen(const std::string &strLocalInterface, uint16_t u16Port);
+    //bReusePort allows several acceptors to listen on the port, with the kernel spreading connections over them (see
+    //cInterruptibleBlockingTCPServer). Throws boost::system::system_error on failure.
+    void                            openAndListen(const std::string &strLocalInterface, uint16_t u16Port, bool bReusePort = false,
+                                                  int32_t i32Backlog = boost::asio::socket_base::max_connections);
     void                            close();
 
     bool                            isOpen();
@@ -66,9 +93,29 @@ public:
     bool                            accept(cInterruptibleBlockingTCPSocket &oSocket, std::string &strPeerAddress, uint32_t u32Timeout_ms = 0);
     bool                            accept(boost::shared_ptr<cInterruptibleBlockingTCPSocket> pSocket, std::string &strPeerAddress, uint32_t u32Timeout_ms = 0);
 
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    //Coroutine version (C++20) for an acceptor on a shared io_service, awaited by a coroutine spawned on it. The socket
+    //should share it too, to be used with the coroutine calls. Timeouts report timed_out and pToken (if given) cancels
+    //the call from any thread, ending only this call. Waits go to the io_service rather than io_uring, which would block
+    //the thread, so don't combine it with the multishot accept. Fails with operation_not_supported on a private
+    //io_service.
+    boost::asio::awaitable<bool>    asyncAccept(cInterruptibleBlockingTCPSocket &oSocket, std::string &strPeerAddress, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+#endif
+
     void                            cancelCurrrentOperations();
 
-    boost::asio::ip::tcp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port);
+    //io_uring backend (Linux only, see cIOUring): a multishot accept stays armed, so connections arriving between calls
+    //are accepted already and each accept() just hands one to the socket. close() stops it. Returns false, leaving the
+    //io_service path in use, if the kernel doesn't support it. Only change while no accept is in progress.
+    //The kernel keeps accepting while nobody calls accept(), taking connections off the listen backlog into the ring.
+    //A caller that stops accepting to limit its connections (as cInterruptibleBlockingTCPServer does) no longer leaves
+    //them in the backlog, and with SO_REUSEPORT they are no longer spread by how quickly each acceptor takes them.
+    //Don't enable it on a server's listen shards.
+    bool                            setIOUringEnabled(bool bEnabled);
+    bool                            isIOUringEnabled() const;
+
+    //Throws boost::system::system_error if the host can't be resolved. See cInterruptibleBlockingResolver.
+    boost::asio::ip::tcp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms = 0);
     std::string                     getEndpointHostAddress(boost::asio::ip::tcp::endpoint oEndPoint);
     uint16_t                        getEndpointPort(boost::asio::ip::tcp::endpoint oEndPoint);
 
@@ -78,6 +125,11 @@ public:
     uint16_t                        getLocalPort();
 
     std::string                     getName();
+
+    //Connections waiting in the accept queue and the queue's limit (TCP_INFO). Linux only, returns false elsewhere.
+    bool                            getListenQueueLength(uint32_t &u32NQueued, uint32_t &u32Backlog);
+    //Connections dropped machine-wide because an accept queue was full (TcpExt ListenOverflows). Linux only, 0 elsewhere.
+    static uint64_t                 getNSystemListenOverflows();
     
     boost::system::error_code       getLastError();
 };
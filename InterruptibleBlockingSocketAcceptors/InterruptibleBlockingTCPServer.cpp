@@ -0,0 +1,460 @@
+
+//System includes
+#include <iostream>
+#include <exception>
+#include <sstream>
+#include <algorithm>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPServer.h"
+
+using namespace std;
+
+cInterruptibleBlockingTCPServer::cShardStats::cShardStats() :
+    m_u64NConnectionsAccepted(0),
+    m_u32ListenQueueLength(0),
+    m_u32ListenBacklog(0),
+    m_u32PeakListenQueueLength(0),
+    m_u64NTimesListenQueueFull(0)
+{
+}
+
+cInterruptibleBlockingTCPServer::cShard::cShard(const string &strName) :
+    m_oAcceptor(strName),
+    m_u64NConnectionsAccepted(0),
+    m_u32PeakListenQueueLength(0),
+    m_u64NTimesListenQueueFull(0)
+{
+}
+
+cInterruptibleBlockingTCPServer::cPendingConnection::cPendingConnection(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, const string &strPeerAddress) :
+    m_pSocket(pSocket),
+    m_strPeerAddress(strPeerAddress)
+{
+}
+
+cInterruptibleBlockingTCPServer::cInterruptibleBlockingTCPServer(const string &strName) :
+    m_u64NListenOverflowsAtStart(0),
+    m_pSharedIOService(NULL),
+    m_u32MaxNConnections(0),
+    m_bStopRequested(false),
+    m_bWorkersExit(false),
+    m_bDiscardQueued(false),
+    m_u32NAcceptsInProgress(0),
+    m_u32PeakQueueDepth(0),
+    m_u64NAcceptsThisInterval(0),
+    m_u64NAcceptsLastInterval(0),
+    m_u64NConnectionsAccepted(0),
+    m_u64NConnectionsHandled(0),
+    m_u64NConnectionsDropped(0),
+    m_u64NAcceptErrors(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingTCPServer::cInterruptibleBlockingTCPServer(boost::asio::io_service &oIOService, const string &strName) :
+    m_u64NListenOverflowsAtStart(0),
+    m_pSharedIOService(&oIOService),
+    m_u32MaxNConnections(0),
+    m_bStopRequested(false),
+    m_bWorkersExit(false),
+    m_bDiscardQueued(false),
+    m_u32NAcceptsInProgress(0),
+    m_u32PeakQueueDepth(0),
+    m_u64NAcceptsThisInterval(0),
+    m_u64NAcceptsLastInterval(0),
+    m_u64NConnectionsAccepted(0),
+    m_u64NConnectionsHandled(0),
+    m_u64NConnectionsDropped(0),
+    m_u64NAcceptErrors(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingTCPServer::~cInterruptibleBlockingTCPServer()
+{
+    stop();
+}
+
+bool cInterruptibleBlockingTCPServer::start(const string &strLocalInterface, uint16_t u16Port,
+                                            const boost::function<void (const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, const string &strPeerAddress)> &fnConnectionHandler,
+                                            uint32_t u32NWorkerThreads, uint32_t u32MaxNConnections,
+                                            uint32_t u32NListenShards, int32_t i32ListenBacklog)
+{
+    stop();
+
+    if(!fnConnectionHandler || !u32NWorkerThreads || !u32MaxNConnections || !u32NListenShards)
+    {
+        cout << "cInterruptibleBlockingTCPServer::start(): A connection handler, worker threads, a connection limit and a listen shard are required." << endl;
+        return false;
+    }
+
+    m_vpShards.clear();
+
+    for(uint32_t u32ShardNo = 0; u32ShardNo < u32NListenShards; u32ShardNo++)
+    {
+        stringstream oSS;
+        oSS << m_strName << "_shard" << u32ShardNo;
+
+        boost::shared_ptr<cShard> pShard(new cShard(u32NListenShards > 1 ? oSS.str() : m_strName));
+
+        try
+        {
+            //With port 0 the other shards join the port the first one was given
+            pShard->m_oAcceptor.openAndListen(strLocalInterface, u32ShardNo ? m_vpShards[0]->m_oAcceptor.getLocalPort() : u16Port,
+                                              u32NListenShards > 1, i32ListenBacklog);
+        }
+        catch(boost::system::system_error &e)
+        {
+            cout << "cInterruptibleBlockingTCPServer::start(): Unable to listen on " << strLocalInterface << ":" << u16Port << ": " << e.code().message() << endl;
+
+            pShard->m_oAcceptor.close();
+            for(uint32_t u32OpenShardNo = 0; u32OpenShardNo < m_vpShards.size(); u32OpenShardNo++)
+                m_vpShards[u32OpenShardNo]->m_oAcceptor.close();
+
+            m_vpShards.clear();
+            return false;
+        }
+
+        m_vpShards.push_back(pShard);
+    }
+
+    m_fnConnectionHandler = fnConnectionHandler;
+    m_u32MaxNConnections = u32MaxNConnections;
+
+    m_bStopRequested = false;
+    m_bWorkersExit = false;
+    m_bDiscardQueued = false;
+    m_u32NAcceptsInProgress = 0;
+    m_u32PeakQueueDepth = 0;
+    m_oAcceptRateIntervalStart = boost::posix_time::microsec_clock::universal_time();
+    m_u64NAcceptsThisInterval = 0;
+    m_u64NAcceptsLastInterval = 0;
+    m_u64NListenOverflowsAtStart = cInterruptibleBlockingTCPAcceptor::getNSystemListenOverflows();
+
+    m_pWorkerThreads.reset(new boost::thread_group);
+    for(uint32_t u32ThreadNo = 0; u32ThreadNo < u32NWorkerThreads; u32ThreadNo++)
+        m_pWorkerThreads->create_thread(boost::bind(&cInterruptibleBlockingTCPServer::workerThreadFunction, this));
+
+    for(uint32_t u32ShardNo = 0; u32ShardNo < m_vpShards.size(); u32ShardNo++)
+        m_vpShards[u32ShardNo]->m_pAcceptThread.reset(new boost::thread(&cInterruptibleBlockingTCPServer::acceptThreadFunction, this, m_vpShards[u32ShardNo].get()));
+
+    cout << "cInterruptibleBlockingTCPServer::start(): \"" << m_strName << "\" listening on " << strLocalInterface << ":" << getLocalPort()
+         << " with " << u32NListenShards << " listen shard(s) and " << u32NWorkerThreads << " workers." << endl;
+
+    return true;
+}
+
+void cInterruptibleBlockingTCPServer::stop(uint32_t u32DrainTimeout_ms)
+{
+    if(!m_pWorkerThreads)
+        return;
+
+    m_bStopRequested = true;
+
+    //The cancel can land just before an accept starts waiting, so repeat it until the thread has exited
+    for(uint32_t u32ShardNo = 0; u32ShardNo < m_vpShards.size(); u32ShardNo++)
+    {
+        cShard &oShard = *m_vpShards[u32ShardNo];
+
+        do
+        {
+            {
+                boost::lock_guard<boost::mutex> oLock(m_oMutex);
+                m_oSlotCondition.notify_all();
+            }
+
+            oShard.m_oAcceptor.cancelCurrrentOperations();
+        }
+        while(!oShard.m_pAcceptThread->timed_join(boost::posix_time::milliseconds(10)));
+
+        oShard.m_pAcceptThread.reset();
+        oShard.m_oAcceptor.close();
+    }
+
+    {
+        boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+        m_bWorkersExit = true;
+        m_oWorkCondition.notify_all();
+
+        //Let the workers get through what was accepted
+        boost::system_time oDeadline = boost::get_system_time() + boost::posix_time::milliseconds(u32DrainTimeout_ms);
+
+        while(!m_dqPendingConnections.empty() || !m_oActiveSockets.empty())
+        {
+            if(!u32DrainTimeout_ms)
+                m_oSlotCondition.wait(oLock);
+            else if(!m_oSlotCondition.timed_wait(oLock, oDeadline))
+                break;
+        }
+
+        //Out of time. Handlers can start another blocking call after a cancel, so repeat it until they have all returned.
+        m_bDiscardQueued = true;
+        m_oWorkCondition.notify_all();
+
+        while(!m_dqPendingConnections.empty() || !m_oActiveSockets.empty())
+        {
+            for(set<cInterruptibleBlockingTCPSocket*>::iterator it = m_oActiveSockets.begin(); it != m_oActiveSockets.end(); ++it)
+                (*it)->cancelCurrrentOperations();
+
+            m_oSlotCondition.timed_wait(oLock, boost::posix_time::milliseconds(10));
+        }
+    }
+
+    m_pWorkerThreads->join_all();
+    m_pWorkerThreads.reset();
+
+    cout << "cInterruptibleBlockingTCPServer::stop(): \"" << m_strName << "\" stopped. Handled " << m_u64NConnectionsHandled.load()
+         << " of " << m_u64NConnectionsAccepted.load() << " connections accepted, dropped " << m_u64NConnectionsDropped.load() << "." << endl;
+}
+
+bool cInterruptibleBlockingTCPServer::isRunning() const
+{
+    return m_pWorkerThreads && !m_bStopRequested;
+}
+
+void cInterruptibleBlockingTCPServer::acceptThreadFunction(cShard *pShard)
+{
+    cInterruptibleBlockingTCPAcceptor &oAcceptor = pShard->m_oAcceptor;
+
+    while(!m_bStopRequested)
+    {
+        //Leave further clients in the listen backlog while at the limit. The slot is taken before accepting.
+        {
+            boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+            while(!m_bStopRequested && m_dqPendingConnections.size() + m_oActiveSockets.size() + m_u32NAcceptsInProgress >= m_u32MaxNConnections)
+                m_oSlotCondition.wait(oLock);
+
+            if(m_bStopRequested)
+                break;
+
+            m_u32NAcceptsInProgress++;
+        }
+
+        boost::shared_ptr<cInterruptibleBlockingTCPSocket> pSocket;
+        if(m_pSharedIOService)
+            pSocket.reset(new cInterruptibleBlockingTCPSocket(*m_pSharedIOService, oAcceptor.getName()));
+        else
+            pSocket.reset(new cInterruptibleBlockingTCPSocket(oAcceptor.getName()));
+
+        string strPeerAddress;
+        if(!oAcceptor.accept(pSocket, strPeerAddress))
+        {
+            {
+                boost::lock_guard<boost::mutex> oLock(m_oMutex);
+                m_u32NAcceptsInProgress--;
+                m_oSlotCondition.notify_all();
+            }
+
+            if(m_bStopRequested)
+                break;
+
+            //E.g. out of file descriptors. Back off briefly rather than spin.
+            m_u64NAcceptErrors++;
+            cout << "cInterruptibleBlockingTCPServer::acceptThreadFunction(): \"" << oAcceptor.getName() << "\" accept failed: " << oAcceptor.getLastError().message() << endl;
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+            continue;
+        }
+
+        m_u64NConnectionsAccepted++;
+        pShard->m_u64NConnectionsAccepted++;
+
+        uint32_t u32NQueued = 0, u32Backlog = 0;
+        bool bHaveQueueLength = oAcceptor.getListenQueueLength(u32NQueued, u32Backlog);
+
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        //Sampled with the connection just accepted already taken off, so a queue at its limit was full (the kernel drops
+        //connections beyond one more than the backlog) a moment ago
+        if(bHaveQueueLength)
+        {
+            if(u32NQueued > pShard->m_u32PeakListenQueueLength)
+                pShard->m_u32PeakListenQueueLength = u32NQueued;
+
+            if(u32NQueued >= u32Backlog)
+                pShard->m_u64NTimesListenQueueFull++;
+        }
+
+        m_u32NAcceptsInProgress--;
+        m_dqPendingConnections.push_back(cPendingConnection(pSocket, strPeerAddress));
+        if(m_dqPendingConnections.size() > m_u32PeakQueueDepth)
+            m_u32PeakQueueDepth = m_dqPendingConnections.size();
+
+        updateAcceptRate(boost::posix_time::microsec_clock::universal_time());
+        m_u64NAcceptsThisInterval++;
+
+        m_oWorkCondition.notify_one();
+    }
+
+    cout << "cInterruptibleBlockingTCPServer::acceptThreadFunction(): Accept thread for \"" << oAcceptor.getName() << "\" exiting." << endl;
+}
+
+void cInterruptibleBlockingTCPServer::workerThreadFunction()
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    for(;;)
+    {
+        while(m_dqPendingConnections.empty() && !m_bWorkersExit)
+            m_oWorkCondition.wait(oLock);
+
+        if(m_dqPendingConnections.empty())
+            return;
+
+        cPendingConnection oConnection = m_dqPendingConnections.front();
+        m_dqPendingConnections.pop_front();
+
+        if(m_bDiscardQueued)
+        {
+            m_u64NConnectionsDropped++;
+            oConnection.m_pSocket->close();
+            m_oSlotCondition.notify_all();
+            continue;
+        }
+
+        m_oActiveSockets.insert(oConnection.m_pSocket.get());
+        oLock.unlock();
+
+        try
+        {
+            m_fnConnectionHandler(oConnection.m_pSocket, oConnection.m_strPeerAddress);
+        }
+        catch(std::exception &e)
+        {
+            cout << "cInterruptibleBlockingTCPServer::workerThreadFunction(): \"" << m_strName << "\" connection handler for " << oConnection.m_strPeerAddress
+                 << " threw: " << e.what() << endl;
+        }
+
+        oLock.lock();
+
+        //No longer reachable by stop()'s cancels once removed
+        m_oActiveSockets.erase(oConnection.m_pSocket.get());
+        m_u64NConnectionsHandled++;
+
+        oLock.unlock();
+        oConnection.m_pSocket->close();
+        oLock.lock();
+
+        m_oSlotCondition.notify_all();
+    }
+}
+
+void cInterruptibleBlockingTCPServer::updateAcceptRate(const boost::posix_time::ptime &oNow)
+{
+    boost::posix_time::time_duration oElapsed = oNow - m_oAcceptRateIntervalStart;
+
+    if(oElapsed < boost::posix_time::seconds(1))
+        return;
+
+    //Nothing was accepted in the last full second if more than one has passed
+    if(oElapsed < boost::posix_time::seconds(2))
+    {
+        m_u64NAcceptsLastInterval = m_u64NAcceptsThisInterval;
+        m_oAcceptRateIntervalStart += boost::posix_time::seconds(1);
+    }
+    else
+    {
+        m_u64NAcceptsLastInterval = 0;
+        m_oAcceptRateIntervalStart = oNow;
+    }
+
+    m_u64NAcceptsThisInterval = 0;
+}
+
+std::string cInterruptibleBlockingTCPServer::getName() const
+{
+    return m_strName;
+}
+
+uint16_t cInterruptibleBlockingTCPServer::getLocalPort()
+{
+    if(m_vpShards.empty() || !m_vpShards[0]->m_oAcceptor.isOpen())
+        return 0;
+
+    return m_vpShards[0]->m_oAcceptor.getLocalPort();
+}
+
+uint64_t cInterruptibleBlockingTCPServer::getNConnectionsAccepted() const
+{
+    return m_u64NConnectionsAccepted.load();
+}
+
+uint64_t cInterruptibleBlockingTCPServer::getNConnectionsHandled() const
+{
+    return m_u64NConnectionsHandled.load();
+}
+
+uint64_t cInterruptibleBlockingTCPServer::getNConnectionsDropped() const
+{
+    return m_u64NConnectionsDropped.load();
+}
+
+uint64_t cInterruptibleBlockingTCPServer::getNAcceptErrors() const
+{
+    return m_u64NAcceptErrors.load();
+}
+
+uint32_t cInterruptibleBlockingTCPServer::getNActiveConnections()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    return m_oActiveSockets.size();
+}
+
+uint32_t cInterruptibleBlockingTCPServer::getQueueDepth()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    return m_dqPendingConnections.size();
+}
+
+uint32_t cInterruptibleBlockingTCPServer::getPeakQueueDepth()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    return m_u32PeakQueueDepth;
+}
+
+double cInterruptibleBlockingTCPServer::getAcceptRate()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    updateAcceptRate(boost::posix_time::microsec_clock::universal_time());
+
+    return m_u64NAcceptsLastInterval;
+}
+
+uint32_t cInterruptibleBlockingTCPServer::getNShards()
+{
+    return m_vpShards.size();
+}
+
+cInterruptibleBlockingTCPServer::cShardStats cInterruptibleBlockingTCPServer::getShardStats(uint32_t u32ShardNo)
+{
+    cShardStats oStats;
+
+    if(u32ShardNo >= m_vpShards.size())
+        return oStats;
+
+    cShard &oShard = *m_vpShards[u32ShardNo];
+
+    oStats.m_u64NConnectionsAccepted = oShard.m_u64NConnectionsAccepted.load();
+    oShard.m_oAcceptor.getListenQueueLength(oStats.m_u32ListenQueueLength, oStats.m_u32ListenBacklog);
+
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    oStats.m_u32PeakListenQueueLength = max(oShard.m_u32PeakListenQueueLength, oStats.m_u32ListenQueueLength);
+    oStats.m_u64NTimesListenQueueFull = oShard.m_u64NTimesListenQueueFull;
+
+    return oStats;
+}
+
+uint64_t cInterruptibleBlockingTCPServer::getNListenOverflows()
+{
+    return cInterruptibleBlockingTCPAcceptor::getNSystemListenOverflows() - m_u64NListenOverflowsAtStart;
+}
@@ -0,0 +1,180 @@
+#ifndef INTERRUPTIBLE_BLOCKING_TCP_SERVER_H
+#define INTERRUPTIBLE_BLOCKING_TCP_SERVER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPAcceptor.h"
+
+//Accepts connections on a cInterruptibleBlockingTCPAcceptor and hands each one to a connection handler on a fixed pool
+//of worker threads, instead of a thread per client. Accepted connections wait in a queue until a worker is free. Once
+//the number of connections queued or being handled reaches the limit, accepting pauses and further clients wait in the
+//listen backlog.
+//
+//The handler is given the connected socket and the peer address and may use the socket's blocking calls freely. The
+//connection is closed when the handler returns.
+//
+//With several listen shards, that many acceptors listen on the port with SO_REUSEPORT, each with its own accept thread
+//and accept queue, and the kernel spreads incoming connections over them. This keeps up with connection storms that
+//would overflow a single accept queue.
+
+class cInterruptibleBlockingTCPServer
+{
+public:
+    class cShardStats
+    {
+    public:
+        cShardStats();
+
+        uint64_t                        m_u64NConnectionsAccepted;
+        //Accept queue now and its limit (Linux only, otherwise 0)
+        uint32_t                        m_u32ListenQueueLength;
+        uint32_t                        m_u32ListenBacklog;
+        //Sampled after each accept. The kernel only counts overflows machine-wide (see getNListenOverflows()), so
+        //finding the queue at its limit is the per-shard sign of them.
+        uint32_t                        m_u32PeakListenQueueLength;
+        uint64_t                        m_u64NTimesListenQueueFull;
+    };
+
+    cInterruptibleBlockingTCPServer(const std::string &strName = "");
+    //Accepted connections use the shared io_service, which the owner must keep running. See cInterruptibleBlockingTCPSocket.
+    cInterruptibleBlockingTCPServer(boost::asio::io_service &oIOService, const std::string &strName = "");
+    ~cInterruptibleBlockingTCPServer();
+
+    //Listens on the interface and port (0 picks a free port, see getLocalPort()) and starts the accept and worker threads.
+    //i32ListenBacklog is the accept queue limit of each shard (the kernel caps it at net.core.somaxconn).
+    bool                                start(const std::string &strLocalInterface, uint16_t u16Port,
+                                              const boost::function<void (const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, const std::string &strPeerAddress)> &fnConnectionHandler,
+                                              uint32_t u32NWorkerThreads = 16, uint32_t u32MaxNConnections = 1024,
+                                              uint32_t u32NListenShards = 1, int32_t i32ListenBacklog = boost::asio::socket_base::max_connections);
+    //Stops accepting, then gives the connections queued or being handled up to u32DrainTimeout_ms (0 waits indefinitely)
+    //to finish. After that, queued connections are closed unhandled and handlers still running are interrupted by
+    //cancelling their socket's operations, so handlers must return once their socket calls fail.
+    void                                stop(uint32_t u32DrainTimeout_ms = 5000);
+
+    bool                                isRunning() const;
+
+    //Some accessors
+    std::string                         getName() const;
+    uint16_t                            getLocalPort();
+
+    uint64_t                            getNConnectionsAccepted() const;
+    uint64_t                            getNConnectionsHandled() const;
+    uint64_t                            getNConnectionsDropped() const;    //Closed unhandled by stop()
+    uint64_t                            getNAcceptErrors() const;
+
+    uint32_t                            getNActiveConnections();            //Being handled
+    uint32_t                            getQueueDepth();                    //Accepted and waiting for a worker
+    uint32_t                            getPeakQueueDepth();
+    double                              getAcceptRate();                    //Connections per second over the last full second
+
+    uint32_t                            getNShards();
+    cShardStats                         getShardStats(uint32_t u32ShardNo);
+    //Connections dropped machine-wide since start() because an accept queue was full, including other programs' queues
+    uint64_t                            getNListenOverflows();
+
+private:
+    class cPendingConnection
+    {
+    public:
+        cPendingConnection(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, const std::string &strPeerAddress);
+
+        boost::shared_ptr<cInterruptibleBlockingTCPSocket> m_pSocket;
+        std::string                     m_strPeerAddress;
+    };
+
+    class cShard
+    {
+    public:
+        cShard(const std::string &strName);
+
+        cInterruptibleBlockingTCPAcceptor m_oAcceptor;
+        boost::scoped_ptr<boost::thread> m_pAcceptThread;
+
+        boost::atomic<uint64_t>         m_u64NConnectionsAccepted;
+        //Guarded by the server's lock
+        uint32_t                        m_u32PeakListenQueueLength;
+        uint64_t                        m_u64NTimesListenQueueFull;
+    };
+
+    std::vector<boost::shared_ptr<cShard> > m_vpShards;
+    uint64_t                            m_u64NListenOverflowsAtStart;
+
+    //NULL unless accepted connections use a shared io_service
+    boost::asio::io_service             *m_pSharedIOService;
+
+    boost::function<void (const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, const std::string &strPeerAddress)> m_fnConnectionHandler;
+    uint32_t                            m_u32MaxNConnections;
+
+    boost::scoped_ptr<boost::thread_group> m_pWorkerThreads;
+    boost::atomic<bool>                 m_bStopRequested;
+    //Set by stop(). Workers exit once the queue is empty, or close what is left in it unhandled after the drain timeout.
+    bool                                m_bWorkersExit;
+    bool                                m_bDiscardQueued;
+
+    std::deque<cPendingConnection>      m_dqPendingConnections;
+    //Sockets whose handlers are running, for interrupting them in stop()
+    std::set<cInterruptibleBlockingTCPSocket*> m_oActiveSockets;
+    //Slots taken by accept threads before accepting, so that shards together can't overshoot the connection limit
+    uint32_t                            m_u32NAcceptsInProgress;
+    uint32_t                            m_u32PeakQueueDepth;
+
+    //Accepts counted per one second interval for getAcceptRate()
+    boost::posix_time::ptime            m_oAcceptRateIntervalStart;
+    uint64_t                            m_u64NAcceptsThisInterval;
+    uint64_t                            m_u64NAcceptsLastInterval;
+
+    //Statistics
+    boost::atomic<uint64_t>             m_u64NConnectionsAccepted;
+    boost::atomic<uint64_t>             m_u64NConnectionsHandled;
+    boost::atomic<uint64_t>             m_u64NConnectionsDropped;
+    boost::atomic<uint64_t>             m_u64NAcceptErrors;
+
+    //Guards the queue, the active sockets, the flags, the accept rate and the shards' queue samples
+    boost::mutex                        m_oMutex;
+    //Signalled when a connection is queued (for the workers) and when one finishes (for the accept thread and stop())
+    boost::condition_variable           m_oWorkCondition;
+    boost::condition_variable           m_oSlotCondition;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+
+    void                                acceptThreadFunction(cShard *pShard);
+    void                                workerThreadFunction();
+
+    //Start a new interval if the current one is over. Called with the lock held.
+    void                                updateAcceptRate(const boost::posix_time::ptime &oNow);
+};
+
+#endif // INTERRUPTIBLE_BLOCKING_TCP_SERVER_H
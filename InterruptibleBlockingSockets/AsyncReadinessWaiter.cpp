@@ -0,0 +1,66 @@
+
+//System includes
+#include <vector>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "AsyncReadinessWaiter.h"
+
+using namespace std;
+
+cAsyncReadinessWaiter::cState::cState() :
+    m_bSocketWaitPending(false),
+    m_u64NextWaiterID(1)
+{
+}
+
+cAsyncReadinessWaiter::cAsyncReadinessWaiter() :
+    m_pState(new cState)
+{
+}
+
+bool cAsyncReadinessWaiter::addWaiter(boost::shared_ptr<cState> pState, const boost::function<void ()> &fnWake, uint64_t &u64WaiterID)
+{
+    boost::lock_guard<boost::mutex> oLock(pState->m_oMutex);
+
+    u64WaiterID = pState->m_u64NextWaiterID++;
+    pState->m_oWaiters[u64WaiterID] = fnWake;
+
+    //A wait left by an operation that was stopped serves this one too
+    if(pState->m_bSocketWaitPending)
+        return false;
+
+    pState->m_bSocketWaitPending = true;
+    return true;
+}
+
+void cAsyncReadinessWaiter::removeWaiter(boost::shared_ptr<cState> pState, uint64_t u64WaiterID)
+{
+    boost::lock_guard<boost::mutex> oLock(pState->m_oMutex);
+
+    pState->m_oWaiters.erase(u64WaiterID);
+}
+
+void cAsyncReadinessWaiter::callback_ready(boost::shared_ptr<cState> pState)
+{
+    vector<boost::function<void ()> > vfnWake;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(pState->m_oMutex);
+
+        pState->m_bSocketWaitPending = false;
+
+        for(map<uint64_t, boost::function<void ()> >::iterator it = pState->m_oWaiters.begin(); it != pState->m_oWaiters.end(); ++it)
+            vfnWake.push_back(it->second);
+
+        //Each operation woken tries its system call again and waits anew if the socket still isn't ready
+        pState->m_oWaiters.clear();
+    }
+
+    for(uint32_t u32Index = 0; u32Index < vfnWake.size(); u32Index++)
+        vfnWake[u32Index]();
+}
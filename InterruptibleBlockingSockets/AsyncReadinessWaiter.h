@@ -0,0 +1,122 @@
+#ifndef ASYNC_READINESS_WAITER_H
+#define ASYNC_READINESS_WAITER_H
+
+//Readiness waits for the coroutine operations of the socket classes, one waiter per socket and direction. An operation
+//whose non-blocking system call would block waits here until the socket may be ready, then tries again (and waits
+//again if it still isn't), or until its cAwaitableDeadline stops it.
+//
+//All operations waiting in the same direction share a single wait on the socket. A deadline only ends its own
+//operation's wait and leaves the wait on the socket in place for the others (and the next operation), so a timeout or
+//cancellation token never aborts other operations on the socket the way cancelling the socket would.
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <map>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+//Local includes
+#include "AwaitableDeadline.h"
+
+class cAsyncReadinessWaiter
+{
+public:
+    cAsyncReadinessWaiter();
+
+    //Completes with no error once the socket (or acceptor) may be ready, otherwise with oDeadline's stop error. Wait
+    //errors on the socket also just end the wait: the caller's next system call reports them.
+    template<typename tSocket, typename tCompletionToken>
+    BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code))
+                                    asyncWait(tSocket &oSocket, boost::asio::socket_base::wait_type eWaitType, cAwaitableDeadline &oDeadline,
+                                              BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken)
+    {
+        return boost::asio::async_compose<tCompletionToken, void(boost::system::error_code)>(
+                    cWaitOperation<tSocket>(m_pState, oSocket, eWaitType, oDeadline), oToken);
+    }
+
+private:
+    //Shared with the wait on the socket, which may complete after the socket is gone
+    class cState
+    {
+    public:
+        cState();
+
+        boost::mutex                    m_oMutex;
+        bool                            m_bSocketWaitPending;
+        //Wake functions (see cAwaitableDeadline) of the operations waiting
+        uint64_t                        m_u64NextWaiterID;
+        std::map<uint64_t, boost::function<void ()> > m_oWaiters;
+    };
+
+    template<typename tSocket>
+    class cWaitOperation
+    {
+    public:
+        cWaitOperation(const boost::shared_ptr<cState> &pState, tSocket &oSocket, boost::asio::socket_base::wait_type eWaitType, cAwaitableDeadline &oDeadline) :
+            m_pState(pState),
+            m_pSocket(&oSocket),
+            m_eWaitType(eWaitType),
+            m_pDeadline(&oDeadline),
+            m_u64WaiterID(0)
+        {
+        }
+
+        template<typename tSelf>
+        void operator()(tSelf &oSelf)
+        {
+            if(addWaiter(m_pState, m_pDeadline->getWakeFunction(), m_u64WaiterID))
+                m_pSocket->async_wait(m_eWaitType, boost::bind(&cAsyncReadinessWaiter::callback_ready, m_pState));
+
+            m_pDeadline->asyncWaitForWake(BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+        }
+
+        template<typename tSelf>
+        void operator()(tSelf &oSelf, const boost::system::error_code &oWakeError)
+        {
+            (void)oWakeError;
+
+            removeWaiter(m_pState, m_u64WaiterID);
+            oSelf.complete(m_pDeadline->getStopError());
+        }
+
+    private:
+        boost::shared_ptr<cState>       m_pState;
+        tSocket                         *m_pSocket;
+        boost::asio::socket_base::wait_type m_eWaitType;
+        cAwaitableDeadline              *m_pDeadline;
+        uint64_t                        m_u64WaiterID;
+    };
+
+    boost::shared_ptr<cState>       m_pState;
+
+    //Not copyable
+    cAsyncReadinessWaiter(const cAsyncReadinessWaiter &oOther);
+    cAsyncReadinessWaiter& operator=(const cAsyncReadinessWaiter &oOther);
+
+    //addWaiter() returns true if the caller has to start the wait on the socket
+    static bool                     addWaiter(boost::shared_ptr<cState> pState, const boost::function<void ()> &fnWake, uint64_t &u64WaiterID);
+    static void                     removeWaiter(boost::shared_ptr<cState> pState, uint64_t u64WaiterID);
+    //Wakes every operation waiting
+    static void                     callback_ready(boost::shared_ptr<cState> pState);
+};
+
+#endif // ASYNC_READINESS_WAITER_H
@@ -0,0 +1,135 @@
+
+//System includes
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio/post.hpp>
+#endif
+
+//Local includes
+#include "AwaitableDeadline.h"
+
+using namespace std;
+
+cAwaitableDeadline::cState::cState(const boost::asio::any_io_executor &oExecutor) :
+    m_oExecutor(oExecutor),
+    m_oTimer(oExecutor),
+    m_oWakeTimer(oExecutor),
+    m_bDone(false),
+    m_bTimedOut(false),
+    m_bCancelled(false)
+{
+}
+
+cAwaitableDeadline::cAwaitableDeadline(const boost::asio::any_io_executor &oExecutor, uint32_t u32Timeout_ms, cCancellationToken *pToken) :
+    m_pState(new cState(oExecutor)),
+    m_pToken(pToken),
+    m_u64TokenHandlerID(0)
+{
+    if(m_pToken)
+    {
+        m_u64TokenHandlerID = m_pToken->addHandler(boost::bind(&cAwaitableDeadline::callback_tokenCancelled, m_pState));
+
+        //Cancelled already. Nothing to arm.
+        if(!m_u64TokenHandlerID)
+        {
+            m_pState->m_bCancelled = true;
+            return;
+        }
+    }
+
+    if(u32Timeout_ms)
+    {
+        m_pState->m_oTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
+        m_pState->m_oTimer.async_wait(boost::bind(&cAwaitableDeadline::callback_timeOut, m_pState, boost::asio::placeholders::error));
+    }
+}
+
+cAwaitableDeadline::~cAwaitableDeadline()
+{
+    //Handlers still queued find the operation done and leave it alone
+    m_pState->m_bDone = true;
+
+    if(m_u64TokenHandlerID)
+        m_pToken->removeHandler(m_u64TokenHandlerID);
+
+    boost::system::error_code oError;
+    m_pState->m_oTimer.cancel(oError);
+    m_pState->m_oWakeTimer.cancel(oError);
+}
+
+void cAwaitableDeadline::setCancelFunction(const boost::function<void ()> &fnCancel)
+{
+    m_pState->m_fnCancel = fnCancel;
+}
+
+boost::function<void ()> cAwaitableDeadline::getWakeFunction() const
+{
+    return boost::bind(&cAwaitableDeadline::callback_wake, m_pState);
+}
+
+boost::system::error_code cAwaitableDeadline::getStopError() const
+{
+    if(m_pState->m_bCancelled)
+        return boost::asio::error::operation_aborted;
+
+    if(m_pState->m_bTimedOut)
+        return boost::asio::error::timed_out;
+
+    return boost::system::error_code();
+}
+
+boost::system::error_code cAwaitableDeadline::getError(const boost::system::error_code &oError) const
+{
+    //A step that completed before the cancel took effect still counts, as do genuine errors
+    if(oError != boost::asio::error::operation_aborted)
+        return oError;
+
+    boost::system::error_code oStopError = getStopError();
+
+    return oStopError ? oStopError : oError;
+}
+
+void cAwaitableDeadline::callback_timeOut(boost::shared_ptr<cState> pState, const boost::system::error_code &oError)
+{
+    if(oError || pState->m_bDone)
+        return;
+
+    pState->m_bTimedOut = true;
+    cancelOperation(pState);
+}
+
+void cAwaitableDeadline::callback_tokenCancelled(boost::shared_ptr<cState> pState)
+{
+    pState->m_bCancelled = true;
+
+    //The operation may only be touched from the coroutine's executor
+    boost::asio::post(pState->m_oExecutor, boost::bind(&cAwaitableDeadline::cancelOperation, pState));
+}
+
+void cAwaitableDeadline::cancelOperation(boost::shared_ptr<cState> pState)
+{
+    if(pState->m_bDone)
+        return;
+
+    wakeOperation(pState);
+
+    if(pState->m_fnCancel)
+        pState->m_fnCancel();
+}
+
+void cAwaitableDeadline::callback_wake(boost::shared_ptr<cState> pState)
+{
+    boost::asio::post(pState->m_oExecutor, boost::bind(&cAwaitableDeadline::wakeOperation, pState));
+}
+
+void cAwaitableDeadline::wakeOperation(boost::shared_ptr<cState> pState)
+{
+    if(pState->m_bDone)
+        return;
+
+    boost::system::error_code oError;
+    pState->m_oWakeTimer.cancel(oError);
+}
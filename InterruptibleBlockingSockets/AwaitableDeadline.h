@@ -0,0 +1,113 @@
+#ifndef AWAITABLE_DEADLINE_H
+#define AWAITABLE_DEADLINE_H
+
+//Timeout and cancellation for the coroutine operations of the socket classes (asyncRead() etc.), the counterpart of
+//cBlockingOperationWaiter for the blocking calls. Created by an operation before it awaits the socket and destroyed
+//once it is done. When the timeout expires, or the cancellation token is cancelled from any thread, the operation is
+//stopped on the coroutine's executor: its wait in asyncWaitForWake() (see cAsyncReadinessWaiter) ends, and the cancel
+//function, if one is set, is run for steps that await an object of their own (e.g. a resolver). Nothing shared with
+//other operations is cancelled, so only this one ends. getStopError() / getError() then give the error to report
+//(timed_out for the timeout). Boost.Asio only has per-operation cancellation slots from 1.77 on.
+//
+//The timer handler and the coroutine must not run concurrently: spawn the coroutine on a strand if the io_service is
+//run by several threads.
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#endif
+
+//Local includes
+#include "CancellationToken.h"
+
+class cAwaitableDeadline
+{
+public:
+    //A timeout of 0 and / or a NULL token disable each
+    cAwaitableDeadline(const boost::asio::any_io_executor &oExecutor, uint32_t u32Timeout_ms, cCancellationToken *pToken);
+    ~cAwaitableDeadline();
+
+    //For a step that awaits an object only it uses (e.g. resolve, or connect before anything else can use the socket).
+    //Cleared with an empty function once the step is done.
+    void                            setCancelFunction(const boost::function<void ()> &fnCancel);
+
+    //Completes once the function from getWakeFunction() has been called, or at once if this has stopped. The handler's
+    //error means nothing: check getStopError(). One wait at a time.
+    template<typename tHandler>
+    void                            asyncWaitForWake(BOOST_ASIO_MOVE_ARG(tHandler) oHandler)
+    {
+        m_pState->m_oWakeTimer.expires_at(boost::posix_time::pos_infin);
+        m_pState->m_oWakeTimer.async_wait(BOOST_ASIO_MOVE_CAST(tHandler)(oHandler));
+
+        //Stopped before the wait started. Nothing else would end it.
+        if(getStopError())
+            wakeOperation(m_pState);
+    }
+
+    //May be called from any thread, also after this is gone
+    boost::function<void ()>        getWakeFunction() const;
+
+    //operation_aborted once the token is cancelled (also before the operation started), timed_out once the timeout has
+    //expired, otherwise no error. Checked before each step: a stop between steps has nothing to cancel.
+    boost::system::error_code       getStopError() const;
+
+    //The error to report for a step that finished with oError: timed_out / operation_aborted if this stopped it
+    boost::system::error_code       getError(const boost::system::error_code &oError) const;
+
+private:
+    //Shared with the timer and token handlers, which may run after the operation is done
+    class cState
+    {
+    public:
+        cState(const boost::asio::any_io_executor &oExecutor);
+
+        boost::asio::any_io_executor    m_oExecutor;
+        boost::asio::deadline_timer     m_oTimer;
+        //Never expires. Cancelled to end the wait in asyncWaitForWake().
+        boost::asio::deadline_timer     m_oWakeTimer;
+        boost::function<void ()>        m_fnCancel;
+
+        boost::atomic<bool>             m_bDone;
+        boost::atomic<bool>             m_bTimedOut;
+        boost::atomic<bool>             m_bCancelled;
+    };
+
+    boost::shared_ptr<cState>       m_pState;
+
+    cCancellationToken              *m_pToken;
+    uint64_t                        m_u64TokenHandlerID;
+
+    //Not copyable
+    cAwaitableDeadline(const cAwaitableDeadline &oOther);
+    cAwaitableDeadline& operator=(const cAwaitableDeadline &oOther);
+
+    static void                     callback_timeOut(boost::shared_ptr<cState> pState, const boost::system::error_code &oError);
+    //Called by the token on the cancelling thread. Passes the cancel on to the executor.
+    static void                     callback_tokenCancelled(boost::shared_ptr<cState> pState);
+    static void                     cancelOperation(boost::shared_ptr<cState> pState);
+    //Passes a wake on to the executor, where wakeOperation() ends the wait
+    static void                     callback_wake(boost::shared_ptr<cState> pState);
+    static void                     wakeOperation(boost::shared_ptr<cState> pState);
+};
+
+#endif // AWAITABLE_DEADLINE_H
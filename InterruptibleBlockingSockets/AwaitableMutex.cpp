@@ -0,0 +1,84 @@
+//System includes
+#include <vector>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "AwaitableMutex.h"
+
+using namespace std;
+
+cAwaitableMutex::cAwaitableMutex() :
+    m_bLocked(false),
+    m_u64NextWaiterID(1)
+{
+}
+
+void cAwaitableMutex::lock()
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    while(m_bLocked)
+        m_oCondition.wait(oLock);
+
+    m_bLocked = true;
+}
+
+bool cAwaitableMutex::try_lock()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    if(m_bLocked)
+        return false;
+
+    m_bLocked = true;
+    return true;
+}
+
+void cAwaitableMutex::unlock()
+{
+    vector<boost::function<void ()> > vfnWake;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        m_bLocked = false;
+
+        for(map<uint64_t, boost::function<void ()> >::iterator it = m_oWaiters.begin(); it != m_oWaiters.end(); ++it)
+            vfnWake.push_back(it->second);
+
+        //Each coroutine call woken tries again and waits anew if another call has taken the mutex first
+        m_oWaiters.clear();
+    }
+
+    m_oCondition.notify_one();
+
+    for(uint32_t u32Index = 0; u32Index < vfnWake.size(); u32Index++)
+        vfnWake[u32Index]();
+}
+
+bool cAwaitableMutex::tryLockOrAddWaiter(const boost::function<void ()> &fnWake, uint64_t &u64WaiterID)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    if(!m_bLocked)
+    {
+        m_bLocked = true;
+        return true;
+    }
+
+    u64WaiterID = m_u64NextWaiterID++;
+    m_oWaiters[u64WaiterID] = fnWake;
+
+    return false;
+}
+
+void cAwaitableMutex::removeWaiter(uint64_t u64WaiterID)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_oWaiters.erase(u64WaiterID);
+}
@@ -0,0 +1,143 @@
+#ifndef AWAITABLE_MUTEX_H
+#define AWAITABLE_MUTEX_H
+
+//A mutex the blocking calls and the coroutine calls of a socket share, one per direction, so that both are serialised
+//the way the blocking calls alone were by a boost::mutex. The blocking calls take it with lock() (it is Lockable, for
+//boost::unique_lock). A coroutine call awaits asyncLock() and holds it across its awaits without blocking its thread:
+//it waits like for the socket (see cAsyncReadinessWaiter), woken whenever the mutex is released, and its
+//cAwaitableDeadline can end the wait.
+//
+//Not recursive. A blocking call waiting for a coroutine call in the same direction blocks its thread, so don't make
+//blocking calls from the threads running the io_service while a coroutine call may hold the mutex: it may need that
+//thread to finish.
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <map>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+//Local includes
+#include "AwaitableDeadline.h"
+
+class cAwaitableMutex
+{
+public:
+    cAwaitableMutex();
+
+    void                            lock();
+    bool                            try_lock();
+    void                            unlock();
+
+    //Completes with no error once the mutex is held (release it with unlock()), otherwise with oDeadline's stop error
+    template<typename tCompletionToken>
+    BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code))
+                                    asyncLock(cAwaitableDeadline &oDeadline, BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken)
+    {
+        return boost::asio::async_compose<tCompletionToken, void(boost::system::error_code)>(cLockOperation(this, oDeadline), oToken);
+    }
+
+private:
+    boost::mutex                    m_oMutex;
+    boost::condition_variable       m_oCondition;
+    bool                            m_bLocked;
+    //Wake functions (see cAwaitableDeadline) of the coroutine calls waiting
+    uint64_t                        m_u64NextWaiterID;
+    std::map<uint64_t, boost::function<void ()> > m_oWaiters;
+
+    class cLockOperation
+    {
+    public:
+        cLockOperation(cAwaitableMutex *pMutex, cAwaitableDeadline &oDeadline) :
+            m_pMutex(pMutex),
+            m_pDeadline(&oDeadline),
+            m_u64WaiterID(0),
+            m_bSuspended(false),
+            m_bCompleting(false)
+        {
+        }
+
+        template<typename tSelf>
+        void operator()(tSelf &oSelf)
+        {
+            //The completion posted by resume()
+            if(m_bCompleting)
+            {
+                oSelf.complete(m_oError);
+                return;
+            }
+
+            resume(oSelf);
+        }
+
+        template<typename tSelf>
+        void operator()(tSelf &oSelf, const boost::system::error_code &oWakeError)
+        {
+            (void)oWakeError;
+
+            m_bSuspended = true;
+            m_pMutex->removeWaiter(m_u64WaiterID);
+
+            resume(oSelf);
+        }
+
+    private:
+        cAwaitableMutex                 *m_pMutex;
+        cAwaitableDeadline              *m_pDeadline;
+        uint64_t                        m_u64WaiterID;
+        boost::system::error_code       m_oError;
+        bool                            m_bSuspended;
+        bool                            m_bCompleting;
+
+        template<typename tSelf>
+        void resume(tSelf &oSelf)
+        {
+            m_oError = m_pDeadline->getStopError();
+
+            //Tries again each time the mutex is released, as another call may have taken it first
+            if(!m_oError && !m_pMutex->tryLockOrAddWaiter(m_pDeadline->getWakeFunction(), m_u64WaiterID))
+            {
+                m_pDeadline->asyncWaitForWake(BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+                return;
+            }
+
+            //An awaited operation must not complete inside the call that started it
+            if(!m_bSuspended)
+            {
+                m_bCompleting = true;
+                boost::asio::post(BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+                return;
+            }
+
+            oSelf.complete(m_oError);
+        }
+    };
+
+    //Not copyable
+    cAwaitableMutex(const cAwaitableMutex &oOther);
+    cAwaitableMutex& operator=(const cAwaitableMutex &oOther);
+
+    //Takes the mutex if free, otherwise registers fnWake to be called when it is released and returns false
+    bool                            tryLockOrAddWaiter(const boost::function<void ()> &fnWake, uint64_t &u64WaiterID);
+    void                            removeWaiter(uint64_t u64WaiterID);
+};
+
+#endif // AWAITABLE_MUTEX_H
@@ -0,0 +1,104 @@
+
+//System includes
+
+//Library includes
+
+//Local includes
+#include "BlockingOperationWaiter.h"
+
+using namespace std;
+
+cBlockingOperationWaiter::cBlockingOperationWaiter(boost::asio::io_service &oIOService, bool bSharedIOService, const boost::function<void()> &fnCancelOperations) :
+    m_oIOService(oIOService),
+    m_bSharedIOService(bSharedIOService),
+    m_fnCancelOperations(fnCancelOperations),
+    m_u32NPendingHandlers(0),
+    m_u32CancelCount(0),
+    m_u32CancelCountAtBegin(0)
+{
+}
+
+void cBlockingOperationWaiter::begin()
+{
+    if(!m_bSharedIOService)
+    {
+        m_oIOService.reset();
+
+        //An operation interrupted by cancel() (which stops the io_service) leaves its aborted handlers queued.
+        //Run them now, otherwise they run during the next operation and cancel its timer. poll() leaves the io_service stopped again.
+        m_oIOService.poll();
+        m_oIOService.reset();
+    }
+
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    m_u32NPendingHandlers = 0;
+    m_dqCompletedHandlers.clear();
+    m_u32CancelCountAtBegin = m_u32CancelCount.load();
+}
+
+void cBlockingOperationWaiter::wait()
+{
+    if(!m_bSharedIOService)
+    {
+        // This will block until all handlers have run
+        // or until it is cancelled.
+        m_oIOService.run();
+        return;
+    }
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    bool bCancelRepeated = false;
+
+    while(m_u32NPendingHandlers)
+    {
+        if(!m_dqCompletedHandlers.empty())
+        {
+            boost::function<void()> fnBoundHandler = m_dqCompletedHandlers.front();
+            m_dqCompletedHandlers.pop_front();
+
+            oLock.unlock();
+            fnBoundHandler();
+            oLock.lock();
+
+            m_u32NPendingHandlers--;
+            continue;
+        }
+
+        //A cancel between begin() and the operations starting found nothing to abort. Now they have started.
+        if(!bCancelRepeated && m_u32CancelCount.load() != m_u32CancelCountAtBegin)
+        {
+            bCancelRepeated = true;
+
+            oLock.unlock();
+            m_fnCancelOperations();
+            oLock.lock();
+
+            continue;
+        }
+
+        m_oCondition.wait(oLock);
+    }
+}
+
+void cBlockingOperationWaiter::cancel()
+{
+    m_u32CancelCount++;
+
+    if(!m_bSharedIOService)
+        m_oIOService.stop();
+
+    m_fnCancelOperations();
+}
+
+bool cBlockingOperationWaiter::isIOServiceShared() const
+{
+    return m_bSharedIOService;
+}
+
+void cBlockingOperationWaiter::handlerComplete(const boost::function<void()> &fnBoundHandler)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_dqCompletedHandlers.push_back(fnBoundHandler);
+    m_oCondition.notify_all();
+}
@@ -0,0 +1,162 @@
+#ifndef BLOCKING_OPERATION_WAITER_H
+#define BLOCKING_OPERATION_WAITER_H
+
+//Turns asynchronous operations on an io_service into a blocking call for the socket classes.
+//
+//With a private io_service (the default for each socket) the calling thread runs the io_service itself until the
+//handlers are done, and a cancel stops it. With a shared io_service (see the socket constructors taking one) the
+//io_service is run by its owner's threads, and a cancel aborts the operation instead of stopping an io_service other
+//sockets are using. The wrapped handlers are then queued by those threads and run by the caller in wait(), so that the
+//socket and its timers are still only used by one thread (an operation can complete before the caller has even set up
+//its timeout).
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+#else
+#include <inttypes.h>
+#endif
+
+#include <deque>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/io_service.hpp>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+//Local includes
+
+class cBlockingOperationWaiter
+{
+public:
+    //A handler with its completion arguments, for running later by wait()
+    template<typename tHandler>
+    class cBoundHandler
+    {
+    public:
+        cBoundHandler(const tHandler &oHandler, const boost::system::error_code &oError) :
+            m_oHandler(oHandler),
+            m_oError(oError)
+        {
+        }
+
+        void operator()()
+        {
+            m_oHandler(m_oError);
+        }
+
+    private:
+        tHandler                    m_oHandler;
+        boost::system::error_code   m_oError;
+    };
+
+    template<typename tHandler, typename tArgument>
+    class cBoundHandlerWithArgument
+    {
+    public:
+        cBoundHandlerWithArgument(const tHandler &oHandler, const boost::system::error_code &oError, const tArgument &oArgument) :
+            m_oHandler(oHandler),
+            m_oError(oError),
+            m_oArgument(oArgument)
+        {
+        }
+
+        void operator()()
+        {
+            m_oHandler(m_oError, m_oArgument);
+        }
+
+    private:
+        tHandler                    m_oHandler;
+        boost::system::error_code   m_oError;
+        tArgument                   m_oArgument;
+    };
+
+    //Runs the wrapped handler (or with a shared io_service queues it for wait()) and counts it as done
+    template<typename tHandler>
+    class cCountedHandler
+    {
+    public:
+        cCountedHandler(const tHandler &oHandler, cBlockingOperationWaiter *pWaiter) :
+            m_oHandler(oHandler),
+            m_pWaiter(pWaiter)
+        {
+        }
+
+        void operator()(const boost::system::error_code &oError)
+        {
+            if(m_pWaiter->isIOServiceShared())
+            {
+                m_pWaiter->handlerComplete(cBoundHandler<tHandler>(m_oHandler, oError));
+                return;
+            }
+
+            m_oHandler(oError);
+        }
+
+        template<typename tArgument>
+        void operator()(const boost::system::error_code &oError, const tArgument &oArgument)
+        {
+            if(m_pWaiter->isIOServiceShared())
+            {
+                m_pWaiter->handlerComplete(cBoundHandlerWithArgument<tHandler, tArgument>(m_oHandler, oError, oArgument));
+                return;
+            }
+
+            m_oHandler(oError, oArgument);
+        }
+
+    private:
+        tHandler                    m_oHandler;
+        cBlockingOperationWaiter    *m_pWaiter;
+    };
+
+    //fnCancelOperations aborts the operations using the io_service (cancel the socket and its timers). It is called by
+    //cancel() and, with a shared io_service, again by wait() in case the cancel came before the operations started.
+    cBlockingOperationWaiter(boost::asio::io_service &oIOService, bool bSharedIOService, const boost::function<void()> &fnCancelOperations);
+
+    //Call before starting the operations of each blocking call
+    void                            begin();
+
+    //Wrap every completion handler of the blocking call, including those of timers. With a private io_service the
+    //handler is run as it is.
+    template<typename tHandler>
+    cCountedHandler<tHandler>       wrap(const tHandler &oHandler)
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+        m_u32NPendingHandlers++;
+
+        return cCountedHandler<tHandler>(oHandler, this);
+    }
+
+    //Blocks until all wrapped handlers have run, or with a private io_service until it is stopped by cancel().
+    //With a shared io_service the handlers are run here, on the calling thread.
+    void                            wait();
+
+    //Interrupt a blocking call in progress on another thread
+    void                            cancel();
+
+    bool                            isIOServiceShared() const;
+
+private:
+    boost::asio::io_service         &m_oIOService;
+    bool                            m_bSharedIOService;
+    boost::function<void()>         m_fnCancelOperations;
+
+    //Handlers wrapped but not run yet, and those completed but waiting for wait(). Only used with a shared io_service.
+    uint32_t                        m_u32NPendingHandlers;
+    std::deque<boost::function<void()> > m_dqCompletedHandlers;
+    boost::atomic<uint32_t>         m_u32CancelCount;
+    uint32_t                        m_u32CancelCountAtBegin;
+    boost::mutex                    m_oMutex;
+    boost::condition_variable       m_oCondition;
+
+    void                            handlerComplete(const boost::function<void()> &fnBoundHandler);
+};
+
+#endif // BLOCKING_OPERATION_WAITER_H
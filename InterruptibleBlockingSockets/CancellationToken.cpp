@@ -0,0 +1,67 @@
+
+//System includes
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "CancellationToken.h"
+
+using namespace std;
+
+cCancellationToken::cCancellationToken() :
+    m_bCancelled(false),
+    m_u64NextHandlerID(1)
+{
+}
+
+void cCancellationToken::cancel()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    if(m_bCancelled)
+        return;
+
+    m_bCancelled = true;
+
+    for(map<uint64_t, boost::function<void ()> >::iterator it = m_oHandlers.begin(); it != m_oHandlers.end(); ++it)
+        it->second();
+
+    m_oHandlers.clear();
+}
+
+bool cCancellationToken::isCancelled()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    return m_bCancelled;
+}
+
+void cCancellationToken::reset()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_bCancelled = false;
+}
+
+uint64_t cCancellationToken::addHandler(const boost::function<void ()> &fnCancel)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    if(m_bCancelled)
+        return 0;
+
+    uint64_t u64HandlerID = m_u64NextHandlerID++;
+    m_oHandlers[u64HandlerID] = fnCancel;
+
+    return u64HandlerID;
+}
+
+void cCancellationToken::removeHandler(uint64_t u64HandlerID)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_oHandlers.erase(u64HandlerID);
+}
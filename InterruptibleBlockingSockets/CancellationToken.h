@@ -0,0 +1,58 @@
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+//Cancels the coroutine operations of the socket classes (asyncRead() etc.) it is passed to. cancel() may be called from
+//any thread and aborts every operation in progress with the token, as well as any started with it afterwards, with
+//operation_aborted. One token can be shared by all the operations of a request or a session. reset() makes it usable
+//again.
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <map>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+//Local includes
+
+class cCancellationToken
+{
+public:
+    cCancellationToken();
+
+    void                            cancel();
+    bool                            isCancelled();
+    void                            reset();
+
+    //For the operations: fnCancel is called (once, from the thread calling cancel()) if the token is cancelled before
+    //the handler is removed. Returns 0 without adding it if the token is cancelled already.
+    uint64_t                        addHandler(const boost::function<void ()> &fnCancel);
+    void                            removeHandler(uint64_t u64HandlerID);
+
+private:
+    bool                            m_bCancelled;
+    uint64_t                        m_u64NextHandlerID;
+    std::map<uint64_t, boost::function<void ()> > m_oHandlers;
+
+    //Handlers are called with the lock held so that once removeHandler() returns its handler can't be running
+    boost::mutex                    m_oMutex;
+};
+
+#endif // CANCELLATION_TOKEN_H
@@ -0,0 +1,220 @@
+
+//System includes
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "EndpointResolverCache.h"
+
+using namespace std;
+
+//Default lifetimes. DNS TTLs aren't available through getaddrinfo() so use fixed values.
+static const uint32_t DEFAULT_POSITIVE_TTL_MS = 60000;
+static const uint32_t DEFAULT_NEGATIVE_TTL_MS = 5000;
+
+//Bound the memory used if many distinct names are resolved
+static const uint32_t MAX_ENTRIES = 4096;
+
+//Threads stuck on an unresponsive DNS server shouldn't pile up, so only this many names are looked up at once
+static const uint32_t MAX_LOOKUP_THREADS = 4;
+
+cEndpointResolverCache::cLookup::cLookup() :
+    m_bDone(false)
+{
+}
+
+cEndpointResolverCache::cEndpointResolverCache() :
+    m_u32NLookupThreads(0),
+    m_u32PositiveTTL_ms(DEFAULT_POSITIVE_TTL_MS),
+    m_u32NegativeTTL_ms(DEFAULT_NEGATIVE_TTL_MS)
+{
+}
+
+cEndpointResolverCache& cEndpointResolverCache::getInstance()
+{
+    //Never destroyed, as a lookup thread may still be running at exit
+    static cEndpointResolverCache *pInstance = new cEndpointResolverCache;
+    return *pInstance;
+}
+
+bool cEndpointResolverCache::parseNumericAddress(const string &strHost, boost::asio::ip::address &oAddress)
+{
+    boost::system::error_code oEC;
+    boost::asio::ip::address_v4 oAddressV4 = boost::asio::ip::address_v4::from_string(strHost, oEC);
+
+    if(oEC)
+        return false;
+
+    oAddress = oAddressV4;
+    return true;
+}
+
+bool cEndpointResolverCache::find(const string &strHost, boost::asio::ip::address &oAddress, boost::system::error_code &oError)
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    map<string, cEntry>::iterator it = m_oEntries.find(strHost);
+
+    if(it == m_oEntries.end())
+        return false;
+
+    if(it->second.m_oExpiryTime <= boost::posix_time::microsec_clock::universal_time())
+    {
+        m_oEntries.erase(it);
+        return false;
+    }
+
+    oError = it->second.m_oError;
+    if(!oError)
+        oAddress = it->second.m_oAddress;
+
+    return true;
+}
+
+void cEndpointResolverCache::insert(const string &strHost, const boost::asio::ip::address &oAddress)
+{
+    cEntry oEntry;
+    oEntry.m_oAddress = oAddress;
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    oEntry.m_oExpiryTime = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(m_u32PositiveTTL_ms);
+    store(strHost, oEntry);
+}
+
+void cEndpointResolverCache::insertFailure(const string &strHost, const boost::system::error_code &oError)
+{
+    cEntry oEntry;
+    oEntry.m_oError = oError;
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    oEntry.m_oExpiryTime = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(m_u32NegativeTTL_ms);
+    store(strHost, oEntry);
+}
+
+boost::shared_ptr<cEndpointResolverCache::cLookup> cEndpointResolverCache::startLookup(const string &strHost)
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    map<string, boost::shared_ptr<cLookup> >::iterator it = m_oLookups.find(strHost);
+
+    if(it != m_oLookups.end())
+        return it->second;
+
+    boost::shared_ptr<cLookup> pLookup(new cLookup);
+    m_oLookups[strHost] = pLookup;
+    m_dqQueuedLookups.push_back(strHost);
+
+    if(m_u32NLookupThreads < MAX_LOOKUP_THREADS)
+    {
+        boost::thread oLookupThread(boost::bind(&cEndpointResolverCache::lookupThreadFunction, this));
+        oLookupThread.detach();
+
+        m_u32NLookupThreads++;
+    }
+
+    return pLookup;
+}
+
+void cEndpointResolverCache::lookupThreadFunction()
+{
+    boost::asio::io_service oIOService;
+    boost::asio::ip::tcp::resolver oResolver(oIOService);
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    //Serve queued names until there are none left
+    while(!m_dqQueuedLookups.empty())
+    {
+        string strHost = m_dqQueuedLookups.front();
+        m_dqQueuedLookups.pop_front();
+
+        oLock.unlock();
+
+        //Same query as the socket classes have always used. The port is filled in by the caller.
+        boost::system::error_code oError;
+        boost::asio::ip::tcp::resolver::iterator oIterator = oResolver.resolve(boost::asio::ip::tcp::resolver::query(boost::asio::ip::tcp::v4(), strHost, "0"), oError);
+
+        boost::asio::ip::address oAddress;
+
+        if(!oError && oIterator == boost::asio::ip::tcp::resolver::iterator())
+            oError = boost::asio::error::host_not_found;
+        else if(!oError)
+            oAddress = oIterator->endpoint().address();
+
+        oLock.lock();
+
+        //Cached in the same step as the lookup is retired, so that a caller finds one or the other. Also cached if
+        //every caller has given up, so that their next attempt is answered straight away.
+        cEntry oEntry;
+        oEntry.m_oAddress = oAddress;
+        oEntry.m_oError = oError;
+        oEntry.m_oExpiryTime = boost::posix_time::microsec_clock::universal_time()
+                + boost::posix_time::milliseconds(oError ? m_u32NegativeTTL_ms : m_u32PositiveTTL_ms);
+        store(strHost, oEntry);
+
+        boost::shared_ptr<cLookup> pLookup = m_oLookups[strHost];
+        m_oLookups.erase(strHost);
+
+        oLock.unlock();
+
+        {
+            boost::lock_guard<boost::mutex> oLookupLock(pLookup->m_oMutex);
+            pLookup->m_oAddress = oAddress;
+            pLookup->m_oError = oError;
+            pLookup->m_bDone = true;
+            pLookup->m_oCondition.notify_all();
+        }
+
+        oLock.lock();
+    }
+
+    m_u32NLookupThreads--;
+}
+
+void cEndpointResolverCache::store(const string &strHost, const cEntry &oEntry)
+{
+    //Caller holds the mutex
+
+    if(m_oEntries.size() >= MAX_ENTRIES && m_oEntries.find(strHost) == m_oEntries.end())
+    {
+        //Make room by dropping expired entries, or everything if that isn't enough
+        boost::posix_time::ptime oNow = boost::posix_time::microsec_clock::universal_time();
+
+        for(map<string, cEntry>::iterator it = m_oEntries.begin(); it != m_oEntries.end(); )
+        {
+            if(it->second.m_oExpiryTime <= oNow)
+                m_oEntries.erase(it++);
+            else
+                ++it;
+        }
+
+        if(m_oEntries.size() >= MAX_ENTRIES)
+            m_oEntries.clear();
+    }
+
+    m_oEntries[strHost] = oEntry;
+}
+
+void cEndpointResolverCache::setTTLs(uint32_t u32PositiveTTL_ms, uint32_t u32NegativeTTL_ms)
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    m_u32PositiveTTL_ms = u32PositiveTTL_ms;
+    m_u32NegativeTTL_ms = u32NegativeTTL_ms;
+}
+
+void cEndpointResolverCache::clear()
+{
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    m_oEntries.clear();
+}
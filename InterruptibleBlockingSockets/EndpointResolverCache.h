@@ -0,0 +1,104 @@
+#ifndef ENDPOINT_RESOLVER_CACHE_H
+#define ENDPOINT_RESOLVER_CACHE_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/ip/address.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+//Local includes
+
+//Process wide cache of host name to address resolutions shared by all sockets (see cInterruptibleBlockingResolver).
+//Successful lookups are kept for the positive TTL, failures for the (shorter) negative TTL so that an unresolvable
+//name doesn't hit DNS on every call either. Thread safe.
+//
+//Misses are looked up here too, so that callers wanting the same name share a single lookup in flight. Lookups run
+//on a few detached threads (getaddrinfo() can't be interrupted) and names beyond that queue for the next free one.
+
+class cEndpointResolverCache
+{
+public:
+    //A system lookup of one name, shared by every caller waiting for it. Outlives any of them.
+    class cLookup
+    {
+    public:
+        cLookup();
+
+        boost::mutex                    m_oMutex;
+        boost::condition_variable       m_oCondition;
+
+        bool                            m_bDone;
+        boost::asio::ip::address        m_oAddress;
+        boost::system::error_code       m_oError;
+    };
+
+    static cEndpointResolverCache&  getInstance();
+
+    //Dotted IPv4 addresses need no resolution at all
+    static bool                     parseNumericAddress(const std::string &strHost, boost::asio::ip::address &oAddress);
+
+    //Returns true if there is an unexpired entry. For a cached failure oError is set and oAddress left untouched.
+    bool                            find(const std::string &strHost, boost::asio::ip::address &oAddress, boost::system::error_code &oError);
+
+    void                            insert(const std::string &strHost, const boost::asio::ip::address &oAddress);
+    void                            insertFailure(const std::string &strHost, const boost::system::error_code &oError);
+
+    //Returns the lookup in flight for strHost, starting one if there is none. Its answer is cached before m_bDone is set.
+    boost::shared_ptr<cLookup>      startLookup(const std::string &strHost);
+
+    void                            setTTLs(uint32_t u32PositiveTTL_ms, uint32_t u32NegativeTTL_ms);
+    void                            clear();
+
+private:
+    class cEntry
+    {
+    public:
+        boost::asio::ip::address        m_oAddress;
+        boost::system::error_code       m_oError;
+        boost::posix_time::ptime        m_oExpiryTime;
+    };
+
+    cEndpointResolverCache();
+
+    void                            store(const std::string &strHost, const cEntry &oEntry);
+
+    std::map<std::string, cEntry>   m_oEntries;
+
+    //Lookups in flight by name, the names waiting for a lookup thread and the number of those threads running
+    std::map<std::string, boost::shared_ptr<cLookup> > m_oLookups;
+    std::deque<std::string>         m_dqQueuedLookups;
+    uint32_t                        m_u32NLookupThreads;
+
+    uint32_t                        m_u32PositiveTTL_ms;
+    uint32_t                        m_u32NegativeTTL_ms;
+
+    boost::mutex                    m_oMutex;
+
+    void                            lookupThreadFunction();
+};
+
+#endif // ENDPOINT_RESOLVER_CACHE_H
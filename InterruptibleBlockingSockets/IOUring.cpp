@@ -0,0 +1,952 @@
+#ifdef __linux__
+
+//System includes
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/error.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+//Local includes
+#include "IOUring.h"
+#include "SocketReadinessWaiter.h"
+
+using namespace std;
+
+namespace
+{
+    //The low bits of an entry's user_data tell what it is, the rest which call it belongs to
+    const uint64_t TAG_OPERATION = 0;
+    const uint64_t TAG_TIMEOUT = 1;
+    const uint64_t TAG_CANCEL = 2;
+    const uint64_t TAG_MULTISHOT = 3;
+    const uint64_t TAG_MASK = 3;
+
+    //Longest wait in stopMultishot() for the kernel to finish the multishot operation
+    const int64_t MULTISHOT_STOP_TIMEOUT_NS = 1000000000;
+
+    uint64_t makeTag(uint64_t u64CallNo, uint64_t u64Type)
+    {
+        return (u64CallNo << 2) | u64Type;
+    }
+
+    int ioUringSetup(uint32_t u32NEntries, io_uring_params *pParams)
+    {
+        return syscall(__NR_io_uring_setup, u32NEntries, pParams);
+    }
+
+    int ioUringEnter(int iRingFD, uint32_t u32NToSubmit, uint32_t u32MinComplete, uint32_t u32Flags, const void *pArgument, size_t uArgumentSize)
+    {
+        return syscall(__NR_io_uring_enter, iRingFD, u32NToSubmit, u32MinComplete, u32Flags, pArgument, uArgumentSize);
+    }
+
+    int ioUringRegister(int iRingFD, uint32_t u32Opcode, const void *pArgument, uint32_t u32NArguments)
+    {
+        return syscall(__NR_io_uring_register, iRingFD, u32Opcode, pArgument, u32NArguments);
+    }
+
+    boost::system::error_code getError(int iErrno)
+    {
+        return boost::system::error_code(iErrno, boost::asio::error::get_system_category());
+    }
+
+    bool probeSupport()
+    {
+        //Setting up a ring checks the features needed
+        cIOUring oRing(2);
+        if(!oRing.isOpen())
+            return false;
+
+        //The operations are probed on a scratch ring, as cIOUring doesn't expose its descriptor
+        io_uring_params oParams;
+        memset(&oParams, 0, sizeof(oParams));
+
+        int iRingFD = ioUringSetup(2, &oParams);
+        if(iRingFD < 0)
+            return false;
+
+        vector<char> vcProbe(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe *pProbe = (io_uring_probe*)&vcProbe[0];
+
+        bool bSupported = ioUringRegister(iRingFD, IORING_REGISTER_PROBE, pProbe, 256) == 0;
+        ::close(iRingFD);
+
+        const uint8_t au8RequiredOps[] = { IORING_OP_NOP, IORING_OP_READ_FIXED, IORING_OP_POLL_ADD, IORING_OP_SENDMSG, IORING_OP_RECVMSG,
+                                           IORING_OP_ACCEPT, IORING_OP_ASYNC_CANCEL, IORING_OP_LINK_TIMEOUT, IORING_OP_SEND, IORING_OP_RECV };
+
+        for(uint32_t u32OpNo = 0; bSupported && u32OpNo < sizeof(au8RequiredOps); u32OpNo++)
+        {
+            uint8_t u8Op = au8RequiredOps[u32OpNo];
+            bSupported = u8Op <= pProbe->last_op && (pProbe->ops[u8Op].flags & IO_URING_OP_SUPPORTED);
+        }
+
+        return bSupported;
+    }
+}
+
+cIOUring::cCompletion::cCompletion(int32_t i32Result, uint32_t u32Flags) :
+    m_i32Result(i32Result),
+    m_u32Flags(u32Flags)
+{
+}
+
+cIOUring::cIOUring(uint32_t u32NEntries) :
+    m_iRingFD(-1),
+    m_pSQRing(MAP_FAILED),
+    m_uSQRingSize(0),
+    m_pCQRing(MAP_FAILED),
+    m_uCQRingSize(0),
+    m_pSQEs((io_uring_sqe*)MAP_FAILED),
+    m_uSQEsSize(0),
+    m_pu32SQHead(NULL),
+    m_pu32SQTail(NULL),
+    m_pu32SQArray(NULL),
+    m_u32SQMask(0),
+    m_u32SQEntries(0),
+    m_u32SQLocalTail(0),
+    m_pu32CQHead(NULL),
+    m_pu32CQTail(NULL),
+    m_pCQEs(NULL),
+    m_u32CQMask(0),
+    m_u64CallNo(0),
+    m_bCallInProgress(false),
+    m_bCallIsSingleOperation(false),
+    m_bCancelled(false),
+    m_bOperationComplete(false),
+    m_i32OperationResult(0),
+    m_pRegisteredBuffer(NULL),
+    m_u32RegisteredBufferSize_B(0),
+    m_bMultishotArmed(false),
+    m_bMultishotAcceptSupported(true),
+    m_pBufferRing(NULL),
+    m_uBufferRingSize(0),
+    m_u32NReceiveBuffers(0),
+    m_u32ReceiveBufferSize_B(0),
+    m_u16BufferRingTail(0)
+{
+    memset(&m_oReceiveHeader, 0, sizeof(m_oReceiveHeader));
+
+    io_uring_params oParams;
+    memset(&oParams, 0, sizeof(oParams));
+
+    //Completion work only runs when we enter the kernel anyway, saving interrupts. Not available before 5.19.
+    oParams.flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+    m_iRingFD = ioUringSetup(u32NEntries, &oParams);
+
+    if(m_iRingFD < 0 && errno == EINVAL)
+    {
+        memset(&oParams, 0, sizeof(oParams));
+        m_iRingFD = ioUringSetup(u32NEntries, &oParams);
+    }
+
+    if(m_iRingFD < 0)
+        return;
+
+    //Timed waits need EXT_ARG (5.11)
+    if(!(oParams.features & IORING_FEAT_EXT_ARG) || !(oParams.features & IORING_FEAT_NODROP))
+    {
+        close();
+        return;
+    }
+
+    m_uSQRingSize = oParams.sq_off.array + oParams.sq_entries * sizeof(uint32_t);
+    m_uCQRingSize = oParams.cq_off.cqes + oParams.cq_entries * sizeof(io_uring_cqe);
+
+    if(oParams.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        m_uSQRingSize = max(m_uSQRingSize, m_uCQRingSize);
+        m_uCQRingSize = m_uSQRingSize;
+    }
+
+    m_pSQRing = mmap(NULL, m_uSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRingFD, IORING_OFF_SQ_RING);
+
+    if(oParams.features & IORING_FEAT_SINGLE_MMAP)
+        m_pCQRing = m_pSQRing;
+    else
+        m_pCQRing = mmap(NULL, m_uCQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRingFD, IORING_OFF_CQ_RING);
+
+    m_uSQEsSize = oParams.sq_entries * sizeof(io_uring_sqe);
+    m_pSQEs = (io_uring_sqe*)mmap(NULL, m_uSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRingFD, IORING_OFF_SQES);
+
+    if(m_pSQRing == MAP_FAILED || m_pCQRing == MAP_FAILED || m_pSQEs == MAP_FAILED)
+    {
+        close();
+        return;
+    }
+
+    char *cpSQRing = (char*)m_pSQRing;
+    m_pu32SQHead = (uint32_t*)(cpSQRing + oParams.sq_off.head);
+    m_pu32SQTail = (uint32_t*)(cpSQRing + oParams.sq_off.tail);
+    m_pu32SQArray = (uint32_t*)(cpSQRing + oParams.sq_off.array);
+    m_u32SQMask = *(uint32_t*)(cpSQRing + oParams.sq_off.ring_mask);
+    m_u32SQEntries = oParams.sq_entries;
+    m_u32SQLocalTail = *m_pu32SQTail;
+
+    char *cpCQRing = (char*)m_pCQRing;
+    m_pu32CQHead = (uint32_t*)(cpCQRing + oParams.cq_off.head);
+    m_pu32CQTail = (uint32_t*)(cpCQRing + oParams.cq_off.tail);
+    m_pCQEs = (io_uring_cqe*)(cpCQRing + oParams.cq_off.cqes);
+    m_u32CQMask = *(uint32_t*)(cpCQRing + oParams.cq_off.ring_mask);
+}
+
+cIOUring::~cIOUring()
+{
+    stopMultishot();
+    close();
+}
+
+void cIOUring::close()
+{
+    if(m_pSQEs != MAP_FAILED)
+        munmap(m_pSQEs, m_uSQEsSize);
+
+    if(m_pCQRing != MAP_FAILED && m_pCQRing != m_pSQRing)
+        munmap(m_pCQRing, m_uCQRingSize);
+
+    if(m_pSQRing != MAP_FAILED)
+        munmap(m_pSQRing, m_uSQRingSize);
+
+    m_pSQEs = (io_uring_sqe*)MAP_FAILED;
+    m_pCQRing = MAP_FAILED;
+    m_pSQRing = MAP_FAILED;
+
+    //Closing the ring also releases registered buffers and the buffer ring
+    if(m_iRingFD >= 0)
+        ::close(m_iRingFD);
+
+    m_iRingFD = -1;
+
+    if(m_pBufferRing)
+        munmap(m_pBufferRing, m_uBufferRingSize);
+
+    m_pBufferRing = NULL;
+}
+
+bool cIOUring::isSupported()
+{
+    static const bool s_bSupported = probeSupport();
+    return s_bSupported;
+}
+
+bool cIOUring::isOpen() const
+{
+    return m_iRingFD >= 0;
+}
+
+bool cIOUring::registerBuffer(void *pBuffer, uint32_t u32NBytes)
+{
+    if(pBuffer == m_pRegisteredBuffer && u32NBytes == m_u32RegisteredBufferSize_B)
+        return true;
+
+    if(m_pRegisteredBuffer)
+    {
+        ioUringRegister(m_iRingFD, IORING_UNREGISTER_BUFFERS, NULL, 0);
+
+        m_pRegisteredBuffer = NULL;
+        m_u32RegisteredBufferSize_B = 0;
+    }
+
+    iovec oIOVec;
+    oIOVec.iov_base = pBuffer;
+    oIOVec.iov_len = u32NBytes;
+
+    //May fail for lack of locked memory (RLIMIT_MEMLOCK on older kernels). Reads then simply aren't fixed.
+    if(ioUringRegister(m_iRingFD, IORING_REGISTER_BUFFERS, &oIOVec, 1) != 0)
+        return false;
+
+    m_pRegisteredBuffer = pBuffer;
+    m_u32RegisteredBufferSize_B = u32NBytes;
+
+    return true;
+}
+
+boost::system::error_code cIOUring::receive(int iFD, void *pBuffer, uint32_t u32NBytes, uint32_t &u32NBytesReceived, int64_t i64Deadline_ns)
+{
+    u32NBytesReceived = 0;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.fd = iFD;
+    oSQE.addr = (uint64_t)(uintptr_t)pBuffer;
+    oSQE.len = u32NBytes;
+
+    char *cpRegistered = (char*)m_pRegisteredBuffer;
+    if(cpRegistered && (char*)pBuffer >= cpRegistered && (char*)pBuffer + u32NBytes <= cpRegistered + m_u32RegisteredBufferSize_B)
+    {
+        oSQE.opcode = IORING_OP_READ_FIXED;
+        oSQE.buf_index = 0;
+    }
+    else
+    {
+        oSQE.opcode = IORING_OP_RECV;
+    }
+
+    int32_t i32Result;
+    boost::system::error_code oError = runOperation(oSQE, i64Deadline_ns, i32Result);
+    if(oError)
+        return oError;
+
+    if(i32Result == 0 && u32NBytes)
+        return boost::asio::error::eof;
+
+    u32NBytesReceived = i32Result;
+    return oError;
+}
+
+boost::system::error_code cIOUring::send(int iFD, const void *pBuffer, uint32_t u32NBytes, uint32_t &u32NBytesSent, int64_t i64Deadline_ns)
+{
+    u32NBytesSent = 0;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_SEND;
+    oSQE.fd = iFD;
+    oSQE.addr = (uint64_t)(uintptr_t)pBuffer;
+    oSQE.len = u32NBytes;
+    oSQE.msg_flags = MSG_NOSIGNAL;
+
+    int32_t i32Result;
+    boost::system::error_code oError = runOperation(oSQE, i64Deadline_ns, i32Result);
+
+    if(!oError)
+        u32NBytesSent = i32Result;
+
+    return oError;
+}
+
+boost::system::error_code cIOUring::receiveMessage(int iFD, msghdr &oHeader, uint32_t &u32NBytesReceived, int64_t i64Deadline_ns)
+{
+    u32NBytesReceived = 0;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_RECVMSG;
+    oSQE.fd = iFD;
+    oSQE.addr = (uint64_t)(uintptr_t)&oHeader;
+    oSQE.len = 1;
+
+    int32_t i32Result;
+    boost::system::error_code oError = runOperation(oSQE, i64Deadline_ns, i32Result);
+
+    if(!oError)
+        u32NBytesReceived = i32Result;
+
+    return oError;
+}
+
+boost::system::error_code cIOUring::sendMessage(int iFD, const msghdr &oHeader, uint32_t &u32NBytesSent, int64_t i64Deadline_ns)
+{
+    u32NBytesSent = 0;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_SENDMSG;
+    oSQE.fd = iFD;
+    oSQE.addr = (uint64_t)(uintptr_t)&oHeader;
+    oSQE.len = 1;
+    oSQE.msg_flags = MSG_NOSIGNAL;
+
+    int32_t i32Result;
+    boost::system::error_code oError = runOperation(oSQE, i64Deadline_ns, i32Result);
+
+    if(!oError)
+        u32NBytesSent = i32Result;
+
+    return oError;
+}
+
+boost::system::error_code cIOUring::waitUntilReady(int iFD, bool bForWriting, int64_t i64Deadline_ns)
+{
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_POLL_ADD;
+    oSQE.fd = iFD;
+    oSQE.poll32_events = bForWriting ? POLLOUT : POLLIN;
+
+    int32_t i32Result;
+    return runOperation(oSQE, i64Deadline_ns, i32Result);
+}
+
+boost::system::error_code cIOUring::accept(int iListenFD, int &iFD, int64_t i64Deadline_ns)
+{
+    iFD = -1;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_ACCEPT;
+    oSQE.fd = iListenFD;
+    oSQE.accept_flags = SOCK_CLOEXEC;
+
+    if(!m_bMultishotAcceptSupported)
+    {
+        int32_t i32Result;
+        boost::system::error_code oError = runOperation(oSQE, i64Deadline_ns, i32Result);
+
+        if(!oError)
+            iFD = i32Result;
+
+        return oError;
+    }
+
+    oSQE.ioprio = IORING_ACCEPT_MULTISHOT;
+
+    boost::system::error_code oError;
+    beginCall(false);
+
+    for(;;)
+    {
+        reap();
+
+        cCompletion oCompletion(0, 0);
+        if(takeMultishotCompletion(oCompletion))
+        {
+            if(oCompletion.m_i32Result >= 0)
+            {
+                iFD = oCompletion.m_i32Result;
+                break;
+            }
+
+            //Kernels before 5.19 reject the multishot flag
+            if(oCompletion.m_i32Result == -EINVAL && !m_bMultishotArmed)
+            {
+                m_bMultishotAcceptSupported = false;
+                endCall();
+
+                return accept(iListenFD, iFD, i64Deadline_ns);
+            }
+
+            oError = getError(-oCompletion.m_i32Result);
+            break;
+        }
+
+        if(!m_bMultishotArmed)
+        {
+            oError = armMultishot(oSQE);
+            if(oError)
+                break;
+
+            continue;
+        }
+
+        oError = waitForMultishotCompletion(i64Deadline_ns);
+        if(oError)
+            break;
+    }
+
+    endCall();
+    return oError;
+}
+
+bool cIOUring::setupReceiveBuffers(uint32_t u32NBuffers, uint32_t u32MaxDatagramSize_B)
+{
+    if(m_pBufferRing)
+        return true;
+
+    //The ring size must be a power of 2
+    uint32_t u32NEntries = 1;
+    while(u32NEntries < u32NBuffers && u32NEntries < 32768)
+        u32NEntries <<= 1;
+
+    m_uBufferRingSize = u32NEntries * sizeof(io_uring_buf);
+    void *pBufferRing = mmap(NULL, m_uBufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(pBufferRing == MAP_FAILED)
+        return false;
+
+    io_uring_buf_reg oRegistration;
+    memset(&oRegistration, 0, sizeof(oRegistration));
+    oRegistration.ring_addr = (uint64_t)(uintptr_t)pBufferRing;
+    oRegistration.ring_entries = u32NEntries;
+    oRegistration.bgid = 0;
+
+    if(ioUringRegister(m_iRingFD, IORING_REGISTER_PBUF_RING, &oRegistration, 1) != 0)
+    {
+        munmap(pBufferRing, m_uBufferRingSize);
+        return false;
+    }
+
+    m_pBufferRing = (io_uring_buf_ring*)pBufferRing;
+    m_u32NReceiveBuffers = u32NEntries;
+    //Each buffer starts with the header and sender's address, followed by the payload
+    m_u32ReceiveBufferSize_B = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_storage) + u32MaxDatagramSize_B;
+    m_vcReceiveBuffers.resize((size_t)u32NEntries * m_u32ReceiveBufferSize_B);
+    m_u16BufferRingTail = 0;
+
+    for(uint32_t u32BufferNo = 0; u32BufferNo < u32NEntries; u32BufferNo++)
+        recycleReceiveBuffer(u32BufferNo);
+
+    //No ancillary data
+    memset(&m_oReceiveHeader, 0, sizeof(m_oReceiveHeader));
+    m_oReceiveHeader.msg_namelen = sizeof(sockaddr_storage);
+
+    return true;
+}
+
+bool cIOUring::hasReceiveBuffers() const
+{
+    return m_pBufferRing != NULL;
+}
+
+boost::system::error_code cIOUring::receiveFrom(int iFD, char *cpBuffer, uint32_t u32NBytes, uint32_t &u32NBytesReceived, sockaddr_storage &oPeerAddress,
+                                                socklen_t &iPeerAddressLength, int64_t i64Deadline_ns)
+{
+    u32NBytesReceived = 0;
+    iPeerAddressLength = 0;
+
+    if(!m_pBufferRing)
+        return boost::asio::error::operation_not_supported;
+
+    io_uring_sqe oSQE;
+    memset(&oSQE, 0, sizeof(oSQE));
+    oSQE.opcode = IORING_OP_RECVMSG;
+    oSQE.fd = iFD;
+    oSQE.addr = (uint64_t)(uintptr_t)&m_oReceiveHeader;
+    oSQE.len = 1;
+    oSQE.ioprio = IORING_RECV_MULTISHOT;
+    oSQE.flags = IOSQE_BUFFER_SELECT;
+    oSQE.buf_group = 0;
+
+    boost::system::error_code oError;
+    beginCall(false);
+
+    for(;;)
+    {
+        reap();
+
+        cCompletion oCompletion(0, 0);
+        if(takeMultishotCompletion(oCompletion))
+        {
+            //All buffers were in use. The receive is armed again below once this call has freed one.
+            if(oCompletion.m_i32Result == -ENOBUFS)
+                continue;
+
+            if(oCompletion.m_i32Result < 0)
+            {
+                oError = getError(-oCompletion.m_i32Result);
+                break;
+            }
+
+            if(!(oCompletion.m_u32Flags & IORING_CQE_F_BUFFER))
+                continue;
+
+            uint16_t u16BufferID = oCompletion.m_u32Flags >> IORING_CQE_BUFFER_SHIFT;
+            const char *cpReceived = &m_vcReceiveBuffers[(size_t)u16BufferID * m_u32ReceiveBufferSize_B];
+            const io_uring_recvmsg_out *pOut = (const io_uring_recvmsg_out*)cpReceived;
+
+            //Header, then space for the address, then the payload
+            uint32_t u32PayloadOffset = sizeof(io_uring_recvmsg_out) + m_oReceiveHeader.msg_namelen + m_oReceiveHeader.msg_controllen;
+            uint32_t u32PayloadLength = (uint32_t)oCompletion.m_i32Result > u32PayloadOffset ? oCompletion.m_i32Result - u32PayloadOffset : 0;
+
+            iPeerAddressLength = min<uint32_t>(pOut->namelen, m_oReceiveHeader.msg_namelen);
+            memcpy(&oPeerAddress, cpReceived + sizeof(io_uring_recvmsg_out), iPeerAddressLength);
+
+            u32NBytesReceived = min(u32PayloadLength, u32NBytes);
+            memcpy(cpBuffer, cpReceived + u32PayloadOffset, u32NBytesReceived);
+
+            recycleReceiveBuffer(u16BufferID);
+            break;
+        }
+
+        if(!m_bMultishotArmed)
+        {
+            oError = armMultishot(oSQE);
+            if(oError)
+                break;
+
+            continue;
+        }
+
+        oError = waitForMultishotCompletion(i64Deadline_ns);
+        if(oError)
+            break;
+    }
+
+    endCall();
+    return oError;
+}
+
+void cIOUring::stopMultishot()
+{
+    if(m_bMultishotArmed && m_iRingFD >= 0)
+    {
+        {
+            boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+            io_uring_sqe *pSQE = getSQE();
+            if(pSQE)
+            {
+                pSQE->opcode = IORING_OP_ASYNC_CANCEL;
+                pSQE->fd = -1;
+                pSQE->addr = TAG_MULTISHOT;
+                pSQE->user_data = makeTag(m_u64CallNo, TAG_CANCEL);
+
+                submit();
+            }
+        }
+
+        //The final completion (without IORING_CQE_F_MORE) tells that the kernel has let go of the socket
+        int64_t i64Deadline_ns = cSocketReadinessWaiter::getCurrentTime_ns() + MULTISHOT_STOP_TIMEOUT_NS;
+
+        for(;;)
+        {
+            reap();
+            if(!m_bMultishotArmed)
+                break;
+
+            boost::system::error_code oError = waitForCompletion(i64Deadline_ns);
+            if(oError && oError != boost::asio::error::interrupted)
+            {
+                cout << "cIOUring::stopMultishot(): The multishot operation didn't finish: " << oError.message() << endl;
+                break;
+            }
+        }
+    }
+
+    cCompletion oCompletion(0, 0);
+    while(takeMultishotCompletion(oCompletion))
+    {
+        if(oCompletion.m_u32Flags & IORING_CQE_F_BUFFER)
+            recycleReceiveBuffer(oCompletion.m_u32Flags >> IORING_CQE_BUFFER_SHIFT);
+        else if(oCompletion.m_i32Result >= 0)
+            ::close(oCompletion.m_i32Result); //Accepted, never taken
+    }
+}
+
+void cIOUring::cancel()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+    if(!m_bCallInProgress || m_bCancelled)
+        return;
+
+    io_uring_sqe *pSQE = getSQE();
+    if(!pSQE)
+        return;
+
+    //A single operation is cancelled. A multishot operation stays armed and the waiting call is just woken.
+    if(m_bCallIsSingleOperation)
+    {
+        pSQE->opcode = IORING_OP_ASYNC_CANCEL;
+        pSQE->fd = -1;
+        pSQE->addr = makeTag(m_u64CallNo, TAG_OPERATION);
+    }
+    else
+    {
+        pSQE->opcode = IORING_OP_NOP;
+    }
+
+    pSQE->user_data = makeTag(m_u64CallNo, TAG_CANCEL);
+
+    m_bCancelled = true;
+    submit();
+}
+
+boost::system::error_code cIOUring::runOperation(const io_uring_sqe &oSQE, int64_t i64Deadline_ns, int32_t &i32Result)
+{
+    i32Result = 0;
+
+    if(m_iRingFD < 0)
+        return boost::asio::error::bad_descriptor;
+
+    //Must outlive the submission, in which the kernel copies it
+    __kernel_timespec oTimeout;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+        m_u64CallNo++;
+        m_bCallInProgress = true;
+        m_bCallIsSingleOperation = true;
+        m_bCancelled = false;
+        m_bOperationComplete = false;
+
+        io_uring_sqe *pSQE = getSQE();
+        io_uring_sqe *pTimeoutSQE = i64Deadline_ns ? getSQE() : NULL;
+
+        if(!pSQE || (i64Deadline_ns && !pTimeoutSQE))
+        {
+            m_u32SQLocalTail = *m_pu32SQTail;
+            m_bCallInProgress = false;
+            return boost::asio::error::no_buffer_space;
+        }
+
+        *pSQE = oSQE;
+        pSQE->user_data = makeTag(m_u64CallNo, TAG_OPERATION);
+
+        if(i64Deadline_ns)
+        {
+            oTimeout.tv_sec = i64Deadline_ns / 1000000000;
+            oTimeout.tv_nsec = i64Deadline_ns % 1000000000;
+
+            //Cancels the operation when it fires. Absolute, on CLOCK_MONOTONIC like our deadlines.
+            pSQE->flags |= IOSQE_IO_LINK;
+            pTimeoutSQE->opcode = IORING_OP_LINK_TIMEOUT;
+            pTimeoutSQE->fd = -1;
+            pTimeoutSQE->addr = (uint64_t)(uintptr_t)&oTimeout;
+            pTimeoutSQE->len = 1;
+            pTimeoutSQE->timeout_flags = IORING_TIMEOUT_ABS;
+            pTimeoutSQE->user_data = makeTag(m_u64CallNo, TAG_TIMEOUT);
+        }
+
+        boost::system::error_code oError = submit();
+        if(oError)
+        {
+            m_bCallInProgress = false;
+            return oError;
+        }
+    }
+
+    //A ready socket completes within the submission
+    for(;;)
+    {
+        reap();
+        if(m_bOperationComplete)
+            break;
+
+        //The linked timeout bounds this wait
+        boost::system::error_code oError = waitForCompletion(0);
+        if(oError && oError != boost::asio::error::interrupted)
+        {
+            //Until the operation completes the kernel may still write into the caller's buffer or read the msghdr /
+            //iovec on its stack, so cancel it and don't return before its completion has arrived
+            cancel();
+
+            for(;;)
+            {
+                reap();
+                if(m_bOperationComplete)
+                    break;
+
+                //The completion ring is read without io_uring_enter(), so keep going if waiting fails again
+                if(waitForCompletion(0))
+                    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+            }
+
+            endCall();
+            return oError;
+        }
+    }
+
+    bool bCancelled = endCall();
+
+    i32Result = m_i32OperationResult;
+
+    if(i32Result == -ECANCELED || i32Result == -EINTR)
+        return bCancelled ? boost::asio::error::operation_aborted : boost::asio::error::timed_out;
+
+    if(i32Result < 0)
+        return getError(-i32Result);
+
+    return boost::system::error_code();
+}
+
+void cIOUring::beginCall(bool bSingleOperation)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+    m_u64CallNo++;
+    m_bCallInProgress = true;
+    m_bCallIsSingleOperation = bSingleOperation;
+    m_bCancelled = false;
+    m_bOperationComplete = false;
+}
+
+bool cIOUring::endCall()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+    m_bCallInProgress = false;
+    return m_bCancelled;
+}
+
+io_uring_sqe* cIOUring::getSQE()
+{
+    uint32_t u32Head = __atomic_load_n(m_pu32SQHead, __ATOMIC_ACQUIRE);
+
+    if(m_u32SQLocalTail - u32Head >= m_u32SQEntries)
+        return NULL;
+
+    uint32_t u32Index = m_u32SQLocalTail & m_u32SQMask;
+    m_u32SQLocalTail++;
+
+    io_uring_sqe *pSQE = &m_pSQEs[u32Index];
+    memset(pSQE, 0, sizeof(*pSQE));
+    m_pu32SQArray[u32Index] = u32Index;
+
+    return pSQE;
+}
+
+boost::system::error_code cIOUring::submit()
+{
+    uint32_t u32NToSubmit = m_u32SQLocalTail - *m_pu32SQTail;
+
+    //Entries are complete before the kernel may look at them
+    __atomic_store_n(m_pu32SQTail, m_u32SQLocalTail, __ATOMIC_RELEASE);
+
+    while(u32NToSubmit)
+    {
+        int iNSubmitted = ioUringEnter(m_iRingFD, u32NToSubmit, 0, 0, NULL, 0);
+
+        if(iNSubmitted < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return getError(errno);
+        }
+
+        u32NToSubmit -= min<uint32_t>(iNSubmitted, u32NToSubmit);
+    }
+
+    return boost::system::error_code();
+}
+
+void cIOUring::reap()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oCompletionMutex);
+
+    uint32_t u32Head = *m_pu32CQHead;
+    uint32_t u32Tail = __atomic_load_n(m_pu32CQTail, __ATOMIC_ACQUIRE);
+
+    while(u32Head != u32Tail)
+    {
+        const io_uring_cqe &oCQE = m_pCQEs[u32Head & m_u32CQMask];
+        u32Head++;
+
+        uint64_t u64Type = oCQE.user_data & TAG_MASK;
+
+        if(u64Type == TAG_MULTISHOT)
+        {
+            m_dqMultishotCompletions.push_back(cCompletion(oCQE.res, oCQE.flags));
+
+            if(!(oCQE.flags & IORING_CQE_F_MORE))
+                m_bMultishotArmed = false;
+        }
+        else if(u64Type == TAG_OPERATION && (oCQE.user_data >> 2) == m_u64CallNo)
+        {
+            m_bOperationComplete = true;
+            m_i32OperationResult = oCQE.res;
+        }
+
+        //Timeouts and cancels only matter for their effect on the operation, which reports it
+    }
+
+    __atomic_store_n(m_pu32CQHead, u32Head, __ATOMIC_RELEASE);
+}
+
+bool cIOUring::takeMultishotCompletion(cCompletion &oCompletion)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oCompletionMutex);
+
+    if(m_dqMultishotCompletions.empty())
+        return false;
+
+    oCompletion = m_dqMultishotCompletions.front();
+    m_dqMultishotCompletions.pop_front();
+
+    return true;
+}
+
+boost::system::error_code cIOUring::waitForCompletion(int64_t i64Deadline_ns)
+{
+    int iResult;
+
+    if(!i64Deadline_ns)
+    {
+        iResult = ioUringEnter(m_iRingFD, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+    else
+    {
+        int64_t i64Remaining_ns = i64Deadline_ns - cSocketReadinessWaiter::getCurrentTime_ns();
+        if(i64Remaining_ns <= 0)
+            return boost::asio::error::timed_out;
+
+        __kernel_timespec oTimeout;
+        oTimeout.tv_sec = i64Remaining_ns / 1000000000;
+        oTimeout.tv_nsec = i64Remaining_ns % 1000000000;
+
+        io_uring_getevents_arg oArgument;
+        memset(&oArgument, 0, sizeof(oArgument));
+        oArgument.ts = (uint64_t)(uintptr_t)&oTimeout;
+
+        iResult = ioUringEnter(m_iRingFD, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &oArgument, sizeof(oArgument));
+    }
+
+    if(iResult >= 0)
+        return boost::system::error_code();
+
+    if(errno == ETIME)
+        return boost::asio::error::timed_out;
+
+    //Signals interrupt the wait. Callers simply wait again.
+    if(errno == EINTR)
+        return boost::asio::error::interrupted;
+
+    return getError(errno);
+}
+
+boost::system::error_code cIOUring::waitForMultishotCompletion(int64_t i64Deadline_ns)
+{
+    boost::system::error_code oError = waitForCompletion(i64Deadline_ns);
+    if(oError && oError != boost::asio::error::interrupted)
+        return oError;
+
+    boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+    if(m_bCancelled)
+        return boost::asio::error::operation_aborted;
+
+    return boost::system::error_code();
+}
+
+boost::system::error_code cIOUring::armMultishot(const io_uring_sqe &oSQE)
+{
+    if(m_iRingFD < 0)
+        return boost::asio::error::bad_descriptor;
+
+    boost::lock_guard<boost::mutex> oLock(m_oSubmitMutex);
+
+    //Once cancelled the socket may be about to close, so it must not be armed again
+    if(m_bCancelled)
+        return boost::asio::error::operation_aborted;
+
+    io_uring_sqe *pSQE = getSQE();
+    if(!pSQE)
+        return boost::asio::error::no_buffer_space;
+
+    *pSQE = oSQE;
+    pSQE->user_data = TAG_MULTISHOT;
+
+    //Before submitting, as its final completion may be taken by another thread in stopMultishot() at once
+    m_bMultishotArmed = true;
+
+    return submit();
+}
+
+void cIOUring::recycleReceiveBuffer(uint16_t u16BufferID)
+{
+    //Only the fields of the entry, as its reserved field overlays the ring's tail. The entries are indexed from the
+    //start of the ring rather than through bufs[], which the kernel header's flexible array misplaces in C++.
+    io_uring_buf &oBuffer = ((io_uring_buf*)m_pBufferRing)[m_u16BufferRingTail & (m_u32NReceiveBuffers - 1)];
+    oBuffer.addr = (uint64_t)(uintptr_t)&m_vcReceiveBuffers[(size_t)u16BufferID * m_u32ReceiveBufferSize_B];
+    oBuffer.len = m_u32ReceiveBufferSize_B;
+    oBuffer.bid = u16BufferID;
+
+    m_u16BufferRingTail++;
+    __atomic_store_n(&m_pBufferRing->tail, m_u16BufferRingTail, __ATOMIC_RELEASE);
+}
+
+#endif // __linux__
@@ -0,0 +1,174 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+//io_uring backend for the socket classes (see setIOUringEnabled()). Linux only, using the system calls directly.
+//
+//Each blocking call becomes a submission of the operation linked to a timeout at the call's deadline. If the socket is
+//ready the operation completes within the io_uring_enter() that submits it, so a transfer costs one system call with
+//no epoll registration, handlers or timers. Otherwise the thread waits in the kernel for the completion.
+//
+//- A buffer given to registerBuffer() is pinned once, so reads into it skip the per call page lookups.
+//- accept() keeps a multishot accept armed: connections that arrive between calls are accepted already and the next
+//  call just takes one. They are taken off the listen backlog even while the caller isn't accepting.
+//- receiveFrom() likewise keeps a multishot receive armed into a ring of provided buffers, so datagrams that arrive
+//  between calls are received already and each call copies one out.
+//
+//A ring serves one thread at a time (each direction of a TCP socket has its own), but cancel() and, after it,
+//stopMultishot() may be called from any thread. Multishot operations keep their socket open in the kernel, so
+//stopMultishot() must be called before closing it.
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+#include <sys/socket.h>
+
+#include <deque>
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/system/error_code.hpp>
+#endif
+
+//Local includes
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+class cIOUring
+{
+public:
+    cIOUring(uint32_t u32NEntries = 8);
+    ~cIOUring();
+
+    //Whether the kernel offers io_uring with the operations used here. Checked once per process. It may be missing
+    //(before 5.11), disabled (kernel.io_uring_disabled) or blocked by a seccomp filter.
+    static bool                     isSupported();
+    bool                            isOpen() const;
+
+    //Replaces the buffer registered before, if any. Costs a system call, so only when the buffer moves.
+    bool                            registerBuffer(void *pBuffer, uint32_t u32NBytes);
+
+    //Single operations. Deadlines are on the clock of cSocketReadinessWaiter::getDeadline_ns(), 0 for none. Failures
+    //are reported as the system calls would, plus timed_out and operation_aborted (cancel()). A receive of 0 bytes
+    //reports eof.
+    boost::system::error_code       receive(int iFD, void *pBuffer, uint32_t u32NBytes, uint32_t &u32NBytesReceived, int64_t i64Deadline_ns);
+    boost::system::error_code       send(int iFD, const void *pBuffer, uint32_t u32NBytes, uint32_t &u32NBytesSent, int64_t i64Deadline_ns);
+    boost::system::error_code       receiveMessage(int iFD, msghdr &oHeader, uint32_t &u32NBytesReceived, int64_t i64Deadline_ns);
+    boost::system::error_code       sendMessage(int iFD, const msghdr &oHeader, uint32_t &u32NBytesSent, int64_t i64Deadline_ns);
+    boost::system::error_code       waitUntilReady(int iFD, bool bForWriting, int64_t i64Deadline_ns);
+
+    //Multishot accept. The new descriptor is blocking and close-on-exec. Falls back to single accepts on kernels
+    //without multishot accept (before 5.19).
+    boost::system::error_code       accept(int iListenFD, int &iFD, int64_t i64Deadline_ns);
+
+    //Multishot datagram receive. Needs the buffer ring set up first (5.19 and later), otherwise use receiveMessage().
+    //Datagrams longer than u32MaxDatagramSize_B are truncated. Once all buffers hold datagrams not taken yet, further
+    //ones wait in the socket until calls make room.
+    bool                            setupReceiveBuffers(uint32_t u32NBuffers, uint32_t u32MaxDatagramSize_B);
+    bool                            hasReceiveBuffers() const;
+    boost::system::error_code       receiveFrom(int iFD, char *cpBuffer, uint32_t u32NBytes, uint32_t &u32NBytesReceived, sockaddr_storage &oPeerAddress,
+                                                socklen_t &iPeerAddressLength, int64_t i64Deadline_ns);
+
+    //Cancel the multishot operation and wait until the kernel has let go of its socket. Connections accepted but not
+    //taken yet are closed, datagrams received but not taken yet are dropped.
+    void                            stopMultishot();
+
+    //Interrupt a call in progress on another thread. It returns operation_aborted. A cancel issued while no call is in
+    //progress is discarded.
+    void                            cancel();
+
+private:
+    class cCompletion
+    {
+    public:
+        cCompletion(int32_t i32Result, uint32_t u32Flags);
+
+        int32_t                     m_i32Result;
+        uint32_t                    m_u32Flags;
+    };
+
+    int                             m_iRingFD;
+
+    //Mapped rings
+    void                            *m_pSQRing;
+    size_t                          m_uSQRingSize;
+    void                            *m_pCQRing;
+    size_t                          m_uCQRingSize;
+    io_uring_sqe                    *m_pSQEs;
+    size_t                          m_uSQEsSize;
+
+    uint32_t                        *m_pu32SQHead;
+    uint32_t                        *m_pu32SQTail;
+    uint32_t                        *m_pu32SQArray;
+    uint32_t                        m_u32SQMask;
+    uint32_t                        m_u32SQEntries;
+    //Entries taken by getSQE() but not yet published to the kernel end at this tail
+    uint32_t                        m_u32SQLocalTail;
+
+    uint32_t                        *m_pu32CQHead;
+    uint32_t                        *m_pu32CQTail;
+    io_uring_cqe                    *m_pCQEs;
+    uint32_t                        m_u32CQMask;
+
+    //Guards submission (the calling thread and cancel()) and the state of the call in progress
+    boost::mutex                    m_oSubmitMutex;
+    uint64_t                        m_u64CallNo;
+    bool                            m_bCallInProgress;
+    bool                            m_bCallIsSingleOperation;
+    bool                            m_bCancelled;
+
+    //Result of the single operation of the current call, once complete
+    bool                            m_bOperationComplete;
+    int32_t                         m_i32OperationResult;
+
+    void                            *m_pRegisteredBuffer;
+    uint32_t                        m_u32RegisteredBufferSize_B;
+
+    //Multishot state. Completions are queued until calls take them.
+    boost::atomic<bool>             m_bMultishotArmed;
+    bool                            m_bMultishotAcceptSupported;
+    std::deque<cCompletion>         m_dqMultishotCompletions;
+
+    //Guards taking completions from the completion ring and the multishot queue, for stopMultishot() from another thread
+    boost::mutex                    m_oCompletionMutex;
+
+    //Provided buffers for multishot receives
+    io_uring_buf_ring               *m_pBufferRing;
+    size_t                          m_uBufferRingSize;
+    std::vector<char>               m_vcReceiveBuffers;
+    uint32_t                        m_u32NReceiveBuffers;
+    uint32_t                        m_u32ReceiveBufferSize_B;
+    uint16_t                        m_u16BufferRingTail;
+    msghdr                          m_oReceiveHeader;
+
+    //Submit the operation (plus a linked timeout for a deadline) as a new call and wait for its result
+    boost::system::error_code       runOperation(const io_uring_sqe &oSQE, int64_t i64Deadline_ns, int32_t &i32Result);
+    void                            beginCall(bool bSingleOperation);
+    bool                            endCall(); //Returns whether the call was cancelled
+
+    //Called with the submit lock held. getSQE() returns NULL if the submission ring is full.
+    io_uring_sqe*                   getSQE();
+    boost::system::error_code       submit();
+
+    //Take completions from the completion ring, without waiting
+    void                            reap();
+    bool                            takeMultishotCompletion(cCompletion &oCompletion);
+    //Wait for at least one more completion, up to the deadline (EXT_ARG timeout)
+    boost::system::error_code       waitForCompletion(int64_t i64Deadline_ns);
+
+    //Wait for the next multishot completion of the current call
+    boost::system::error_code       waitForMultishotCompletion(int64_t i64Deadline_ns);
+    boost::system::error_code       armMultishot(const io_uring_sqe &oSQE);
+
+    void                            recycleReceiveBuffer(uint16_t u16BufferID);
+    void                            close();
+};
+
+#endif // __linux__
+
+#endif // IO_URING_H
@@ -0,0 +1,132 @@
+
+//System includes
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingResolver.h"
+
+using namespace std;
+
+cInterruptibleBlockingResolver::cInterruptibleBlockingResolver() :
+    m_bResolving(false),
+    m_bCancelRequested(false),
+    m_bLookupCancelled(false)
+{
+}
+
+bool cInterruptibleBlockingResolver::resolve(const string &strHost, boost::asio::ip::address &oAddress, uint32_t u32Timeout_ms)
+{
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+        m_bResolving = true;
+        m_bCancelRequested = false;
+    }
+
+    m_oLastError = boost::system::error_code();
+
+    if(findWithoutLookup(strHost, oAddress, m_oLastError))
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+        m_bResolving = false;
+
+        return !m_oLastError;
+    }
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        if(m_bCancelRequested)
+        {
+            m_bResolving = false;
+            m_oLastError = boost::asio::error::operation_aborted;
+            return false;
+        }
+    }
+
+    //Joins the lookup of any other caller already waiting for this name
+    boost::shared_ptr<cEndpointResolverCache::cLookup> pLookup = cEndpointResolverCache::getInstance().startLookup(strHost);
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        m_bLookupCancelled = m_bCancelRequested;
+        m_pCurrentLookup = pLookup;
+    }
+
+    boost::system_time oDeadline = boost::get_system_time() + boost::posix_time::milliseconds(u32Timeout_ms);
+
+    {
+        // This will block until the lookup completes, times out or is cancelled.
+        boost::unique_lock<boost::mutex> oLock(pLookup->m_oMutex);
+
+        while(!pLookup->m_bDone && !m_bLookupCancelled)
+        {
+            if(!u32Timeout_ms)
+                pLookup->m_oCondition.wait(oLock);
+            else if(!pLookup->m_oCondition.timed_wait(oLock, oDeadline) && !pLookup->m_bDone && !m_bLookupCancelled)
+                break;
+        }
+
+        if(pLookup->m_bDone)
+        {
+            m_oLastError = pLookup->m_oError;
+            if(!m_oLastError)
+                oAddress = pLookup->m_oAddress;
+        }
+        else if(m_bLookupCancelled)
+            m_oLastError = boost::asio::error::operation_aborted;
+        else
+            m_oLastError = boost::asio::error::timed_out;
+    }
+
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    m_pCurrentLookup.reset();
+    m_bResolving = false;
+
+    return !m_oLastError;
+}
+
+bool cInterruptibleBlockingResolver::findWithoutLookup(const string &strHost, boost::asio::ip::address &oAddress, boost::system::error_code &oError)
+{
+    oError = boost::system::error_code();
+
+    if(cEndpointResolverCache::parseNumericAddress(strHost, oAddress))
+        return true;
+
+    return cEndpointResolverCache::getInstance().find(strHost, oAddress, oError);
+}
+
+void cInterruptibleBlockingResolver::storeResult(const string &strHost, const boost::asio::ip::address &oAddress, const boost::system::error_code &oError)
+{
+    if(!oError)
+        cEndpointResolverCache::getInstance().insert(strHost, oAddress);
+    //Only cache genuine answers from the resolver, not our own timeouts / cancellations
+    else if(oError != boost::asio::error::operation_aborted && oError != boost::asio::error::timed_out)
+        cEndpointResolverCache::getInstance().insertFailure(strHost, oError);
+}
+
+void cInterruptibleBlockingResolver::cancelCurrrentOperations()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    if(!m_bResolving)
+        return;
+
+    m_bCancelRequested = true;
+
+    if(m_pCurrentLookup)
+    {
+        boost::lock_guard<boost::mutex> oLookupLock(m_pCurrentLookup->m_oMutex);
+        m_bLookupCancelled = true;
+        m_pCurrentLookup->m_oCondition.notify_all();
+    }
+}
+
+boost::system::error_code cInterruptibleBlockingResolver::getLastError() const
+{
+    return m_oLastError;
+}
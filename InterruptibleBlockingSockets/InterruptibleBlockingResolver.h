@@ -0,0 +1,71 @@
+#ifndef INTERRUPTIBLE_BLOCKING_RESOLVER_H
+#define INTERRUPTIBLE_BLOCKING_RESOLVER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <string>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+//Local includes
+#include "EndpointResolverCache.h"
+
+//Host name to IPv4 address resolution for the socket classes' createEndpoint().
+//Dotted addresses are parsed directly and names are looked up in cEndpointResolverCache before going to the system
+//resolver. The lookup honours a timeout and can be interrupted with cancelCurrrentOperations().
+//
+//getaddrinfo() itself can't be interrupted, so a timed out or cancelled lookup is abandoned rather than aborted.
+//Lookups run on cEndpointResolverCache's lookup threads, shared by every resolver waiting for the same name. An
+//abandoned lookup finishes there without holding up the socket or the resolver's destruction, and its answer still
+//goes into the cache.
+
+class cInterruptibleBlockingResolver
+{
+public:
+    cInterruptibleBlockingResolver();
+
+    //A timeout of 0 waits indefinitely
+    bool                            resolve(const std::string &strHost, boost::asio::ip::address &oAddress, uint32_t u32Timeout_ms = 0);
+
+    void                            cancelCurrrentOperations();
+
+    //The steps of resolve() around the system lookup, for callers doing the lookup themselves (the coroutine connects).
+    //findWithoutLookup() answers dotted addresses and cached names, storeResult() caches what a lookup returned.
+    static bool                     findWithoutLookup(const std::string &strHost, boost::asio::ip::address &oAddress, boost::system::error_code &oError);
+    static void                     storeResult(const std::string &strHost, const boost::asio::ip::address &oAddress, const boost::system::error_code &oError);
+
+    boost::system::error_code       getLastError() const;
+
+private:
+    //Guards the members below against a concurrent cancelCurrrentOperations()
+    boost::mutex                    m_oMutex;
+    //Set for the whole of resolve() so that a cancel arriving before the lookup has started isn't lost
+    bool                            m_bResolving;
+    bool                            m_bCancelRequested;
+    boost::shared_ptr<cEndpointResolverCache::cLookup> m_pCurrentLookup;
+    //Tells this resolver's wait to give up. Guarded by m_pCurrentLookup's mutex, as other resolvers may share it.
+    bool                            m_bLookupCancelled;
+
+    boost::system::error_code       m_oLastError;
+};
+
+#endif // INTERRUPTIBLE_BLOCKING_RESOLVER_H
@@ -0,0 +1,435 @@
+#ifdef __linux__
+
+//System includes
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPBulkConnector.h"
+#include "SocketReadinessWaiter.h"
+
+using namespace std;
+
+namespace
+{
+    //Peer waiting for no lookup
+    const uint32_t NO_LOOKUP = 0xffffffff;
+
+    boost::system::error_code getErrno()
+    {
+        return boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+
+    void signalEventFD(int iFD)
+    {
+        if(iFD < 0)
+            return;
+
+        uint64_t u64Increment = 1;
+        ssize_t iResult = write(iFD, &u64Increment, sizeof(u64Increment));
+        (void)iResult; //Only fails if the counter would overflow, in which case it is signalled already
+    }
+
+    void clearEventFD(int iFD)
+    {
+        if(iFD < 0)
+            return;
+
+        uint64_t u64Count;
+        ssize_t iResult = read(iFD, &u64Count, sizeof(u64Count));
+        (void)iResult; //EAGAIN if it wasn't signalled
+    }
+}
+
+cInterruptibleBlockingTCPBulkConnector::cPeer::cPeer(const string &strPeerAddress, uint16_t u16PeerPort) :
+    m_strPeerAddress(strPeerAddress),
+    m_u16PeerPort(u16PeerPort),
+    m_u32Elapsed_ms(0)
+{
+}
+
+cInterruptibleBlockingTCPBulkConnector::cLookups::cLookup::cLookup(const string &strHost) :
+    m_strHost(strHost),
+    m_pResolver(new cInterruptibleBlockingResolver()),
+    m_bDone(false)
+{
+}
+
+cInterruptibleBlockingTCPBulkConnector::cLookups::cLookups() :
+    m_iEventFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+cInterruptibleBlockingTCPBulkConnector::cLookups::~cLookups()
+{
+    if(m_iEventFD >= 0)
+        close(m_iEventFD);
+}
+
+cInterruptibleBlockingTCPBulkConnector::cInterruptibleBlockingTCPBulkConnector(const string &strName) :
+    m_bCancelRequested(false),
+    m_iEventFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    m_strName(strName)
+{
+    if(m_iEventFD < 0)
+        cout << "cInterruptibleBlockingTCPBulkConnector::cInterruptibleBlockingTCPBulkConnector(): Unable to create eventfd. Connects will not be interruptible." << endl;
+}
+
+cInterruptibleBlockingTCPBulkConnector::~cInterruptibleBlockingTCPBulkConnector()
+{
+    if(m_iEventFD >= 0)
+        close(m_iEventFD);
+}
+
+uint32_t cInterruptibleBlockingTCPBulkConnector::connect(vector<cPeer> &voPeers, uint32_t u32Timeout_ms, const boost::function<void(cPeer &)> &fnConnected)
+{
+    int64_t i64Start_ns = cSocketReadinessWaiter::getCurrentTime_ns();
+    int64_t i64Deadline_ns = cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms);
+
+    uint32_t u32NConnected = 0;
+    uint32_t u32NUnfinished = 0;
+
+    //Per peer: the descriptor of its connect in flight, the lookup it is waiting for and whether it has its result
+    vector<int> viFDs(voPeers.size(), -1);
+    vector<uint32_t> vu32LookupNos(voPeers.size(), NO_LOOKUP);
+    vector<bool> vbFinished(voPeers.size(), true);
+
+    boost::shared_ptr<cLookups> pLookups(new cLookups());
+    map<string, uint32_t> oLookupNos;
+
+    for(uint32_t u32PeerNo = 0; u32PeerNo < voPeers.size(); u32PeerNo++)
+    {
+        cPeer &oPeer = voPeers[u32PeerNo];
+
+        oPeer.m_pSocket.reset();
+        oPeer.m_oError = boost::system::error_code();
+        oPeer.m_u32Elapsed_ms = 0;
+
+        boost::asio::ip::address oAddress;
+
+        if(cInterruptibleBlockingResolver::findWithoutLookup(oPeer.m_strPeerAddress, oAddress, oPeer.m_oError))
+        {
+            if(!oPeer.m_oError)
+                viFDs[u32PeerNo] = startConnect(oAddress, oPeer.m_u16PeerPort, oPeer.m_oError);
+        }
+        else
+        {
+            //One lookup per name however many peers share it
+            map<string, uint32_t>::iterator it = oLookupNos.find(oPeer.m_strPeerAddress);
+            if(it == oLookupNos.end())
+            {
+                it = oLookupNos.insert(make_pair(oPeer.m_strPeerAddress, (uint32_t)pLookups->m_voLookups.size())).first;
+                pLookups->m_voLookups.push_back(cLookups::cLookup(oPeer.m_strPeerAddress));
+            }
+
+            vu32LookupNos[u32PeerNo] = it->second;
+        }
+
+        if(oPeer.m_oError)
+            continue;
+
+        vbFinished[u32PeerNo] = false;
+        u32NUnfinished++;
+    }
+
+    if(!pLookups->m_voLookups.empty())
+    {
+        {
+            boost::lock_guard<boost::mutex> oLock(m_oMutex);
+            m_pLookups = pLookups;
+        }
+
+        for(uint32_t u32LookupNo = 0; u32LookupNo < pLookups->m_voLookups.size(); u32LookupNo++)
+        {
+            boost::thread oLookupThread(boost::bind(&cInterruptibleBlockingTCPBulkConnector::lookupThreadFunction, pLookups, u32LookupNo, u32Timeout_ms));
+            oLookupThread.detach();
+        }
+    }
+
+    vector<bool> vbLookupHandled(pLookups->m_voLookups.size(), false);
+    vector<pollfd> voPollFDs;
+    vector<uint32_t> vu32PolledPeerNos;
+    boost::system::error_code oStopError;
+
+    while(u32NUnfinished)
+    {
+        {
+            boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+            if(m_bCancelRequested)
+                oStopError = boost::asio::error::operation_aborted;
+        }
+
+        if(!oStopError && i64Deadline_ns && cSocketReadinessWaiter::getCurrentTime_ns() >= i64Deadline_ns)
+            oStopError = boost::asio::error::timed_out;
+
+        if(oStopError)
+            break;
+
+        voPollFDs.clear();
+        vu32PolledPeerNos.clear();
+
+        pollfd oPollFD;
+        oPollFD.events = POLLIN;
+        oPollFD.revents = 0;
+
+        oPollFD.fd = m_iEventFD;
+        voPollFDs.push_back(oPollFD);
+        oPollFD.fd = pLookups->m_iEventFD;
+        voPollFDs.push_back(oPollFD);
+
+        //Completion, also an immediate one, is reported as the descriptor becoming writable
+        oPollFD.events = POLLOUT;
+        for(uint32_t u32PeerNo = 0; u32PeerNo < voPeers.size(); u32PeerNo++)
+        {
+            if(viFDs[u32PeerNo] < 0)
+                continue;
+
+            oPollFD.fd = viFDs[u32PeerNo];
+            voPollFDs.push_back(oPollFD);
+            vu32PolledPeerNos.push_back(u32PeerNo);
+        }
+
+        timespec oTimeout;
+        timespec *pTimeout = NULL;
+
+        if(i64Deadline_ns)
+        {
+            int64_t i64Remaining_ns = max<int64_t>(i64Deadline_ns - cSocketReadinessWaiter::getCurrentTime_ns(), 0);
+
+            oTimeout.tv_sec = i64Remaining_ns / 1000000000LL;
+            oTimeout.tv_nsec = i64Remaining_ns % 1000000000LL;
+            pTimeout = &oTimeout;
+        }
+
+        int iResult = ppoll(&voPollFDs[0], voPollFDs.size(), pTimeout, NULL);
+
+        if(iResult < 0 && errno != EINTR)
+        {
+            oStopError = getErrno();
+            break;
+        }
+
+        if(iResult <= 0)
+            continue; //Re-evaluates the deadline above
+
+        for(uint32_t u32PolledNo = 0; u32PolledNo < vu32PolledPeerNos.size(); u32PolledNo++)
+        {
+            if(!voPollFDs[u32PolledNo + 2].revents)
+                continue;
+
+            uint32_t u32PeerNo = vu32PolledPeerNos[u32PolledNo];
+            cPeer &oPeer = voPeers[u32PeerNo];
+            int iFD = viFDs[u32PeerNo];
+
+            int iError = 0;
+            socklen_t iLength = sizeof(iError);
+
+            if(getsockopt(iFD, SOL_SOCKET, SO_ERROR, &iError, &iLength) != 0)
+                oPeer.m_oError = getErrno();
+            else if(iError)
+                oPeer.m_oError = boost::system::error_code(iError, boost::asio::error::get_system_category());
+
+            if(oPeer.m_oError)
+                close(iFD);
+            else
+                oPeer.m_pSocket = createSocket(iFD, oPeer, oPeer.m_oError);
+
+            viFDs[u32PeerNo] = -1;
+            vbFinished[u32PeerNo] = true;
+            oPeer.m_u32Elapsed_ms = (cSocketReadinessWaiter::getCurrentTime_ns() - i64Start_ns) / 1000000;
+            u32NUnfinished--;
+
+            if(oPeer.m_pSocket)
+            {
+                u32NConnected++;
+
+                if(fnConnected)
+                    fnConnected(oPeer);
+            }
+        }
+
+        if(voPollFDs[1].revents)
+        {
+            clearEventFD(pLookups->m_iEventFD);
+
+            boost::lock_guard<boost::mutex> oLock(pLookups->m_oMutex);
+
+            for(uint32_t u32LookupNo = 0; u32LookupNo < pLookups->m_voLookups.size(); u32LookupNo++)
+            {
+                const cLookups::cLookup &oLookup = pLookups->m_voLookups[u32LookupNo];
+
+                if(!oLookup.m_bDone || vbLookupHandled[u32LookupNo])
+                    continue;
+
+                vbLookupHandled[u32LookupNo] = true;
+
+                for(uint32_t u32PeerNo = 0; u32PeerNo < voPeers.size(); u32PeerNo++)
+                {
+                    if(vu32LookupNos[u32PeerNo] != u32LookupNo || vbFinished[u32PeerNo])
+                        continue;
+
+                    cPeer &oPeer = voPeers[u32PeerNo];
+
+                    oPeer.m_oError = oLookup.m_oError;
+                    if(!oPeer.m_oError)
+                        viFDs[u32PeerNo] = startConnect(oLookup.m_oAddress, oPeer.m_u16PeerPort, oPeer.m_oError);
+
+                    if(oPeer.m_oError)
+                    {
+                        vbFinished[u32PeerNo] = true;
+                        oPeer.m_u32Elapsed_ms = (cSocketReadinessWaiter::getCurrentTime_ns() - i64Start_ns) / 1000000;
+                        u32NUnfinished--;
+                    }
+                }
+            }
+        }
+    }
+
+    //Whatever is left stopped at the deadline, with a cancel or (unlikely) a failed ppoll()
+    for(uint32_t u32PeerNo = 0; u32PeerNo < voPeers.size(); u32PeerNo++)
+    {
+        if(vbFinished[u32PeerNo])
+            continue;
+
+        if(viFDs[u32PeerNo] >= 0)
+            close(viFDs[u32PeerNo]);
+
+        voPeers[u32PeerNo].m_oError = oStopError;
+        voPeers[u32PeerNo].m_u32Elapsed_ms = (cSocketReadinessWaiter::getCurrentTime_ns() - i64Start_ns) / 1000000;
+    }
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        //Lookups still running are abandoned. Their answers still go into the cache.
+        m_pLookups.reset();
+
+        //The cancel has been used up
+        m_bCancelRequested = false;
+        clearEventFD(m_iEventFD);
+    }
+
+    cout << "cInterruptibleBlockingTCPBulkConnector::connect(): \"" << m_strName << "\" connected to " << u32NConnected
+         << " of " << voPeers.size() << " peers in " << (cSocketReadinessWaiter::getCurrentTime_ns() - i64Start_ns) / 1000000 << " ms." << endl;
+
+    return u32NConnected;
+}
+
+void cInterruptibleBlockingTCPBulkConnector::lookupThreadFunction(boost::shared_ptr<cLookups> pLookups, uint32_t u32LookupNo, uint32_t u32Timeout_ms)
+{
+    cLookups::cLookup &oLookup = pLookups->m_voLookups[u32LookupNo];
+
+    boost::asio::ip::address oAddress;
+    bool bResolved = oLookup.m_pResolver->resolve(oLookup.m_strHost, oAddress, u32Timeout_ms);
+
+    {
+        boost::lock_guard<boost::mutex> oLock(pLookups->m_oMutex);
+
+        oLookup.m_bDone = true;
+        oLookup.m_oAddress = oAddress;
+        oLookup.m_oError = bResolved ? boost::system::error_code() : oLookup.m_pResolver->getLastError();
+    }
+
+    signalEventFD(pLookups->m_iEventFD);
+}
+
+int cInterruptibleBlockingTCPBulkConnector::startConnect(const boost::asio::ip::address &oAddress, uint16_t u16PeerPort, boost::system::error_code &oError)
+{
+    //The socket classes are IPv4 only
+    if(!oAddress.is_v4())
+    {
+        oError = boost::asio::error::address_family_not_supported;
+        return -1;
+    }
+
+    int iFD = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(iFD < 0)
+    {
+        oError = getErrno();
+        return -1;
+    }
+
+    //The same options as openAndConnect() sets
+    int iReceiveBufferSize = 64 * 1024 * 1024;
+    int iReuseAddress = 1;
+    setsockopt(iFD, SOL_SOCKET, SO_RCVBUF, &iReceiveBufferSize, sizeof(iReceiveBufferSize));
+    setsockopt(iFD, SOL_SOCKET, SO_REUSEADDR, &iReuseAddress, sizeof(iReuseAddress));
+
+    boost::asio::ip::tcp::endpoint oPeerEndpoint(oAddress, u16PeerPort);
+
+    if(::connect(iFD, oPeerEndpoint.data(), oPeerEndpoint.size()) != 0 && errno != EINPROGRESS)
+    {
+        oError = getErrno();
+        close(iFD);
+        return -1;
+    }
+
+    return iFD;
+}
+
+boost::shared_ptr<cInterruptibleBlockingTCPSocket> cInterruptibleBlockingTCPBulkConnector::createSocket(int iFD, const cPeer &oPeer, boost::system::error_code &oError)
+{
+    //As in cTCPEventEngine::releaseToSocket() the socket classes are given a blocking descriptor
+    int iFlags = fcntl(iFD, F_GETFL, 0);
+    if(iFlags < 0 || fcntl(iFD, F_SETFL, iFlags & ~O_NONBLOCK) != 0)
+    {
+        oError = getErrno();
+        close(iFD);
+        return boost::shared_ptr<cInterruptibleBlockingTCPSocket>();
+    }
+
+    stringstream oSS;
+    oSS << m_strName << " " << oPeer.m_strPeerAddress << ":" << oPeer.m_u16PeerPort;
+
+    boost::shared_ptr<cInterruptibleBlockingTCPSocket> pSocket(new cInterruptibleBlockingTCPSocket(oSS.str()));
+
+    if(!pSocket->attachDescriptor(iFD))
+    {
+        oError = boost::asio::error::bad_descriptor;
+        close(iFD);
+        return boost::shared_ptr<cInterruptibleBlockingTCPSocket>();
+    }
+
+    return pSocket;
+}
+
+void cInterruptibleBlockingTCPBulkConnector::cancelCurrrentOperations()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_bCancelRequested = true;
+    signalEventFD(m_iEventFD);
+
+    //connect() doesn't wait for its lookups, but this lets their threads finish early
+    if(m_pLookups)
+    {
+        for(uint32_t u32LookupNo = 0; u32LookupNo < m_pLookups->m_voLookups.size(); u32LookupNo++)
+            m_pLookups->m_voLookups[u32LookupNo].m_pResolver->cancelCurrrentOperations();
+    }
+}
+
+std::string cInterruptibleBlockingTCPBulkConnector::getName() const
+{
+    return m_strName;
+}
+
+#endif // __linux__
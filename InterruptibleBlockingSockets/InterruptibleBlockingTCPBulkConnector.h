@@ -0,0 +1,114 @@
+#ifndef INTERRUPTIBLE_BLOCKING_TCP_BULK_CONNECTOR_H
+#define INTERRUPTIBLE_BLOCKING_TCP_BULK_CONNECTOR_H
+
+//Connects to many peers at once under a single deadline, so that unreachable peers cost one timeout in total rather than
+//one each. Linux only.
+//
+//Every connect is started straight away as a non-blocking connect and all of them are waited for together with one
+//ppoll() on the calling thread, as cTCPEventEngine::connect() does. Names that are neither dotted addresses nor cached
+//are looked up first, each on a thread of its own, and their connects start as the answers arrive. Connected
+//descriptors are handed to a cInterruptibleBlockingTCPSocket with attachDescriptor().
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+
+#include <string>
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/system/error_code.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPSocket.h"
+#include "InterruptibleBlockingResolver.h"
+
+class cInterruptibleBlockingTCPBulkConnector
+{
+public:
+    class cPeer
+    {
+    public:
+        cPeer(const std::string &strPeerAddress, uint16_t u16PeerPort);
+
+        std::string                     m_strPeerAddress;
+        uint16_t                        m_u16PeerPort;
+
+        //Results. The socket is only set if the connection succeeded. Errors are timed_out for peers that didn't
+        //connect before the deadline and operation_aborted after a cancel.
+        boost::shared_ptr<cInterruptibleBlockingTCPSocket> m_pSocket;
+        boost::system::error_code       m_oError;
+        //From the start of connect() until this peer succeeded or failed
+        uint32_t                        m_u32Elapsed_ms;
+    };
+
+    cInterruptibleBlockingTCPBulkConnector(const std::string &strName = "");
+    ~cInterruptibleBlockingTCPBulkConnector();
+
+    //Connects to all peers within u32Timeout_ms (0 waits indefinitely). Returns the number of peers connected.
+    //fnConnected, if set, is called on the calling thread as each peer connects, so that its socket can be used without
+    //waiting for the slowest peer.
+    uint32_t                            connect(std::vector<cPeer> &voPeers, uint32_t u32Timeout_ms,
+                                                const boost::function<void(cPeer &)> &fnConnected = boost::function<void(cPeer &)>());
+
+    //Interrupt a connect() in progress on another thread. A cancel issued while none is in progress stops the next one.
+    void                                cancelCurrrentOperations();
+
+    std::string                         getName() const;
+
+private:
+    //Name lookups of one connect(). Shared with the lookup threads, which may outlive connect() after a cancel or timeout.
+    class cLookups
+    {
+    public:
+        class cLookup
+        {
+        public:
+            cLookup(const std::string &strHost);
+
+            std::string                     m_strHost;
+            boost::shared_ptr<cInterruptibleBlockingResolver> m_pResolver;
+
+            bool                            m_bDone;
+            boost::asio::ip::address        m_oAddress;
+            boost::system::error_code       m_oError;
+        };
+
+        cLookups();
+        ~cLookups();
+
+        //Guards the results in m_voLookups. Entries are only added before the lookup threads start.
+        boost::mutex                    m_oMutex;
+        std::vector<cLookup>            m_voLookups;
+        //Signalled as each lookup finishes
+        int                             m_iEventFD;
+    };
+
+    //Guards the members below against a concurrent cancelCurrrentOperations()
+    boost::mutex                        m_oMutex;
+    bool                                m_bCancelRequested;
+    boost::shared_ptr<cLookups>         m_pLookups;
+    //Signalled by cancelCurrrentOperations()
+    int                                 m_iEventFD;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+
+    static void                         lookupThreadFunction(boost::shared_ptr<cLookups> pLookups, uint32_t u32LookupNo, uint32_t u32Timeout_ms);
+
+    //Starts a non-blocking connect. Returns the descriptor, or -1 with oError set if the connect failed straight away.
+    static int                          startConnect(const boost::asio::ip::address &oAddress, uint16_t u16PeerPort, boost::system::error_code &oError);
+    //Hands a connected descriptor to a new socket
+    boost::shared_ptr<cInterruptibleBlockingTCPSocket> createSocket(int iFD, const cPeer &oPeer, boost::system::error_code &oError);
+};
+
+#endif // __linux__
+
+#endif // INTERRUPTIBLE_BLOCKING_TCP_BULK_CONNECTOR_H
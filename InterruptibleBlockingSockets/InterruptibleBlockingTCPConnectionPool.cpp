@@ -0,0 +1,567 @@
+
+//System includes
+#include <iostream>
+#include <sstream>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPConnectionPool.h"
+
+using namespace std;
+
+cInterruptibleBlockingTCPConnectionPool::cIdleConnection::cIdleConnection(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket) :
+    m_pSocket(pSocket),
+    m_oLastCheckedTime(boost::posix_time::microsec_clock::universal_time())
+{
+}
+
+cInterruptibleBlockingTCPConnectionPool::cEndpoint::cEndpoint() :
+    m_u16PeerPort(0),
+    m_u32NConnections(0),
+    m_u32NInUse(0),
+    m_u32NBeingChecked(0),
+    m_u32NConsecutiveFailures(0)
+{
+}
+
+cInterruptibleBlockingTCPConnectionPool::cInterruptibleBlockingTCPConnectionPool(const string &strName) :
+    m_bStopRequested(false),
+    m_bMaintenanceRequested(false),
+    m_u32ConnectTimeout_ms(1000),
+    m_u32HealthCheckInterval_ms(5000),
+    m_u32MinBackoff_ms(100),
+    m_u32MaxBackoff_ms(30000),
+    m_oRandomGenerator(boost::posix_time::microsec_clock::universal_time().time_of_day().total_microseconds()),
+    m_u64NConnectsSucceeded(0),
+    m_u64NConnectsFailed(0),
+    m_u64NConnectionsDropped(0),
+    m_u32CancelCount(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingTCPConnectionPool::~cInterruptibleBlockingTCPConnectionPool()
+{
+    stop();
+}
+
+bool cInterruptibleBlockingTCPConnectionPool::start(uint32_t u32ConnectTimeout_ms, uint32_t u32HealthCheckInterval_ms,
+                                                    uint32_t u32MinBackoff_ms, uint32_t u32MaxBackoff_ms)
+{
+    stop();
+
+    if(!u32ConnectTimeout_ms || !u32HealthCheckInterval_ms || !u32MinBackoff_ms || u32MaxBackoff_ms < u32MinBackoff_ms)
+    {
+        cout << "cInterruptibleBlockingTCPConnectionPool::start(): Timeout, interval and backoffs must be non-zero with the maximum backoff at least the minimum." << endl;
+        return false;
+    }
+
+    m_u32ConnectTimeout_ms = u32ConnectTimeout_ms;
+    m_u32HealthCheckInterval_ms = u32HealthCheckInterval_ms;
+    m_u32MinBackoff_ms = u32MinBackoff_ms;
+    m_u32MaxBackoff_ms = u32MaxBackoff_ms;
+
+    m_bStopRequested = false;
+    m_pMaintenanceThread.reset(new boost::thread(&cInterruptibleBlockingTCPConnectionPool::maintenanceThreadFunction, this));
+
+    return true;
+}
+
+void cInterruptibleBlockingTCPConnectionPool::stop()
+{
+    if(!m_pMaintenanceThread)
+        return;
+
+    m_bStopRequested = true;
+
+    //The cancel can land just before a connect starts waiting, so repeat it until the thread has exited
+    do
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+#ifdef __linux__
+        if(m_pConnector)
+            m_pConnector->cancelCurrrentOperations();
+#else
+        if(m_pConnectingSocket)
+            m_pConnectingSocket->cancelCurrrentOperations();
+#endif
+
+        requestMaintenance();
+    }
+    while(!m_pMaintenanceThread->timed_join(boost::posix_time::milliseconds(10)));
+
+    m_pMaintenanceThread.reset();
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+        for(map<string, cEndpoint>::iterator it = m_oEndpoints.begin(); it != m_oEndpoints.end(); ++it)
+        {
+            for(uint32_t u32ConnectionNo = 0; u32ConnectionNo < it->second.m_dqIdleConnections.size(); u32ConnectionNo++)
+                it->second.m_dqIdleConnections[u32ConnectionNo].m_pSocket->close();
+
+            it->second.m_dqIdleConnections.clear();
+            it->second.m_u32NConsecutiveFailures = 0;
+            it->second.m_oNextConnectTime = boost::posix_time::ptime();
+        }
+    }
+
+    //Wake anyone still waiting for a connection
+    cancelCurrrentOperations();
+}
+
+bool cInterruptibleBlockingTCPConnectionPool::isRunning() const
+{
+    return m_pMaintenanceThread && !m_bStopRequested;
+}
+
+void cInterruptibleBlockingTCPConnectionPool::addEndpoint(const string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32NConnections)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    cEndpoint &oEndpoint = m_oEndpoints[getEndpointKey(strPeerAddress, u16PeerPort)];
+    oEndpoint.m_strPeerAddress = strPeerAddress;
+    oEndpoint.m_u16PeerPort = u16PeerPort;
+    oEndpoint.m_u32NConnections = u32NConnections;
+
+    requestMaintenance();
+}
+
+boost::shared_ptr<cInterruptibleBlockingTCPSocket> cInterruptibleBlockingTCPConnectionPool::acquire(const string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms)
+{
+    string strKey = getEndpointKey(strPeerAddress, u16PeerPort);
+
+    uint32_t u32CancelCount = m_u32CancelCount.load();
+    boost::system_time oDeadline = boost::get_system_time() + boost::posix_time::milliseconds(u32Timeout_ms);
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    for(;;)
+    {
+        if(u32CancelCount != m_u32CancelCount.load() || !isRunning())
+            return boost::shared_ptr<cInterruptibleBlockingTCPSocket>();
+
+        map<string, cEndpoint>::iterator itEndpoint = m_oEndpoints.find(strKey);
+        if(itEndpoint == m_oEndpoints.end())
+        {
+            cout << "cInterruptibleBlockingTCPConnectionPool::acquire(): No connections are kept for " << strKey << ". See addEndpoint()." << endl;
+            return boost::shared_ptr<cInterruptibleBlockingTCPSocket>();
+        }
+
+        cEndpoint &oEndpoint = itEndpoint->second;
+
+        if(!oEndpoint.m_dqIdleConnections.empty())
+        {
+            //Most recently used first. The maintenance thread checks from the other end.
+            boost::shared_ptr<cInterruptibleBlockingTCPSocket> pSocket = oEndpoint.m_dqIdleConnections.back().m_pSocket;
+            oEndpoint.m_dqIdleConnections.pop_back();
+
+            oEndpoint.m_u32NInUse++;
+            m_oInUseEndpointKeys[pSocket.get()] = strKey;
+
+            //A single non-blocking system call, so that a connection the peer closed while idle is never handed out
+            oLock.unlock();
+
+            if(isIdleConnectionHealthy(*pSocket))
+                return pSocket;
+
+            pSocket->close();
+
+            oLock.lock();
+
+            oEndpoint.m_u32NInUse--;
+            m_oInUseEndpointKeys.erase(pSocket.get());
+            m_u64NConnectionsDropped++;
+
+            requestMaintenance();
+            continue;
+        }
+
+        if(u32Timeout_ms)
+        {
+            if(boost::get_system_time() >= oDeadline)
+                return boost::shared_ptr<cInterruptibleBlockingTCPSocket>();
+
+            m_oAvailableCondition.timed_wait(oLock, oDeadline);
+        }
+        else
+        {
+            m_oAvailableCondition.wait(oLock);
+        }
+    }
+}
+
+void cInterruptibleBlockingTCPConnectionPool::release(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, bool bHealthy)
+{
+    if(!pSocket)
+        return;
+
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    map<cInterruptibleBlockingTCPSocket*, string>::iterator itKey = m_oInUseEndpointKeys.find(pSocket.get());
+    if(itKey == m_oInUseEndpointKeys.end())
+    {
+        cout << "cInterruptibleBlockingTCPConnectionPool::release(): Socket \"" << pSocket->getName() << "\" was not handed out by this pool." << endl;
+        return;
+    }
+
+    cEndpoint &oEndpoint = m_oEndpoints[itKey->second];
+    m_oInUseEndpointKeys.erase(itKey);
+    oEndpoint.m_u32NInUse--;
+
+    //Surplus if the target was lowered while the connection was in use
+    uint32_t u32NConnections = oEndpoint.m_dqIdleConnections.size() + oEndpoint.m_u32NInUse + oEndpoint.m_u32NBeingChecked;
+
+    if(!bHealthy || !isRunning() || u32NConnections >= oEndpoint.m_u32NConnections)
+    {
+        pSocket->close();
+        m_u64NConnectionsDropped++;
+
+        requestMaintenance();
+        return;
+    }
+
+    oEndpoint.m_dqIdleConnections.push_back(cIdleConnection(pSocket));
+
+    //Waiters may be after other endpoints, so wake them all
+    m_oAvailableCondition.notify_all();
+}
+
+void cInterruptibleBlockingTCPConnectionPool::cancelCurrrentOperations()
+{
+    m_u32CancelCount++;
+
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    m_oAvailableCondition.notify_all();
+}
+
+void cInterruptibleBlockingTCPConnectionPool::requestMaintenance()
+{
+    m_bMaintenanceRequested = true;
+    m_oMaintenanceCondition.notify_one();
+}
+
+void cInterruptibleBlockingTCPConnectionPool::maintenanceThreadFunction()
+{
+    cout << "cInterruptibleBlockingTCPConnectionPool::maintenanceThreadFunction(): Maintenance thread for \"" << m_strName << "\" started." << endl;
+
+    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+
+    while(!m_bStopRequested)
+    {
+        m_bMaintenanceRequested = false;
+
+        boost::posix_time::ptime oNextRoundTime = maintainEndpoints(oLock);
+
+        //Requests made while the lock was released for connecting or checking are picked up straight away
+        if(!m_bMaintenanceRequested && !m_bStopRequested)
+            m_oMaintenanceCondition.timed_wait(oLock, oNextRoundTime);
+    }
+
+    cout << "cInterruptibleBlockingTCPConnectionPool::maintenanceThreadFunction(): Maintenance thread for \"" << m_strName << "\" exiting." << endl;
+}
+
+boost::posix_time::ptime cInterruptibleBlockingTCPConnectionPool::maintainEndpoints(boost::unique_lock<boost::mutex> &oLock)
+{
+    boost::posix_time::ptime oNow = boost::posix_time::microsec_clock::universal_time();
+    boost::posix_time::ptime oNextRoundTime = oNow + boost::posix_time::milliseconds(m_u32HealthCheckInterval_ms);
+    boost::posix_time::time_duration oHealthCheckInterval = boost::posix_time::milliseconds(m_u32HealthCheckInterval_ms);
+
+    //Endpoints are never removed so the iterator survives releasing the lock
+    for(map<string, cEndpoint>::iterator it = m_oEndpoints.begin(); it != m_oEndpoints.end() && !m_bStopRequested; ++it)
+    {
+        cEndpoint &oEndpoint = it->second;
+
+        //Drop surplus idle connections after the target was lowered
+        while(!oEndpoint.m_dqIdleConnections.empty() &&
+              oEndpoint.m_dqIdleConnections.size() + oEndpoint.m_u32NInUse + oEndpoint.m_u32NBeingChecked > oEndpoint.m_u32NConnections)
+        {
+            oEndpoint.m_dqIdleConnections.front().m_pSocket->close();
+            oEndpoint.m_dqIdleConnections.pop_front();
+            m_u64NConnectionsDropped++;
+        }
+
+        //Check connections that have sat idle for an interval. Taken out of the idle list meanwhile so that they can't be
+        //handed out. Checked ones go to the back, so this stops at the first one checked during this round.
+        while(!m_bStopRequested && !oEndpoint.m_dqIdleConnections.empty() &&
+              oEndpoint.m_dqIdleConnections.front().m_oLastCheckedTime + oHealthCheckInterval <= oNow)
+        {
+            cIdleConnection oConnection = oEndpoint.m_dqIdleConnections.front();
+            oEndpoint.m_dqIdleConnections.pop_front();
+            oEndpoint.m_u32NBeingChecked++;
+
+            oLock.unlock();
+            bool bHealthy = isIdleConnectionHealthy(*oConnection.m_pSocket);
+            oLock.lock();
+
+            oEndpoint.m_u32NBeingChecked--;
+
+            if(bHealthy)
+            {
+                oEndpoint.m_dqIdleConnections.push_back(cIdleConnection(oConnection.m_pSocket));
+                m_oAvailableCondition.notify_all();
+            }
+            else
+            {
+                cout << "cInterruptibleBlockingTCPConnectionPool::maintainEndpoints(): Dropping dead idle connection to " << it->first << "." << endl;
+                oConnection.m_pSocket->close();
+                m_u64NConnectionsDropped++;
+            }
+        }
+
+        if(!oEndpoint.m_dqIdleConnections.empty())
+            oNextRoundTime = min(oNextRoundTime, oEndpoint.m_dqIdleConnections.front().m_oLastCheckedTime + oHealthCheckInterval);
+    }
+
+    //Top up, unless backing off after failures. All endpoints together, so that one that can't be reached doesn't
+    //delay the others.
+    vector<string> vstrConnectKeys;
+
+    for(map<string, cEndpoint>::iterator it = m_oEndpoints.begin(); it != m_oEndpoints.end() && !m_bStopRequested; ++it)
+    {
+        cEndpoint &oEndpoint = it->second;
+
+        if(!oEndpoint.m_oNextConnectTime.is_not_a_date_time() &&
+           oEndpoint.m_oNextConnectTime > boost::posix_time::microsec_clock::universal_time())
+        {
+            oNextRoundTime = min(oNextRoundTime, oEndpoint.m_oNextConnectTime);
+            continue;
+        }
+
+        for(uint32_t u32NConnections = oEndpoint.m_dqIdleConnections.size() + oEndpoint.m_u32NInUse + oEndpoint.m_u32NBeingChecked;
+            u32NConnections < oEndpoint.m_u32NConnections; u32NConnections++)
+            vstrConnectKeys.push_back(it->first);
+    }
+
+    if(vstrConnectKeys.empty() || m_bStopRequested)
+        return oNextRoundTime;
+
+    connectEndpoints(vstrConnectKeys, oLock);
+
+    //Retry those that failed once their backoff is over
+    for(map<string, cEndpoint>::iterator it = m_oEndpoints.begin(); it != m_oEndpoints.end(); ++it)
+    {
+        if(!it->second.m_oNextConnectTime.is_not_a_date_time())
+            oNextRoundTime = min(oNextRoundTime, it->second.m_oNextConnectTime);
+    }
+
+    return oNextRoundTime;
+}
+
+void cInterruptibleBlockingTCPConnectionPool::connectEndpoints(const vector<string> &vstrEndpointKeys, boost::unique_lock<boost::mutex> &oLock)
+{
+    //Connections are handed to their endpoint (and to acquire()) as soon as they are made
+    vector<bool> vbConnected(vstrEndpointKeys.size(), false);
+
+#ifdef __linux__
+    vector<cInterruptibleBlockingTCPBulkConnector::cPeer> voPeers;
+
+    for(uint32_t u32ConnectNo = 0; u32ConnectNo < vstrEndpointKeys.size(); u32ConnectNo++)
+    {
+        const cEndpoint &oEndpoint = m_oEndpoints[vstrEndpointKeys[u32ConnectNo]];
+        voPeers.push_back(cInterruptibleBlockingTCPBulkConnector::cPeer(oEndpoint.m_strPeerAddress, oEndpoint.m_u16PeerPort));
+    }
+
+    boost::shared_ptr<cInterruptibleBlockingTCPBulkConnector> pConnector(new cInterruptibleBlockingTCPBulkConnector(m_strName));
+    m_pConnector = pConnector;
+
+    oLock.unlock();
+    pConnector->connect(voPeers, m_u32ConnectTimeout_ms, boost::bind(&cInterruptibleBlockingTCPConnectionPool::addConnection, this, _1));
+    oLock.lock();
+
+    m_pConnector.reset();
+
+    for(uint32_t u32ConnectNo = 0; u32ConnectNo < voPeers.size(); u32ConnectNo++)
+        vbConnected[u32ConnectNo] = voPeers[u32ConnectNo].m_pSocket ? true : false;
+#else
+    //One at a time
+    for(uint32_t u32ConnectNo = 0; u32ConnectNo < vstrEndpointKeys.size() && !m_bStopRequested; u32ConnectNo++)
+    {
+        cEndpoint &oEndpoint = m_oEndpoints[vstrEndpointKeys[u32ConnectNo]];
+        string strPeerAddress = oEndpoint.m_strPeerAddress;
+        uint16_t u16PeerPort = oEndpoint.m_u16PeerPort;
+
+        boost::shared_ptr<cInterruptibleBlockingTCPSocket> pSocket(new cInterruptibleBlockingTCPSocket(m_strName + " " + vstrEndpointKeys[u32ConnectNo]));
+        m_pConnectingSocket = pSocket;
+
+        oLock.unlock();
+        bool bConnected = pSocket->openAndConnect(strPeerAddress, u16PeerPort, m_u32ConnectTimeout_ms);
+        oLock.lock();
+
+        m_pConnectingSocket.reset();
+
+        if(!bConnected)
+        {
+            pSocket->close();
+            continue;
+        }
+
+        vbConnected[u32ConnectNo] = true;
+        m_u64NConnectsSucceeded++;
+
+        oEndpoint.m_dqIdleConnections.push_back(cIdleConnection(pSocket));
+        m_oAvailableCondition.notify_all();
+    }
+#endif
+
+    //Connections already made are closed by stop()
+    if(m_bStopRequested)
+        return;
+
+    //Per endpoint: connects that succeeded and failed
+    map<string, pair<uint32_t, uint32_t> > oResults;
+
+    for(uint32_t u32ConnectNo = 0; u32ConnectNo < vbConnected.size(); u32ConnectNo++)
+    {
+        pair<uint32_t, uint32_t> &oResult = oResults[vstrEndpointKeys[u32ConnectNo]];
+
+        if(vbConnected[u32ConnectNo])
+        {
+            oResult.first++;
+            continue;
+        }
+
+        oResult.second++;
+        m_u64NConnectsFailed++;
+    }
+
+    for(map<string, pair<uint32_t, uint32_t> >::iterator it = oResults.begin(); it != oResults.end(); ++it)
+    {
+        cEndpoint &oEndpoint = m_oEndpoints[it->first];
+
+        if(!it->second.second)
+        {
+            oEndpoint.m_u32NConsecutiveFailures = 0;
+            oEndpoint.m_oNextConnectTime = boost::posix_time::ptime();
+            continue;
+        }
+
+        //A round with any success starts the count again
+        oEndpoint.m_u32NConsecutiveFailures = it->second.first ? 1 : oEndpoint.m_u32NConsecutiveFailures + 1;
+
+        uint32_t u32Backoff_ms = getBackoff_ms(oEndpoint.m_u32NConsecutiveFailures);
+        oEndpoint.m_oNextConnectTime = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(u32Backoff_ms);
+
+        cout << "cInterruptibleBlockingTCPConnectionPool::connectEndpoints(): Unable to make " << it->second.second << " of "
+             << it->second.first + it->second.second << " connections to " << it->first << " (attempt "
+             << oEndpoint.m_u32NConsecutiveFailures << "). Retrying in " << u32Backoff_ms << " ms." << endl;
+    }
+}
+
+#ifdef __linux__
+void cInterruptibleBlockingTCPConnectionPool::addConnection(cInterruptibleBlockingTCPBulkConnector::cPeer &oPeer)
+{
+    //Called by the connector on the maintenance thread, which has released the lock
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    m_oEndpoints[getEndpointKey(oPeer.m_strPeerAddress, oPeer.m_u16PeerPort)].m_dqIdleConnections.push_back(cIdleConnection(oPeer.m_pSocket));
+    m_u64NConnectsSucceeded++;
+
+    m_oAvailableCondition.notify_all();
+}
+#endif
+
+uint32_t cInterruptibleBlockingTCPConnectionPool::getBackoff_ms(uint32_t u32NConsecutiveFailures)
+{
+    uint64_t u64Backoff_ms = m_u32MinBackoff_ms;
+
+    for(uint32_t u32FailureNo = 1; u32FailureNo < u32NConsecutiveFailures && u64Backoff_ms < m_u32MaxBackoff_ms; u32FailureNo++)
+        u64Backoff_ms *= 2;
+
+    if(u64Backoff_ms > m_u32MaxBackoff_ms)
+        u64Backoff_ms = m_u32MaxBackoff_ms;
+
+    //Half fixed, half random
+    boost::random::uniform_int_distribution<uint32_t> oJitter(u64Backoff_ms / 2, u64Backoff_ms);
+    return oJitter(m_oRandomGenerator);
+}
+
+bool cInterruptibleBlockingTCPConnectionPool::isIdleConnectionHealthy(cInterruptibleBlockingTCPSocket &oSocket)
+{
+    boost::asio::ip::tcp::socket *pSocket = oSocket.getBoostSocketPointer();
+
+    if(!pSocket->is_open())
+        return false;
+
+    //Anything left unread would be taken as the response to the next request
+    try
+    {
+        if(oSocket.getBytesAvailable())
+            return false;
+    }
+    catch(boost::system::system_error &e)
+    {
+        return false;
+    }
+
+    //Peek without blocking. An idle, healthy connection has nothing to read. End of file, a reset or unsolicited data
+    //all make it unusable.
+    boost::system::error_code oError;
+    boost::system::error_code oModeError;
+    char cByte;
+
+    bool bNonBlocking = pSocket->non_blocking();
+    pSocket->non_blocking(true, oModeError);
+    size_t u32NReceived = pSocket->receive(boost::asio::buffer(&cByte, 1), boost::asio::socket_base::message_peek, oError);
+    pSocket->non_blocking(bNonBlocking, oModeError);
+
+    return !u32NReceived && oError == boost::asio::error::would_block;
+}
+
+string cInterruptibleBlockingTCPConnectionPool::getEndpointKey(const string &strPeerAddress, uint16_t u16PeerPort)
+{
+    stringstream oSS;
+    oSS << strPeerAddress << ":" << u16PeerPort;
+    return oSS.str();
+}
+
+std::string cInterruptibleBlockingTCPConnectionPool::getName() const
+{
+    return m_strName;
+}
+
+uint32_t cInterruptibleBlockingTCPConnectionPool::getNIdleConnections(const string &strPeerAddress, uint16_t u16PeerPort)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    map<string, cEndpoint>::iterator itEndpoint = m_oEndpoints.find(getEndpointKey(strPeerAddress, u16PeerPort));
+    if(itEndpoint == m_oEndpoints.end())
+        return 0;
+
+    return itEndpoint->second.m_dqIdleConnections.size();
+}
+
+uint32_t cInterruptibleBlockingTCPConnectionPool::getNConnectionsInUse(const string &strPeerAddress, uint16_t u16PeerPort)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    map<string, cEndpoint>::iterator itEndpoint = m_oEndpoints.find(getEndpointKey(strPeerAddress, u16PeerPort));
+    if(itEndpoint == m_oEndpoints.end())
+        return 0;
+
+    return itEndpoint->second.m_u32NInUse;
+}
+
+uint64_t cInterruptibleBlockingTCPConnectionPool::getNConnectsSucceeded() const
+{
+    return m_u64NConnectsSucceeded.load();
+}
+
+uint64_t cInterruptibleBlockingTCPConnectionPool::getNConnectsFailed() const
+{
+    return m_u64NConnectsFailed.load();
+}
+
+uint64_t cInterruptibleBlockingTCPConnectionPool::getNConnectionsDropped() const
+{
+    return m_u64NConnectionsDropped.load();
+}
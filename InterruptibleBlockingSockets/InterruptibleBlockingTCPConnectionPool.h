@@ -0,0 +1,174 @@
+#ifndef INTERRUPTIBLE_BLOCKING_TCP_CONNECTION_POOL_H
+#define INTERRUPTIBLE_BLOCKING_TCP_CONNECTION_POOL_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPSocket.h"
+#include "InterruptibleBlockingTCPBulkConnector.h"
+
+//Keeps a number of connected cInterruptibleBlockingTCPSockets per peer endpoint ready to be handed out, so that request
+//paths don't pay for resolution and connection. A maintenance thread tops each endpoint up to its target count,
+//making all the connections missing across endpoints at once (on Linux with cInterruptibleBlockingTCPBulkConnector, so
+//that an unreachable peer costs a single connect timeout per round rather than holding up the others). It reconnects
+//with exponential backoff (plus jitter so that many clients don't retry in step) while the peer is
+//unreachable, and periodically checks idle connections for a close or reset by the peer.
+//
+//Connections are handed out exclusively. Return them with release(), flagging them unhealthy after an I/O error (or
+//if a response was left unread) to have the pool replace them. Release all connections before destroying the pool.
+
+class cInterruptibleBlockingTCPConnectionPool
+{
+public:
+    cInterruptibleBlockingTCPConnectionPool(const std::string &strName = "");
+    ~cInterruptibleBlockingTCPConnectionPool();
+
+    //Starts the maintenance thread. Backoff doubles from u32MinBackoff_ms per consecutive failed connect up to
+    //u32MaxBackoff_ms, and each wait is randomised between half and all of it.
+    bool                                start(uint32_t u32ConnectTimeout_ms = 1000, uint32_t u32HealthCheckInterval_ms = 5000,
+                                              uint32_t u32MinBackoff_ms = 100, uint32_t u32MaxBackoff_ms = 30000);
+    //Closes idle connections. Connections still handed out are closed when released.
+    void                                stop();
+
+    bool                                isRunning() const;
+
+    //Sets the number of connections kept for the endpoint, adding it if new. Connections are made in the background.
+    void                                addEndpoint(const std::string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32NConnections);
+
+    //Hands out an idle connection to the endpoint, waiting up to the timeout (0 waits indefinitely) for one if none is
+    //idle. Returns an empty pointer on timeout, cancel, stop or for an unknown endpoint.
+    boost::shared_ptr<cInterruptibleBlockingTCPSocket> acquire(const std::string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms = 0);
+    void                                release(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket, bool bHealthy = true);
+
+    //Wake any thread blocked in acquire(). It returns an empty pointer.
+    void                                cancelCurrrentOperations();
+
+    //Some accessors
+    std::string                         getName() const;
+
+    uint32_t                            getNIdleConnections(const std::string &strPeerAddress, uint16_t u16PeerPort);
+    uint32_t                            getNConnectionsInUse(const std::string &strPeerAddress, uint16_t u16PeerPort);
+    uint64_t                            getNConnectsSucceeded() const;
+    uint64_t                            getNConnectsFailed() const;
+    uint64_t                            getNConnectionsDropped() const;     //Found dead, released unhealthy or surplus
+
+private:
+    class cIdleConnection
+    {
+    public:
+        cIdleConnection(const boost::shared_ptr<cInterruptibleBlockingTCPSocket> &pSocket);
+
+        boost::shared_ptr<cInterruptibleBlockingTCPSocket> m_pSocket;
+        boost::posix_time::ptime        m_oLastCheckedTime;
+    };
+
+    class cEndpoint
+    {
+    public:
+        cEndpoint();
+
+        std::string                     m_strPeerAddress;
+        uint16_t                        m_u16PeerPort;
+        uint32_t                        m_u32NConnections;
+
+        //Oldest checked at the front
+        std::deque<cIdleConnection>     m_dqIdleConnections;
+        uint32_t                        m_u32NInUse;
+        uint32_t                        m_u32NBeingChecked;
+
+        uint32_t                        m_u32NConsecutiveFailures;
+        boost::posix_time::ptime        m_oNextConnectTime;
+    };
+
+    //Keyed by "address:port"
+    std::map<std::string, cEndpoint>    m_oEndpoints;
+    //Handed out sockets and the endpoint they belong to
+    std::map<cInterruptibleBlockingTCPSocket*, std::string> m_oInUseEndpointKeys;
+
+    boost::scoped_ptr<boost::thread>    m_pMaintenanceThread;
+    boost::atomic<bool>                 m_bStopRequested;
+    bool                                m_bMaintenanceRequested;
+
+#ifdef __linux__
+    //Connector of the maintenance thread's connects in progress, so that stop() can interrupt them. A new one per round
+    //so that a cancel arriving after a round has finished doesn't stop the next.
+    boost::shared_ptr<cInterruptibleBlockingTCPBulkConnector> m_pConnector;
+#else
+    //Socket currently being connected by the maintenance thread, so that stop() can interrupt it
+    boost::shared_ptr<cInterruptibleBlockingTCPSocket> m_pConnectingSocket;
+#endif
+
+    uint32_t                            m_u32ConnectTimeout_ms;
+    uint32_t                            m_u32HealthCheckInterval_ms;
+    uint32_t                            m_u32MinBackoff_ms;
+    uint32_t                            m_u32MaxBackoff_ms;
+
+    boost::random::mt19937              m_oRandomGenerator;
+
+    //Statistics
+    boost::atomic<uint64_t>             m_u64NConnectsSucceeded;
+    boost::atomic<uint64_t>             m_u64NConnectsFailed;
+    boost::atomic<uint64_t>             m_u64NConnectionsDropped;
+
+    //Guards everything above. Never held while connecting or checking connections.
+    boost::mutex                        m_oMutex;
+    //Signalled when a connection becomes idle (for acquire()) and when the maintenance thread has work
+    boost::condition_variable           m_oAvailableCondition;
+    boost::condition_variable           m_oMaintenanceCondition;
+    boost::atomic<uint32_t>             m_u32CancelCount;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+
+    void                                maintenanceThreadFunction();
+    //Wake the maintenance thread for an early round. Called with the lock held.
+    void                                requestMaintenance();
+    //One round of maintenance with the lock held. Returns the time at which the next round is due.
+    boost::posix_time::ptime            maintainEndpoints(boost::unique_lock<boost::mutex> &oLock);
+    //Makes one connection per entry of vstrEndpointKeys (an endpoint appears once per connection it is missing) and
+    //hands them to their endpoints, backing off those with failures. Called with the lock held, released meanwhile.
+    void                                connectEndpoints(const std::vector<std::string> &vstrEndpointKeys, boost::unique_lock<boost::mutex> &oLock);
+#ifdef __linux__
+    //Hands a connection to its endpoint as soon as the connector has made it
+    void                                addConnection(cInterruptibleBlockingTCPBulkConnector::cPeer &oPeer);
+#endif
+    uint32_t                            getBackoff_ms(uint32_t u32NConsecutiveFailures);
+
+    //Non-blocking check that an idle connection has not been closed by the peer and has no unsolicited data
+    static bool                         isIdleConnectionHealthy(cInterruptibleBlockingTCPSocket &oSocket);
+
+    static std::string                  getEndpointKey(const std::string &strPeerAddress, uint16_t u16PeerPort);
+};
+
+#endif // INTERRUPTIBLE_BLOCKING_TCP_CONNECTION_POOL_H
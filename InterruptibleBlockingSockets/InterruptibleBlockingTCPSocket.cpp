@@ -1,348 +1,2175 @@
 
 //System includes
 #include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 //Library includes
 #ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
 #include <boost/bind.hpp>
 #include <boost/asio/placeholders.hpp>
-#include <boost/asio/read.hpp>
-#include <boost/asio/write.hpp>
-#include <boost/asio/read_until.hpp>
-#include <boost/asio/streambuf.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #endif
 
 //Local includes
 #include "InterruptibleBlockingTCPSocket.h"
+#include "AwaitableDeadline.h"
 
 using namespace std;
 
+//readUntil() buffer sizing. Each read into the buffer offers the kernel at least MIN_READ_SIZE_B.
+static const uint32_t READ_BUFFER_INITIAL_SIZE_B = 64 * 1024;
+static const uint32_t MIN_READ_SIZE_B = 4 * 1024;
+static const uint32_t MAX_LINE_LENGTH_DEFAULT_B = 1024 * 1024;
+//Kernel limit on the number of iovecs per sendmsg() / recvmsg() call (UIO_MAXIOV)
+static const uint32_t MAX_IOVECS_PER_CALL = 1024;
+
+//Find the first occurrence of the delimiter in [cpBegin, cpEnd). memchr() (vectorised in the C library) skips to
+//candidates for the first byte and memcmp() checks the rest.
+const char* cInterruptibleBlockingTCPSocket::findDelimiter(const char *cpBegin, const char *cpEnd, const string &strDelimiter)
+{
+    size_t szDelimiterLength = strDelimiter.length();
+    const char *cpCandidate = cpBegin;
+
+    while((size_t)(cpEnd - cpCandidate) >= szDelimiterLength)
+    {
+        cpCandidate = (const char*)memchr(cpCandidate, strDelimiter[0], cpEnd - cpCandidate - szDelimiterLength + 1);
+
+        if(!cpCandidate)
+            return NULL;
+
+        if(szDelimiterLength == 1 || !memcmp(cpCandidate + 1, strDelimiter.data() + 1, szDelimiterLength - 1))
+            return cpCandidate;
+
+        cpCandidate++;
+    }
+
+    return NULL;
+}
+
+//The transfer behind every read and write of the socket, blocking or awaited. Each attempt is one non-blocking system
+//call over as many of the buffers as it takes. When the socket isn't ready, a blocking call waits in place with
+//waitUntilReadable() / waitUntilWritable(), i.e. with the fast path waiter, io_uring or the io_service as configured,
+//so the operation has completed before asyncTransfer() returns. With io_uring a blocking call submits the transfer
+//itself to the ring, which waits for the socket. A coroutine call waits with the socket's cAsyncReadinessWaiter instead,
+//which leaves the thread free, and its deadline ends only that wait.
+class cInterruptibleBlockingTCPSocket::cTransferOperation
+{
+public:
+    cTransferOperation(cInterruptibleBlockingTCPSocket *pSocket, bool bWriting, std::vector<boost::asio::mutable_buffer> &voBuffers, bool bAll, bool bZeroCopy, uint32_t u32Timeout_ms,
+                       const boost::posix_time::ptime &oStartTime, cAwaitableDeadline *pDeadline);
+
+    template<typename tSelf>
+    void operator()(tSelf &oSelf)
+    {
+        //The completion posted by resume()
+        if(m_bCompleting)
+        {
+            oSelf.complete(m_oError, m_u32NBytesTransferred);
+            return;
+        }
+
+        if(m_pDeadline)
+            m_oError = m_pDeadline->getStopError();
+
+        resume(oSelf);
+    }
+
+    //The readiness wait of a coroutine call has ended, with the deadline's error if it stopped the call
+    template<typename tSelf>
+    void operator()(tSelf &oSelf, const boost::system::error_code &oWaitError)
+    {
+        m_bSuspended = true;
+        m_oError = oWaitError;
+
+#ifdef __linux__
+        m_pSocket->reapZeroCopyCompletions(getSocket().native_handle());
+#endif
+
+        resume(oSelf);
+    }
+
+private:
+    cInterruptibleBlockingTCPSocket *m_pSocket;
+    bool                            m_bWriting;
+    //The caller's, for the blocking calls the socket's (see asyncTransfer())
+    std::vector<boost::asio::mutable_buffer> *m_pvoBuffers;
+    bool                            m_bAll;
+    bool                            m_bZeroCopy;
+    uint32_t                        m_u32Timeout_ms;
+    boost::posix_time::ptime        m_oStartTime;
+    cAwaitableDeadline              *m_pDeadline;
+
+    //Progress through the buffers. The first one left may have been partly transferred already.
+    uint32_t                        m_u32FirstBuffer;
+    uint32_t                        m_u32NBytesTransferred;
+    boost::system::error_code       m_oError;
+
+#ifdef __linux__
+    //For the ring. Only read the clock if we actually have to wait.
+    int64_t                         m_i64Deadline_ns;
+#endif
+
+    bool                            m_bSuspended;
+    bool                            m_bCompleting;
+
+    template<typename tSelf>
+    void resume(tSelf &oSelf)
+    {
+        while(!m_oError && !isDone())
+            m_oError = transferSome();
+
+        //Only the coroutine calls get here. The blocking ones have waited already.
+        if(m_oError == boost::asio::error::would_block)
+        {
+            cAsyncReadinessWaiter &oWaiter = m_bWriting ? m_pSocket->m_oAsyncWriteReadiness : m_pSocket->m_oAsyncReadReadiness;
+            oWaiter.asyncWait(getSocket(), m_bWriting ? boost::asio::socket_base::wait_write : boost::asio::socket_base::wait_read,
+                              *m_pDeadline, BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+            return;
+        }
+
+        //An awaited operation must not complete inside the call that started it
+        if(m_pDeadline && !m_bSuspended)
+        {
+            m_bCompleting = true;
+            boost::asio::post(BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+            return;
+        }
+
+        oSelf.complete(m_oError, m_u32NBytesTransferred);
+    }
+
+    bool                            isDone() const;
+    boost::asio::ip::tcp::socket&   getSocket() const;
+    std::vector<boost::asio::mutable_buffer>& getBuffers() const;
+
+    //One attempt, followed by the wait of a blocking call if the socket wasn't ready. Returns would_block for a
+    //coroutine call to wait.
+    boost::system::error_code       transferSome();
+    boost::system::error_code       attemptTransfer();
+    void                            advance(uint32_t u32NBytes);
+};
+
+//openAndConnect() for both the blocking and the coroutine call: looks the peer up unless it is a dotted address or
+//cached (see cInterruptibleBlockingResolver), then connects the socket the caller has opened. A blocking call looks up
+//with m_oResolver, which honours the timeout and cancelCurrrentOperations(), and the caller waits for the connect with
+//m_oReadWaiter. A coroutine call looks up on asio's resolver thread, with a resolver of its own that the deadline can
+//cancel.
+class cInterruptibleBlockingTCPSocket::cConnectOperation
+{
+public:
+    cConnectOperation(cInterruptibleBlockingTCPSocket *pSocket, const string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms,
+                      cAwaitableDeadline *pDeadline);
+
+    template<typename tSelf>
+    void operator()(tSelf &oSelf)
+    {
+        //The completion posted by finish()
+        if(m_bCompleting)
+        {
+            oSelf.complete(m_oError);
+            return;
+        }
+
+        if(m_pDeadline)
+            m_oError = m_pDeadline->getStopError();
+
+        boost::asio::ip::address oAddress;
+
+        if(m_oError || cInterruptibleBlockingResolver::findWithoutLookup(m_strPeerAddress, oAddress, m_oError))
+        {
+            lookupDone(oSelf, oAddress);
+            return;
+        }
+
+        if(!m_pDeadline)
+        {
+            m_pSocket->m_oResolver.resolve(m_strPeerAddress, oAddress, m_u32Timeout_ms);
+            m_oError = m_pSocket->m_oResolver.getLastError();
+
+            lookupDone(oSelf, oAddress);
+            return;
+        }
+
+        m_pResolver.reset(new boost::asio::ip::tcp::resolver(m_pSocket->m_oIOService));
+        m_pDeadline->setCancelFunction(boost::bind(&boost::asio::ip::tcp::resolver::cancel, m_pResolver));
+
+        //Same query as cInterruptibleBlockingResolver
+        m_pResolver->async_resolve(boost::asio::ip::tcp::v4(), m_strPeerAddress, "0", BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+    }
+
+    //Lookup of a coroutine call done
+    template<typename tSelf>
+    void operator()(tSelf &oSelf, const boost::system::error_code &oError, const boost::asio::ip::tcp::resolver::results_type &oResults)
+    {
+        m_bSuspended = true;
+        m_pDeadline->setCancelFunction(boost::function<void ()>());
+
+        m_oError = m_pDeadline->getError(oError);
+
+        boost::asio::ip::address oAddress;
+
+        if(!m_oError && oResults.empty())
+            m_oError = boost::asio::error::host_not_found;
+
+        if(!m_oError)
+            oAddress = oResults.begin()->endpoint().address();
+
+        cInterruptibleBlockingResolver::storeResult(m_strPeerAddress, oAddress, m_oError);
+
+        lookupDone(oSelf, oAddress);
+    }
+
+    //Connect done
+    template<typename tSelf>
+    void operator()(tSelf &oSelf, const boost::system::error_code &oError)
+    {
+        m_oError = oError;
+
+        if(m_pDeadline)
+        {
+            m_pDeadline->setCancelFunction(boost::function<void ()>());
+            m_oError = m_pDeadline->getError(oError);
+        }
+
+        oSelf.complete(m_oError);
+    }
+
+private:
+    cInterruptibleBlockingTCPSocket *m_pSocket;
+    string                          m_strPeerAddress;
+    uint16_t                        m_u16PeerPort;
+    uint32_t                        m_u32Timeout_ms;
+    cAwaitableDeadline              *m_pDeadline;
+
+    boost::shared_ptr<boost::asio::ip::tcp::resolver> m_pResolver;
+    boost::system::error_code       m_oError;
+
+    bool                            m_bSuspended;
+    bool                            m_bCompleting;
+
+    template<typename tSelf>
+    void lookupDone(tSelf &oSelf, const boost::asio::ip::address &oAddress)
+    {
+        if(m_oError && (!m_pDeadline || !m_pDeadline->getStopError()))
+            cout << "cInterruptibleBlockingTCPSocket::" << (m_pDeadline ? "asyncOpenAndConnect" : "openAndConnect") << "(): Unable to resolve "
+                 << m_strPeerAddress << ": " << m_oError.message() << endl;
+
+        if(!m_oError && m_pDeadline)
+            m_oError = m_pDeadline->getStopError();
+
+        if(m_oError)
+        {
+            finish(oSelf);
+            return;
+        }
+
+        if(m_pDeadline)
+            m_pDeadline->setCancelFunction(boost::bind(&cInterruptibleBlockingTCPSocket::cancelConnect, m_pSocket));
+
+        m_pSocket->m_oSocket.async_connect(boost::asio::ip::tcp::endpoint(oAddress, m_u16PeerPort), BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+    }
+
+    template<typename tSelf>
+    void finish(tSelf &oSelf)
+    {
+        //An awaited operation must not complete inside the call that started it
+        if(m_pDeadline && !m_bSuspended)
+        {
+            m_bCompleting = true;
+            boost::asio::post(BOOST_ASIO_MOVE_CAST(tSelf)(oSelf));
+            return;
+        }
+
+        oSelf.complete(m_oError);
+    }
+};
+
+template<typename tCompletionToken>
+BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code, uint32_t))
+cInterruptibleBlockingTCPSocket::asyncTransfer(bool bWriting, vector<boost::asio::mutable_buffer> &voBuffers, bool bAll, bool bZeroCopy,
+                                               uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime, cAwaitableDeadline *pDeadline,
+                                               BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken)
+{
+    return boost::asio::async_compose<tCompletionToken, void(boost::system::error_code, uint32_t)>(
+                cTransferOperation(this, bWriting, voBuffers, bAll, bZeroCopy, u32Timeout_ms, oStartTime, pDeadline), oToken);
+}
+
+template<typename tCompletionToken>
+BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code))
+cInterruptibleBlockingTCPSocket::asyncConnect(const string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms,
+                                              cAwaitableDeadline *pDeadline, BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken)
+{
+    return boost::asio::async_compose<tCompletionToken, void(boost::system::error_code)>(
+                cConnectOperation(this, strPeerAddress, u16PeerPort, u32Timeout_ms, pDeadline), oToken);
+}
+
+cInterruptibleBlockingTCPSocket::cTransferOperation::cTransferOperation(cInterruptibleBlockingTCPSocket *pSocket, bool bWriting,
+                                                                         vector<boost::asio::mutable_buffer> &voBuffers, bool bAll, bool bZeroCopy,
+                                                                         uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime,
+                                                                         cAwaitableDeadline *pDeadline) :
+    m_pSocket(pSocket),
+    m_bWriting(bWriting),
+    m_pvoBuffers(&voBuffers),
+    m_bAll(bAll),
+    m_bZeroCopy(bZeroCopy),
+    m_u32Timeout_ms(u32Timeout_ms),
+    m_oStartTime(oStartTime),
+    m_pDeadline(pDeadline),
+    m_u32FirstBuffer(0),
+    m_u32NBytesTransferred(0),
+#ifdef __linux__
+    m_i64Deadline_ns(-1),
+#endif
+    m_bSuspended(false),
+    m_bCompleting(false)
+{
+    //Step over empty buffers so that they can't read as a closed connection
+    while(m_u32FirstBuffer < voBuffers.size() && !boost::asio::buffer_size(voBuffers[m_u32FirstBuffer]))
+        m_u32FirstBuffer++;
+}
+
+bool cInterruptibleBlockingTCPSocket::cTransferOperation::isDone() const
+{
+    return m_u32FirstBuffer == getBuffers().size() || (!m_bAll && m_u32NBytesTransferred);
+}
+
+boost::asio::ip::tcp::socket& cInterruptibleBlockingTCPSocket::cTransferOperation::getSocket() const
+{
+    return m_bWriting ? m_pSocket->m_oWriteSocket : m_pSocket->m_oSocket;
+}
+
+vector<boost::asio::mutable_buffer>& cInterruptibleBlockingTCPSocket::cTransferOperation::getBuffers() const
+{
+    return *m_pvoBuffers;
+}
+
+boost::system::error_code cInterruptibleBlockingTCPSocket::cTransferOperation::transferSome()
+{
+    boost::system::error_code oError = attemptTransfer();
+
+    if(oError != boost::asio::error::would_block || m_pDeadline)
+        return oError;
+
+    if(m_oStartTime.is_not_a_date_time())
+        m_oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    if(m_bWriting)
+        return m_pSocket->waitUntilWritable(m_u32Timeout_ms, m_oStartTime) ? boost::system::error_code() : m_pSocket->m_oLastWriteError;
+
+    return m_pSocket->waitUntilReadable(m_u32Timeout_ms, m_oStartTime) ? boost::system::error_code() : m_pSocket->m_oLastReadError;
+}
+
+#ifdef __linux__
+boost::system::error_code cInterruptibleBlockingTCPSocket::cTransferOperation::attemptTransfer()
+{
+    vector<boost::asio::mutable_buffer> &voBuffers = getBuffers();
+    vector<iovec> &voIOVecs = m_bWriting ? m_pSocket->m_voWriteIOVecs : m_pSocket->m_voReadIOVecs;
+    int iFD = getSocket().native_handle();
+
+    voIOVecs.resize(min<size_t>(voBuffers.size() - m_u32FirstBuffer, MAX_IOVECS_PER_CALL));
+    for(uint32_t u32Index = 0; u32Index < voIOVecs.size(); u32Index++)
+    {
+        voIOVecs[u32Index].iov_base = boost::asio::buffer_cast<void*>(voBuffers[m_u32FirstBuffer + u32Index]);
+        voIOVecs[u32Index].iov_len = boost::asio::buffer_size(voBuffers[m_u32FirstBuffer + u32Index]);
+    }
+
+    msghdr oHeader;
+    memset(&oHeader, 0, sizeof(oHeader));
+    oHeader.msg_iov = &voIOVecs[0];
+    oHeader.msg_iovlen = voIOVecs.size();
+
+    ssize_t iNTransferred;
+    cIOUring *pIOUring = m_bWriting ? m_pSocket->m_pWriteIOUring.get() : m_pSocket->m_pReadIOUring.get();
+
+    //The ring waits for the socket itself, which a coroutine call mustn't do on its executor
+    if(pIOUring && !m_pDeadline && !m_bZeroCopy)
+    {
+        //Calls that transfer repeatedly keep to their overall timeout
+        if(m_i64Deadline_ns < 0)
+        {
+            m_i64Deadline_ns = 0;
+
+            if(m_u32Timeout_ms && !m_oStartTime.is_not_a_date_time())
+            {
+                boost::posix_time::time_duration oRemaining = m_oStartTime + boost::posix_time::milliseconds(m_u32Timeout_ms)
+                        - boost::posix_time::microsec_clock::universal_time();
+
+                if(oRemaining.total_milliseconds() <= 0)
+                    return boost::asio::error::timed_out;
+
+                m_i64Deadline_ns = cSocketReadinessWaiter::getDeadline_ns(oRemaining.total_milliseconds());
+            }
+            else
+                m_i64Deadline_ns = cSocketReadinessWaiter::getDeadline_ns(m_u32Timeout_ms);
+        }
+
+        uint32_t u32NTransferred;
+        boost::system::error_code oError;
+
+        if(voIOVecs.size() == 1 && m_bWriting)
+            oError = pIOUring->send(iFD, voIOVecs[0].iov_base, voIOVecs[0].iov_len, u32NTransferred, m_i64Deadline_ns);
+        else if(voIOVecs.size() == 1)
+            oError = pIOUring->receive(iFD, voIOVecs[0].iov_base, voIOVecs[0].iov_len, u32NTransferred, m_i64Deadline_ns);
+        else if(m_bWriting)
+            oError = pIOUring->sendMessage(iFD, oHeader, u32NTransferred, m_i64Deadline_ns);
+        else
+            oError = pIOUring->receiveMessage(iFD, oHeader, u32NTransferred, m_i64Deadline_ns);
+
+        if(oError)
+            return oError;
+
+        iNTransferred = u32NTransferred;
+    }
+    else if(m_bWriting)
+        iNTransferred = sendmsg(iFD, &oHeader, MSG_DONTWAIT | MSG_NOSIGNAL | (m_bZeroCopy ? MSG_ZEROCOPY : 0));
+    else
+        iNTransferred = recvmsg(iFD, &oHeader, MSG_DONTWAIT);
+
+    if(iNTransferred > 0)
+    {
+        if(m_bZeroCopy)
+            m_pSocket->m_pZeroCopyTracker->countSend();
+
+        advance(iNTransferred);
+        return boost::system::error_code();
+    }
+
+    //Nothing sent only happens once the connection has gone. Nothing received means the peer closed it.
+    if(iNTransferred == 0 && m_bWriting)
+        return boost::asio::error::broken_pipe;
+
+    if(iNTransferred == 0)
+        return boost::asio::error::eof;
+
+    if(errno == EINTR)
+        return boost::system::error_code();
+
+    if(errno == ENOBUFS && m_bZeroCopy)
+    {
+        //Too many zero copy sends outstanding for the socket's option memory. Copy the rest instead.
+        m_bZeroCopy = false;
+        return boost::system::error_code();
+    }
+
+    if(errno == EAGAIN || errno == EWOULDBLOCK)
+        return boost::asio::error::would_block;
+
+    return boost::system::error_code(errno, boost::asio::error::get_system_category());
+}
+#else
+boost::system::error_code cInterruptibleBlockingTCPSocket::cTransferOperation::attemptTransfer()
+{
+    boost::asio::ip::tcp::socket &oSocket = getSocket();
+    boost::asio::mutable_buffer oBuffer = getBuffers()[m_u32FirstBuffer];
+
+    boost::system::error_code oError, oModeError;
+    bool bNonBlocking = oSocket.non_blocking();
+    oSocket.non_blocking(true, oModeError);
+
+    size_t uNTransferred = m_bWriting ? oSocket.write_some(boost::asio::const_buffer(oBuffer), oError) : oSocket.read_some(oBuffer, oError);
+
+    oSocket.non_blocking(bNonBlocking, oModeError);
+
+    if(!oError)
+        advance(uNTransferred);
+
+    return oError;
+}
+#endif
+
+void cInterruptibleBlockingTCPSocket::cTransferOperation::advance(uint32_t u32NBytes)
+{
+    vector<boost::asio::mutable_buffer> &voBuffers = getBuffers();
+
+    m_u32NBytesTransferred += u32NBytes;
+
+    //Step over the completed buffers and trim the partially transferred one
+    while(u32NBytes)
+    {
+        boost::asio::mutable_buffer &oBuffer = voBuffers[m_u32FirstBuffer];
+
+        if(u32NBytes < boost::asio::buffer_size(oBuffer))
+        {
+            oBuffer = oBuffer + u32NBytes;
+            break;
+        }
+
+        u32NBytes -= boost::asio::buffer_size(oBuffer);
+        m_u32FirstBuffer++;
+    }
+
+    while(m_u32FirstBuffer < voBuffers.size() && !boost::asio::buffer_size(voBuffers[m_u32FirstBuffer]))
+        m_u32FirstBuffer++;
+}
+
+cInterruptibleBlockingTCPSocket::cConnectOperation::cConnectOperation(cInterruptibleBlockingTCPSocket *pSocket, const string &strPeerAddress, uint16_t u16PeerPort,
+                                                                       uint32_t u32Timeout_ms, cAwaitableDeadline *pDeadline) :
+    m_pSocket(pSocket),
+    m_strPeerAddress(strPeerAddress),
+    m_u16PeerPort(u16PeerPort),
+    m_u32Timeout_ms(u32Timeout_ms),
+    m_pDeadline(pDeadline),
+    m_bSuspended(false),
+    m_bCompleting(false)
+{
+}
+
 cInterruptibleBlockingTCPSocket::cInterruptibleBlockingTCPSocket(const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_pOwnedWriteIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
+    m_oSocket(m_oIOService),
+    m_oWriteIOService(*m_pOwnedWriteIOService),
+    m_oWriteSocket(m_oWriteIOService),
+    m_oOpenAndConnectTimer(m_oIOService),
+    m_oReadTimer(m_oIOService),
+    m_oWriteTimer(m_oWriteIOService),
+    m_oReadWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingTCPSocket::cancelReadIO, this)),
+    m_oWriteWaiter(m_oWriteIOService, false, boost::bind(&cInterruptibleBlockingTCPSocket::cancelWriteIO, this)),
+    m_bOpenAndConnectError(true),
+    m_bReadError(true),
+    m_bWriteError(true),
+    m_u32NBytesLastRead(0),
+    m_u32NBytesLastWritten(0),
+    m_u64NBytesLastWrittenFromFile(0),
+    m_bKernelTimestamps(false),
+    m_u32ReadBufferStart(0),
+    m_u32ReadBufferEnd(0),
+    m_u32ReadBufferCapacity_B(READ_BUFFER_INITIAL_SIZE_B),
+    m_u32MaxLineLength_B(MAX_LINE_LENGTH_DEFAULT_B),
+    m_bReadBuffering(false),
+    m_u64NReadBufferHits(0),
+    m_u64NReadBufferMisses(0),
+    m_bWriteCoalescing(false),
+    m_u32WriteCoalescingThreshold_B(0),
+    m_u32WriteCoalescingMaxDelay_ms(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingTCPSocket::cInterruptibleBlockingTCPSocket(boost::asio::io_service &oIOService, const string &strName) :
+    m_oIOService(oIOService),
     m_oSocket(m_oIOService),
+    m_oWriteIOService(oIOService),
+    m_oWriteSocket(m_oWriteIOService),
     m_oOpenAndConnectTimer(m_oIOService),
     m_oReadTimer(m_oIOService),
-    m_oWriteTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWriteTimer(m_oWriteIOService),
+    m_oReadWaiter(m_oIOService, true, boost::bind(&cInterruptibleBlockingTCPSocket::cancelReadIO, this)),
+    m_oWriteWaiter(m_oWriteIOService, true, boost::bind(&cInterruptibleBlockingTCPSocket::cancelWriteIO, this)),
     m_bOpenAndConnectError(true),
     m_bReadError(true),
     m_bWriteError(true),
+    m_u32NBytesLastRead(0),
+    m_u32NBytesLastWritten(0),
+    m_u64NBytesLastWrittenFromFile(0),
+    m_bKernelTimestamps(false),
+    m_u32ReadBufferStart(0),
+    m_u32ReadBufferEnd(0),
+    m_u32ReadBufferCapacity_B(READ_BUFFER_INITIAL_SIZE_B),
+    m_u32MaxLineLength_B(MAX_LINE_LENGTH_DEFAULT_B),
+    m_bReadBuffering(false),
+    m_u64NReadBufferHits(0),
+    m_u64NReadBufferMisses(0),
+    m_bWriteCoalescing(false),
+    m_u32WriteCoalescingThreshold_B(0),
+    m_u32WriteCoalescingMaxDelay_ms(0),
     m_strName(strName)
 {
 }
 
 cInterruptibleBlockingTCPSocket::cInterruptibleBlockingTCPSocket(const string &strRemoteAddress, uint16_t u16RemotePort, const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_pOwnedWriteIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
     m_oSocket(m_oIOService),
+    m_oWriteIOService(*m_pOwnedWriteIOService),
+    m_oWriteSocket(m_oWriteIOService),
     m_oOpenAndConnectTimer(m_oIOService),
     m_oReadTimer(m_oIOService),
-    m_oWriteTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWriteTimer(m_oWriteIOService),
+    m_oReadWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingTCPSocket::cancelReadIO, this)),
+    m_oWriteWaiter(m_oWriteIOService, false, boost::bind(&cInterruptibleBlockingTCPSocket::cancelWriteIO, this)),
     m_bOpenAndConnectError(true),
     m_bReadError(true),
     m_bWriteError(true),
+    m_u32NBytesLastRead(0),
+    m_u32NBytesLastWritten(0),
+    m_u64NBytesLastWrittenFromFile(0),
+    m_bKernelTimestamps(false),
+    m_u32ReadBufferStart(0),
+    m_u32ReadBufferEnd(0),
+    m_u32ReadBufferCapacity_B(READ_BUFFER_INITIAL_SIZE_B),
+    m_u32MaxLineLength_B(MAX_LINE_LENGTH_DEFAULT_B),
+    m_bReadBuffering(false),
+    m_u64NReadBufferHits(0),
+    m_u64NReadBufferMisses(0),
+    m_bWriteCoalescing(false),
+    m_u32WriteCoalescingThreshold_B(0),
+    m_u32WriteCoalescingMaxDelay_ms(0),
     m_strName(strName)
 {
     openAndConnect(strRemoteAddress, u16RemotePort);
 }
 
-cInterruptibleBlockingTCPSocket::~cInterruptibleBlockingTCPSocket()
-{
-    close();
+cInterruptibleBlockingTCPSocket::~cInterruptibleBlockingTCPSocket()
+{
+    close();
+}
+
+bool cInterruptibleBlockingTCPSocket::openAndConnect(string strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms)
+{
+    //Replaces the connection both directions use
+    boost::unique_lock<cAwaitableMutex> oReadLock(m_oReadMutex);
+    boost::unique_lock<cAwaitableMutex> oWriteLock(m_oWriteMutex);
+
+    //Necessary after a timeout or previously finished run:
+    m_oReadWaiter.begin();
+
+    //If the socket is already open close it
+    closeSocket();
+
+    //Open the socket
+    m_oSocket.open(boost::asio::ip::tcp::v4(), m_oLastopenAndConnectError);
+
+    if(m_oLastopenAndConnectError)
+    {
+        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Error opening socket: " << m_oLastopenAndConnectError.message() << endl;
+        return false;
+    }
+    else
+    {
+        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Successfully opened TCP socket. Attempting to connect..." << endl;
+    }
+    fflush(stdout);
+
+    //Set some socket options
+    m_oSocket.set_option( boost::asio::socket_base::receive_buffer_size(64 * 1024 * 1024) ); //Set buffer to 64 MB
+    m_oSocket.set_option( boost::asio::socket_base::reuse_address(true) );
+
+    m_bOpenAndConnectError = true;
+    m_oLastopenAndConnectError = boost::asio::error::operation_aborted;
+
+    //Set up before the lookup so that the timeout covers resolution and connection together
+    if(u32Timeout_ms)
+    {
+        m_oOpenAndConnectTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
+        m_oOpenAndConnectTimer.async_wait( m_oReadWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_connectTimeOut,
+                                                                          this, boost::asio::placeholders::error)) );
+    }
+
+    //Resolves in place, then the connect can time out or be cancelled at any point
+    asyncConnect(strPeerAddress, u16PeerPort, u32Timeout_ms, NULL,
+                 m_oReadWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_connectComplete,
+                                                this,
+                                                boost::asio::placeholders::error))
+                 );
+
+    m_oReadWaiter.wait();
+
+    if(!m_bOpenAndConnectError)
+        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Successfully connected TCP socket to " << strPeerAddress << ":" << u16PeerPort << endl;
+
+    return !m_bOpenAndConnectError;
+}
+
+void cInterruptibleBlockingTCPSocket::close()
+{
+    boost::unique_lock<cAwaitableMutex> oReadLock(m_oReadMutex);
+    boost::unique_lock<cAwaitableMutex> oWriteLock(m_oWriteMutex);
+
+    closeSocket();
+}
+
+void cInterruptibleBlockingTCPSocket::closeSocket()
+{
+    //Anything still coalesced is discarded. Call flush() first to send it.
+    m_vcWriteBuffer.clear();
+
+    //As are bytes read ahead, so that the next connection doesn't start with the end of this one
+    m_u32ReadBufferStart = 0;
+    m_u32ReadBufferEnd = 0;
+
+    if(m_oWriteSocket.is_open())
+    {
+        try
+        {
+            m_oWriteSocket.cancel();
+            m_oWriteSocket.close();
+        }
+        catch(boost::system::system_error &e)
+        {
+            //Catch special conditions where socket is trying to be opened etc.
+            //Prevents crash.
+        }
+    }
+
+    //If the socket is open close it
+    if(m_oSocket.is_open())
+    {
+        m_oSocket.cancel();
+
+        try
+        {
+            m_oSocket.close();
+        }
+        catch(boost::system::system_error &e)
+        {
+            //Catch special conditions where socket is trying to be opened etc.
+            //Prevents crash.
+        }
+    }
+}
+
+bool cInterruptibleBlockingTCPSocket::send(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    //Note this function sends to the specific endpoint set in the constructor or with the openAndBind function
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    //Keep the stream in order
+    if(!flushWriteBuffer(u32Timeout_ms))
+        return false;
+
+    m_voWriteTransferBuffers.assign(1, boost::asio::mutable_buffer(const_cast<char*>(cpBuffer), u32NBytes));
+
+    //Returns once at least a byte is written
+    return writeTransferBuffers(false, false, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::receive(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    if(m_bReadBuffering || m_u32ReadBufferEnd > m_u32ReadBufferStart)
+        return bufferedRead(cpBuffer, u32NBytes, false, u32Timeout_ms);
+
+    return directRead(cpBuffer, u32NBytes, false, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::setKernelTimestampsEnabled(bool bEnabled)
+{
+#ifdef SO_TIMESTAMPNS
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    boost::system::error_code oEC;
+    m_oSocket.set_option( boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_TIMESTAMPNS>(bEnabled), oEC );
+
+    if(oEC)
+    {
+        m_oLastReadError = oEC;
+        cout << "cInterruptibleBlockingTCPSocket::setKernelTimestampsEnabled(): Error setting SO_TIMESTAMPNS: " << oEC.message() << endl;
+        return false;
+    }
+
+    m_bKernelTimestamps = bEnabled;
+    return true;
+#else
+    cout << "cInterruptibleBlockingTCPSocket::setKernelTimestampsEnabled(): Kernel timestamps are not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::receiveTimestamped(char *cpBuffer, uint32_t u32NBytes, int64_t &i64Timestamp_ns, uint32_t u32Timeout_ms)
+{
+    i64Timestamp_ns = 0;
+
+#ifdef __linux__
+    if(!m_bKernelTimestamps && !setKernelTimestampsEnabled(true))
+        return false;
+
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    //Data already in the read buffer must come first. Its arrival time is no longer known so the timestamp stays 0.
+    if(m_u32ReadBufferEnd > m_u32ReadBufferStart)
+        return bufferedRead(cpBuffer, u32NBytes, false, u32Timeout_ms);
+
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    for(;;)
+    {
+        //Use recvmsg directly so that the timestamp control message comes back with the data
+        iovec oIOVec;
+        oIOVec.iov_base = cpBuffer;
+        oIOVec.iov_len = u32NBytes;
+
+        char acControl[64];
+
+        msghdr oHeader;
+        memset(&oHeader, 0, sizeof(oHeader));
+        oHeader.msg_iov = &oIOVec;
+        oHeader.msg_iovlen = 1;
+        oHeader.msg_control = acControl;
+        oHeader.msg_controllen = sizeof(acControl);
+
+        ssize_t iNReceived = recvmsg(m_oSocket.native_handle(), &oHeader, MSG_DONTWAIT);
+
+        if(iNReceived > 0)
+        {
+            for(cmsghdr *pMessage = CMSG_FIRSTHDR(&oHeader); pMessage; pMessage = CMSG_NXTHDR(&oHeader, pMessage))
+            {
+                if(pMessage->cmsg_level == SOL_SOCKET && pMessage->cmsg_type == SO_TIMESTAMPNS)
+                {
+                    timespec oTimestamp;
+                    memcpy(&oTimestamp, CMSG_DATA(pMessage), sizeof(oTimestamp));
+                    i64Timestamp_ns = (int64_t)oTimestamp.tv_sec * 1000000000LL + oTimestamp.tv_nsec;
+                }
+            }
+
+            m_u32NBytesLastRead = iNReceived;
+            m_oLastReadError = boost::system::error_code();
+            m_bReadError = false;
+            return true;
+        }
+
+        if(iNReceived == 0)
+        {
+            //Peer closed the connection
+            m_u32NBytesLastRead = 0;
+            m_oLastReadError = boost::asio::error::eof;
+            m_bReadError = true;
+            return false;
+        }
+
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            m_u32NBytesLastRead = 0;
+            m_oLastReadError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            m_bReadError = true;
+            return false;
+        }
+
+        if(!waitUntilReadable(u32Timeout_ms, oStartTime))
+            return false;
+    }
+#else
+    //No ancillary data on this platform. Fall back to a plain receive.
+    return receive(cpBuffer, u32NBytes, u32Timeout_ms);
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::waitUntilReadable(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime)
+{
+    //Calls that wait repeatedly keep to their overall timeout
+    uint32_t u32RemainingTimeout_ms = 0;
+
+    if(u32Timeout_ms)
+    {
+        boost::posix_time::time_duration oRemaining = oStartTime + boost::posix_time::milliseconds(u32Timeout_ms)
+                - boost::posix_time::microsec_clock::universal_time();
+
+        if(oRemaining.total_milliseconds() <= 0)
+        {
+            m_bReadError = true;
+            m_oLastReadError = boost::asio::error::timed_out;
+            return false;
+        }
+
+        u32RemainingTimeout_ms = oRemaining.total_milliseconds();
+    }
+
+#ifdef __linux__
+    if(m_pReadIOUring)
+    {
+        m_oLastReadError = m_pReadIOUring->waitUntilReady(m_oSocket.native_handle(), false, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bReadError = m_oLastReadError ? true : false;
+        reapZeroCopyCompletions(m_oSocket.native_handle());
+
+        return !m_bReadError;
+    }
+
+    if(m_pFastPathReadWaiter)
+    {
+        m_oLastReadError = m_pFastPathReadWaiter->wait(m_oSocket.native_handle(), false, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bReadError = m_oLastReadError ? true : false;
+        reapZeroCopyCompletions(m_oSocket.native_handle());
+
+        return !m_bReadError;
+    }
+#endif
+
+    //Necessary after a timeout or previously finished run:
+    m_oReadWaiter.begin();
+
+    //Assume the wait was interrupted unless the completion handler reports otherwise
+    m_bReadError = true;
+    m_oLastReadError = boost::asio::error::operation_aborted;
+
+    //A null buffers receive completes when data is available without consuming it
+    m_oSocket.async_receive( boost::asio::null_buffers(),
+                             m_oReadWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_readReady,
+                                                            this,
+                                                            boost::asio::placeholders::error)) );
+
+    // Setup a deadline time to implement our timeout.
+    if(u32RemainingTimeout_ms)
+    {
+        m_oReadTimer.expires_from_now(boost::posix_time::milliseconds(u32RemainingTimeout_ms));
+        m_oReadTimer.async_wait(m_oReadWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_readTimeOut,
+                                                               this, boost::asio::placeholders::error)));
+    }
+
+    // This will block until data is available
+    // or until it is cancelled.
+    m_oReadWaiter.wait();
+
+    return !m_bReadError;
+}
+
+bool cInterruptibleBlockingTCPSocket::waitUntilWritable(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime)
+{
+    //Calls that wait repeatedly keep to their overall timeout
+    uint32_t u32RemainingTimeout_ms = 0;
+
+    if(u32Timeout_ms)
+    {
+        boost::posix_time::time_duration oRemaining = oStartTime + boost::posix_time::milliseconds(u32Timeout_ms)
+                - boost::posix_time::microsec_clock::universal_time();
+
+        if(oRemaining.total_milliseconds() <= 0)
+        {
+            m_bWriteError = true;
+            m_oLastWriteError = boost::asio::error::timed_out;
+            return false;
+        }
+
+        u32RemainingTimeout_ms = oRemaining.total_milliseconds();
+    }
+
+#ifdef __linux__
+    if(m_pWriteIOUring)
+    {
+        m_oLastWriteError = m_pWriteIOUring->waitUntilReady(m_oWriteSocket.native_handle(), true, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bWriteError = m_oLastWriteError ? true : false;
+        reapZeroCopyCompletions(m_oWriteSocket.native_handle());
+
+        return !m_bWriteError;
+    }
+
+    if(m_pFastPathWriteWaiter)
+    {
+        m_oLastWriteError = m_pFastPathWriteWaiter->wait(m_oWriteSocket.native_handle(), true, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bWriteError = m_oLastWriteError ? true : false;
+        reapZeroCopyCompletions(m_oWriteSocket.native_handle());
+
+        return !m_bWriteError;
+    }
+#endif
+
+    //Necessary after a timeout or previously finished run:
+    m_oWriteWaiter.begin();
+
+    //Assume the wait was interrupted unless the completion handler reports otherwise
+    m_bWriteError = true;
+    m_oLastWriteError = boost::asio::error::operation_aborted;
+
+    //A null buffers send completes when there is room in the send buffer without sending anything
+    m_oWriteSocket.async_send( boost::asio::null_buffers(),
+                          m_oWriteWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeReady,
+                                                          this,
+                                                          boost::asio::placeholders::error)) );
+
+    // Setup a deadline time to implement our timeout.
+    if(u32RemainingTimeout_ms)
+    {
+        m_oWriteTimer.expires_from_now(boost::posix_time::milliseconds(u32RemainingTimeout_ms));
+        m_oWriteTimer.async_wait(m_oWriteWaiter.wrap(boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeTimeOut,
+                                                                 this, boost::asio::placeholders::error)));
+    }
+
+    // This will block until the socket is writable
+    // or until it is cancelled.
+    m_oWriteWaiter.wait();
+
+    return !m_bWriteError;
+}
+
+bool cInterruptibleBlockingTCPSocket::setFastPathEnabled(bool bEnabled)
+{
+#ifdef __linux__
+    if(bEnabled && !m_pFastPathReadWaiter)
+    {
+        m_pFastPathReadWaiter.reset(new cSocketReadinessWaiter);
+        m_pFastPathWriteWaiter.reset(new cSocketReadinessWaiter);
+    }
+    else if(!bEnabled)
+    {
+        m_pFastPathReadWaiter.reset();
+        m_pFastPathWriteWaiter.reset();
+    }
+
+    return true;
+#else
+    cout << "cInterruptibleBlockingTCPSocket::setFastPathEnabled(): The fast path is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::isFastPathEnabled() const
+{
+#ifdef __linux__
+    return m_pFastPathReadWaiter.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::setIOUringEnabled(bool bEnabled)
+{
+#ifdef __linux__
+    if(bEnabled && !m_pReadIOUring)
+    {
+        if(!cIOUring::isSupported())
+        {
+            cout << "cInterruptibleBlockingTCPSocket::setIOUringEnabled(): io_uring is not available, keeping the current path." << endl;
+            return false;
+        }
+
+        m_pReadIOUring.reset(new cIOUring);
+        m_pWriteIOUring.reset(new cIOUring);
+
+        if(!m_pReadIOUring->isOpen() || !m_pWriteIOUring->isOpen())
+        {
+            cout << "cInterruptibleBlockingTCPSocket::setIOUringEnabled(): Failed to set up the rings, keeping the current path." << endl;
+
+            m_pReadIOUring.reset();
+            m_pWriteIOUring.reset();
+            return false;
+        }
+    }
+    else if(!bEnabled)
+    {
+        m_pReadIOUring.reset();
+        m_pWriteIOUring.reset();
+    }
+
+    return true;
+#else
+    cout << "cInterruptibleBlockingTCPSocket::setIOUringEnabled(): io_uring is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::isIOUringEnabled() const
+{
+#ifdef __linux__
+    return m_pReadIOUring.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::write(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    bool bZeroCopy;
+
+    if(!prepareWrite(cpBuffer, u32NBytes, m_voWriteTransferBuffers, bZeroCopy))
+        return true;
+
+    bool bResult = writeTransferBuffers(true, bZeroCopy, u32Timeout_ms);
+    takeFlushedBytes(bResult);
+
+    return bResult;
+}
+
+bool cInterruptibleBlockingTCPSocket::prepareWrite(const char *cpBuffer, uint32_t u32NBytes, vector<boost::asio::mutable_buffer> &voBuffers, bool &bZeroCopy)
+{
+    bZeroCopy = false;
+
+    if(m_bWriteCoalescing)
+    {
+        bool bDue = m_vcWriteBuffer.size() + u32NBytes >= m_u32WriteCoalescingThreshold_B;
+
+        if(!bDue && m_u32WriteCoalescingMaxDelay_ms && !m_vcWriteBuffer.empty())
+        {
+            boost::posix_time::time_duration oAge = boost::posix_time::microsec_clock::universal_time() - m_oWriteBufferStartTime;
+            bDue = oAge.total_milliseconds() >= m_u32WriteCoalescingMaxDelay_ms;
+        }
+
+        if(!bDue)
+        {
+            if(m_vcWriteBuffer.empty() && m_u32WriteCoalescingMaxDelay_ms)
+                m_oWriteBufferStartTime = boost::posix_time::microsec_clock::universal_time();
+
+            m_vcWriteBuffer.insert(m_vcWriteBuffer.end(), cpBuffer, cpBuffer + u32NBytes);
+
+            //Accepted. Errors sending it are reported by whichever call flushes the buffer.
+            m_u32NBytesLastWritten = u32NBytes;
+            m_bWriteError = false;
+            m_oLastWriteError = boost::system::error_code();
+
+            return false;
+        }
+    }
+
+    //Pending data and this write go out together in one gathered system call
+    voBuffers.clear();
+
+    if(!m_vcWriteBuffer.empty())
+        voBuffers.push_back(boost::asio::buffer(m_vcWriteBuffer));
+
+    voBuffers.push_back(boost::asio::mutable_buffer(const_cast<char*>(cpBuffer), u32NBytes));
+
+#ifdef __linux__
+    //Not for internal buffers such as the coalescing buffer, which are reused as soon as the call returns
+    if(!m_bWriteCoalescing && m_vcWriteBuffer.empty() && m_pZeroCopyTracker && m_pZeroCopyTracker->isWorthwhile(u32NBytes))
+    {
+        bZeroCopy = true;
+
+        //Keep the pending count current without waiting
+        m_pZeroCopyTracker->reap(m_oWriteSocket.native_handle());
+    }
+#endif
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::writeTransferBuffers(bool bAll, bool bZeroCopy, uint32_t u32Timeout_ms)
+{
+    //No bytes transferred counts as an error
+    m_oLastWriteError = transfer(true, bAll, bZeroCopy, u32Timeout_ms, boost::posix_time::ptime(), m_u32NBytesLastWritten);
+    m_bWriteError = m_oLastWriteError || !m_u32NBytesLastWritten;
+
+    return !m_bWriteError;
+}
+
+boost::system::error_code cInterruptibleBlockingTCPSocket::transfer(bool bWriting, bool bAll, bool bZeroCopy, uint32_t u32Timeout_ms,
+                                                                    const boost::posix_time::ptime &oStartTime, uint32_t &u32NBytesTransferred)
+{
+    boost::system::error_code oError;
+    u32NBytesTransferred = 0;
+
+    //Waits in place, so the handler has run by the time this returns
+    asyncTransfer(bWriting, bWriting ? m_voWriteTransferBuffers : m_voReadTransferBuffers, bAll, bZeroCopy, u32Timeout_ms, oStartTime, NULL,
+                  boost::bind(&cInterruptibleBlockingTCPSocket::storeTransferResult, &oError, &u32NBytesTransferred, _1, _2));
+
+    return oError;
+}
+
+void cInterruptibleBlockingTCPSocket::storeTransferResult(boost::system::error_code *pError, uint32_t *pNBytesTransferred,
+                                                          const boost::system::error_code &oError, uint32_t u32NBytesTransferred)
+{
+    *pError = oError;
+    *pNBytesTransferred = u32NBytesTransferred;
+}
+
+#ifdef __linux__
+void cInterruptibleBlockingTCPSocket::reapZeroCopyCompletions(int iFD)
+{
+    if(m_pZeroCopyTracker)
+        m_pZeroCopyTracker->reap(iFD);
+}
+#endif
+
+bool cInterruptibleBlockingTCPSocket::setZeroCopyEnabled(bool bEnabled, uint32_t u32Threshold_B)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+    {
+        m_pZeroCopyTracker->reap(m_oWriteSocket.native_handle());
+
+        if(m_pZeroCopyTracker->getNPending())
+        {
+            cout << "cInterruptibleBlockingTCPSocket::setZeroCopyEnabled(): Zero copy sends are still pending. Call waitForZeroCopyCompletions() first." << endl;
+            return false;
+        }
+    }
+
+    if(!bEnabled)
+    {
+        m_pZeroCopyTracker.reset();
+        return true;
+    }
+
+    boost::system::error_code oError = cZeroCopySendTracker::enable(m_oWriteSocket.native_handle());
+    if(oError)
+    {
+        cout << "cInterruptibleBlockingTCPSocket::setZeroCopyEnabled(): Unable to enable SO_ZEROCOPY: " << oError.message() << endl;
+        return false;
+    }
+
+    m_pZeroCopyTracker.reset(new cZeroCopySendTracker(u32Threshold_B));
+    return true;
+#else
+    (void)u32Threshold_B;
+    cout << "cInterruptibleBlockingTCPSocket::setZeroCopyEnabled(): Zero copy sends are not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::isZeroCopyEnabled() const
+{
+#ifdef __linux__
+    return m_pZeroCopyTracker.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::waitForZeroCopyCompletions(uint32_t u32Timeout_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+#ifdef __linux__
+    if(!m_pZeroCopyTracker)
+        return true;
+
+    boost::system::error_code oError = m_pZeroCopyTracker->waitForCompletions(m_oWriteSocket.native_handle(), cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms));
+    if(oError)
+    {
+        m_bWriteError = true;
+        m_oLastWriteError = oError;
+        return false;
+    }
+#else
+    (void)u32Timeout_ms;
+#endif
+
+    return true;
+}
+
+uint32_t cInterruptibleBlockingTCPSocket::getNZeroCopySendsPending()
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+    {
+        m_pZeroCopyTracker->reap(m_oWriteSocket.native_handle());
+        return m_pZeroCopyTracker->getNPending();
+    }
+#endif
+
+    return 0;
+}
+
+uint64_t cInterruptibleBlockingTCPSocket::getNZeroCopySendsCopied() const
+{
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+        return m_pZeroCopyTracker->getNCopied();
+#endif
+
+    return 0;
+}
+
+bool cInterruptibleBlockingTCPSocket::write(const std::string &strData, uint32_t u32Timeout_ms)
+{
+    return write(strData.c_str(), strData.length(), u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::writeFile(int iFileDescriptor, uint64_t u64Offset, uint64_t u64NBytes, uint32_t u32Timeout_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    //Keep the stream in order
+    if(!flushWriteBuffer(u32Timeout_ms))
+        return false;
+
+    m_u32NBytesLastWritten = 0;
+    m_u64NBytesLastWrittenFromFile = 0;
+
+#ifdef __linux__
+    //sendfile() has no per call non-blocking flag so the descriptor itself must be non-blocking. Asio's async operations
+    //cope with that so it is left set.
+    boost::system::error_code oError;
+    m_oWriteSocket.native_non_blocking(true, oError);
+    if(oError)
+    {
+        m_bWriteError = true;
+        m_oLastWriteError = oError;
+        return false;
+    }
+
+    off_t iOffset = u64Offset;
+    boost::posix_time::ptime oStartTime;
+
+    while(m_u64NBytesLastWrittenFromFile < u64NBytes)
+    {
+        //The kernel copies straight from the page cache to the socket. It takes at most ~2 GB per call anyway.
+        uint64_t u64NBytesThisCall = min(u64NBytes - m_u64NBytesLastWrittenFromFile, (uint64_t)0x7ffff000);
+        ssize_t iNSent = sendfile(m_oWriteSocket.native_handle(), iFileDescriptor, &iOffset, u64NBytesThisCall);
+
+        if(iNSent > 0)
+        {
+            m_u64NBytesLastWrittenFromFile += iNSent;
+            //The 32 bit count of the other writes, saturated
+            m_u32NBytesLastWritten = min(m_u64NBytesLastWrittenFromFile, (uint64_t)0xffffffff);
+            continue;
+        }
+
+        if(iNSent == 0)
+        {
+            //The file ends before the requested range does
+            m_bWriteError = true;
+            m_oLastWriteError = boost::asio::error::eof;
+            return false;
+        }
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            m_bWriteError = true;
+            m_oLastWriteError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            return false;
+        }
+
+        if(oStartTime.is_not_a_date_time())
+            oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        if(!waitUntilWritable(u32Timeout_ms, oStartTime))
+            return false;
+    }
+
+    //As in write() no bytes transferred counts as an error
+    m_bWriteError = !m_u64NBytesLastWrittenFromFile;
+    m_oLastWriteError = boost::system::error_code();
+
+    return !m_bWriteError;
+#else
+    cout << "cInterruptibleBlockingTCPSocket::writeFile(): Not supported on this platform." << endl;
+
+    m_bWriteError = true;
+    m_oLastWriteError = boost::asio::error::operation_not_supported;
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingTCPSocket::flushWriteBuffer(uint32_t u32Timeout_ms)
+{
+    if(m_vcWriteBuffer.empty())
+        return true;
+
+    m_voWriteTransferBuffers.assign(1, boost::asio::buffer(m_vcWriteBuffer));
+    bool bResult = writeTransferBuffers(true, false, u32Timeout_ms);
+
+    //Dropped even on failure as part of it may have been sent (see takeFlushedBytes())
+    m_vcWriteBuffer.clear();
+
+    return bResult;
+}
+
+void cInterruptibleBlockingTCPSocket::takeFlushedBytes(bool bWritten)
+{
+    //Sent together with the caller's data. The pending bytes were already counted when write() accepted them so leave
+    //them out of the count for this call.
+    if(bWritten)
+        m_u32NBytesLastWritten -= m_vcWriteBuffer.size();
+
+    //On failure part of the data may have been sent. It can't be retried without corrupting the stream so drop it.
+    m_vcWriteBuffer.clear();
+}
+
+boost::system::error_code cInterruptibleBlockingTCPSocket::flushBeforeRead(uint32_t u32Timeout_ms)
+{
+    //Without coalescing nothing is left pending (bar data from before it was disabled, which the next write sends), so
+    //readers don't need to touch the write side at all
+    if(!m_bWriteCoalescing)
+        return boost::system::error_code();
+
+    //A request may be sitting in the write buffer. Send it before waiting for the response to it. Called without the read
+    //lock so that only this reader waits for a write in progress. The read fails if the flush does.
+    boost::unique_lock<cAwaitableMutex> oWriteLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    if(!m_vcWriteBuffer.empty() && !flushWriteBuffer(u32Timeout_ms))
+        return m_oLastWriteError;
+
+    return boost::system::error_code();
+}
+
+bool cInterruptibleBlockingTCPSocket::failRead(const boost::system::error_code &oError)
+{
+    m_u32NBytesLastRead = 0;
+    m_bReadError = true;
+    m_oLastReadError = oError;
+
+    return false;
+}
+
+bool cInterruptibleBlockingTCPSocket::flush(uint32_t u32Timeout_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    return flushWriteBuffer(u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::setWriteCoalescingEnabled(bool bEnabled, uint32_t u32Threshold_B, uint32_t u32MaxDelay_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    m_bWriteCoalescing = bEnabled;
+    m_u32WriteCoalescingThreshold_B = u32Threshold_B;
+    m_u32WriteCoalescingMaxDelay_ms = u32MaxDelay_ms;
+
+    if(bEnabled)
+        m_vcWriteBuffer.reserve(u32Threshold_B);
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::isWriteCoalescingEnabled() const
+{
+    return m_bWriteCoalescing;
+}
+
+uint32_t cInterruptibleBlockingTCPSocket::getNBytesPendingWrite() const
+{
+    return m_vcWriteBuffer.size();
+}
+
+bool cInterruptibleBlockingTCPSocket::read(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    if(m_bReadBuffering || m_u32ReadBufferEnd > m_u32ReadBufferStart)
+        return bufferedRead(cpBuffer, u32NBytes, true, u32Timeout_ms);
+
+    return directRead(cpBuffer, u32NBytes, true, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::directRead(char *cpBuffer, uint32_t u32NBytes, bool bAll, uint32_t u32Timeout_ms)
+{
+    m_voReadTransferBuffers.assign(1, boost::asio::mutable_buffer(cpBuffer, u32NBytes));
+
+    return readTransferBuffers(bAll, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::readTransferBuffers(bool bAll, uint32_t u32Timeout_ms)
+{
+    //No bytes transferred counts as an error
+    m_oLastReadError = transfer(false, bAll, false, u32Timeout_ms, boost::posix_time::ptime(), m_u32NBytesLastRead);
+    m_bReadError = m_oLastReadError || !m_u32NBytesLastRead;
+
+    return !m_bReadError;
+}
+
+bool cInterruptibleBlockingTCPSocket::bufferedRead(char *cpBuffer, uint32_t u32NBytes, bool bAll, uint32_t u32Timeout_ms)
+{
+    uint32_t u32NBytesCopied = takeFromReadBuffer(cpBuffer, u32NBytes);
+
+    if(u32NBytesCopied == u32NBytes || (!bAll && u32NBytesCopied))
+    {
+        m_u64NReadBufferHits++;
+
+        m_u32NBytesLastRead = u32NBytesCopied;
+        m_bReadError = !u32NBytesCopied;
+        m_oLastReadError = boost::system::error_code();
+
+        return !m_bReadError;
+    }
+
+    m_u64NReadBufferMisses++;
+
+    uint32_t u32NBytesRemaining = u32NBytes - u32NBytesCopied;
+
+    //Large reads go straight into the caller's buffer rather than being copied through ours
+    if(!m_bReadBuffering || u32NBytesRemaining >= m_u32ReadBufferCapacity_B / 2)
+    {
+        bool bResult = directRead(cpBuffer + u32NBytesCopied, u32NBytesRemaining, bAll, u32Timeout_ms);
+        m_u32NBytesLastRead += u32NBytesCopied;
+
+        return bResult;
+    }
+
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    while(u32NBytesCopied < u32NBytes)
+    {
+        //Pulls in everything the kernel has, up to the free space in the buffer
+        if(!fillReadBuffer(u32Timeout_ms, oStartTime))
+        {
+            m_u32NBytesLastRead = u32NBytesCopied;
+            return false;
+        }
+
+        u32NBytesCopied += takeFromReadBuffer(cpBuffer + u32NBytesCopied, u32NBytes - u32NBytesCopied);
+
+        if(!bAll)
+            break;
+    }
+
+    m_u32NBytesLastRead = u32NBytesCopied;
+    m_bReadError = false;
+    m_oLastReadError = boost::system::error_code();
+
+    return true;
+}
+
+uint32_t cInterruptibleBlockingTCPSocket::takeFromReadBuffer(char *cpBuffer, uint32_t u32NBytes)
+{
+    uint32_t u32NBytesCopied = min(u32NBytes, m_u32ReadBufferEnd - m_u32ReadBufferStart);
+
+    if(u32NBytesCopied)
+    {
+        memcpy(cpBuffer, &m_vcReadBuffer[m_u32ReadBufferStart], u32NBytesCopied);
+        m_u32ReadBufferStart += u32NBytesCopied;
+    }
+
+    return u32NBytesCopied;
+}
+
+bool cInterruptibleBlockingTCPSocket::peek(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    m_u32NBytesLastRead = 0;
+
+    if(m_u32ReadBufferEnd - m_u32ReadBufferStart >= u32NBytes)
+    {
+        m_u64NReadBufferHits++;
+    }
+    else
+    {
+        m_u64NReadBufferMisses++;
+
+        boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        while(m_u32ReadBufferEnd - m_u32ReadBufferStart < u32NBytes)
+        {
+            if(!fillReadBuffer(u32Timeout_ms, oStartTime))
+                return false;
+        }
+    }
+
+    if(u32NBytes)
+        memcpy(cpBuffer, &m_vcReadBuffer[m_u32ReadBufferStart], u32NBytes);
+
+    m_u32NBytesLastRead = u32NBytes;
+    m_bReadError = false;
+    m_oLastReadError = boost::system::error_code();
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::skip(uint32_t u32NBytes, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    uint32_t u32NBytesSkipped = min(u32NBytes, m_u32ReadBufferEnd - m_u32ReadBufferStart);
+    m_u32ReadBufferStart += u32NBytesSkipped;
+
+    if(u32NBytesSkipped == u32NBytes)
+    {
+        m_u64NReadBufferHits++;
+    }
+    else
+    {
+        m_u64NReadBufferMisses++;
+
+        boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        while(u32NBytesSkipped < u32NBytes)
+        {
+            if(!fillReadBuffer(u32Timeout_ms, oStartTime))
+            {
+                m_u32NBytesLastRead = u32NBytesSkipped;
+                return false;
+            }
+
+            uint32_t u32NBytesDiscarded = min(u32NBytes - u32NBytesSkipped, m_u32ReadBufferEnd - m_u32ReadBufferStart);
+            m_u32ReadBufferStart += u32NBytesDiscarded;
+            u32NBytesSkipped += u32NBytesDiscarded;
+        }
+    }
+
+    m_u32NBytesLastRead = u32NBytesSkipped;
+    m_bReadError = false;
+    m_oLastReadError = boost::system::error_code();
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::setReadBufferingEnabled(bool bEnabled, uint32_t u32Capacity_B)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    //fillReadBuffer() always reads at least MIN_READ_SIZE_B at a time
+    m_u32ReadBufferCapacity_B = max(u32Capacity_B, MIN_READ_SIZE_B);
+    m_bReadBuffering = bEnabled;
+
+    //Resize now if that doesn't lose unread data. Otherwise the buffer keeps its size until it next empties.
+    if(m_u32ReadBufferStart == m_u32ReadBufferEnd)
+    {
+        m_u32ReadBufferStart = 0;
+        m_u32ReadBufferEnd = 0;
+
+        if(bEnabled)
+            m_vcReadBuffer.resize(m_u32ReadBufferCapacity_B);
+        else
+            vector<char>().swap(m_vcReadBuffer);
+    }
+
+    return true;
+}
+
+void cInterruptibleBlockingTCPSocket::setMaxLineLength(uint32_t u32MaxLineLength_B)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    m_u32MaxLineLength_B = u32MaxLineLength_B;
+}
+
+bool cInterruptibleBlockingTCPSocket::isReadBufferingEnabled() const
+{
+    return m_bReadBuffering;
+}
+
+uint64_t cInterruptibleBlockingTCPSocket::getNReadBufferHits() const
+{
+    return m_u64NReadBufferHits;
+}
+
+uint64_t cInterruptibleBlockingTCPSocket::getNReadBufferMisses() const
+{
+    return m_u64NReadBufferMisses;
+}
+
+void cInterruptibleBlockingTCPSocket::resetReadBufferStatistics()
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    m_u64NReadBufferHits = 0;
+    m_u64NReadBufferMisses = 0;
+}
+
+bool cInterruptibleBlockingTCPSocket::write(const std::vector<boost::asio::const_buffer> &voBuffers, uint32_t u32Timeout_ms)
+{
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex);
+
+    prepareWriteSocket();
+
+    //Pending coalesced data goes out first, in the same system call
+    m_voWriteTransferBuffers.clear();
+
+    if(!m_vcWriteBuffer.empty())
+        m_voWriteTransferBuffers.push_back(boost::asio::buffer(m_vcWriteBuffer));
+
+    for(vector<boost::asio::const_buffer>::const_iterator it = voBuffers.begin(); it != voBuffers.end(); ++it)
+        m_voWriteTransferBuffers.push_back(boost::asio::mutable_buffer(const_cast<void*>(boost::asio::buffer_cast<const void*>(*it)), boost::asio::buffer_size(*it)));
+
+    bool bResult = writeTransferBuffers(true, false, u32Timeout_ms);
+    takeFlushedBytes(bResult);
+
+    return bResult;
+}
+
+bool cInterruptibleBlockingTCPSocket::read(const std::vector<boost::asio::mutable_buffer> &voBuffers, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    if(m_bReadBuffering || m_u32ReadBufferEnd > m_u32ReadBufferStart)
+    {
+        //Data already held in the read buffer comes first. Only what it can't supply is read from the socket.
+        m_voReadTransferBuffers.clear();
+        uint32_t u32NBytesCopied = 0;
+
+        for(uint32_t u32Index = 0; u32Index < voBuffers.size(); u32Index++)
+        {
+            uint32_t u32NBytesToCopy = boost::asio::buffer_size(voBuffers[u32Index]);
+            uint32_t u32NBytesTaken = takeFromReadBuffer(boost::asio::buffer_cast<char*>(voBuffers[u32Index]), u32NBytesToCopy);
+            u32NBytesCopied += u32NBytesTaken;
+
+            if(u32NBytesTaken < u32NBytesToCopy)
+            {
+                m_voReadTransferBuffers.push_back(voBuffers[u32Index] + u32NBytesTaken);
+                m_voReadTransferBuffers.insert(m_voReadTransferBuffers.end(), voBuffers.begin() + u32Index + 1, voBuffers.end());
+                break;
+            }
+        }
+
+        if(m_voReadTransferBuffers.empty())
+        {
+            m_u64NReadBufferHits++;
+
+            m_u32NBytesLastRead = u32NBytesCopied;
+            m_bReadError = !u32NBytesCopied;
+            m_oLastReadError = boost::system::error_code();
+
+            return !m_bReadError;
+        }
+
+        m_u64NReadBufferMisses++;
+
+        bool bResult = readTransferBuffers(true, u32Timeout_ms);
+        m_u32NBytesLastRead += u32NBytesCopied;
+
+        return bResult;
+    }
+
+    m_voReadTransferBuffers.assign(voBuffers.begin(), voBuffers.end());
+
+    return readTransferBuffers(true, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingTCPSocket::readUntil(string &strBuffer, const string &strDelimiter, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    uint32_t u32LineLength_B;
+
+    if(!bufferUntil(strDelimiter, u32LineLength_B, u32Timeout_ms))
+        return false;
+
+    strBuffer.append(&m_vcReadBuffer[m_u32ReadBufferStart], u32LineLength_B);
+    m_u32ReadBufferStart += u32LineLength_B;
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::readUntilView(const char *&cpLine, uint32_t &u32NBytes, const string &strDelimiter, uint32_t u32Timeout_ms)
+{
+    boost::system::error_code oFlushError = flushBeforeRead(u32Timeout_ms);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex);
+
+    if(oFlushError)
+        return failRead(oFlushError);
+
+    cpLine = NULL;
+    u32NBytes = 0;
+
+    uint32_t u32LineLength_B;
+
+    if(!bufferUntil(strDelimiter, u32LineLength_B, u32Timeout_ms))
+        return false;
+
+    //Consumed but left in place. The buffer is only rearranged by the next fill.
+    cpLine = &m_vcReadBuffer[m_u32ReadBufferStart];
+    u32NBytes = u32LineLength_B;
+    m_u32ReadBufferStart += u32LineLength_B;
+
+    return true;
 }
 
-bool cInterruptibleBlockingTCPSocket::openAndConnect(string strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms)
+bool cInterruptibleBlockingTCPSocket::bufferUntil(const string &strDelimiter, uint32_t &u32LineLength_B, uint32_t u32Timeout_ms)
 {
-    if(m_oSocket.get_io_service().stopped())
+    u32LineLength_B = 0;
+    m_u32NBytesLastRead = 0;
+
+    if(strDelimiter.empty())
     {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
+        m_bReadError = true;
+        m_oLastReadError = boost::asio::error::invalid_argument;
+        return false;
     }
 
-    //If the socket is already open close it
-    close();
+    //Only read the clock if we actually have to wait for data
+    boost::posix_time::ptime oStartTime;
 
-    //Open the socket
-    m_oSocket.open(boost::asio::ip::tcp::v4(), m_oLastopenAndConnectError);
+    //Offset from m_u32ReadBufferStart to search from so that each byte is only scanned once
+    uint32_t u32SearchOffset = 0;
 
-    if(m_oLastopenAndConnectError)
-    {
-        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Error opening socket: " << m_oLastopenAndConnectError.message() << endl;
-        return false;
-    }
-    else
+    while(!findBufferedLine(strDelimiter, u32SearchOffset, u32LineLength_B))
     {
-        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Successfully opened TCP socket. Attempting to connect..." << endl;
+        if(oStartTime.is_not_a_date_time())
+            oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        //Data read so far (a partial line) stays in the buffer for the next call
+        if(!fillReadBuffer(u32Timeout_ms, oStartTime))
+            return false;
     }
-    fflush(stdout);
 
-    //Set some socket options
-    m_oSocket.set_option( boost::asio::socket_base::receive_buffer_size(64 * 1024 * 1024) ); //Set buffer to 64 MB
-    m_oSocket.set_option( boost::asio::socket_base::reuse_address(true) );
+    return true;
+}
 
-    boost::asio::ip::tcp::endpoint oPeerEndPoint;
-    try
-    {
-        oPeerEndPoint = createEndpoint(strPeerAddress, u16PeerPort);
-    }
-    catch(boost::system::system_error &e)
-    {
-        //Typically thrown when hostname cannot be resolved.
+bool cInterruptibleBlockingTCPSocket::findBufferedLine(const string &strDelimiter, uint32_t &u32SearchOffset, uint32_t &u32LineLength_B)
+{
+    if(m_u32ReadBufferEnd == m_u32ReadBufferStart)
         return false;
-    }
 
-    //Async connect can have timeout or be cancelled at any point
-    m_oSocket.async_connect(oPeerEndPoint,
-                            boost::bind(&cInterruptibleBlockingTCPSocket::callback_connectComplete,
-                                        this,
-                                        boost::asio::placeholders::error)
-                            );
+    const char *cpStart = &m_vcReadBuffer[m_u32ReadBufferStart];
+    const char *cpEnd = &m_vcReadBuffer[0] + m_u32ReadBufferEnd;
 
+    const char *cpDelimiter = findDelimiter(cpStart + u32SearchOffset, cpEnd, strDelimiter);
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
+    if(cpDelimiter)
     {
-        m_oOpenAndConnectTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
-        m_oOpenAndConnectTimer.async_wait( boost::bind(&cInterruptibleBlockingTCPSocket::callback_connectTimeOut,
-                                                       this, boost::asio::placeholders::error) );
-    }
+        u32LineLength_B = cpDelimiter - cpStart + strDelimiter.length();
 
-    m_oSocket.get_io_service().run();
+        m_u32NBytesLastRead = u32LineLength_B;
+        m_bReadError = false;
+        m_oLastReadError = boost::system::error_code();
 
-    if(!m_bOpenAndConnectError)
-        cout << "cInterruptibleBlockingTCPSocket::openAndConnect(): Successfully connected TCP socket to " << strPeerAddress << ":" << u16PeerPort << endl;
+        return true;
+    }
 
-    return !m_bOpenAndConnectError;
+    //A delimiter may straddle the end of what we have so far
+    uint32_t u32NBytesBuffered = m_u32ReadBufferEnd - m_u32ReadBufferStart;
+    u32SearchOffset = u32NBytesBuffered >= strDelimiter.length() ? u32NBytesBuffered - strDelimiter.length() + 1 : 0;
+
+    return false;
 }
 
-void cInterruptibleBlockingTCPSocket::close()
+bool cInterruptibleBlockingTCPSocket::makeReadBufferSpace(char *&cpFree, uint32_t &u32NBytesFree)
 {
-    //If the socket is open close it
-    if(m_oSocket.is_open())
+    if(m_u32ReadBufferStart == m_u32ReadBufferEnd)
     {
-        m_oSocket.cancel();
+        m_u32ReadBufferStart = 0;
+        m_u32ReadBufferEnd = 0;
+    }
 
-        try
+    //Make space at the end. Unread data is moved to the front only when needed so copying is amortised O(1) per byte.
+    if(m_vcReadBuffer.size() - m_u32ReadBufferEnd < MIN_READ_SIZE_B)
+    {
+        if(m_u32ReadBufferStart)
         {
-            m_oSocket.close();
+            memmove(&m_vcReadBuffer[0], &m_vcReadBuffer[m_u32ReadBufferStart], m_u32ReadBufferEnd - m_u32ReadBufferStart);
+            m_u32ReadBufferEnd -= m_u32ReadBufferStart;
+            m_u32ReadBufferStart = 0;
         }
-        catch(boost::system::system_error &e)
+
+        if(m_vcReadBuffer.size() - m_u32ReadBufferEnd < MIN_READ_SIZE_B)
         {
-            //Catch special conditions where socket is trying to be opened etc.
-            //Prevents crash.
+            //Only a line (or peek) without an end in sight fills the whole buffer. Don't let one grow it without bound.
+            if(m_u32ReadBufferEnd >= m_u32MaxLineLength_B)
+            {
+                m_bReadError = true;
+                m_oLastReadError = boost::asio::error::message_size;
+                cout << "cInterruptibleBlockingTCPSocket::makeReadBufferSpace(): More than " << m_u32MaxLineLength_B
+                     << " B buffered without the end of the line." << endl;
+                return false;
+            }
+
+            uint64_t u64NewSize_B = m_vcReadBuffer.empty() ? m_u32ReadBufferCapacity_B : m_vcReadBuffer.size() * 2;
+            if(!m_vcReadBuffer.empty())
+                u64NewSize_B = min(u64NewSize_B, (uint64_t)m_u32MaxLineLength_B + MIN_READ_SIZE_B);
+
+            m_vcReadBuffer.resize(u64NewSize_B);
         }
     }
+
+    cpFree = &m_vcReadBuffer[m_u32ReadBufferEnd];
+    u32NBytesFree = m_vcReadBuffer.size() - m_u32ReadBufferEnd;
+
+    return true;
 }
 
-bool cInterruptibleBlockingTCPSocket::send(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+bool cInterruptibleBlockingTCPSocket::prepareReadBufferFill(vector<boost::asio::mutable_buffer> &voBuffers)
 {
-    //Note this function sends to the specific endpoint set in the constructor or with the openAndBind function
+    char *cpFree;
+    uint32_t u32NBytesFree;
 
-    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    if(!makeReadBufferSpace(cpFree, u32NBytesFree))
+        return false;
 
-    if(m_oSocket.get_io_service().stopped())
-    {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
-    }
+#ifdef __linux__
+    //Registered again only when the buffer has been reallocated
+    if(m_pReadIOUring)
+        m_pReadIOUring->registerBuffer(&m_vcReadBuffer[0], m_vcReadBuffer.size());
+#endif
 
-    //Asynchronously write characters
-    m_oSocket.async_send( boost::asio::buffer(cpBuffer, u32NBytes),
-                          boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeComplete,
-                                      this,
-                                      boost::asio::placeholders::error,
-                                      boost::asio::placeholders::bytes_transferred) );
+    voBuffers.assign(1, boost::asio::mutable_buffer(cpFree, u32NBytesFree));
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::fillReadBuffer(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime)
+{
+    if(!prepareReadBufferFill(m_voReadTransferBuffers))
+        return false;
+
+    //Pulls in everything the kernel has, up to the free space. Calls that read repeatedly keep to their overall timeout.
+    uint32_t u32NReceived;
+    boost::system::error_code oError = transfer(false, false, false, u32Timeout_ms, oStartTime, u32NReceived);
+
+    if(oError)
     {
-        m_oWriteTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
-        m_oWriteTimer.async_wait( boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeTimeOut,
-                                              this, boost::asio::placeholders::error) );
+        m_bReadError = true;
+        m_oLastReadError = oError;
+        return false;
     }
 
-    // This will block until at least a byte is written
-    // or until it is cancelled.
-    m_oSocket.get_io_service().run();
+    m_u32ReadBufferEnd += u32NReceived;
+    return true;
+}
 
-    return !m_bWriteError;
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+bool cInterruptibleBlockingTCPSocket::checkSharedIOService(const char *cpFunction, boost::system::error_code &oError) const
+{
+    if(!m_pOwnedIOService)
+        return true;
+
+    cout << "cInterruptibleBlockingTCPSocket::" << cpFunction << "(): Coroutine calls need a socket on a shared io_service" << endl;
+    oError = boost::asio::error::operation_not_supported;
+
+    return false;
 }
 
-bool cInterruptibleBlockingTCPSocket::receive(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+boost::asio::awaitable<boost::system::error_code> cInterruptibleBlockingTCPSocket::asyncFlushBeforeRead(cAwaitableDeadline &oDeadline)
 {
-    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    if(!m_bWriteCoalescing)
+        co_return boost::system::error_code();
 
-    if(m_oSocket.get_io_service().stopped())
-    {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
-    }
+    //Held until the data has gone out, as by flushBeforeRead()
+    boost::system::error_code oError;
+    co_await m_oWriteMutex.asyncLock(oDeadline, boost::asio::redirect_error(boost::asio::use_awaitable, oError));
 
-    //Asynchronously read characters into string
-    m_oSocket.async_receive( boost::asio::buffer(cpBuffer, u32NBytes),
-                             boost::bind(&cInterruptibleBlockingTCPSocket::callback_readComplete,
-                                         this,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred) );
+    if(oError)
+        co_return oError;
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
-    {
-        m_oReadTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oReadTimer.async_wait(boost::bind(&cInterruptibleBlockingTCPSocket::callback_readTimeOut,
-                                            this, boost::asio::placeholders::error));
-    }
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex, boost::adopt_lock);
+    prepareWriteSocket();
 
-    // This will block until at least a byte is read
-    // or until it is cancelled.
-    m_oSocket.get_io_service().run();
+    if(m_vcWriteBuffer.empty())
+        co_return boost::system::error_code();
 
-    return !m_bReadError;
+    //Dropped even on failure as part of it may have been sent (see takeFlushedBytes()), so taken out now
+    vector<char> vcPending;
+    vcPending.swap(m_vcWriteBuffer);
+    vector<boost::asio::mutable_buffer> voBuffers(1, boost::asio::buffer(vcPending));
+
+    co_await asyncTransfer(true, voBuffers, true, false, 0, boost::posix_time::ptime(), &oDeadline,
+                           boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+    //Hand the memory back, keeping the capacity reserved for coalescing
+    vcPending.clear();
+    m_vcWriteBuffer.swap(vcPending);
+
+    co_return oError;
 }
 
-bool cInterruptibleBlockingTCPSocket::write(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+boost::asio::awaitable<bool> cInterruptibleBlockingTCPSocket::asyncOpenAndConnect(string strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms, cCancellationToken *pToken)
 {
-    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    m_bOpenAndConnectError = true;
 
-    //The write function guarantees deliver of all u32NBytes bytes in send buffer unless and error is encountered
+    if(!checkSharedIOService("asyncOpenAndConnect", m_oLastopenAndConnectError))
+        co_return false;
 
-    if(m_oSocket.get_io_service().stopped())
-    {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
-    }
+    //If the socket is already open close it
+    close();
 
-    //Asynchronously write all data
-    boost::asio::async_write(m_oSocket, boost::asio::buffer(cpBuffer, u32NBytes),
-                             boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeComplete,
-                                         this,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred) );
+    m_oSocket.open(boost::asio::ip::tcp::v4(), m_oLastopenAndConnectError);
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
+    if(m_oLastopenAndConnectError)
     {
-        m_oWriteTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oWriteTimer.async_wait(boost::bind(&cInterruptibleBlockingTCPSocket::callback_writeTimeOut,
-                                             this, boost::asio::placeholders::error));
+        cout << "cInterruptibleBlockingTCPSocket::asyncOpenAndConnect(): Error opening socket: " << m_oLastopenAndConnectError.message() << endl;
+        co_return false;
     }
 
-    // This will block until all bytes are written
-    // or until it is cancelled.
-    m_oSocket.get_io_service().run();
+    //Same options as openAndConnect()
+    m_oSocket.set_option( boost::asio::socket_base::receive_buffer_size(64 * 1024 * 1024) ); //Set buffer to 64 MB
+    m_oSocket.set_option( boost::asio::socket_base::reuse_address(true) );
 
-    return !m_bWriteError;
-}
+    //The timeout covers resolution and connection together
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
 
-bool cInterruptibleBlockingTCPSocket::write(const std::string &strData, uint32_t u32Timeout_ms)
-{
-    return write(strData.c_str(), strData.length(), u32Timeout_ms);
+    boost::system::error_code oError;
+    co_await asyncConnect(strPeerAddress, u16PeerPort, 0, &oDeadline, boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+    m_bOpenAndConnectError = oError ? true : false;
+    m_oLastopenAndConnectError = oError;
+
+    co_return !m_bOpenAndConnectError;
 }
 
-bool cInterruptibleBlockingTCPSocket::read(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
+boost::asio::awaitable<bool> cInterruptibleBlockingTCPSocket::asyncWrite(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms, cCancellationToken *pToken)
 {
-    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    //The timeout covers the wait for the lock, which is held until the data has gone out, as by write(). The results
+    //are only set with it held, as a blocking write() may be setting them.
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
+
+    boost::system::error_code oError;
 
-    //The read function guarantees reading of all u32NBytes bytes to buffer unless an error is encountered
+    if(checkSharedIOService("asyncWrite", oError))
+        co_await m_oWriteMutex.asyncLock(oDeadline, boost::asio::redirect_error(boost::asio::use_awaitable, oError));
 
-    if(m_oSocket.get_io_service().stopped())
+    if(oError)
     {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
+        m_u32NBytesLastWritten = 0;
+        m_bWriteError = true;
+        m_oLastWriteError = oError;
+        co_return false;
     }
 
-    //Asynchronously read until the delimiting character is found
-    boost::asio::async_read(m_oSocket, boost::asio::buffer(cpBuffer, u32NBytes),
-                            boost::bind(&cInterruptibleBlockingTCPSocket::callback_readComplete,
-                                        this,
-                                        boost::asio::placeholders::error,
-                                        boost::asio::placeholders::bytes_transferred) );
+    boost::unique_lock<cAwaitableMutex> oLock(m_oWriteMutex, boost::adopt_lock);
+    prepareWriteSocket();
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
-    {
-        m_oReadTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oReadTimer.async_wait(boost::bind(&cInterruptibleBlockingTCPSocket::callback_readTimeOut,
-                                            this, boost::asio::placeholders::error));
-    }
+    bool bZeroCopy;
+    vector<boost::asio::mutable_buffer> voBuffers;
 
-    // This will block until all bytes are read
-    // or until it is cancelled.
-    m_oSocket.get_io_service().run();
+    if(!prepareWrite(cpBuffer, u32NBytes, voBuffers, bZeroCopy))
+        co_return true;
 
-    return !m_bReadError;
+    //Coalesced data going out with this write is taken out of the write buffer meanwhile. swap() leaves it where
+    //voBuffers points.
+    vector<char> vcPending;
+    vcPending.swap(m_vcWriteBuffer);
+
+    uint32_t u32NBytesWritten = co_await asyncTransfer(true, voBuffers, true, bZeroCopy, 0, boost::posix_time::ptime(), &oDeadline,
+                                                       boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+    //No bytes transferred counts as an error, as for write()
+    m_u32NBytesLastWritten = u32NBytesWritten;
+    m_bWriteError = oError || !u32NBytesWritten;
+    m_oLastWriteError = oError;
+
+    m_vcWriteBuffer.swap(vcPending);
+    takeFlushedBytes(!m_bWriteError);
+
+    co_return !m_bWriteError;
 }
 
-bool cInterruptibleBlockingTCPSocket::readUntil(string &strBuffer, const string &strDelimiter, uint32_t u32Timeout_ms)
+boost::asio::awaitable<bool> cInterruptibleBlockingTCPSocket::asyncRead(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms, cCancellationToken *pToken)
 {
-    boost::unique_lock<boost::mutex> oLock(m_oMutex);
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
 
-    //Check if we have already read up the delimeter if so return this string
-    if(m_strReadUntilBuff.find_first_of(strDelimiter) != string::npos)
-    {
-        uint32_t u32DelimPos = m_strReadUntilBuff.find_first_of(strDelimiter);
-        strBuffer.append(m_strReadUntilBuff.substr(0, u32DelimPos + 1));
-        m_strReadUntilBuff.erase(0, u32DelimPos + 1);
+    //A request may be sitting in the write buffer, as for read(). The read lock is taken after it has gone out. The
+    //results are only set with it held, as a blocking read() may be setting them.
+    boost::system::error_code oError;
 
-        return true;
-    }
+    if(checkSharedIOService("asyncRead", oError))
+        oError = co_await asyncFlushBeforeRead(oDeadline);
 
-    if(m_oSocket.get_io_service().stopped())
-    {
-        //Necessary after a timeout or previously finished run:
-        m_oSocket.get_io_service().reset();
-    }
+    if(!oError)
+        co_await m_oReadMutex.asyncLock(oDeadline, boost::asio::redirect_error(boost::asio::use_awaitable, oError));
 
-    boost::asio::streambuf oStreamBuf;
+    if(oError)
+        co_return failRead(oError);
 
-    //Asynchronously read until the delimiting character is found
-    boost::asio::async_read_until(m_oSocket, oStreamBuf, strDelimiter,
-                                  boost::bind(&cInterruptibleBlockingTCPSocket::callback_readComplete,
-                                              this,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred) );
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex, boost::adopt_lock);
 
-    // Setup a deadline time to implement our timeout.
-    if(u32Timeout_ms)
+    //Data left in the read buffer (by readUntil() etc.) comes first
+    uint32_t u32NBytesCopied = takeFromReadBuffer(cpBuffer, u32NBytes);
+    uint32_t u32NBytesRead = 0;
+
+    if(u32NBytesCopied < u32NBytes)
     {
-        m_oReadTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oReadTimer.async_wait(boost::bind(&cInterruptibleBlockingTCPSocket::callback_readTimeOut,
-                                            this, boost::asio::placeholders::error));
+        vector<boost::asio::mutable_buffer> voBuffers(1, boost::asio::mutable_buffer(cpBuffer + u32NBytesCopied, u32NBytes - u32NBytesCopied));
+        u32NBytesRead = co_await asyncTransfer(false, voBuffers, true, false, 0, boost::posix_time::ptime(), &oDeadline,
+                                               boost::asio::redirect_error(boost::asio::use_awaitable, oError));
     }
 
-    // This will block until the delimiter is found and read
-    // or until the it is cancelled.
-    for(;;)
+    //No bytes transferred counts as an error, as for read()
+    m_u32NBytesLastRead = u32NBytesCopied + u32NBytesRead;
+    m_bReadError = oError || !m_u32NBytesLastRead;
+    m_oLastReadError = oError;
+
+    co_return !m_bReadError;
+}
+
+boost::asio::awaitable<bool> cInterruptibleBlockingTCPSocket::asyncReadUntil(string &strBuffer, const string &strDelimiter, uint32_t u32Timeout_ms, cCancellationToken *pToken)
+{
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
+
+    //A request may be sitting in the write buffer, as for readUntil()
+    boost::system::error_code oError;
+
+    if(checkSharedIOService("asyncReadUntil", oError) && strDelimiter.empty())
+        oError = boost::asio::error::invalid_argument;
+    else if(!oError)
+        oError = co_await asyncFlushBeforeRead(oDeadline);
+
+    if(!oError)
+        co_await m_oReadMutex.asyncLock(oDeadline, boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+    if(oError)
+        co_return failRead(oError);
+
+    boost::unique_lock<cAwaitableMutex> oLock(m_oReadMutex, boost::adopt_lock);
+    m_bReadError = true;
+    m_u32NBytesLastRead = 0;
+
+    //The buffering and search of bufferUntil(), with the reads awaited instead
+    uint32_t u32SearchOffset = 0;
+    uint32_t u32LineLength_B = 0;
+    vector<boost::asio::mutable_buffer> voBuffers;
+
+    if(!findBufferedLine(strDelimiter, u32SearchOffset, u32LineLength_B))
     {
-        try
-        {
-            m_oSocket.get_io_service().run();
-            break;
-        }
-        catch(...)
+        do
         {
-            cout << "cInterruptibleBlockingTCPSocket::readUntil(): Caught exception on io_service::run()" << endl;
-        }
-    }
+            if(!prepareReadBufferFill(voBuffers))
+                co_return false;
 
-    //Copy the data to the member string. This may contain more than 1 of the delimiter
-    try
-    {
-        m_strReadUntilBuff.append( std::string( (std::istreambuf_iterator<char>(&oStreamBuf)), std::istreambuf_iterator<char>() ) );
-    }
-    catch(...)
-    {
-        cout << "cInterruptibleBlockingTCPSocket::readUntil(): Got string convertion error." << endl;
-    }
+            uint32_t u32NReceived = co_await asyncTransfer(false, voBuffers, false, false, 0, boost::posix_time::ptime(), &oDeadline,
+                                                           boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+            //Data read so far (a partial line) stays in the buffer for the next call
+            if(oError)
+                co_return failRead(oError);
 
-    //Move characters up to the first instance of the delimiter to the argument string
-    uint32_t u32DelimPos = m_strReadUntilBuff.find_first_of(strDelimiter);
-    strBuffer.append(m_strReadUntilBuff.substr(0, u32DelimPos + 1));
-    m_strReadUntilBuff.erase(0, u32DelimPos + 1);
+            m_u32ReadBufferEnd += u32NReceived;
+        }
+        while(!findBufferedLine(strDelimiter, u32SearchOffset, u32LineLength_B));
+    }
 
-    //Debug: Deallocation of the streambuffer seems segfault sometimes. Try empty first:
-    oStreamBuf.consume(oStreamBuf.size());
+    strBuffer.append(&m_vcReadBuffer[m_u32ReadBufferStart], u32LineLength_B);
+    m_u32ReadBufferStart += u32LineLength_B;
 
-    return !m_bReadError;
+    co_return true;
 }
+#endif
 
 void cInterruptibleBlockingTCPSocket::callback_connectComplete(const boost::system::error_code& oError)
 {
@@ -359,32 +2186,28 @@ void cInterruptibleBlockingTCPSocket::callback_connectComplete(const boost::syst
 
 void cInterruptibleBlockingTCPSocket::callback_connectTimeOut(const boost::system::error_code& oError)
 {
+    //Cancelled because the connect completed. Keep the connect's own result (e.g. connection refused).
     if (oError)
-    {
-        m_oLastopenAndConnectError = oError;
         return;
-    }
 
     std::cout << "!!! Time out reached on socket connect\"" << m_strName << "\" (" << this << ")" << std::endl;
 
     m_oSocket.cancel();
 }
 
-void cInterruptibleBlockingTCPSocket::callback_readComplete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred)
+void cInterruptibleBlockingTCPSocket::callback_readReady(const boost::system::error_code& oError)
 {
-    m_bReadError = oError || (u32NBytesTransferred == 0);
+    m_bReadError = oError ? true : false;
     m_oReadTimer.cancel();
 
-    m_u32NBytesLastRead = u32NBytesTransferred;
     m_oLastReadError = oError;
 }
 
-void cInterruptibleBlockingTCPSocket::callback_writeComplete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred)
+void cInterruptibleBlockingTCPSocket::callback_writeReady(const boost::system::error_code& oError)
 {
-    m_bWriteError = oError || (u32NBytesTransferred == 0);
+    m_bWriteError = oError ? true : false;
     m_oWriteTimer.cancel();
 
-    m_u32NBytesLastWritten = u32NBytesTransferred;
     m_oLastWriteError = oError;
 }
 
@@ -407,14 +2230,107 @@ void cInterruptibleBlockingTCPSocket::callback_writeTimeOut(const boost::system:
         return;
     }
 
-    m_oSocket.cancel();
+    m_oWriteSocket.cancel();
+}
+
+void cInterruptibleBlockingTCPSocket::prepareWriteSocket()
+{
+    //Writes use their own descriptor, a duplicate of the connected socket, so that they can be driven by their own
+    //io_service. It is created on the first write after each connect / accept and closed by close().
+    if(m_oWriteSocket.is_open() || !m_oSocket.is_open())
+        return;
+
+    boost::system::error_code oError;
+    boost::asio::ip::tcp::endpoint oLocalEndpoint = m_oSocket.local_endpoint(oError);
+    if(oError)
+        oLocalEndpoint = boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 0);
+
+#ifdef _WIN32
+    WSAPROTOCOL_INFOW oProtocolInfo;
+    SOCKET hDuplicate = INVALID_SOCKET;
+
+    if(!WSADuplicateSocketW(m_oSocket.native_handle(), GetCurrentProcessId(), &oProtocolInfo))
+        hDuplicate = WSASocketW(oProtocolInfo.iAddressFamily, oProtocolInfo.iSocketType, oProtocolInfo.iProtocol, &oProtocolInfo, 0, WSA_FLAG_OVERLAPPED);
+
+    if(hDuplicate == INVALID_SOCKET)
+    {
+        oError = boost::system::error_code(WSAGetLastError(), boost::asio::error::get_system_category());
+    }
+    else
+    {
+        m_oWriteSocket.assign(oLocalEndpoint.protocol(), hDuplicate, oError);
+        if(oError)
+            closesocket(hDuplicate);
+    }
+#else
+    int iDuplicate = dup(m_oSocket.native_handle());
+
+    if(iDuplicate < 0)
+    {
+        oError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+    else
+    {
+        m_oWriteSocket.assign(oLocalEndpoint.protocol(), iDuplicate, oError);
+        if(oError)
+            ::close(iDuplicate);
+    }
+#endif
+
+    if(oError)
+    {
+        cout << "cInterruptibleBlockingTCPSocket::prepareWriteSocket(): Unable to duplicate socket for writing: " << oError.message() << endl;
+        return;
+    }
+
+    //Both descriptors share the blocking mode. Keep it non-blocking for good so that neither side's asio state can turn
+    //it back to blocking underneath the other.
+    boost::system::error_code oModeError;
+    m_oSocket.native_non_blocking(true, oModeError);
+    m_oWriteSocket.native_non_blocking(true, oModeError);
 }
 
 void cInterruptibleBlockingTCPSocket::cancelCurrrentOperations()
+{
+    m_oResolver.cancelCurrrentOperations();
+
+    cancelReadOperations();
+    cancelWriteOperations();
+}
+
+void cInterruptibleBlockingTCPSocket::cancelReadOperations()
+{
+#ifdef __linux__
+    if(m_pFastPathReadWaiter)
+        m_pFastPathReadWaiter->cancel();
+
+    if(m_pReadIOUring)
+        m_pReadIOUring->cancel();
+#endif
+
+    m_oReadWaiter.cancel();
+}
+
+void cInterruptibleBlockingTCPSocket::cancelWriteOperations()
+{
+#ifdef __linux__
+    if(m_pFastPathWriteWaiter)
+        m_pFastPathWriteWaiter->cancel();
+
+    if(m_pWriteIOUring)
+        m_pWriteIOUring->cancel();
+
+    if(m_pZeroCopyTracker)
+        m_pZeroCopyTracker->cancel();
+#endif
+
+    m_oWriteWaiter.cancel();
+}
+
+void cInterruptibleBlockingTCPSocket::cancelReadIO()
 {
     try
     {
-        m_oSocket.get_io_service().stop();
         m_oSocket.cancel();
     }
     catch(boost::system::system_error &e)
@@ -425,6 +2341,7 @@ void cInterruptibleBlockingTCPSocket::cancelCurrrentOperations()
 
     try
     {
+        m_oOpenAndConnectTimer.cancel();
         m_oReadTimer.cancel();
     }
     catch(boost::system::system_error &e)
@@ -432,6 +2349,20 @@ void cInterruptibleBlockingTCPSocket::cancelCurrrentOperations()
         //Catch special conditions where socket is trying to be opened etc.
         //Prevents crash.
     }
+}
+
+void cInterruptibleBlockingTCPSocket::cancelWriteIO()
+{
+    try
+    {
+        if(m_oWriteSocket.is_open())
+            m_oWriteSocket.cancel();
+    }
+    catch(boost::system::system_error &e)
+    {
+        //Catch special conditions where socket is trying to be opened etc.
+        //Prevents crash.
+    }
 
     try
     {
@@ -444,12 +2375,21 @@ void cInterruptibleBlockingTCPSocket::cancelCurrrentOperations()
     }
 }
 
-boost::asio::ip::tcp::endpoint cInterruptibleBlockingTCPSocket::createEndpoint(string strHostAddress, uint16_t u16Port)
+void cInterruptibleBlockingTCPSocket::cancelConnect()
 {
-    stringstream oSS;
-    oSS << u16Port;
+    boost::system::error_code oError;
+    m_oSocket.cancel(oError);
+}
+
+boost::asio::ip::tcp::endpoint cInterruptibleBlockingTCPSocket::createEndpoint(string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms)
+{
+    boost::asio::ip::address oAddress;
+
+    //Throw on failure as the synchronous resolver used to
+    if(!m_oResolver.resolve(strHostAddress, oAddress, u32Timeout_ms))
+        throw boost::system::system_error(m_oResolver.getLastError());
 
-    return *m_oResolver.resolve(boost::asio::ip::tcp::resolver::query(boost::asio::ip::tcp::v4(), strHostAddress, oSS.str()));
+    return boost::asio::ip::tcp::endpoint(oAddress, u16Port);
 }
 
 std::string cInterruptibleBlockingTCPSocket::getEndpointHostAddress(boost::asio::ip::tcp::endpoint oEndPoint) const
@@ -507,6 +2447,11 @@ uint32_t cInterruptibleBlockingTCPSocket::getNBytesLastWritten() const
     return m_u32NBytesLastWritten;
 }
 
+uint64_t cInterruptibleBlockingTCPSocket::getNBytesLastWrittenFromFile() const
+{
+    return m_u64NBytesLastWrittenFromFile;
+}
+
 boost::system::error_code cInterruptibleBlockingTCPSocket::getLastWriteError() const
 {
     return m_oLastWriteError;
@@ -517,12 +2462,78 @@ boost::system::error_code cInterruptibleBlockingTCPSocket::getLastReadError() co
     return m_oLastReadError;
 }
 
+boost::system::error_code cInterruptibleBlockingTCPSocket::getLastOpenAndConnectError() const
+{
+    return m_oLastopenAndConnectError;
+}
+
 uint32_t cInterruptibleBlockingTCPSocket::getBytesAvailable() const
 {
-    return m_oSocket.available();
+    //Includes data already pulled into the read buffer
+    return m_oSocket.available() + m_u32ReadBufferEnd - m_u32ReadBufferStart;
 }
 
 boost::asio::ip::tcp::socket* cInterruptibleBlockingTCPSocket::getBoostSocketPointer()
 {
     return &m_oSocket;
 }
+
+#ifdef __linux__
+bool cInterruptibleBlockingTCPSocket::detachDescriptor(int &iFD, string &strUnreadData)
+{
+    boost::unique_lock<cAwaitableMutex> oReadLock(m_oReadMutex);
+    boost::unique_lock<cAwaitableMutex> oWriteLock(m_oWriteMutex);
+
+    iFD = -1;
+    strUnreadData.clear();
+
+    if(!m_oSocket.is_open())
+        return false;
+
+    //A duplicate stays open when the socket is closed below
+    iFD = dup(m_oSocket.native_handle());
+
+    if(iFD < 0)
+    {
+        cout << "cInterruptibleBlockingTCPSocket::detachDescriptor(): Unable to duplicate descriptor: " << strerror(errno) << endl;
+        return false;
+    }
+
+    if(m_u32ReadBufferEnd > m_u32ReadBufferStart)
+        strUnreadData.assign(&m_vcReadBuffer[m_u32ReadBufferStart], m_u32ReadBufferEnd - m_u32ReadBufferStart);
+
+    closeSocket();
+
+    return true;
+}
+
+bool cInterruptibleBlockingTCPSocket::attachDescriptor(int iFD, const string &strUnreadData)
+{
+    boost::unique_lock<cAwaitableMutex> oReadLock(m_oReadMutex);
+    boost::unique_lock<cAwaitableMutex> oWriteLock(m_oWriteMutex);
+
+    closeSocket();
+
+    boost::system::error_code oError;
+    m_oSocket.assign(boost::asio::ip::tcp::v4(), iFD, oError);
+
+    if(oError)
+    {
+        cout << "cInterruptibleBlockingTCPSocket::attachDescriptor(): Unable to assign descriptor: " << oError.message() << endl;
+        return false;
+    }
+
+    m_u32ReadBufferStart = 0;
+    m_u32ReadBufferEnd = strUnreadData.length();
+
+    if(m_u32ReadBufferEnd)
+    {
+        if(m_vcReadBuffer.size() < m_u32ReadBufferEnd)
+            m_vcReadBuffer.resize(max(m_u32ReadBufferEnd, m_u32ReadBufferCapacity_B));
+
+        memcpy(&m_vcReadBuffer[0], strUnreadData.data(), m_u32ReadBufferEnd);
+    }
+
+    return true;
+}
+#endif
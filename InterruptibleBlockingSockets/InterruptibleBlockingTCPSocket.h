@@ -18,22 +18,41 @@ typedef unsigned __int64 uint64_t;
 #endif
 
 #include <vector>
+#include <utility> //Needed before asio's coroutine support (std::exchange)
+
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
 
 //Library includes:
 #ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/awaitable.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/scoped_ptr.hpp>
 #endif
 
 //Local includes
+#include "SocketReadinessWaiter.h"
+#include "BlockingOperationWaiter.h"
+#include "ZeroCopySendTracker.h"
+#include "IOUring.h"
+#include "InterruptibleBlockingResolver.h"
+#include "CancellationToken.h"
+#include "AsyncReadinessWaiter.h"
+#include "AwaitableMutex.h"
 
 class cInterruptibleBlockingTCPSocket
 {
 
 public:
     cInterruptibleBlockingTCPSocket(const std::string &strName = "");
+    //Uses an externally owned io_service instead of private ones. The owner must keep it running (e.g. a thread pool
+    //calling run() with a work object) for as long as the socket exists. Calls still block and remain interruptible,
+    //but a cancel aborts only this socket's operations rather than stopping the io_service.
+    cInterruptibleBlockingTCPSocket(boost::asio::io_service &oIOService, const std::string &strName = "");
     cInterruptibleBlockingTCPSocket(const std::string &strPeerAddress, uint16_t u16PeerPort, const std::string &strName = "");
 
     ~cInterruptibleBlockingTCPSocket();
@@ -45,16 +64,112 @@ public:
     bool                            send(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
     bool                            receive(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
 
+    //As receive() but also returns the kernel software receive timestamp (SO_TIMESTAMPNS) in ns since the epoch.
+    //For TCP this is the arrival time of the most recent segment contributing to the data read.
+    bool                            setKernelTimestampsEnabled(bool bEnabled = true);
+    bool                            receiveTimestamped(char *cpBuffer, uint32_t u32NBytes, int64_t &i64Timestamp_ns, uint32_t u32Timeout_ms = 0);
+
     //Guarantee all bytes sent
     bool                            write(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
     bool                            write(const std::string &strData, uint32_t u32Timeout_ms = 0); //Convenience function for sending of text
     bool                            read(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
-    bool                            readUntil(std::string &strBuffer, const std::string &strDelimiter, uint32_t u32Timeout_ms = 0); //Convenience function, read until a delimeter is found.
+    //Send u64NBytes of an open file starting at u64Offset without copying through user space (sendfile, Linux only).
+    //The file position is not changed. getNBytesLastWrittenFromFile() gives the progress, also beyond 4 GB.
+    bool                            writeFile(int iFileDescriptor, uint64_t u64Offset, uint64_t u64NBytes, uint32_t u32Timeout_ms = 0);
+    //Scatter / gather versions: all buffers are written (filled) in order, as if they were one contiguous buffer, without
+    //copying them together first. getNBytesLastWritten() / getNBytesLastRead() give the total over all buffers.
+    bool                            write(const std::vector<boost::asio::const_buffer> &voBuffers, uint32_t u32Timeout_ms = 0);
+    bool                            read(const std::vector<boost::asio::mutable_buffer> &voBuffers, uint32_t u32Timeout_ms = 0);
+    //Read until the full delimiter string is found. The data up to and including the delimiter is appended to strBuffer.
+    //Anything read beyond the delimiter is kept for the next call.
+    bool                            readUntil(std::string &strBuffer, const std::string &strDelimiter, uint32_t u32Timeout_ms = 0);
+    //As readUntil() but without copying: cpLine points into the socket's read buffer and stays valid until the next read call
+    bool                            readUntilView(const char *&cpLine, uint32_t &u32NBytes, const std::string &strDelimiter, uint32_t u32Timeout_ms = 0);
+    //Longest line readUntil() / readUntilView() will buffer (and longest peek()). A longer one fails with message_size and
+    //stays in the buffer, where read() or skip() can still consume it. The buffer never grows beyond this.
+    void                            setMaxLineLength(uint32_t u32MaxLineLength_B = 1024 * 1024);
+
+    //Zero copy sends (Linux only, SO_ZEROCOPY): write() payloads of at least u32Threshold_B are sent from the caller's
+    //buffer without copying it into the kernel. write() still returns once the data is queued, but the buffer must not
+    //be modified or freed until getNZeroCopySendsPending() is 0 or waitForZeroCopyCompletions() has returned true.
+    //Coalesced writes (see below) are always copied. Can't be disabled while sends are pending.
+    bool                            setZeroCopyEnabled(bool bEnabled, uint32_t u32Threshold_B = 128 * 1024);
+    bool                            isZeroCopyEnabled() const;
+    bool                            waitForZeroCopyCompletions(uint32_t u32Timeout_ms = 0);
+    uint32_t                        getNZeroCopySendsPending();
+    //Sends for which the kernel copied after all (e.g. over loopback or to a device without scatter gather)
+    uint64_t                        getNZeroCopySendsCopied() const;
+
+    //Write coalescing: write() calls are collected in memory and sent with a single system call once u32Threshold_B
+    //bytes are pending, or on the first write after data has been pending for u32MaxDelay_ms (0 to disable the delay).
+    //Pending data is also sent by flush(), send(), the scatter write and before any read, so a request always goes out
+    //before its response is waited for. There's no background timer: idle data waits for one of those calls.
+    //While data is pending write() reports success; send errors are reported by the call that flushes the buffer.
+    bool                            setWriteCoalescingEnabled(bool bEnabled, uint32_t u32Threshold_B = 16 * 1024, uint32_t u32MaxDelay_ms = 0);
+    bool                            isWriteCoalescingEnabled() const;
+    bool                            flush(uint32_t u32Timeout_ms = 0);
+    uint32_t                        getNBytesPendingWrite() const;
 
+    //Look at / discard the next u32NBytes of the stream. Peeked data stays in the read buffer for the next read.
+    bool                            peek(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
+    bool                            skip(uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
+
+    //Read buffering: receive / read pull in as much as the kernel has (up to u32Capacity_B, or up to the size a long line
+    //grew the buffer to, see setMaxLineLength()) with one system call and serve following small reads from memory. Reads
+    //of at least half the capacity bypass the buffer. Data left in the buffer (also by readUntil() and peek()) is always
+    //returned first, whether buffering is enabled or not.
+    bool                            setReadBufferingEnabled(bool bEnabled, uint32_t u32Capacity_B = 64 * 1024);
+    bool                            isReadBufferingEnabled() const;
+    //Reads / peeks / skips served entirely from the buffer (hits) vs those that needed the socket (misses)
+    uint64_t                        getNReadBufferHits() const;
+    uint64_t                        getNReadBufferMisses() const;
+    void                            resetReadBufferStatistics();
+
+    //Reads and writes are full duplex: each direction has its own lock, io_service, timer and fast path waiter, so one
+    //thread can block in a read while another writes. Writes go through a duplicate of the connected descriptor.
+    //Buffering, coalescing and zero copy settings take their direction's lock, as does setKernelTimestampsEnabled() (read).
+    //openAndConnect(), close() and detachDescriptor() / attachDescriptor() take both, so they wait for any blocking
+    //read or write in progress: cancel it first to close a socket another thread is blocked on. With write coalescing
+    //enabled, reads wait for any write in progress so that pending data goes out first.
+    //cancelReadOperations() also interrupts openAndConnect(). cancelCurrrentOperations() cancels both directions.
     void                            cancelCurrrentOperations();
+    void                            cancelReadOperations();
+    void                            cancelWriteOperations();
+
+    //Fast path (Linux only): send / receive / write / read go straight to non-blocking system calls and only wait, with
+    //ppoll() plus an eventfd for cancelCurrrentOperations(), when the socket isn't ready. Avoids the io_service reset / run
+    //and timer setup per call. Timeouts report timed_out rather than operation_aborted.
+    //Only change while no other operation is in progress. Returns false if not supported.
+    bool                            setFastPathEnabled(bool bEnabled);
+    bool                            isFastPathEnabled() const;
+
+    //io_uring backend (Linux only, see cIOUring): each transfer or wait is one submission, linked to a timeout, to a ring
+    //per direction, so a call on a ready socket costs a single system call. The readUntil() buffer is registered with the
+    //read ring. Takes precedence over the fast path and reports errors the same way. Only change while no other
+    //operation is in progress. Returns false, leaving the current path in use, if the kernel doesn't support it.
+    bool                            setIOUringEnabled(bool bEnabled);
+    bool                            isIOUringEnabled() const;
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    //Coroutine versions (C++20) for sockets on a shared io_service, awaited by coroutines spawned on it, so that many
+    //connections can be served by a few threads instead of a thread each. They run the same operations as the blocking
+    //calls (see cTransferOperation) and report results, errors and byte counts the same way, including coalescing,
+    //zero copy and the read buffer, but timeouts report timed_out. The timeout covers the whole call and pToken (if
+    //given) cancels it from any thread, ending only this call. Waits go to the io_service rather than the fast path
+    //waiter or io_uring, which would block the thread. They take their direction's lock like the blocking calls and
+    //hold it until done, so calls in the same direction, awaited or blocking, run one at a time (the timeout covers
+    //the wait for the lock). Don't make blocking calls from the io_service's threads meanwhile (see cAwaitableMutex).
+    //Fail with operation_not_supported on a private io_service.
+    boost::asio::awaitable<bool>    asyncOpenAndConnect(std::string strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+    boost::asio::awaitable<bool>    asyncWrite(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+    boost::asio::awaitable<bool>    asyncRead(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+    boost::asio::awaitable<bool>    asyncReadUntil(std::string &strBuffer, const std::string &strDelimiter, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+#endif
 
     //Some utility functions
-    boost::asio::ip::tcp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port);
+    //Throws boost::system::system_error if the host can't be resolved. Dotted addresses and previously resolved names
+    //(see cEndpointResolverCache) return without a lookup. Lookups honour the timeout and cancelCurrrentOperations().
+    boost::asio::ip::tcp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms = 0);
     std::string                     getEndpointHostAddress(boost::asio::ip::tcp::endpoint oEndPoint) const;
     uint16_t                        getEndpointPort(boost::asio::ip::tcp::endpoint oEndPoint) const;
 
@@ -71,6 +186,7 @@ public:
 
     uint32_t                        getNBytesLastRead() const;
     uint32_t                        getNBytesLastWritten() const;
+    uint64_t                        getNBytesLastWrittenFromFile() const;
     boost::system::error_code       getLastReadError() const;
     boost::system::error_code       getLastWriteError() const;
     boost::system::error_code       getLastOpenAndConnectError() const;
@@ -79,19 +195,45 @@ public:
     uint32_t                        getBytesAvailable() const;
     boost::asio::ip::tcp::socket*   getBoostSocketPointer();
 
+#ifdef __linux__
+    //Hand the connection over to other code (e.g. cTCPEventEngine) and take it back. detachDescriptor() returns a
+    //descriptor for the connection, which the caller then owns, and any data already read into the socket's buffer but
+    //not consumed yet. The socket is left closed and coalesced writes are discarded as by close().
+    //attachDescriptor() takes over a connected descriptor. strUnreadData is returned by the next reads before anything new.
+    bool                            detachDescriptor(int &iFD, std::string &strUnreadData);
+    bool                            attachDescriptor(int iFD, const std::string &strUnreadData = "");
+#endif
+
+    //Find the first occurrence of the delimiter in [cpBegin, cpEnd) the way readUntil() does. NULL if not found.
+    static const char*              findDelimiter(const char *cpBegin, const char *cpEnd, const std::string &strDelimiter);
+
 private:
+    //Private io_services. Not created when the socket uses a shared one.
+    boost::scoped_ptr<boost::asio::io_service> m_pOwnedIOService;
+    boost::scoped_ptr<boost::asio::io_service> m_pOwnedWriteIOService;
+
     //The serial port and io service for the port
-    boost::asio::io_service         m_oIOService;
+    boost::asio::io_service         &m_oIOService;
     boost::asio::ip::tcp::socket    m_oSocket;
 
+    //Writes run on their own io_service (unless shared) and duplicate descriptor (see prepareWriteSocket())
+    boost::asio::io_service         &m_oWriteIOService;
+    boost::asio::ip::tcp::socket    m_oWriteSocket;
+
     //Timer for determining timeouts
     boost::asio::deadline_timer     m_oOpenAndConnectTimer;
     boost::asio::deadline_timer     m_oReadTimer;
     boost::asio::deadline_timer     m_oWriteTimer;
 
-    boost::asio::ip::tcp::resolver  m_oResolver;
+    //Run (or wait for) the asynchronous operations behind each blocking call. Connects use the read side.
+    cBlockingOperationWaiter        m_oReadWaiter;
+    cBlockingOperationWaiter        m_oWriteWaiter;
+
+    //Cached, interruptible host name resolution for createEndpoint()
+    cInterruptibleBlockingResolver  m_oResolver;
 
-    //Flag for determining read errors
+    //Flag for determining read errors. Set to operation_aborted before each asynchronous operation so that a cancel that
+    //stops the io_service before the completion handler runs is reported as a failure.
     bool                            m_bOpenAndConnectError;
     bool                            m_bReadError;
     bool                            m_bWriteError;
@@ -99,28 +241,160 @@ private:
     //Info about about last transaction
     uint32_t                        m_u32NBytesLastRead;
     uint32_t                        m_u32NBytesLastWritten;
+    uint64_t                        m_u64NBytesLastWrittenFromFile;
     boost::system::error_code       m_oLastReadError;
     boost::system::error_code       m_oLastReadTimeoutError;
     boost::system::error_code       m_oLastWriteError;
     boost::system::error_code       m_oLastopenAndConnectError;
 
-    //Receive string used by readUntil function
-    //(Require persistence across calls)
-    std::string                      m_strReadUntilBuff;
+    bool                            m_bKernelTimestamps;
+
+#ifdef __linux__
+    //Only exist while the fast path is enabled. Separate for each direction so that cancelling one wait can't be consumed by the other
+    boost::scoped_ptr<cSocketReadinessWaiter> m_pFastPathReadWaiter;
+    boost::scoped_ptr<cSocketReadinessWaiter> m_pFastPathWriteWaiter;
+
+    //Only exist while the io_uring backend is enabled. One per direction, like the fast path waiters.
+    boost::scoped_ptr<cIOUring>     m_pReadIOUring;
+    boost::scoped_ptr<cIOUring>     m_pWriteIOUring;
+
+    //Scatter / gather lists for the system calls of cTransferOperation, kept to avoid allocating per call
+    std::vector<iovec>              m_voReadIOVecs;
+    std::vector<iovec>              m_voWriteIOVecs;
+
+    //Only exists while zero copy sends are enabled
+    boost::scoped_ptr<cZeroCopySendTracker> m_pZeroCopyTracker;
+#endif
+
+    //Receive buffer used by readUntil functions, peek() / skip() and read buffering (requires persistence across calls).
+    //Unread data is [m_u32ReadBufferStart, m_u32ReadBufferEnd). It is only moved to the front when space runs out.
+    std::vector<char>               m_vcReadBuffer;
+    uint32_t                        m_u32ReadBufferStart;
+    uint32_t                        m_u32ReadBufferEnd;
+    uint32_t                        m_u32ReadBufferCapacity_B;
+    uint32_t                        m_u32MaxLineLength_B;
+    bool                            m_bReadBuffering;
+    uint64_t                        m_u64NReadBufferHits;
+    uint64_t                        m_u64NReadBufferMisses;
+
+    //What each direction's cTransferOperation transfers for the blocking calls, set up by the caller under the lock.
+    //Kept to avoid allocating per call. The write side buffers are only ever read from. The coroutine calls keep their
+    //own in the coroutine frame.
+    std::vector<boost::asio::mutable_buffer> m_voReadTransferBuffers;
+    std::vector<boost::asio::mutable_buffer> m_voWriteTransferBuffers;
+
+    //Readiness waits of the coroutine calls, per direction
+    cAsyncReadinessWaiter           m_oAsyncReadReadiness;
+    cAsyncReadinessWaiter           m_oAsyncWriteReadiness;
+
+    //Write coalescing buffer and settings (see setWriteCoalescingEnabled())
+    std::vector<char>               m_vcWriteBuffer;
+    bool                            m_bWriteCoalescing;
+    uint32_t                        m_u32WriteCoalescingThreshold_B;
+    uint32_t                        m_u32WriteCoalescingMaxDelay_ms;
+    boost::posix_time::ptime        m_oWriteBufferStartTime;
 
     //Optional label for this socket. May be useful for debugging.
     std::string                     m_strName;
 
-    //Boost sockets are not thread safe so lock access during reading/writing
-    boost::mutex                    m_oMutex;
+    //Boost sockets are not thread safe so lock access during reading/writing. One lock per direction for full duplex.
+    //The coroutine calls hold them across their awaits (see cAwaitableMutex).
+    cAwaitableMutex                 m_oReadMutex;
+    cAwaitableMutex                 m_oWriteMutex;
 
     //Internal callback functions for TCP socket port called by boost asynchronous socket API
     void                            callback_connectComplete(const boost::system::error_code& oError);
     void                            callback_connectTimeOut(const boost::system::error_code& oError);
-    void                            callback_readComplete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred);
     void                            callback_readTimeOut(const boost::system::error_code& oError);
-    void                            callback_writeComplete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred);
+    void                            callback_readReady(const boost::system::error_code& oError);
     void                            callback_writeTimeOut(const boost::system::error_code& oError);
+    void                            callback_writeReady(const boost::system::error_code& oError);
+
+    //Wait (interruptibly) until data can be read / sent without transferring any. The timeout is counted from oStartTime.
+    bool                            waitUntilReadable(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime);
+    bool                            waitUntilWritable(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime);
+
+    //close() without taking the locks, for callers that already hold both
+    void                            closeSocket();
+
+    //Abort the asynchronous operations of each side (see cBlockingOperationWaiter)
+    void                            cancelReadIO();
+    void                            cancelWriteIO();
+    //Stops the connect of asyncOpenAndConnect(), the only operation on the socket while it connects
+    void                            cancelConnect();
+
+    //The I/O of the blocking calls and the coroutine calls, written once as asio composed operations (defined in the
+    //.cpp). The blocking calls pass a NULL deadline and a handler, and the operation has completed by the time the
+    //call returns (see transfer()), or for the connect once m_oReadWaiter is done. The coroutine calls pass their
+    //deadline and use_awaitable. u32Timeout_ms and oStartTime only apply to the blocking calls.
+    class cTransferOperation;
+    class cConnectOperation;
+
+    //Transfers voBuffers, which must outlive the operation: all of them with bAll, otherwise whatever the first
+    //successful system call transfers. Completes with the error and the number of bytes transferred. Called with the
+    //direction's lock held until it completes.
+    template<typename tCompletionToken>
+    BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code, uint32_t))
+                                    asyncTransfer(bool bWriting, std::vector<boost::asio::mutable_buffer> &voBuffers, bool bAll, bool bZeroCopy,
+                                                  uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime, cAwaitableDeadline *pDeadline, BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken);
+    //Looks the peer up if needed and connects the open socket to it
+    template<typename tCompletionToken>
+    BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(tCompletionToken, void(boost::system::error_code))
+                                    asyncConnect(const std::string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms,
+                                                 cAwaitableDeadline *pDeadline, BOOST_ASIO_MOVE_ARG(tCompletionToken) oToken);
+
+    //Runs asyncTransfer() of m_voReadTransferBuffers / m_voWriteTransferBuffers for a blocking call. The timeout is
+    //counted from oStartTime, or from the first wait if not set.
+    boost::system::error_code       transfer(bool bWriting, bool bAll, bool bZeroCopy, uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime,
+                                             uint32_t &u32NBytesTransferred);
+    static void                     storeTransferResult(boost::system::error_code *pError, uint32_t *pNBytesTransferred,
+                                                        const boost::system::error_code &oError, uint32_t u32NBytesTransferred);
+
+    //Open the write side descriptor for the current connection if not done yet. Called with the write lock held.
+    void                            prepareWriteSocket();
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    //Nothing runs a private io_service for the coroutine calls. Reports operation_not_supported in oError.
+    bool                            checkSharedIOService(const char *cpFunction, boost::system::error_code &oError) const;
+    //flushBeforeRead() for the coroutine reads
+    boost::asio::awaitable<boost::system::error_code> asyncFlushBeforeRead(cAwaitableDeadline &oDeadline);
+#endif
+
+    //Read buffer management for readUntil(). bufferUntil() makes sure the buffer holds a complete line starting at
+    //m_u32ReadBufferStart and returns its length including the delimiter. fillReadBuffer() appends at least 1 byte.
+    bool                            bufferUntil(const std::string &strDelimiter, uint32_t &u32LineLength_B, uint32_t u32Timeout_ms);
+    bool                            fillReadBuffer(uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime);
+    //The steps shared with asyncReadUntil(). findBufferedLine() searches the buffered data from u32SearchOffset, which it
+    //advances past what has been searched. prepareReadBufferFill() sets the free space at the end of the buffer (made if
+    //needed) up as the read transfer in voBuffers.
+    bool                            findBufferedLine(const std::string &strDelimiter, uint32_t &u32SearchOffset, uint32_t &u32LineLength_B);
+    bool                            prepareReadBufferFill(std::vector<boost::asio::mutable_buffer> &voBuffers);
+    bool                            makeReadBufferSpace(char *&cpFree, uint32_t &u32NBytesFree);
+    //Copies up to u32NBytes of buffered data out and consumes it. Returns the number of bytes copied.
+    uint32_t                        takeFromReadBuffer(char *cpBuffer, uint32_t u32NBytes);
+
+    //Read paths behind receive / read. directRead() bypasses the read buffer, bufferedRead() drains it first.
+    //readTransferBuffers() transfers what has been set up in m_voReadTransferBuffers and records the result.
+    bool                            directRead(char *cpBuffer, uint32_t u32NBytes, bool bAll, uint32_t u32Timeout_ms);
+    bool                            bufferedRead(char *cpBuffer, uint32_t u32NBytes, bool bAll, uint32_t u32Timeout_ms);
+    bool                            readTransferBuffers(bool bAll, uint32_t u32Timeout_ms);
+
+    //Write paths behind send / write. prepareWrite() sets voBuffers up for write(), with any coalesced data first, and
+    //returns false if the data was only coalesced (write() has succeeded then). writeTransferBuffers()
+    //transfers them and records the result.
+    bool                            prepareWrite(const char *cpBuffer, uint32_t u32NBytes, std::vector<boost::asio::mutable_buffer> &voBuffers, bool &bZeroCopy);
+    bool                            writeTransferBuffers(bool bAll, bool bZeroCopy, uint32_t u32Timeout_ms);
+    bool                            flushWriteBuffer(uint32_t u32Timeout_ms);
+    void                            takeFlushedBytes(bool bWritten);
+    boost::system::error_code       flushBeforeRead(uint32_t u32Timeout_ms);
+    //Sets the read error and returns false
+    bool                            failRead(const boost::system::error_code &oError);
+
+#ifdef __linux__
+    //Called after each readiness wait. Completions left on the error queue would keep POLLERR set, so that the wait
+    //returned at once and the read / write loops spun on EAGAIN.
+    void                            reapZeroCopyCompletions(int iFD);
+#endif
 };
 
 #endif // INTERRUPTIBLE_BLOCKING_TCP_SOCKET_H
@@ -0,0 +1,473 @@
+
+#ifdef __linux__
+
+//System includes
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <unistd.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/placeholders.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPPacketRing.h"
+
+#ifndef PACKET_IGNORE_OUTGOING
+#define PACKET_IGNORE_OUTGOING 23
+#endif
+
+using namespace std;
+
+cInterruptibleBlockingUDPPacketRing::cPacketView::cPacketView() :
+    m_cpPayload(NULL),
+    m_u32NBytes(0),
+    m_u32NBytesOnWire(0),
+    m_i64Timestamp_ns(0)
+{
+}
+
+cInterruptibleBlockingUDPPacketRing::cBlock::cBlock() :
+    m_u8pBlock(NULL),
+    m_u8pNextPacket(NULL),
+    m_u32NPackets(0),
+    m_u32NPacketsVisited(0)
+{
+}
+
+uint32_t cInterruptibleBlockingUDPPacketRing::cBlock::getNPackets() const
+{
+    return m_u32NPackets;
+}
+
+bool cInterruptibleBlockingUDPPacketRing::cBlock::getNextPacket(cPacketView &oPacket)
+{
+    while(m_u32NPacketsVisited < m_u32NPackets)
+    {
+        const tpacket3_hdr *pHeader = reinterpret_cast<const tpacket3_hdr*>(m_u8pNextPacket);
+
+        m_u8pNextPacket += pHeader->tp_next_offset;
+        m_u32NPacketsVisited++;
+
+        //SOCK_DGRAM capture so the frame starts at the IP header. The BPF filter has already checked for unfragmented UDP.
+        const uint8_t *u8pIPHeader = reinterpret_cast<const uint8_t*>(pHeader) + pHeader->tp_net;
+        uint32_t u32NBytesCaptured = pHeader->tp_snaplen - (pHeader->tp_net - pHeader->tp_mac);
+        uint32_t u32IPHeaderLength = (u8pIPHeader[0] & 0x0f) * 4;
+
+        if(u32NBytesCaptured < u32IPHeaderLength + 8)
+            continue; //Truncated
+
+        const uint8_t *u8pUDPHeader = u8pIPHeader + u32IPHeaderLength;
+
+        uint32_t u32SourceAddress;
+        uint16_t u16SourcePort;
+        uint16_t u16UDPLength;
+        memcpy(&u32SourceAddress, u8pIPHeader + 12, sizeof(u32SourceAddress));
+        memcpy(&u16SourcePort, u8pUDPHeader, sizeof(u16SourcePort));
+        memcpy(&u16UDPLength, u8pUDPHeader + 4, sizeof(u16UDPLength));
+
+        u16UDPLength = ntohs(u16UDPLength);
+        if(u16UDPLength < 8)
+            continue; //Malformed
+
+        oPacket.m_cpPayload = reinterpret_cast<const char*>(u8pUDPHeader + 8);
+        oPacket.m_u32NBytesOnWire = u16UDPLength - 8;
+        oPacket.m_u32NBytes = min(oPacket.m_u32NBytesOnWire, u32NBytesCaptured - u32IPHeaderLength - 8);
+        oPacket.m_oPeerEndpoint = boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4(ntohl(u32SourceAddress)), ntohs(u16SourcePort));
+        oPacket.m_i64Timestamp_ns = (int64_t)pHeader->tp_sec * 1000000000LL + pHeader->tp_nsec;
+
+        return true;
+    }
+
+    return false;
+}
+
+cInterruptibleBlockingUDPPacketRing::cInterruptibleBlockingUDPPacketRing(const string &strName) :
+    m_oDescriptor(m_oIOService),
+    m_oTimer(m_oIOService),
+    m_oWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingUDPPacketRing::cancelIO, this)),
+    m_u8pRing(NULL),
+    m_u32BlockSize_B(0),
+    m_u32NBlocks(0),
+    m_u32CurrentBlock(0),
+    m_u16UDPPort(0),
+    m_bError(true),
+    m_bTimedOut(false),
+    m_u64NPacketsReceived(0),
+    m_u64NPacketsDropped(0),
+    m_u64NRingFreezes(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingUDPPacketRing::~cInterruptibleBlockingUDPPacketRing()
+{
+    close();
+}
+
+bool cInterruptibleBlockingUDPPacketRing::open(const string &strInterfaceName, uint16_t u16UDPPort, uint32_t u32BlockSize_B, uint32_t u32NBlocks, uint32_t u32BlockTimeout_ms)
+{
+    //If the ring is already open close it
+    close();
+
+    //Datagram mode packet socket: link layer headers are stripped so the same filter works on any interface type
+    int iFD = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IP));
+    if(iFD < 0)
+    {
+        m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::open(): Error opening packet socket (requires CAP_NET_RAW): " << m_oLastError.message() << endl;
+        return false;
+    }
+
+    int iVersion = TPACKET_V3;
+    if(setsockopt(iFD, SOL_PACKET, PACKET_VERSION, &iVersion, sizeof(iVersion)))
+    {
+        m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::open(): TPACKET_V3 not supported: " << m_oLastError.message() << endl;
+        ::close(iFD);
+        return false;
+    }
+
+    //On loopback each datagram would otherwise be seen twice (once outgoing and once incoming). Not available before Linux 4.20.
+    int iIgnoreOutgoing = 1;
+    setsockopt(iFD, SOL_PACKET, PACKET_IGNORE_OUTGOING, &iIgnoreOutgoing, sizeof(iIgnoreOutgoing));
+
+    //Filter before setting up the ring and binding so that the ring only ever sees our datagrams
+    if(!attachPortFilter(iFD, u16UDPPort))
+    {
+        ::close(iFD);
+        return false;
+    }
+
+    tpacket_req3 oRequest;
+    memset(&oRequest, 0, sizeof(oRequest));
+    oRequest.tp_block_size = u32BlockSize_B;
+    oRequest.tp_block_nr = u32NBlocks;
+    oRequest.tp_frame_size = TPACKET_ALIGNMENT << 7; //Nominal only. V3 packs variable length frames into blocks.
+    oRequest.tp_frame_nr = ((uint64_t)u32BlockSize_B * u32NBlocks) / oRequest.tp_frame_size;
+    oRequest.tp_retire_blk_tov = u32BlockTimeout_ms;
+
+    if(setsockopt(iFD, SOL_PACKET, PACKET_RX_RING, &oRequest, sizeof(oRequest)))
+    {
+        m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::open(): Error creating RX ring (block size must be a multiple of the page size): " << m_oLastError.message() << endl;
+        ::close(iFD);
+        return false;
+    }
+
+    void *vpRing = mmap(NULL, (size_t)u32BlockSize_B * u32NBlocks, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, iFD, 0);
+    if(vpRing == MAP_FAILED)
+    {
+        m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::open(): Error mapping RX ring: " << m_oLastError.message() << endl;
+        ::close(iFD);
+        return false;
+    }
+
+    sockaddr_ll oAddress;
+    memset(&oAddress, 0, sizeof(oAddress));
+    oAddress.sll_family = AF_PACKET;
+    oAddress.sll_protocol = htons(ETH_P_IP);
+    oAddress.sll_ifindex = if_nametoindex(strInterfaceName.c_str());
+
+    if(!oAddress.sll_ifindex || bind(iFD, reinterpret_cast<sockaddr*>(&oAddress), sizeof(oAddress)))
+    {
+        m_oLastError = boost::system::error_code(oAddress.sll_ifindex ? errno : ENODEV, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::open(): Error binding to interface \"" << strInterfaceName << "\": " << m_oLastError.message() << endl;
+        munmap(vpRing, (size_t)u32BlockSize_B * u32NBlocks);
+        ::close(iFD);
+        return false;
+    }
+
+    //Hand the descriptor to asio so that waits are interruptible in the same way as the socket classes
+    m_oDescriptor.assign(iFD, m_oLastError);
+    if(m_oLastError)
+    {
+        munmap(vpRing, (size_t)u32BlockSize_B * u32NBlocks);
+        ::close(iFD);
+        return false;
+    }
+
+    m_u8pRing = static_cast<uint8_t*>(vpRing);
+    m_u32BlockSize_B = u32BlockSize_B;
+    m_u32NBlocks = u32NBlocks;
+    m_u32CurrentBlock = 0;
+    m_u16UDPPort = u16UDPPort;
+
+    m_u64NPacketsReceived = 0;
+    m_u64NPacketsDropped = 0;
+    m_u64NRingFreezes = 0;
+
+    cout << "cInterruptibleBlockingUDPPacketRing::open(): Capturing UDP port " << u16UDPPort << " on " << strInterfaceName
+         << " into " << u32NBlocks << " x " << u32BlockSize_B << " B ring." << endl;
+
+    return true;
+}
+
+bool cInterruptibleBlockingUDPPacketRing::openForSocket(const cInterruptibleBlockingUDPSocket &oSocket, const string &strInterfaceName,
+                                                        uint32_t u32BlockSize_B, uint32_t u32NBlocks, uint32_t u32BlockTimeout_ms)
+{
+    return open(strInterfaceName, oSocket.getLocalPort(), u32BlockSize_B, u32NBlocks, u32BlockTimeout_ms);
+}
+
+bool cInterruptibleBlockingUDPPacketRing::attachPortFilter(int iFD, uint16_t u16UDPPort)
+{
+    //Classic BPF run from the start of the IPv4 header: accept unfragmented (or first fragment free) UDP to u16UDPPort.
+    sock_filter aoFilterCode[] =
+    {
+        BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 9),                   //A = IP protocol
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   IPPROTO_UDP, 0, 6),
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 6),                   //A = flags / fragment offset
+        BPF_JUMP(BPF_JMP | BPF_JSET| BPF_K,   0x1fff, 4, 0),        //Non-first fragments carry no UDP header
+        BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, 0),                   //X = IP header length
+        BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 2),                   //A = UDP destination port
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   u16UDPPort, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K,             0xffffffff),          //Accept whole packet
+        BPF_STMT(BPF_RET | BPF_K,             0)                    //Reject
+    };
+
+    sock_fprog oFilter;
+    oFilter.len = sizeof(aoFilterCode) / sizeof(aoFilterCode[0]);
+    oFilter.filter = aoFilterCode;
+
+    if(setsockopt(iFD, SOL_SOCKET, SO_ATTACH_FILTER, &oFilter, sizeof(oFilter)))
+    {
+        m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+        cout << "cInterruptibleBlockingUDPPacketRing::attachPortFilter(): Error attaching port filter: " << m_oLastError.message() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+void cInterruptibleBlockingUDPPacketRing::close()
+{
+    cancelCurrrentOperations();
+
+    if(m_oDescriptor.is_open())
+    {
+        boost::system::error_code oEC;
+        m_oDescriptor.close(oEC);
+    }
+
+    if(m_u8pRing)
+    {
+        munmap(m_u8pRing, (size_t)m_u32BlockSize_B * m_u32NBlocks);
+        m_u8pRing = NULL;
+    }
+}
+
+bool cInterruptibleBlockingUDPPacketRing::isOpen() const
+{
+    return m_u8pRing != NULL;
+}
+
+bool cInterruptibleBlockingUDPPacketRing::getNextBlock(cBlock &oBlock, uint32_t u32Timeout_ms)
+{
+    if(!isOpen())
+    {
+        m_bError = true;
+        m_oLastError = boost::asio::error::bad_descriptor;
+        return false;
+    }
+
+    tpacket_block_desc *pDescriptor = getBlockDescriptor(m_u32CurrentBlock);
+
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    //Only wait if the kernel hasn't already handed over the next block
+    while(!(pDescriptor->hdr.bh1.block_status & TP_STATUS_USER))
+    {
+        uint32_t u32RemainingTimeout_ms = 0;
+
+        if(u32Timeout_ms)
+        {
+            boost::posix_time::time_duration oRemaining = oStartTime + boost::posix_time::milliseconds(u32Timeout_ms)
+                    - boost::posix_time::microsec_clock::universal_time();
+
+            if(oRemaining.total_milliseconds() <= 0)
+            {
+                m_bError = true;
+                m_oLastError = boost::asio::error::timed_out;
+                return false;
+            }
+
+            u32RemainingTimeout_ms = oRemaining.total_milliseconds();
+        }
+
+        //Necessary after a timeout. Also runs the aborted handlers a cancel leaves queued, which would otherwise cancel
+        //this wait's timer.
+        m_oWaiter.begin();
+
+        //Assume the wait was interrupted unless the completion handler reports otherwise
+        m_bError = true;
+        m_bTimedOut = false;
+        m_oLastError = boost::asio::error::operation_aborted;
+
+        //The packet socket polls readable once the current block is retired to user space
+        m_oDescriptor.async_read_some( boost::asio::null_buffers(),
+                                       m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPPacketRing::callback_ready,
+                                                                  this,
+                                                                  boost::asio::placeholders::error)) );
+
+        // Setup a deadline time to implement our timeout.
+        if(u32RemainingTimeout_ms)
+        {
+            m_oTimer.expires_from_now(boost::posix_time::milliseconds(u32RemainingTimeout_ms));
+            m_oTimer.async_wait(m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPPacketRing::callback_timeOut,
+                                                           this, boost::asio::placeholders::error)));
+        }
+
+        // This will block until a block is ready
+        // or until the it is cancelled.
+        m_oWaiter.wait();
+
+        if(m_bError)
+        {
+            //The wait itself only sees the cancel from callback_timeOut()
+            if(m_bTimedOut)
+                m_oLastError = boost::asio::error::timed_out;
+
+            return false;
+        }
+    }
+
+    //Make sure packet contents are read only after the status word
+    __sync_synchronize();
+
+    oBlock.m_u8pBlock = reinterpret_cast<const uint8_t*>(pDescriptor);
+    oBlock.m_u8pNextPacket = oBlock.m_u8pBlock + pDescriptor->hdr.bh1.offset_to_first_pkt;
+    oBlock.m_u32NPackets = pDescriptor->hdr.bh1.num_pkts;
+    oBlock.m_u32NPacketsVisited = 0;
+
+    m_bError = false;
+    m_oLastError = boost::system::error_code();
+
+    return true;
+}
+
+void cInterruptibleBlockingUDPPacketRing::releaseBlock()
+{
+    if(!isOpen())
+        return;
+
+    tpacket_block_desc *pDescriptor = getBlockDescriptor(m_u32CurrentBlock);
+
+    if(!(pDescriptor->hdr.bh1.block_status & TP_STATUS_USER))
+        return;
+
+    //All reads of the block must complete before it is returned to the kernel
+    __sync_synchronize();
+    pDescriptor->hdr.bh1.block_status = TP_STATUS_KERNEL;
+
+    m_u32CurrentBlock = (m_u32CurrentBlock + 1) % m_u32NBlocks;
+}
+
+tpacket_block_desc* cInterruptibleBlockingUDPPacketRing::getBlockDescriptor(uint32_t u32BlockNo) const
+{
+    return reinterpret_cast<tpacket_block_desc*>(m_u8pRing + (size_t)u32BlockNo * m_u32BlockSize_B);
+}
+
+void cInterruptibleBlockingUDPPacketRing::callback_ready(const boost::system::error_code& oError)
+{
+    m_bError = oError ? true : false;
+    m_oTimer.cancel();
+
+    m_oLastError = oError;
+}
+
+void cInterruptibleBlockingUDPPacketRing::callback_timeOut(const boost::system::error_code& oError)
+{
+    if (oError)
+    {
+        m_oLastError = oError;
+        return;
+    }
+
+    std::cout << "!!! Time out reached on packet ring \"" << m_strName << "\" (" << this << ")" << std::endl;
+
+    m_bTimedOut = true;
+    m_oDescriptor.cancel();
+}
+
+void cInterruptibleBlockingUDPPacketRing::cancelCurrrentOperations()
+{
+    m_oWaiter.cancel();
+}
+
+void cInterruptibleBlockingUDPPacketRing::cancelIO()
+{
+    try
+    {
+        m_oDescriptor.cancel();
+        m_oTimer.cancel();
+    }
+    catch(boost::system::system_error &e)
+    {
+        //Catch special conditions where descriptor is trying to be opened etc.
+        //Prevents crash.
+    }
+}
+
+void cInterruptibleBlockingUDPPacketRing::updateStatistics()
+{
+    if(!m_oDescriptor.is_open())
+        return;
+
+    tpacket_stats_v3 oStats;
+    socklen_t oLength = sizeof(oStats);
+
+    if(getsockopt(m_oDescriptor.native_handle(), SOL_PACKET, PACKET_STATISTICS, &oStats, &oLength))
+        return;
+
+    //tp_packets includes the drops
+    m_u64NPacketsReceived += oStats.tp_packets;
+    m_u64NPacketsDropped += oStats.tp_drops;
+    m_u64NRingFreezes += oStats.tp_freeze_q_cnt;
+}
+
+std::string cInterruptibleBlockingUDPPacketRing::getName() const
+{
+    return m_strName;
+}
+
+uint16_t cInterruptibleBlockingUDPPacketRing::getUDPPort() const
+{
+    return m_u16UDPPort;
+}
+
+boost::system::error_code cInterruptibleBlockingUDPPacketRing::getLastError() const
+{
+    return m_oLastError;
+}
+
+uint64_t cInterruptibleBlockingUDPPacketRing::getNPacketsReceived()
+{
+    updateStatistics();
+    return m_u64NPacketsReceived;
+}
+
+uint64_t cInterruptibleBlockingUDPPacketRing::getNPacketsDropped()
+{
+    updateStatistics();
+    return m_u64NPacketsDropped;
+}
+
+uint64_t cInterruptibleBlockingUDPPacketRing::getNRingFreezes()
+{
+    updateStatistics();
+    return m_u64NRingFreezes;
+}
+
+#endif // __linux__
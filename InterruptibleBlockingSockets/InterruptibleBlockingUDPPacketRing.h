@@ -0,0 +1,142 @@
+#ifndef INTERRUPTIBLE_BLOCKING_UDP_PACKET_RING_H
+#define INTERRUPTIBLE_BLOCKING_UDP_PACKET_RING_H
+
+//Memory mapped (PACKET_MMAP / TPACKET_V3) receive path for high rate UDP streams. Linux only.
+//
+//An AF_PACKET socket is bound to a network interface and filtered (in kernel, with BPF) down to IPv4 UDP datagrams
+//addressed to one port. The kernel fills blocks of a ring shared with user space and the blocks are handed out
+//directly, so no copy is made between kernel and user space. UDP payloads are located inside each block.
+//
+//The kernel still delivers the same datagrams to any ordinary socket bound to the port. Keeping a
+//cInterruptibleBlockingUDPSocket bound there (see openForSocket()) stops the host from answering with ICMP port
+//unreachable. Its receive buffer simply overflows unless it is also read.
+//
+//Requires CAP_NET_RAW. Works on any interface including "lo" or a veth pair.
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+#include <linux/if_packet.h>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPSocket.h"
+#include "BlockingOperationWaiter.h"
+
+class cInterruptibleBlockingUDPPacketRing
+{
+public:
+    //One UDP datagram inside a ring block
+    class cPacketView
+    {
+    public:
+        cPacketView();
+
+        const char                      *m_cpPayload;
+        uint32_t                        m_u32NBytes;          //Payload bytes available (limited to the capture length)
+        uint32_t                        m_u32NBytesOnWire;    //Payload length from the UDP header
+        boost::asio::ip::udp::endpoint  m_oPeerEndpoint;
+        int64_t                         m_i64Timestamp_ns;    //Kernel receive time, ns since the epoch
+    };
+
+    //A block of packets retired by the kernel. Valid until releaseBlock() is called.
+    class cBlock
+    {
+    public:
+        cBlock();
+
+        uint32_t                        getNPackets() const;
+        bool                            getNextPacket(cPacketView &oPacket); //Returns false once all packets have been visited
+
+    private:
+        friend class cInterruptibleBlockingUDPPacketRing;
+
+        const uint8_t                   *m_u8pBlock;
+        const uint8_t                   *m_u8pNextPacket;
+        uint32_t                        m_u32NPackets;
+        uint32_t                        m_u32NPacketsVisited;
+    };
+
+    cInterruptibleBlockingUDPPacketRing(const std::string &strName = "");
+    ~cInterruptibleBlockingUDPPacketRing();
+
+    //u32BlockTimeout_ms bounds how long the kernel holds a partially filled block before retiring it to user space
+    bool                            open(const std::string &strInterfaceName, uint16_t u16UDPPort,
+                                         uint32_t u32BlockSize_B = 4 * 1024 * 1024, uint32_t u32NBlocks = 64, uint32_t u32BlockTimeout_ms = 10);
+    bool                            openForSocket(const cInterruptibleBlockingUDPSocket &oSocket, const std::string &strInterfaceName,
+                                                  uint32_t u32BlockSize_B = 4 * 1024 * 1024, uint32_t u32NBlocks = 64, uint32_t u32BlockTimeout_ms = 10);
+    void                            close();
+
+    bool                            isOpen() const;
+
+    //Blocks until the kernel retires the next block (or timeout / cancel). Blocks must be released in order, one at a time.
+    //getLastError() is timed_out after a timeout and operation_aborted after cancelCurrrentOperations().
+    bool                            getNextBlock(cBlock &oBlock, uint32_t u32Timeout_ms = 0);
+    void                            releaseBlock();
+
+    void                            cancelCurrrentOperations();
+
+    //Some accessors
+    std::string                     getName() const;
+    uint16_t                        getUDPPort() const;
+    boost::system::error_code       getLastError() const;
+
+    //Kernel counters (PACKET_STATISTICS). Note reading these resets the kernel's counters so they are accumulated here.
+    uint64_t                        getNPacketsReceived();
+    uint64_t                        getNPacketsDropped();
+    uint64_t                        getNRingFreezes();
+
+private:
+    boost::asio::io_service         m_oIOService;
+    boost::asio::posix::stream_descriptor m_oDescriptor; //Wraps the packet socket so waits run through the io_service
+
+    //Timer for determining timeouts
+    boost::asio::deadline_timer     m_oTimer;
+
+    //Runs the waits of getNextBlock() (see cBlockingOperationWaiter)
+    cBlockingOperationWaiter        m_oWaiter;
+
+    //Shared ring
+    uint8_t                         *m_u8pRing;
+    uint32_t                        m_u32BlockSize_B;
+    uint32_t                        m_u32NBlocks;
+    uint32_t                        m_u32CurrentBlock;
+
+    uint16_t                        m_u16UDPPort;
+
+    //Flag for determining read errors
+    bool                            m_bError;
+    bool                            m_bTimedOut; //Set by callback_timeOut() to tell timeouts from cancellations
+    boost::system::error_code       m_oLastError;
+
+    //Accumulated kernel statistics
+    uint64_t                        m_u64NPacketsReceived;
+    uint64_t                        m_u64NPacketsDropped;
+    uint64_t                        m_u64NRingFreezes;
+
+    //Optional label for this ring. May be useful for debugging.
+    std::string                     m_strName;
+
+    tpacket_block_desc*             getBlockDescriptor(uint32_t u32BlockNo) const;
+    bool                            attachPortFilter(int iFD, uint16_t u16UDPPort);
+    void                            updateStatistics();
+
+    //Abort the wait in progress (see cBlockingOperationWaiter)
+    void                            cancelIO();
+
+    //Internal callback functions called by boost asynchronous API
+    void                            callback_ready(const boost::system::error_code& oError);
+    void                            callback_timeOut(const boost::system::error_code& oError);
+};
+
+#endif // __linux__
+
+#endif // INTERRUPTIBLE_BLOCKING_UDP_PACKET_RING_H
@@ -0,0 +1,119 @@
+
+//System includes
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+//Library includes
+
+//Local includes
+#include "InterruptibleBlockingUDPReceiverGroup.h"
+
+using namespace std;
+
+cInterruptibleBlockingUDPReceiverGroup::cShardStats::cShardStats() :
+    m_u64NPacketsReceived(0),
+    m_u64NOverruns(0),
+    m_u32Occupancy(0),
+    m_u32HighWaterMark(0)
+{
+}
+
+cInterruptibleBlockingUDPReceiverGroup::cInterruptibleBlockingUDPReceiverGroup(const string &strName) :
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingUDPReceiverGroup::~cInterruptibleBlockingUDPReceiverGroup()
+{
+    stop();
+}
+
+bool cInterruptibleBlockingUDPReceiverGroup::start(const string &strLocalAddress, uint16_t u16LocalPort, uint32_t u32NShards,
+                                                   uint32_t u32NSlotsPerShard, uint32_t u32SlotSize_B,
+                                                   const vector<int32_t> &vi32CPUCores, uint32_t u32MaxBatchSize)
+{
+    stop();
+
+    for(uint32_t u32ShardNo = 0; u32ShardNo < u32NShards; u32ShardNo++)
+    {
+        stringstream oSS;
+        oSS << m_strName << "_shard" << u32ShardNo;
+
+        int32_t i32CPUCore = u32ShardNo < vi32CPUCores.size() ? vi32CPUCores[u32ShardNo] : -1;
+
+        boost::shared_ptr<cInterruptibleBlockingUDPStreamReceiver> pShard(new cInterruptibleBlockingUDPStreamReceiver(oSS.str()));
+
+        if(!pShard->start(strLocalAddress, u16LocalPort, u32NSlotsPerShard, u32SlotSize_B, i32CPUCore, u32MaxBatchSize, true))
+        {
+            cout << "cInterruptibleBlockingUDPReceiverGroup::start(): Failed to start shard " << u32ShardNo << " of \"" << m_strName << "\"." << endl;
+            stop();
+            return false;
+        }
+
+        m_vpShards.push_back(pShard);
+    }
+
+    cout << "cInterruptibleBlockingUDPReceiverGroup::start(): Started " << u32NShards << " receiver shards on port " << u16LocalPort << endl;
+
+    return true;
+}
+
+void cInterruptibleBlockingUDPReceiverGroup::stop()
+{
+    for(uint32_t u32ShardNo = 0; u32ShardNo < m_vpShards.size(); u32ShardNo++)
+        m_vpShards[u32ShardNo]->stop();
+
+    m_vpShards.clear();
+}
+
+uint32_t cInterruptibleBlockingUDPReceiverGroup::getNShards() const
+{
+    return m_vpShards.size();
+}
+
+cInterruptibleBlockingUDPStreamReceiver& cInterruptibleBlockingUDPReceiverGroup::getShard(uint32_t u32ShardNo)
+{
+    return *m_vpShards.at(u32ShardNo);
+}
+
+void cInterruptibleBlockingUDPReceiverGroup::cancelCurrrentOperations()
+{
+    for(uint32_t u32ShardNo = 0; u32ShardNo < m_vpShards.size(); u32ShardNo++)
+        m_vpShards[u32ShardNo]->cancelCurrrentOperations();
+}
+
+cInterruptibleBlockingUDPReceiverGroup::cShardStats cInterruptibleBlockingUDPReceiverGroup::getShardStats(uint32_t u32ShardNo) const
+{
+    const cInterruptibleBlockingUDPStreamReceiver &oShard = *m_vpShards.at(u32ShardNo);
+
+    cShardStats oStats;
+    oStats.m_u64NPacketsReceived = oShard.getNPacketsReceived();
+    oStats.m_u64NOverruns = oShard.getNOverruns();
+    oStats.m_u32Occupancy = oShard.getOccupancy();
+    oStats.m_u32HighWaterMark = oShard.getHighWaterMark();
+
+    return oStats;
+}
+
+cInterruptibleBlockingUDPReceiverGroup::cShardStats cInterruptibleBlockingUDPReceiverGroup::getAggregateStats() const
+{
+    cShardStats oAggregate;
+
+    for(uint32_t u32ShardNo = 0; u32ShardNo < m_vpShards.size(); u32ShardNo++)
+    {
+        cShardStats oStats = getShardStats(u32ShardNo);
+
+        oAggregate.m_u64NPacketsReceived += oStats.m_u64NPacketsReceived;
+        oAggregate.m_u64NOverruns += oStats.m_u64NOverruns;
+        oAggregate.m_u32Occupancy += oStats.m_u32Occupancy;
+        oAggregate.m_u32HighWaterMark = max(oAggregate.m_u32HighWaterMark, oStats.m_u32HighWaterMark);
+    }
+
+    return oAggregate;
+}
+
+std::string cInterruptibleBlockingUDPReceiverGroup::getName() const
+{
+    return m_strName;
+}
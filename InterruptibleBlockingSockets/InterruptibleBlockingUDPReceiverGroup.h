@@ -0,0 +1,80 @@
+#ifndef INTERRUPTIBLE_BLOCKING_UDP_RECEIVER_GROUP_H
+#define INTERRUPTIBLE_BLOCKING_UDP_RECEIVER_GROUP_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/shared_ptr.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPStreamReceiver.h"
+
+//Spreads the traffic arriving on one UDP port over several cores. N stream receivers bind the same port with
+//SO_REUSEPORT, each with its own receive thread (optionally pinned) and ring. The kernel hashes unicast flows
+//(source / destination address and port) across the shards so a single flow always lands on the same shard.
+//Each shard's ring is consumed separately via getShard(n).
+//
+//Note that multicast datagrams are delivered to every socket bound to the port rather than being spread. To shard
+//multicast traffic, join a different subset of groups on each shard's socket (getShard(n).getSocket()).
+
+class cInterruptibleBlockingUDPReceiverGroup
+{
+public:
+    class cShardStats
+    {
+    public:
+        cShardStats();
+
+        uint64_t                        m_u64NPacketsReceived;
+        uint64_t                        m_u64NOverruns;
+        uint32_t                        m_u32Occupancy;
+        uint32_t                        m_u32HighWaterMark;
+    };
+
+    cInterruptibleBlockingUDPReceiverGroup(const std::string &strName = "");
+    ~cInterruptibleBlockingUDPReceiverGroup();
+
+    //vi32CPUCores gives the core for each shard's receive thread. Missing entries (or negative values) are left unpinned.
+    bool                                start(const std::string &strLocalAddress, uint16_t u16LocalPort, uint32_t u32NShards,
+                                              uint32_t u32NSlotsPerShard, uint32_t u32SlotSize_B,
+                                              const std::vector<int32_t> &vi32CPUCores = std::vector<int32_t>(), uint32_t u32MaxBatchSize = 64);
+    void                                stop();
+
+    uint32_t                            getNShards() const;
+    cInterruptibleBlockingUDPStreamReceiver& getShard(uint32_t u32ShardNo);
+
+    //Wake consumers blocked on any shard
+    void                                cancelCurrrentOperations();
+
+    //Statistics
+    cShardStats                         getShardStats(uint32_t u32ShardNo) const;
+    cShardStats                         getAggregateStats() const;  //Sum over shards. High water mark is the maximum over shards.
+
+    std::string                         getName() const;
+
+private:
+    std::vector<boost::shared_ptr<cInterruptibleBlockingUDPStreamReceiver> > m_vpShards;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+};
+
+#endif // INTERRUPTIBLE_BLOCKING_UDP_RECEIVER_GROUP_H
@@ -2,32 +2,116 @@
 
 //System includes
 #include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 
 //Library includes
 #ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
 #include <boost/bind.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/asio/ip/multicast.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#endif
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#endif
+
+#ifdef __linux__
+#include <netinet/udp.h>
 #endif
 
 //Local includes
 #include "InterruptibleBlockingUDPSocket.h"
+#include "AwaitableDeadline.h"
 
 using namespace std;
 
+#ifdef __linux__
+//Per message space for ancillary data from the kernel. Comfortably holds all control messages this class enables.
+static const uint32_t CONTROL_BUFFER_SIZE_B = 128;
+#endif
+
+//Limits for a single segmented send: the largest UDP payload and the kernel's maximum number of segments per send (UDP_MAX_SEGMENTS)
+static const uint32_t MAX_UDP_PAYLOAD_SIZE_B = 65507;
+static const uint32_t MAX_SEGMENTS_PER_SEND = 64;
+
+static const uint32_t RECEIVE_BUFFER_SIZE_B = 64 * 1024 * 1024;
+
+cInterruptibleBlockingUDPSocket::cReceiveSlot::cReceiveSlot(char *cpBuffer, uint32_t u32BufferSize) :
+    m_cpBuffer(cpBuffer),
+    m_u32BufferSize(u32BufferSize),
+    m_u32NBytesReceived(0),
+    m_i64Timestamp_ns(0),
+    m_u32SegmentSize_B(0),
+    m_bTruncated(false)
+{
+}
+
+cInterruptibleBlockingUDPSocket::cStatistics::cStatistics() :
+    m_u64NDatagramsReceived(0),
+    m_u64NBytesReceived(0),
+    m_u64NDatagramsSent(0),
+    m_u64NBytesSent(0),
+    m_u64NTimeouts(0),
+    m_u64NCancellations(0),
+    m_u32NKernelDrops(0),
+    m_u32ReceiveBufferSize_B(0)
+{
+}
+
 cInterruptibleBlockingUDPSocket::cInterruptibleBlockingUDPSocket(const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
+    m_oSocket(m_oIOService),
+    m_oTimer(m_oIOService),
+    m_oWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingUDPSocket::cancelIO, this)),
+    m_bError(true),
+    m_u32NBytesLastTransferred(0),
+    m_u32NDatagramsLastTransferred(0),
+    m_bKernelTimestamps(false),
+    m_bGRO(false),
+    m_bDropCounting(false),
+    m_bSegmentationRefused(false),
+    m_bTimedOut(false),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingUDPSocket::cInterruptibleBlockingUDPSocket(boost::asio::io_service &oIOService, const string &strName) :
+    m_oIOService(oIOService),
     m_oSocket(m_oIOService),
     m_oTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWaiter(m_oIOService, true, boost::bind(&cInterruptibleBlockingUDPSocket::cancelIO, this)),
     m_bError(true),
+    m_u32NBytesLastTransferred(0),
+    m_u32NDatagramsLastTransferred(0),
+    m_bKernelTimestamps(false),
+    m_bGRO(false),
+    m_bDropCounting(false),
+    m_bSegmentationRefused(false),
+    m_bTimedOut(false),
     m_strName(strName)
 {
 }
 
 cInterruptibleBlockingUDPSocket::cInterruptibleBlockingUDPSocket(const string &strLocalInterface, uint16_t u16LocalPort, const string &strPeerAddress, uint16_t u16PeerPort, const string &strName) :
+    m_pOwnedIOService(new boost::asio::io_service),
+    m_oIOService(*m_pOwnedIOService),
     m_oSocket(m_oIOService),
     m_oTimer(m_oIOService),
-    m_oResolver(m_oIOService),
+    m_oWaiter(m_oIOService, false, boost::bind(&cInterruptibleBlockingUDPSocket::cancelIO, this)),
     m_bError(true),
+    m_u32NBytesLastTransferred(0),
+    m_u32NDatagramsLastTransferred(0),
+    m_bKernelTimestamps(false),
+    m_bGRO(false),
+    m_bDropCounting(false),
+    m_bSegmentationRefused(false),
+    m_bTimedOut(false),
     m_strName(strName)
 {
     if(strPeerAddress.length())
@@ -42,7 +126,7 @@ cInterruptibleBlockingUDPSocket::~cInterruptibleBlockingUDPSocket()
     close();
 }
 
-bool cInterruptibleBlockingUDPSocket::openAndBind(const string &strLocalAddress, uint16_t u16LocalPort)
+bool cInterruptibleBlockingUDPSocket::openAndBind(const string &strLocalAddress, uint16_t u16LocalPort, bool bReusePort)
 {
     //Error code to check returns of socket functions
     boost::system::error_code oEC;
@@ -53,14 +137,9 @@ bool cInterruptibleBlockingUDPSocket::openAndBind(const string &strLocalAddress,
     //Open the socket
     m_oSocket.open(boost::asio::ip::udp::v4(), oEC);
 
-    //Set some socket options
-    m_oSocket.set_option( boost::asio::socket_base::receive_buffer_size(64 * 1024 * 1024) ); //Set buffer to 64 MB
-    m_oSocket.set_option( boost::asio::socket_base::reuse_address(true) );
-
-    m_oLocalEndpoint = createEndpoint(strLocalAddress, u16LocalPort);
-
     if(oEC)
     {
+        m_oLastError = oEC;
         cout << "cInterruptibleBlockingUDPSocket::openAndBind(): Error opening socket: " << oEC.message() << endl;
         return false;
     }
@@ -69,6 +148,36 @@ bool cInterruptibleBlockingUDPSocket::openAndBind(const string &strLocalAddress,
         cout << "cInterruptibleBlockingUDPSocket::openAndBind(): Successfully opened UDP socket." << endl;
     }
 
+    //Set some socket options
+    m_oSocket.set_option( boost::asio::socket_base::receive_buffer_size(RECEIVE_BUFFER_SIZE_B) ); //Set buffer to 64 MB
+    m_oSocket.set_option( boost::asio::socket_base::reuse_address(true) );
+
+    //The kernel silently limits the buffer (net.core.rmem_max on Linux) so check what we actually got. Only a warning.
+    boost::system::error_code oOptionEC;
+    boost::asio::socket_base::receive_buffer_size oReceiveBufferSize;
+    m_oSocket.get_option(oReceiveBufferSize, oOptionEC);
+    if(!oOptionEC && (uint32_t)oReceiveBufferSize.value() < RECEIVE_BUFFER_SIZE_B)
+        cout << "cInterruptibleBlockingUDPSocket::openAndBind(): Warning: Receive buffer is " << oReceiveBufferSize.value() << " bytes, less than the " << RECEIVE_BUFFER_SIZE_B << " requested." << endl;
+
+    if(bReusePort)
+    {
+#ifdef SO_REUSEPORT
+        //Fatal, as for cInterruptibleBlockingTCPAcceptor: without it the shards of a receiver group can't share the port
+        m_oSocket.set_option( boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), oEC );
+        if(oEC)
+        {
+            m_oLastError = oEC;
+            cout << "cInterruptibleBlockingUDPSocket::openAndBind(): Unable to set SO_REUSEPORT: " << oEC.message() << endl;
+            close();
+            return false;
+        }
+#else
+        cout << "cInterruptibleBlockingUDPSocket::openAndBind(): SO_REUSEPORT is not supported on this platform." << endl;
+#endif
+    }
+
+    m_oLocalEndpoint = createEndpoint(strLocalAddress, u16LocalPort);
+
     m_oSocket.bind(m_oLocalEndpoint, oEC);
     if (oEC)
     {
@@ -120,6 +229,12 @@ void cInterruptibleBlockingUDPSocket::close()
     cout << "cInterruptibleBlockingUDPSocket::close(): Cancelling all current socket operations." << endl;
     cancelCurrrentOperations();
 
+#ifdef __linux__
+    //The kernel holds the socket open while a multishot receive is armed
+    if(m_pIOUring)
+        m_pIOUring->stopMultishot();
+#endif
+
     //If the socket is open close it
     if(m_oSocket.is_open())
     {
@@ -135,95 +250,383 @@ void cInterruptibleBlockingUDPSocket::close()
     }
 }
 
+bool cInterruptibleBlockingUDPSocket::joinMulticastGroup(const string &strGroupAddress, const string &strInterfaceAddress)
+{
+    boost::system::error_code oEC;
+
+    boost::asio::ip::address_v4 oGroupAddress = boost::asio::ip::address_v4::from_string(strGroupAddress, oEC);
+    boost::asio::ip::address_v4 oInterfaceAddress;
+    if(!oEC && strInterfaceAddress.length())
+        oInterfaceAddress = boost::asio::ip::address_v4::from_string(strInterfaceAddress, oEC);
+
+    if(!oEC)
+        m_oSocket.set_option( boost::asio::ip::multicast::join_group(oGroupAddress, oInterfaceAddress), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::joinMulticastGroup(): Error joining group " << strGroupAddress << ": " << oEC.message() << endl;
+        return false;
+    }
+
+    cout << "cInterruptibleBlockingUDPSocket::joinMulticastGroup(): Joined multicast group " << strGroupAddress << endl;
+    return true;
+}
+
+bool cInterruptibleBlockingUDPSocket::leaveMulticastGroup(const string &strGroupAddress, const string &strInterfaceAddress)
+{
+    boost::system::error_code oEC;
+
+    boost::asio::ip::address_v4 oGroupAddress = boost::asio::ip::address_v4::from_string(strGroupAddress, oEC);
+    boost::asio::ip::address_v4 oInterfaceAddress;
+    if(!oEC && strInterfaceAddress.length())
+        oInterfaceAddress = boost::asio::ip::address_v4::from_string(strInterfaceAddress, oEC);
+
+    if(!oEC)
+        m_oSocket.set_option( boost::asio::ip::multicast::leave_group(oGroupAddress, oInterfaceAddress), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::leaveMulticastGroup(): Error leaving group " << strGroupAddress << ": " << oEC.message() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool cInterruptibleBlockingUDPSocket::joinSourceSpecificMulticastGroup(const string &strGroupAddress, const string &strSourceAddress, const string &strInterfaceAddress)
+{
+    return changeSourceSpecificMembership(IP_ADD_SOURCE_MEMBERSHIP, strGroupAddress, strSourceAddress, strInterfaceAddress);
+}
+
+bool cInterruptibleBlockingUDPSocket::leaveSourceSpecificMulticastGroup(const string &strGroupAddress, const string &strSourceAddress, const string &strInterfaceAddress)
+{
+    return changeSourceSpecificMembership(IP_DROP_SOURCE_MEMBERSHIP, strGroupAddress, strSourceAddress, strInterfaceAddress);
+}
+
+bool cInterruptibleBlockingUDPSocket::changeSourceSpecificMembership(int iOption, const string &strGroupAddress, const string &strSourceAddress, const string &strInterfaceAddress)
+{
+    //Asio has no option class for source specific membership so fill in ip_mreq_source directly
+    boost::system::error_code oEC;
+
+    boost::asio::ip::address_v4 oGroupAddress = boost::asio::ip::address_v4::from_string(strGroupAddress, oEC);
+    boost::asio::ip::address_v4 oSourceAddress;
+    boost::asio::ip::address_v4 oInterfaceAddress;
+    if(!oEC)
+        oSourceAddress = boost::asio::ip::address_v4::from_string(strSourceAddress, oEC);
+    if(!oEC && strInterfaceAddress.length())
+        oInterfaceAddress = boost::asio::ip::address_v4::from_string(strInterfaceAddress, oEC);
+
+    if(!oEC)
+    {
+        ip_mreq_source oRequest;
+        memset(&oRequest, 0, sizeof(oRequest));
+        oRequest.imr_multiaddr.s_addr = htonl(oGroupAddress.to_ulong());
+        oRequest.imr_sourceaddr.s_addr = htonl(oSourceAddress.to_ulong());
+        oRequest.imr_interface.s_addr = htonl(oInterfaceAddress.to_ulong());
+
+        if(setsockopt(m_oSocket.native_handle(), IPPROTO_IP, iOption, reinterpret_cast<const char*>(&oRequest), sizeof(oRequest)))
+            oEC = boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::changeSourceSpecificMembership(): Error changing membership of group " << strGroupAddress
+             << " for source " << strSourceAddress << ": " << oEC.message() << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool cInterruptibleBlockingUDPSocket::setMulticastInterface(const string &strInterfaceAddress)
+{
+    boost::system::error_code oEC;
+
+    boost::asio::ip::address_v4 oInterfaceAddress = boost::asio::ip::address_v4::from_string(strInterfaceAddress, oEC);
+    if(!oEC)
+        m_oSocket.set_option( boost::asio::ip::multicast::outbound_interface(oInterfaceAddress), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::setMulticastInterface(): Error setting interface " << strInterfaceAddress << ": " << oEC.message() << endl;
+        return false;
+    }
+
+    return true;
+}
+
 bool cInterruptibleBlockingUDPSocket::send(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
 {
     //Note this function sends to the specific endpoint set in the constructor or with the openAndBind function
 
+#ifdef __linux__
+    if(m_pZeroCopyTracker && m_pZeroCopyTracker->isWorthwhile(u32NBytes))
+        return fastSend(cpBuffer, u32NBytes, NULL, u32Timeout_ms);
+
+    if(m_pIOUring)
+        return ioUringSend(cpBuffer, u32NBytes, NULL, u32Timeout_ms);
+
+    if(m_pFastPathWaiter)
+        return fastSend(cpBuffer, u32NBytes, NULL, u32Timeout_ms);
+#endif
+
     //Necessary after a timeout:
-    m_oSocket.get_io_service().reset();
+    m_oWaiter.begin();
 
     //Asynchronously write characters
     m_oSocket.async_send( boost::asio::buffer(cpBuffer, u32NBytes),
-                          boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
-                                      this,
-                                      boost::asio::placeholders::error,
-                                      boost::asio::placeholders::bytes_transferred) );
+                          m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
+                                                     this,
+                                                     boost::asio::placeholders::error,
+                                                     boost::asio::placeholders::bytes_transferred)) );
 
     // Setup a deadline time to implement our timeout.
     if(u32Timeout_ms)
     {
         m_oTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
-        m_oTimer.async_wait( boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
-                                         this, boost::asio::placeholders::error) );
+        m_oTimer.async_wait( m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
+                                                        this, boost::asio::placeholders::error)) );
     }
 
     // This will block until a character is read
     // or until the it is cancelled.
-    m_oSocket.get_io_service().run();
+    m_oWaiter.wait();
 
-    return !m_bError;
+    return finishTransfer(false);
 }
 
 bool cInterruptibleBlockingUDPSocket::sendTo(const char *cpBuffer, uint32_t u32NBytes, const std::string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms)
 {
-    return cInterruptibleBlockingUDPSocket::sendTo(cpBuffer, u32NBytes, createEndpoint(strPeerAddress, u16PeerPort), u32Timeout_ms);
+    //Resolution normally comes from the cache so this doesn't count against the send timeout
+    return cInterruptibleBlockingUDPSocket::sendTo(cpBuffer, u32NBytes, createEndpoint(strPeerAddress, u16PeerPort, u32Timeout_ms), u32Timeout_ms);
 }
 
 bool cInterruptibleBlockingUDPSocket::sendTo(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms)
 {
     //Note this function sends to the specific endpoint set in the constructor or with the openAndBind function
 
+#ifdef __linux__
+    if(m_pZeroCopyTracker && m_pZeroCopyTracker->isWorthwhile(u32NBytes))
+        return fastSend(cpBuffer, u32NBytes, &oPeerEndpoint, u32Timeout_ms);
+
+    if(m_pIOUring)
+        return ioUringSend(cpBuffer, u32NBytes, &oPeerEndpoint, u32Timeout_ms);
+
+    if(m_pFastPathWaiter)
+        return fastSend(cpBuffer, u32NBytes, &oPeerEndpoint, u32Timeout_ms);
+#endif
+
     //Necessary after a timeout:
-    m_oSocket.get_io_service().reset();
+    m_oWaiter.begin();
 
     //Asynchronously write characters
     m_oSocket.async_send_to( boost::asio::buffer(cpBuffer, u32NBytes),
                              oPeerEndpoint,
-                             boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
-                                         this,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred) );
+                             m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
+                                                        this,
+                                                        boost::asio::placeholders::error,
+                                                        boost::asio::placeholders::bytes_transferred)) );
 
     // Setup a deadline time to implement our timeout.
     if(u32Timeout_ms)
     {
         m_oTimer.expires_from_now( boost::posix_time::milliseconds(u32Timeout_ms) );
-        m_oTimer.async_wait( boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
-                                         this, boost::asio::placeholders::error) );
+        m_oTimer.async_wait( m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
+                                                        this, boost::asio::placeholders::error)) );
     }
 
     // This will block until a character is read
     // or until the it is cancelled.
-    m_oSocket.get_io_service().run();
+    m_oWaiter.wait();
 
-    return !m_bError;
+    return finishTransfer(false);
+}
+
+bool cInterruptibleBlockingUDPSocket::sendBatch(const vector<cSendEntry> &voEntries, uint32_t u32Timeout_ms)
+{
+    m_u32NBytesLastTransferred = 0;
+    m_u32NDatagramsLastTransferred = 0;
+
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    //Submit as many entries per system call as the kernel will take, only waiting when the send buffer is full
+    while(m_u32NDatagramsLastTransferred < voEntries.size())
+    {
+        if(trySendBatch(voEntries, m_u32NDatagramsLastTransferred))
+            continue;
+
+        if(m_oLastError != boost::asio::error::would_block)
+            return false;
+
+        if(!waitUntilReady(true, u32Timeout_ms, oStartTime))
+            return false;
+    }
+
+    m_bError = false;
+    m_oLastError = boost::system::error_code();
+
+    return true;
+}
+
+bool cInterruptibleBlockingUDPSocket::sendToMany(const char *cpBuffer, uint32_t u32NBytes, const vector<boost::asio::ip::udp::endpoint> &voPeerEndpoints, uint32_t u32Timeout_ms)
+{
+    //Reuse the member vector so that repeated fan-outs don't allocate
+    m_voFanOutEntries.resize(voPeerEndpoints.size());
+
+    for(uint32_t u32EntryNo = 0; u32EntryNo < voPeerEndpoints.size(); u32EntryNo++)
+        m_voFanOutEntries[u32EntryNo] = cSendEntry(cpBuffer, u32NBytes, voPeerEndpoints[u32EntryNo]);
+
+    return sendBatch(m_voFanOutEntries, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingUDPSocket::trySendBatch(const vector<cSendEntry> &voEntries, uint32_t u32FirstEntry)
+{
+#ifdef __linux__
+    uint32_t u32NEntries = voEntries.size() - u32FirstEntry;
+
+    if(m_voSendBatchHeaders.size() < u32NEntries)
+    {
+        m_voSendBatchHeaders.resize(u32NEntries);
+        m_voSendBatchIOVecs.resize(u32NEntries);
+    }
+
+    for(uint32_t u32EntryNo = 0; u32EntryNo < u32NEntries; u32EntryNo++)
+    {
+        const cSendEntry &oEntry = voEntries[u32FirstEntry + u32EntryNo];
+
+        m_voSendBatchIOVecs[u32EntryNo].iov_base = const_cast<char*>(oEntry.m_cpBuffer);
+        m_voSendBatchIOVecs[u32EntryNo].iov_len = oEntry.m_u32NBytes;
+
+        //A NULL address sends to the connected peer
+        msghdr &oHeader = m_voSendBatchHeaders[u32EntryNo].msg_hdr;
+        if(oEntry.m_bUsePeerEndpoint)
+        {
+            oHeader.msg_name = const_cast<sockaddr*>(oEntry.m_oPeerEndpoint.data());
+            oHeader.msg_namelen = oEntry.m_oPeerEndpoint.size();
+        }
+        else
+        {
+            oHeader.msg_name = NULL;
+            oHeader.msg_namelen = 0;
+        }
+        oHeader.msg_iov = &m_voSendBatchIOVecs[u32EntryNo];
+        oHeader.msg_iovlen = 1;
+        oHeader.msg_control = NULL;
+        oHeader.msg_controllen = 0;
+        oHeader.msg_flags = 0;
+    }
+
+    int iNSent = sendmmsg(m_oSocket.native_handle(), &m_voSendBatchHeaders.front(), u32NEntries, MSG_DONTWAIT);
+
+    if(iNSent <= 0)
+    {
+        m_bError = true;
+        if(iNSent == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+            m_oLastError = boost::asio::error::would_block;
+        else
+            m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+        return false;
+    }
+
+    uint32_t u32NBytesSent = 0;
+    for(int iEntryNo = 0; iEntryNo < iNSent; iEntryNo++)
+        u32NBytesSent += m_voSendBatchHeaders[iEntryNo].msg_len;
+
+    m_u32NBytesLastTransferred += u32NBytesSent;
+    m_u32NDatagramsLastTransferred += iNSent;
+
+    countTransfer(false, iNSent, u32NBytesSent);
+
+    return true;
+#else
+    //No sendmmsg on this platform. Emulate with non-blocking single datagram sends.
+    boost::system::error_code oEC, oModeEC;
+    bool bNonBlocking = m_oSocket.non_blocking();
+    m_oSocket.non_blocking(true, oModeEC);
+
+    uint32_t u32NSent = 0;
+    uint32_t u32NBytesSent = 0;
+    for(uint32_t u32EntryNo = u32FirstEntry; u32EntryNo < voEntries.size(); u32EntryNo++)
+    {
+        const cSendEntry &oEntry = voEntries[u32EntryNo];
+
+        if(oEntry.m_bUsePeerEndpoint)
+            u32NBytesSent += m_oSocket.send_to(boost::asio::buffer(oEntry.m_cpBuffer, oEntry.m_u32NBytes), oEntry.m_oPeerEndpoint, 0, oEC);
+        else
+            u32NBytesSent += m_oSocket.send(boost::asio::buffer(oEntry.m_cpBuffer, oEntry.m_u32NBytes), 0, oEC);
+
+        if(oEC)
+            break;
+
+        u32NSent++;
+    }
+
+    m_oSocket.non_blocking(bNonBlocking, oModeEC);
+
+    m_u32NBytesLastTransferred += u32NBytesSent;
+    m_u32NDatagramsLastTransferred += u32NSent;
+
+    countTransfer(false, u32NSent, u32NBytesSent);
+
+    if(!u32NSent)
+    {
+        m_bError = true;
+        m_oLastError = oEC;
+        return false;
+    }
+
+    return true;
+#endif
 }
 
 bool cInterruptibleBlockingUDPSocket::receive(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms)
 {
+    //The drop counter only arrives as ancillary data
+    if(m_bDropCounting)
+    {
+        boost::asio::ip::udp::endpoint oPeerEndpoint;
+        int64_t i64Timestamp_ns;
+        uint32_t u32SegmentSize_B;
+
+        return receiveMessage(cpBuffer, u32NBytes, oPeerEndpoint, i64Timestamp_ns, u32SegmentSize_B, u32Timeout_ms);
+    }
+
+#ifdef __linux__
+    if(m_pIOUring)
+        return ioUringReceive(cpBuffer, u32NBytes, NULL, u32Timeout_ms);
+
+    if(m_pFastPathWaiter)
+        return fastReceive(cpBuffer, u32NBytes, NULL, u32Timeout_ms);
+#endif
+
     //Necessary after a timeout:
-    m_oSocket.get_io_service().reset();
+    m_oWaiter.begin();
 
     //Asynchronously read characters into string
     m_oSocket.async_receive( boost::asio::buffer(cpBuffer, u32NBytes),
-                             boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
-                                         this,
-                                         boost::asio::placeholders::error,
-                                         boost::asio::placeholders::bytes_transferred) );
+                             m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
+                                                        this,
+                                                        boost::asio::placeholders::error,
+                                                        boost::asio::placeholders::bytes_transferred)) );
 
     // Setup a deadline time to implement our timeout.
     if(u32Timeout_ms)
     {
         m_oTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oTimer.async_wait(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
-                                        this, boost::asio::placeholders::error));
+        m_oTimer.async_wait(m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
+                                                       this, boost::asio::placeholders::error)));
     }
 
     // This will block until a byte is read
     // or until the it is cancelled.
-    m_oSocket.get_io_service().run();
+    m_oWaiter.wait();
 
-    return !m_bError;
+    return finishTransfer(true);
 }
 
 bool cInterruptibleBlockingUDPSocket::receiveFrom(char *cpBuffer, uint32_t u32NBytes, std::string &strPeerAddress, uint16_t &u16PeerPort, uint32_t u32Timeout_ms)
@@ -239,114 +642,1359 @@ bool cInterruptibleBlockingUDPSocket::receiveFrom(char *cpBuffer, uint32_t u32NB
 
 bool cInterruptibleBlockingUDPSocket::receiveFrom(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms)
 {
+    //The drop counter only arrives as ancillary data
+    if(m_bDropCounting)
+    {
+        int64_t i64Timestamp_ns;
+        uint32_t u32SegmentSize_B;
+
+        return receiveMessage(cpBuffer, u32NBytes, oPeerEndpoint, i64Timestamp_ns, u32SegmentSize_B, u32Timeout_ms);
+    }
+
+#ifdef __linux__
+    if(m_pIOUring)
+        return ioUringReceive(cpBuffer, u32NBytes, &oPeerEndpoint, u32Timeout_ms);
+
+    if(m_pFastPathWaiter)
+        return fastReceive(cpBuffer, u32NBytes, &oPeerEndpoint, u32Timeout_ms);
+#endif
+
     //Necessary after a timeout:
-    m_oSocket.get_io_service().reset();
+    m_oWaiter.begin();
 
     //Asynchronously read characters into string
     m_oSocket.async_receive_from( boost::asio::buffer(cpBuffer, u32NBytes),
                                   oPeerEndpoint,
-                                  boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
-                                              this,
-                                              boost::asio::placeholders::error,
-                                              boost::asio::placeholders::bytes_transferred) );
+                                  m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_complete,
+                                                             this,
+                                                             boost::asio::placeholders::error,
+                                                             boost::asio::placeholders::bytes_transferred)) );
 
     // Setup a deadline time to implement our timeout.
     if(u32Timeout_ms)
     {
         m_oTimer.expires_from_now(boost::posix_time::milliseconds(u32Timeout_ms));
-        m_oTimer.async_wait(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
-                                        this, boost::asio::placeholders::error));
+        m_oTimer.async_wait(m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
+                                                       this, boost::asio::placeholders::error)));
     }
 
     // This will block until a byte is read
     // or until the it is cancelled.
-    m_oSocket.get_io_service().run();
+    m_oWaiter.wait();
 
-    return !m_bError;
+    return finishTransfer(true);
 }
 
-
-void cInterruptibleBlockingUDPSocket::callback_complete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred)
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+boost::asio::awaitable<bool> cInterruptibleBlockingUDPSocket::asyncSendTo(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint,
+                                                                          uint32_t u32Timeout_ms, cCancellationToken *pToken)
 {
-    m_bError = oError || (u32NBytesTransferred == 0);
-    m_oTimer.cancel();
+    if(m_pOwnedIOService)
+    {
+        cout << "cInterruptibleBlockingUDPSocket::asyncSendTo(): Coroutine calls need a socket on a shared io_service" << endl;
+        setTransferResult(boost::asio::error::operation_not_supported, 0);
+        co_return false;
+    }
 
-    m_u32NBytesLastTransferred = u32NBytesTransferred;
-    m_oLastError = oError;
-}
+    bool bZeroCopy = prepareZeroCopySend(u32NBytes);
 
-void cInterruptibleBlockingUDPSocket::callback_timeOut(const boost::system::error_code& oError)
-{
-    if (oError)
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
+
+    boost::system::error_code oError = oDeadline.getStopError();
+    uint32_t u32NBytesSent = 0;
+
+    //The system call of fastSend(), waiting on the io_service when the socket isn't ready
+    while(!oError)
     {
-        m_oLastError = oError;
-        return;
+        oError = trySendDatagram(cpBuffer, u32NBytes, &oPeerEndpoint, bZeroCopy, u32NBytesSent);
+
+        if(oError != boost::asio::error::would_block)
+            break;
+
+        co_await m_oAsyncSendReadiness.asyncWait(m_oSocket, boost::asio::socket_base::wait_write, oDeadline,
+                                                 boost::asio::redirect_error(boost::asio::use_awaitable, oError));
+
+#ifdef __linux__
+        reapZeroCopyCompletions();
+#endif
     }
 
-    std::cout << "!!! Time out reached on socket \"" << m_strName << "\" (" << this << ")" << std::endl;
+    setTransferResult(oError, u32NBytesSent);
 
-    m_oSocket.cancel();
+    co_return finishTransfer(false);
 }
 
-void cInterruptibleBlockingUDPSocket::cancelCurrrentOperations()
-{   
-    try
+boost::asio::awaitable<bool> cInterruptibleBlockingUDPSocket::asyncReceiveFrom(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint,
+                                                                               uint32_t u32Timeout_ms, cCancellationToken *pToken)
+{
+    if(m_pOwnedIOService)
     {
-        m_oSocket.get_io_service().stop();
-        m_oSocket.cancel();
-        m_oTimer.cancel();
+        cout << "cInterruptibleBlockingUDPSocket::asyncReceiveFrom(): Coroutine calls need a socket on a shared io_service" << endl;
+        setTransferResult(boost::asio::error::operation_not_supported, 0);
+        co_return false;
     }
-    catch(boost::system::system_error &e)
+
+    cAwaitableDeadline oDeadline(co_await boost::asio::this_coro::executor, u32Timeout_ms, pToken);
+
+    boost::system::error_code oError = oDeadline.getStopError();
+    uint32_t u32NBytesReceived = 0;
+
+    //The system call of fastReceive(), waiting on the io_service when there is nothing to receive
+    while(!oError)
     {
-        //Catch special conditions where socket is trying to be opened etc.
-        //Prevents crash.
+        oError = tryReceiveDatagram(cpBuffer, u32NBytes, &oPeerEndpoint, u32NBytesReceived);
+
+        if(oError != boost::asio::error::would_block)
+            break;
+
+        co_await m_oAsyncReceiveReadiness.asyncWait(m_oSocket, boost::asio::socket_base::wait_read, oDeadline,
+                                                    boost::asio::redirect_error(boost::asio::use_awaitable, oError));
     }
-}
 
-boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::createEndpoint(string strHostAddress, uint16_t u16Port)
-{
-    stringstream oSS;
-    oSS << u16Port;
+    setTransferResult(oError, u32NBytesReceived);
 
-    return *m_oResolver.resolve(boost::asio::ip::udp::resolver::query(boost::asio::ip::udp::v4(), strHostAddress, oSS.str()));
+    co_return finishTransfer(true);
 }
+#endif
 
-std::string cInterruptibleBlockingUDPSocket::getEndpointHostAddress(boost::asio::ip::udp::endpoint oEndpoint) const
+cInterruptibleBlockingUDPSocket::cSendEntry::cSendEntry(const char *cpBuffer, uint32_t u32NBytes) :
+    m_cpBuffer(cpBuffer),
+    m_u32NBytes(u32NBytes),
+    m_bUsePeerEndpoint(false)
 {
-    return oEndpoint.address().to_string();
 }
 
-uint16_t cInterruptibleBlockingUDPSocket::getEndpointPort(boost::asio::ip::udp::endpoint oEndpoint) const
+cInterruptibleBlockingUDPSocket::cSendEntry::cSendEntry(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint) :
+    m_cpBuffer(cpBuffer),
+    m_u32NBytes(u32NBytes),
+    m_bUsePeerEndpoint(true),
+    m_oPeerEndpoint(oPeerEndpoint)
 {
-    return oEndpoint.port();
 }
 
-boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::getLocalEndpoint() const
+bool cInterruptibleBlockingUDPSocket::receiveBatch(vector<cReceiveSlot> &voSlots, uint32_t u32Timeout_ms)
 {
-    return m_oLocalEndpoint;
-}
+    m_u32NBytesLastTransferred = 0;
+    m_u32NDatagramsLastTransferred = 0;
 
-std::string cInterruptibleBlockingUDPSocket::getLocalInterface() const
-{
-    return getEndpointHostAddress(m_oLocalEndpoint);
-}
+    if(voSlots.empty())
+        return true;
 
-uint16_t cInterruptibleBlockingUDPSocket::getLocalPort() const
-{
-    return getEndpointPort(m_oLocalEndpoint);
-}
+    //Fast path: if datagrams are already queued in the kernel pick them up without an io_service cycle
+    if(tryReceiveBatch(voSlots))
+        return true;
 
-boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::getPeerEndpoint() const
-{
-    return m_oPeerEndpoint;
-}
+    if(m_oLastError != boost::asio::error::would_block)
+        return false;
 
-std::string cInterruptibleBlockingUDPSocket::getPeerAddress() const
-{
-    return getEndpointHostAddress(m_oPeerEndpoint);
+    //Nothing queued yet. Wait for the socket to become readable (this honours the timeout and
+    //cancelCurrrentOperations()) and then drain as much as possible in one system call.
+    //A readable socket can still yield EAGAIN (e.g. a datagram dropped on checksum) so loop on that
+    //case with whatever is left of the timeout.
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    for(;;)
+    {
+        if(!waitUntilReady(false, u32Timeout_ms, oStartTime))
+            return false;
+
+        if(tryReceiveBatch(voSlots))
+            return true;
+
+        if(m_oLastError != boost::asio::error::would_block)
+            return false;
+    }
 }
 
-uint16_t cInterruptibleBlockingUDPSocket::getPeerPort() const
+bool cInterruptibleBlockingUDPSocket::tryReceiveBatch(vector<cReceiveSlot> &voSlots)
+{
+#ifdef __linux__
+    uint32_t u32NSlots = voSlots.size();
+
+    if(m_voReceiveBatchHeaders.size() < u32NSlots)
+    {
+        m_voReceiveBatchHeaders.resize(u32NSlots);
+        m_voReceiveBatchIOVecs.resize(u32NSlots);
+        m_vcReceiveBatchControl.resize(u32NSlots * CONTROL_BUFFER_SIZE_B);
+    }
+
+    for(uint32_t u32SlotNo = 0; u32SlotNo < u32NSlots; u32SlotNo++)
+    {
+        cReceiveSlot &oSlot = voSlots[u32SlotNo];
+
+        m_voReceiveBatchIOVecs[u32SlotNo].iov_base = oSlot.m_cpBuffer;
+        m_voReceiveBatchIOVecs[u32SlotNo].iov_len = oSlot.m_u32BufferSize;
+
+        //The kernel writes the source address straight into the slot's endpoint
+        msghdr &oHeader = m_voReceiveBatchHeaders[u32SlotNo].msg_hdr;
+        oHeader.msg_name = oSlot.m_oPeerEndpoint.data();
+        oHeader.msg_namelen = oSlot.m_oPeerEndpoint.capacity();
+        oHeader.msg_iov = &m_voReceiveBatchIOVecs[u32SlotNo];
+        oHeader.msg_iovlen = 1;
+        //Only ask for ancillary data if something has been enabled. It costs an extra copy per datagram.
+        if(m_bKernelTimestamps || m_bGRO || m_bDropCounting)
+        {
+            oHeader.msg_control = &m_vcReceiveBatchControl[u32SlotNo * CONTROL_BUFFER_SIZE_B];
+            oHeader.msg_controllen = CONTROL_BUFFER_SIZE_B;
+        }
+        else
+        {
+            oHeader.msg_control = NULL;
+            oHeader.msg_controllen = 0;
+        }
+        oHeader.msg_flags = 0;
+    }
+
+    int iNReceived = recvmmsg(m_oSocket.native_handle(), &m_voReceiveBatchHeaders.front(), u32NSlots, MSG_DONTWAIT, NULL);
+
+    if(iNReceived < 0)
+    {
+        m_bError = true;
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            m_oLastError = boost::asio::error::would_block;
+        else
+            m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+        return false;
+    }
+
+    for(int iSlotNo = 0; iSlotNo < iNReceived; iSlotNo++)
+    {
+        voSlots[iSlotNo].m_u32NBytesReceived = m_voReceiveBatchHeaders[iSlotNo].msg_len;
+        voSlots[iSlotNo].m_bTruncated = (m_voReceiveBatchHeaders[iSlotNo].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        voSlots[iSlotNo].m_oPeerEndpoint.resize(m_voReceiveBatchHeaders[iSlotNo].msg_hdr.msg_namelen);
+        parseControlMessages(m_voReceiveBatchHeaders[iSlotNo].msg_hdr, voSlots[iSlotNo].m_i64Timestamp_ns, voSlots[iSlotNo].m_u32SegmentSize_B);
+        if(!voSlots[iSlotNo].m_u32SegmentSize_B)
+            voSlots[iSlotNo].m_u32SegmentSize_B = voSlots[iSlotNo].m_u32NBytesReceived;
+
+        m_u32NBytesLastTransferred += m_voReceiveBatchHeaders[iSlotNo].msg_len;
+    }
+
+    m_u32NDatagramsLastTransferred = iNReceived;
+    m_bError = false;
+    m_oLastError = boost::system::error_code();
+
+    countTransfer(true, m_u32NDatagramsLastTransferred, m_u32NBytesLastTransferred);
+
+    return true;
+#else
+    //No recvmmsg on this platform. Emulate with non-blocking single datagram reads.
+    boost::system::error_code oEC, oModeEC;
+    bool bNonBlocking = m_oSocket.non_blocking();
+    m_oSocket.non_blocking(true, oModeEC);
+
+    for(uint32_t u32SlotNo = 0; u32SlotNo < voSlots.size(); u32SlotNo++)
+    {
+        cReceiveSlot &oSlot = voSlots[u32SlotNo];
+
+        oSlot.m_u32NBytesReceived = m_oSocket.receive_from(boost::asio::buffer(oSlot.m_cpBuffer, oSlot.m_u32BufferSize), oSlot.m_oPeerEndpoint, 0, oEC);
+        if(oEC)
+            break;
+
+        oSlot.m_u32SegmentSize_B = oSlot.m_u32NBytesReceived;
+        m_u32NBytesLastTransferred += oSlot.m_u32NBytesReceived;
+        m_u32NDatagramsLastTransferred++;
+    }
+
+    m_oSocket.non_blocking(bNonBlocking, oModeEC);
+
+    m_bError = !m_u32NDatagramsLastTransferred;
+    m_oLastError = m_u32NDatagramsLastTransferred ? boost::system::error_code() : oEC;
+
+    countTransfer(true, m_u32NDatagramsLastTransferred, m_u32NBytesLastTransferred);
+
+    return !m_bError;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::setKernelTimestampsEnabled(bool bEnabled)
+{
+#ifdef SO_TIMESTAMPNS
+    boost::system::error_code oEC;
+    m_oSocket.set_option( boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_TIMESTAMPNS>(bEnabled), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::setKernelTimestampsEnabled(): Error setting SO_TIMESTAMPNS: " << oEC.message() << endl;
+        return false;
+    }
+
+    m_bKernelTimestamps = bEnabled;
+    return true;
+#else
+    cout << "cInterruptibleBlockingUDPSocket::setKernelTimestampsEnabled(): Kernel timestamps are not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::receiveFromTimestamped(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t u32Timeout_ms)
+{
+    m_u32NBytesLastTransferred = 0;
+    m_u32NDatagramsLastTransferred = 0;
+
+    if(!m_bKernelTimestamps && !setKernelTimestampsEnabled(true))
+        return false;
+
+    uint32_t u32SegmentSize_B;
+
+    return receiveMessage(cpBuffer, u32NBytes, oPeerEndpoint, i64Timestamp_ns, u32SegmentSize_B, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingUDPSocket::receiveMessage(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B, uint32_t u32Timeout_ms)
+{
+    m_u32NBytesLastTransferred = 0;
+    m_u32NDatagramsLastTransferred = 0;
+
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+    //Read directly if a datagram is queued, otherwise wait for one to arrive (honouring timeout and cancellation)
+    for(;;)
+    {
+        if(tryReceiveMessage(cpBuffer, u32NBytes, oPeerEndpoint, i64Timestamp_ns, u32SegmentSize_B))
+            return true;
+
+        if(m_oLastError != boost::asio::error::would_block)
+            return false;
+
+        if(!waitUntilReady(false, u32Timeout_ms, oStartTime))
+            return false;
+    }
+}
+
+bool cInterruptibleBlockingUDPSocket::tryReceiveMessage(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B)
+{
+    i64Timestamp_ns = 0;
+    u32SegmentSize_B = 0;
+
+#ifdef __linux__
+    iovec oIOVec;
+    oIOVec.iov_base = cpBuffer;
+    oIOVec.iov_len = u32NBytes;
+
+    char acControl[CONTROL_BUFFER_SIZE_B];
+
+    msghdr oHeader;
+    oHeader.msg_name = oPeerEndpoint.data();
+    oHeader.msg_namelen = oPeerEndpoint.capacity();
+    oHeader.msg_iov = &oIOVec;
+    oHeader.msg_iovlen = 1;
+    oHeader.msg_control = acControl;
+    oHeader.msg_controllen = sizeof(acControl);
+    oHeader.msg_flags = 0;
+
+    ssize_t iNReceived = recvmsg(m_oSocket.native_handle(), &oHeader, MSG_DONTWAIT);
+
+    if(iNReceived < 0)
+    {
+        m_bError = true;
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            m_oLastError = boost::asio::error::would_block;
+        else
+            m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+        return false;
+    }
+
+    oPeerEndpoint.resize(oHeader.msg_namelen);
+    parseControlMessages(oHeader, i64Timestamp_ns, u32SegmentSize_B);
+    if(!u32SegmentSize_B)
+        u32SegmentSize_B = iNReceived;
+
+    //As for receive() an empty datagram counts as an error
+    m_u32NBytesLastTransferred = iNReceived;
+    m_u32NDatagramsLastTransferred = 1;
+    m_bError = (iNReceived == 0);
+    m_oLastError = boost::system::error_code();
+
+    //The rest of the datagram, or of the datagrams GRO coalesced, was discarded. The part that fit is still reported.
+    if(oHeader.msg_flags & MSG_TRUNC)
+    {
+        m_bError = true;
+        m_oLastError = boost::asio::error::message_size;
+    }
+
+    return finishTransfer(true);
+#else
+    boost::system::error_code oModeEC;
+    bool bNonBlocking = m_oSocket.non_blocking();
+    m_oSocket.non_blocking(true, oModeEC);
+
+    m_u32NBytesLastTransferred = m_oSocket.receive_from(boost::asio::buffer(cpBuffer, u32NBytes), oPeerEndpoint, 0, m_oLastError);
+
+    m_oSocket.non_blocking(bNonBlocking, oModeEC);
+
+    m_bError = m_oLastError || !m_u32NBytesLastTransferred;
+    m_u32NDatagramsLastTransferred = m_bError ? 0 : 1;
+    u32SegmentSize_B = m_u32NBytesLastTransferred;
+
+    return finishTransfer(true);
+#endif
+}
+
+#ifdef __linux__
+void cInterruptibleBlockingUDPSocket::parseControlMessages(const msghdr &oHeader, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B)
+{
+    i64Timestamp_ns = 0;
+    u32SegmentSize_B = 0;
+
+    if(!oHeader.msg_controllen)
+        return;
+
+    for(cmsghdr *pMessage = CMSG_FIRSTHDR(&oHeader); pMessage; pMessage = CMSG_NXTHDR(const_cast<msghdr*>(&oHeader), pMessage))
+    {
+        if(pMessage->cmsg_level == SOL_SOCKET && pMessage->cmsg_type == SO_TIMESTAMPNS)
+        {
+            timespec oTimestamp;
+            memcpy(&oTimestamp, CMSG_DATA(pMessage), sizeof(oTimestamp));
+            i64Timestamp_ns = (int64_t)oTimestamp.tv_sec * 1000000000LL + oTimestamp.tv_nsec;
+        }
+#ifdef SO_RXQ_OVFL
+        else if(pMessage->cmsg_level == SOL_SOCKET && pMessage->cmsg_type == SO_RXQ_OVFL)
+        {
+            memcpy(&m_oStatistics.m_u32NKernelDrops, CMSG_DATA(pMessage), sizeof(m_oStatistics.m_u32NKernelDrops));
+        }
+#endif
+#ifdef UDP_GRO
+        else if(pMessage->cmsg_level == SOL_UDP && pMessage->cmsg_type == UDP_GRO)
+        {
+            int iSegmentSize_B;
+            memcpy(&iSegmentSize_B, CMSG_DATA(pMessage), sizeof(iSegmentSize_B));
+            u32SegmentSize_B = iSegmentSize_B;
+        }
+#endif
+    }
+}
+#endif
+
+bool cInterruptibleBlockingUDPSocket::setGROEnabled(bool bEnabled)
+{
+#if defined(__linux__) && defined(UDP_GRO)
+    boost::system::error_code oEC;
+    m_oSocket.set_option( boost::asio::detail::socket_option::boolean<SOL_UDP, UDP_GRO>(bEnabled), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::setGROEnabled(): Error setting UDP_GRO: " << oEC.message() << endl;
+        return false;
+    }
+
+    m_bGRO = bEnabled;
+    return true;
+#else
+    cout << "cInterruptibleBlockingUDPSocket::setGROEnabled(): UDP GRO is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::receiveCoalesced(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t &u32SegmentSize_B, uint32_t u32Timeout_ms)
+{
+    u32SegmentSize_B = 0;
+
+    //Without GRO support this still works, 1 datagram at a time
+    if(!m_bGRO)
+        setGROEnabled(true);
+
+    int64_t i64Timestamp_ns;
+
+    if(!receiveMessage(cpBuffer, u32NBytes, oPeerEndpoint, i64Timestamp_ns, u32SegmentSize_B, u32Timeout_ms))
+        return false;
+
+    m_u32NDatagramsLastTransferred = (m_u32NBytesLastTransferred + u32SegmentSize_B - 1) / u32SegmentSize_B;
+    return true;
+}
+
+bool cInterruptibleBlockingUDPSocket::sendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, uint32_t u32Timeout_ms)
+{
+    return sendSegmented(cpBuffer, u32NBytes, u32SegmentSize_B, NULL, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingUDPSocket::sendToSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    return sendSegmented(cpBuffer, u32NBytes, u32SegmentSize_B, &oPeerEndpoint, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingUDPSocket::sendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    m_u32NBytesLastTransferred = 0;
+    m_u32NDatagramsLastTransferred = 0;
+
+    if(!u32SegmentSize_B || u32SegmentSize_B > MAX_UDP_PAYLOAD_SIZE_B)
+    {
+        m_bError = true;
+        m_oLastError = boost::asio::error::invalid_argument;
+        cout << "cInterruptibleBlockingUDPSocket::sendSegmented(): Invalid segment size " << u32SegmentSize_B << endl;
+        return false;
+    }
+
+    uint32_t u32NBytesSent = 0;
+    uint32_t u32NDatagramsSent = 0;
+    boost::posix_time::ptime oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    //Each system call carries as many whole segments as fit in one UDP payload
+    uint32_t u32MaxSegmentsPerSend = MAX_UDP_PAYLOAD_SIZE_B / u32SegmentSize_B;
+    if(u32MaxSegmentsPerSend > MAX_SEGMENTS_PER_SEND)
+        u32MaxSegmentsPerSend = MAX_SEGMENTS_PER_SEND;
+
+    uint32_t u32MaxBytesPerSend = u32MaxSegmentsPerSend * u32SegmentSize_B;
+
+    while(!m_bSegmentationRefused && u32NBytesSent < u32NBytes)
+    {
+        uint32_t u32NBytesThisSend = u32NBytes - u32NBytesSent;
+        if(u32NBytesThisSend > u32MaxBytesPerSend)
+            u32NBytesThisSend = u32MaxBytesPerSend;
+
+        if(trySendSegmented(cpBuffer + u32NBytesSent, u32NBytesThisSend, u32SegmentSize_B, pPeerEndpoint))
+        {
+            uint32_t u32NDatagramsThisSend = (u32NBytesThisSend + u32SegmentSize_B - 1) / u32SegmentSize_B;
+
+            u32NBytesSent += u32NBytesThisSend;
+            u32NDatagramsSent += u32NDatagramsThisSend;
+            countTransfer(false, u32NDatagramsThisSend, u32NBytesThisSend);
+            continue;
+        }
+
+        //Report progress on failure as well
+        m_u32NBytesLastTransferred = u32NBytesSent;
+        m_u32NDatagramsLastTransferred = u32NDatagramsSent;
+
+        //The headers know UDP_SEGMENT but the kernel (or the device, without checksum offload) doesn't support it
+        if(m_oLastError == boost::asio::error::invalid_argument || m_oLastError == boost::asio::error::no_protocol_option
+                || m_oLastError.value() == EIO)
+        {
+            cout << "cInterruptibleBlockingUDPSocket::sendSegmented(): UDP_SEGMENT refused (" << m_oLastError.message()
+                 << "). Sending segments as separate datagrams from now on." << endl;
+            m_bSegmentationRefused = true;
+            break;
+        }
+
+        if(m_oLastError != boost::asio::error::would_block)
+            return false;
+
+        if(!waitUntilReady(true, u32Timeout_ms, oStartTime))
+            return false;
+    }
+
+    if(u32NBytesSent == u32NBytes)
+    {
+        m_u32NBytesLastTransferred = u32NBytesSent;
+        m_u32NDatagramsLastTransferred = u32NDatagramsSent;
+        m_bError = false;
+        m_oLastError = boost::system::error_code();
+
+        return true;
+    }
+#endif
+
+    //No segmentation offload. Send the rest with what is left of the timeout.
+    uint32_t u32RemainingTimeout_ms = 0;
+
+    if(u32Timeout_ms)
+    {
+        boost::posix_time::time_duration oRemaining = oStartTime + boost::posix_time::milliseconds(u32Timeout_ms)
+                - boost::posix_time::microsec_clock::universal_time();
+
+        if(oRemaining.total_milliseconds() <= 0)
+        {
+            m_bError = true;
+            m_oLastError = boost::asio::error::timed_out;
+            return false;
+        }
+
+        u32RemainingTimeout_ms = oRemaining.total_milliseconds();
+    }
+
+    bool bSent = sendSegmentsSeparately(cpBuffer + u32NBytesSent, u32NBytes - u32NBytesSent, u32SegmentSize_B, pPeerEndpoint, u32RemainingTimeout_ms);
+
+    m_u32NBytesLastTransferred += u32NBytesSent;
+    m_u32NDatagramsLastTransferred += u32NDatagramsSent;
+
+    return bSent;
+}
+
+bool cInterruptibleBlockingUDPSocket::sendSegmentsSeparately(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    vector<cSendEntry> voEntries;
+
+    for(uint32_t u32Offset = 0; u32Offset < u32NBytes; u32Offset += u32SegmentSize_B)
+    {
+        uint32_t u32NBytesThisSegment = u32NBytes - u32Offset < u32SegmentSize_B ? u32NBytes - u32Offset : u32SegmentSize_B;
+
+        if(pPeerEndpoint)
+            voEntries.push_back(cSendEntry(cpBuffer + u32Offset, u32NBytesThisSegment, *pPeerEndpoint));
+        else
+            voEntries.push_back(cSendEntry(cpBuffer + u32Offset, u32NBytesThisSegment));
+    }
+
+    return sendBatch(voEntries, u32Timeout_ms);
+}
+
+bool cInterruptibleBlockingUDPSocket::trySendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint)
+{
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    iovec oIOVec;
+    oIOVec.iov_base = const_cast<char*>(cpBuffer);
+    oIOVec.iov_len = u32NBytes;
+
+    //Aligned storage for the UDP_SEGMENT control message
+    union
+    {
+        char acBuffer[CMSG_SPACE(sizeof(uint16_t))];
+        cmsghdr oAlign;
+    } oControl;
+    memset(&oControl, 0, sizeof(oControl));
+
+    msghdr oHeader;
+    oHeader.msg_name = pPeerEndpoint ? const_cast<sockaddr*>(pPeerEndpoint->data()) : NULL;
+    oHeader.msg_namelen = pPeerEndpoint ? pPeerEndpoint->size() : 0;
+    oHeader.msg_iov = &oIOVec;
+    oHeader.msg_iovlen = 1;
+    oHeader.msg_control = oControl.acBuffer;
+    oHeader.msg_controllen = sizeof(oControl.acBuffer);
+    oHeader.msg_flags = 0;
+
+    cmsghdr *pMessage = CMSG_FIRSTHDR(&oHeader);
+    pMessage->cmsg_level = SOL_UDP;
+    pMessage->cmsg_type = UDP_SEGMENT;
+    pMessage->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t u16SegmentSize_B = u32SegmentSize_B;
+    memcpy(CMSG_DATA(pMessage), &u16SegmentSize_B, sizeof(u16SegmentSize_B));
+
+    ssize_t iNSent = sendmsg(m_oSocket.native_handle(), &oHeader, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+    if(iNSent < 0)
+    {
+        m_bError = true;
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            m_oLastError = boost::asio::error::would_block;
+        else
+            m_oLastError = boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+        return false;
+    }
+
+    return true;
+#else
+    //Only called when segmentation offload is available
+    m_bError = true;
+    m_oLastError = boost::asio::error::operation_not_supported;
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::setFastPathEnabled(bool bEnabled)
+{
+#ifdef __linux__
+    if(bEnabled && !m_pFastPathWaiter)
+        m_pFastPathWaiter.reset(new cSocketReadinessWaiter);
+    else if(!bEnabled)
+        m_pFastPathWaiter.reset();
+
+    return true;
+#else
+    cout << "cInterruptibleBlockingUDPSocket::setFastPathEnabled(): The fast path is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::isFastPathEnabled() const
+{
+#ifdef __linux__
+    return m_pFastPathWaiter.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::setIOUringEnabled(bool bEnabled, uint32_t u32NReceiveBuffers, uint32_t u32MaxDatagramSize_B)
+{
+#ifdef __linux__
+    if(bEnabled && !m_pIOUring)
+    {
+        if(!cIOUring::isSupported())
+        {
+            cout << "cInterruptibleBlockingUDPSocket::setIOUringEnabled(): io_uring is not available, keeping the current path." << endl;
+            return false;
+        }
+
+        m_pIOUring.reset(new cIOUring);
+
+        if(!m_pIOUring->isOpen() || (u32NReceiveBuffers && !m_pIOUring->setupReceiveBuffers(u32NReceiveBuffers, u32MaxDatagramSize_B)))
+        {
+            cout << "cInterruptibleBlockingUDPSocket::setIOUringEnabled(): Failed to set up the ring, keeping the current path." << endl;
+
+            m_pIOUring.reset();
+            return false;
+        }
+    }
+    else if(!bEnabled)
+    {
+        //Stops any multishot receive. Datagrams it received but weren't taken yet are lost.
+        m_pIOUring.reset();
+    }
+
+    return true;
+#else
+    cout << "cInterruptibleBlockingUDPSocket::setIOUringEnabled(): io_uring is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::isIOUringEnabled() const
+{
+#ifdef __linux__
+    return m_pIOUring.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::setZeroCopyEnabled(bool bEnabled, uint32_t u32Threshold_B)
+{
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+    {
+        m_pZeroCopyTracker->reap(m_oSocket.native_handle());
+
+        if(m_pZeroCopyTracker->getNPending())
+        {
+            cout << "cInterruptibleBlockingUDPSocket::setZeroCopyEnabled(): Zero copy sends are still pending. Call waitForZeroCopyCompletions() first." << endl;
+            return false;
+        }
+    }
+
+    if(!bEnabled)
+    {
+        m_pZeroCopyTracker.reset();
+        return true;
+    }
+
+    boost::system::error_code oError = cZeroCopySendTracker::enable(m_oSocket.native_handle());
+    if(oError)
+    {
+        m_oLastError = oError;
+        cout << "cInterruptibleBlockingUDPSocket::setZeroCopyEnabled(): Unable to enable SO_ZEROCOPY: " << oError.message() << endl;
+        return false;
+    }
+
+    m_pZeroCopyTracker.reset(new cZeroCopySendTracker(u32Threshold_B));
+    return true;
+#else
+    (void)u32Threshold_B;
+    cout << "cInterruptibleBlockingUDPSocket::setZeroCopyEnabled(): Zero copy sends are not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::isZeroCopyEnabled() const
+{
+#ifdef __linux__
+    return m_pZeroCopyTracker.get() != NULL;
+#else
+    return false;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::waitForZeroCopyCompletions(uint32_t u32Timeout_ms)
+{
+#ifdef __linux__
+    if(!m_pZeroCopyTracker)
+        return true;
+
+    boost::system::error_code oError = m_pZeroCopyTracker->waitForCompletions(m_oSocket.native_handle(), cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms));
+    if(oError)
+    {
+        m_bError = true;
+        m_oLastError = oError;
+        return false;
+    }
+#else
+    (void)u32Timeout_ms;
+#endif
+
+    return true;
+}
+
+uint32_t cInterruptibleBlockingUDPSocket::getNZeroCopySendsPending()
+{
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+    {
+        m_pZeroCopyTracker->reap(m_oSocket.native_handle());
+        return m_pZeroCopyTracker->getNPending();
+    }
+#endif
+
+    return 0;
+}
+
+uint64_t cInterruptibleBlockingUDPSocket::getNZeroCopySendsCopied() const
+{
+#ifdef __linux__
+    if(m_pZeroCopyTracker)
+        return m_pZeroCopyTracker->getNCopied();
+#endif
+
+    return 0;
+}
+
+#ifdef __linux__
+bool cInterruptibleBlockingUDPSocket::fastSend(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    //Only read the clock if we actually have to wait
+    boost::posix_time::ptime oStartTime;
+
+    bool bZeroCopy = prepareZeroCopySend(u32NBytes);
+
+    for(;;)
+    {
+        uint32_t u32NBytesSent;
+        boost::system::error_code oError = trySendDatagram(cpBuffer, u32NBytes, pPeerEndpoint, bZeroCopy, u32NBytesSent);
+
+        if(oError != boost::asio::error::would_block)
+        {
+            //As in callback_complete() no bytes transferred counts as an error
+            setTransferResult(oError, u32NBytesSent);
+            return finishTransfer(false);
+        }
+
+        if(oStartTime.is_not_a_date_time())
+            oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        if(!waitUntilReady(true, u32Timeout_ms, oStartTime))
+            return false;
+    }
+}
+
+bool cInterruptibleBlockingUDPSocket::fastReceive(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    //Only read the clock if we actually have to wait
+    boost::posix_time::ptime oStartTime;
+
+    for(;;)
+    {
+        uint32_t u32NBytesReceived;
+        boost::system::error_code oError = tryReceiveDatagram(cpBuffer, u32NBytes, pPeerEndpoint, u32NBytesReceived);
+
+        if(oError != boost::asio::error::would_block)
+        {
+            //As in callback_complete() no bytes transferred counts as an error
+            setTransferResult(oError, u32NBytesReceived);
+            return finishTransfer(true);
+        }
+
+        if(oStartTime.is_not_a_date_time())
+            oStartTime = boost::posix_time::microsec_clock::universal_time();
+
+        if(!waitUntilReady(false, u32Timeout_ms, oStartTime))
+            return false;
+    }
+}
+
+bool cInterruptibleBlockingUDPSocket::ioUringSend(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    int64_t i64Deadline_ns = cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms);
+    uint32_t u32NSent;
+
+    if(pPeerEndpoint)
+    {
+        iovec oIOVec;
+        oIOVec.iov_base = const_cast<char*>(cpBuffer);
+        oIOVec.iov_len = u32NBytes;
+
+        msghdr oHeader;
+        memset(&oHeader, 0, sizeof(oHeader));
+        oHeader.msg_name = const_cast<sockaddr*>(pPeerEndpoint->data());
+        oHeader.msg_namelen = pPeerEndpoint->size();
+        oHeader.msg_iov = &oIOVec;
+        oHeader.msg_iovlen = 1;
+
+        m_oLastError = m_pIOUring->sendMessage(m_oSocket.native_handle(), oHeader, u32NSent, i64Deadline_ns);
+    }
+    else
+    {
+        m_oLastError = m_pIOUring->send(m_oSocket.native_handle(), cpBuffer, u32NBytes, u32NSent, i64Deadline_ns);
+    }
+
+    //As in callback_complete() no bytes transferred counts as an error
+    m_u32NBytesLastTransferred = u32NSent;
+    m_u32NDatagramsLastTransferred = u32NSent ? 1 : 0;
+    m_bError = m_oLastError || !u32NSent;
+
+    return finishTransfer(false);
+}
+
+bool cInterruptibleBlockingUDPSocket::ioUringReceive(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms)
+{
+    int64_t i64Deadline_ns = cSocketReadinessWaiter::getDeadline_ns(u32Timeout_ms);
+    uint32_t u32NReceived;
+
+    if(m_pIOUring->hasReceiveBuffers())
+    {
+        sockaddr_storage oPeerAddress;
+        socklen_t iPeerAddressLength;
+
+        m_oLastError = m_pIOUring->receiveFrom(m_oSocket.native_handle(), cpBuffer, u32NBytes, u32NReceived, oPeerAddress, iPeerAddressLength, i64Deadline_ns);
+
+        if(!m_oLastError && pPeerEndpoint)
+        {
+            iPeerAddressLength = min<socklen_t>(iPeerAddressLength, pPeerEndpoint->capacity());
+            memcpy(pPeerEndpoint->data(), &oPeerAddress, iPeerAddressLength);
+            pPeerEndpoint->resize(iPeerAddressLength);
+        }
+    }
+    else
+    {
+        iovec oIOVec;
+        oIOVec.iov_base = cpBuffer;
+        oIOVec.iov_len = u32NBytes;
+
+        msghdr oHeader;
+        memset(&oHeader, 0, sizeof(oHeader));
+        oHeader.msg_iov = &oIOVec;
+        oHeader.msg_iovlen = 1;
+
+        if(pPeerEndpoint)
+        {
+            oHeader.msg_name = pPeerEndpoint->data();
+            oHeader.msg_namelen = pPeerEndpoint->capacity();
+        }
+
+        m_oLastError = m_pIOUring->receiveMessage(m_oSocket.native_handle(), oHeader, u32NReceived, i64Deadline_ns);
+
+        if(!m_oLastError && pPeerEndpoint)
+            pPeerEndpoint->resize(oHeader.msg_namelen);
+    }
+
+    //As in callback_complete() no bytes transferred counts as an error
+    m_u32NBytesLastTransferred = u32NReceived;
+    m_u32NDatagramsLastTransferred = u32NReceived ? 1 : 0;
+    m_bError = m_oLastError || !u32NReceived;
+
+    return finishTransfer(true);
+}
+
+void cInterruptibleBlockingUDPSocket::reapZeroCopyCompletions()
+{
+    if(m_pZeroCopyTracker)
+        m_pZeroCopyTracker->reap(m_oSocket.native_handle());
+}
+#endif
+
+bool cInterruptibleBlockingUDPSocket::prepareZeroCopySend(uint32_t u32NBytes)
+{
+#ifdef __linux__
+    if(m_pZeroCopyTracker && m_pZeroCopyTracker->isWorthwhile(u32NBytes))
+    {
+        //Keep the pending count current without waiting
+        m_pZeroCopyTracker->reap(m_oSocket.native_handle());
+        return true;
+    }
+#else
+    (void)u32NBytes;
+#endif
+
+    return false;
+}
+
+boost::system::error_code cInterruptibleBlockingUDPSocket::trySendDatagram(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint,
+                                                                           bool &bZeroCopy, uint32_t &u32NBytesSent)
+{
+    u32NBytesSent = 0;
+
+#ifdef __linux__
+    for(;;)
+    {
+        int iFlags = MSG_DONTWAIT | MSG_NOSIGNAL | (bZeroCopy ? MSG_ZEROCOPY : 0);
+        ssize_t iNSent;
+
+        if(pPeerEndpoint)
+            iNSent = sendto(m_oSocket.native_handle(), cpBuffer, u32NBytes, iFlags, pPeerEndpoint->data(), pPeerEndpoint->size());
+        else
+            iNSent = ::send(m_oSocket.native_handle(), cpBuffer, u32NBytes, iFlags);
+
+        if(iNSent >= 0)
+        {
+            if(iNSent > 0 && bZeroCopy)
+                m_pZeroCopyTracker->countSend();
+
+            u32NBytesSent = iNSent;
+            return boost::system::error_code();
+        }
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno == ENOBUFS && bZeroCopy)
+        {
+            //Too many zero copy sends outstanding for the socket's option memory. Copy this one instead.
+            bZeroCopy = false;
+            continue;
+        }
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return boost::asio::error::would_block;
+
+        return boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+#else
+    (void)bZeroCopy;
+
+    boost::system::error_code oError, oModeError;
+    bool bNonBlocking = m_oSocket.non_blocking();
+    m_oSocket.non_blocking(true, oModeError);
+
+    if(pPeerEndpoint)
+        u32NBytesSent = m_oSocket.send_to(boost::asio::buffer(cpBuffer, u32NBytes), *pPeerEndpoint, 0, oError);
+    else
+        u32NBytesSent = m_oSocket.send(boost::asio::buffer(cpBuffer, u32NBytes), 0, oError);
+
+    m_oSocket.non_blocking(bNonBlocking, oModeError);
+
+    return oError;
+#endif
+}
+
+boost::system::error_code cInterruptibleBlockingUDPSocket::tryReceiveDatagram(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint,
+                                                                              uint32_t &u32NBytesReceived)
+{
+    u32NBytesReceived = 0;
+
+#ifdef __linux__
+    for(;;)
+    {
+        ssize_t iNReceived;
+
+        if(pPeerEndpoint)
+        {
+            socklen_t oAddressLength = pPeerEndpoint->capacity();
+            iNReceived = recvfrom(m_oSocket.native_handle(), cpBuffer, u32NBytes, MSG_DONTWAIT, pPeerEndpoint->data(), &oAddressLength);
+
+            if(iNReceived >= 0)
+                pPeerEndpoint->resize(oAddressLength);
+        }
+        else
+        {
+            iNReceived = recv(m_oSocket.native_handle(), cpBuffer, u32NBytes, MSG_DONTWAIT);
+        }
+
+        if(iNReceived >= 0)
+        {
+            u32NBytesReceived = iNReceived;
+            return boost::system::error_code();
+        }
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return boost::asio::error::would_block;
+
+        return boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+#else
+    boost::system::error_code oError, oModeError;
+    bool bNonBlocking = m_oSocket.non_blocking();
+    m_oSocket.non_blocking(true, oModeError);
+
+    if(pPeerEndpoint)
+        u32NBytesReceived = m_oSocket.receive_from(boost::asio::buffer(cpBuffer, u32NBytes), *pPeerEndpoint, 0, oError);
+    else
+        u32NBytesReceived = m_oSocket.receive(boost::asio::buffer(cpBuffer, u32NBytes), 0, oError);
+
+    m_oSocket.non_blocking(bNonBlocking, oModeError);
+
+    return oError;
+#endif
+}
+
+bool cInterruptibleBlockingUDPSocket::waitUntilReady(bool bForWriting, uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime)
+{
+    //Batched calls may wait several times. The timeout applies to the call as a whole so only wait for what is left of it.
+    uint32_t u32RemainingTimeout_ms = 0;
+
+    if(u32Timeout_ms)
+    {
+        boost::posix_time::time_duration oRemaining = oStartTime + boost::posix_time::milliseconds(u32Timeout_ms)
+                - boost::posix_time::microsec_clock::universal_time();
+
+        if(oRemaining.total_milliseconds() <= 0)
+        {
+            m_bError = true;
+            m_oLastError = boost::asio::error::timed_out;
+            countInterruption();
+            return false;
+        }
+
+        u32RemainingTimeout_ms = oRemaining.total_milliseconds();
+    }
+
+#ifdef __linux__
+    if(m_pIOUring)
+    {
+        m_oLastError = m_pIOUring->waitUntilReady(m_oSocket.native_handle(), bForWriting, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bError = m_oLastError ? true : false;
+        reapZeroCopyCompletions();
+        countInterruption();
+
+        return !m_bError;
+    }
+
+    if(m_pFastPathWaiter)
+    {
+        m_oLastError = m_pFastPathWaiter->wait(m_oSocket.native_handle(), bForWriting, cSocketReadinessWaiter::getDeadline_ns(u32RemainingTimeout_ms));
+        m_bError = m_oLastError ? true : false;
+        reapZeroCopyCompletions();
+        countInterruption();
+
+        return !m_bError;
+    }
+#endif
+
+    //Necessary after a timeout:
+    m_oWaiter.begin();
+
+    //Assume the wait was interrupted unless the completion handler reports otherwise
+    m_bError = true;
+    m_oLastError = boost::asio::error::operation_aborted;
+
+    //A null buffers operation completes when the socket is ready without transferring any data
+    if(bForWriting)
+    {
+        m_oSocket.async_send( boost::asio::null_buffers(),
+                              m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_ready,
+                                                         this,
+                                                         boost::asio::placeholders::error)) );
+    }
+    else
+    {
+        m_oSocket.async_receive( boost::asio::null_buffers(),
+                                 m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_ready,
+                                                            this,
+                                                            boost::asio::placeholders::error)) );
+    }
+
+    // Setup a deadline time to implement our timeout.
+    if(u32RemainingTimeout_ms)
+    {
+        m_oTimer.expires_from_now(boost::posix_time::milliseconds(u32RemainingTimeout_ms));
+        m_oTimer.async_wait(m_oWaiter.wrap(boost::bind(&cInterruptibleBlockingUDPSocket::callback_timeOut,
+                                                       this, boost::asio::placeholders::error)));
+    }
+
+    // This will block until the socket is ready
+    // or until the it is cancelled.
+    m_oWaiter.wait();
+
+    countInterruption();
+
+    return !m_bError;
+}
+
+void cInterruptibleBlockingUDPSocket::callback_complete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred)
+{
+    setTransferResult(oError, u32NBytesTransferred);
+    m_oTimer.cancel();
+}
+
+void cInterruptibleBlockingUDPSocket::setTransferResult(const boost::system::error_code& oError, uint32_t u32NBytesTransferred)
+{
+    m_bError = oError || (u32NBytesTransferred == 0);
+
+    m_u32NBytesLastTransferred = u32NBytesTransferred;
+    m_u32NDatagramsLastTransferred = m_bError ? 0 : 1;
+    m_oLastError = oError;
+}
+
+void cInterruptibleBlockingUDPSocket::callback_ready(const boost::system::error_code& oError)
+{
+    m_bError = oError ? true : false;
+    m_oTimer.cancel();
+
+    m_oLastError = oError;
+}
+
+void cInterruptibleBlockingUDPSocket::callback_timeOut(const boost::system::error_code& oError)
+{
+    if (oError)
+    {
+        m_oLastError = oError;
+        return;
+    }
+
+    std::cout << "!!! Time out reached on socket \"" << m_strName << "\" (" << this << ")" << std::endl;
+
+    m_bTimedOut = true;
+    m_oSocket.cancel();
+}
+
+void cInterruptibleBlockingUDPSocket::countTransfer(bool bReceived, uint32_t u32NDatagrams, uint32_t u32NBytes)
+{
+    if(bReceived)
+    {
+        m_oStatistics.m_u64NDatagramsReceived += u32NDatagrams;
+        m_oStatistics.m_u64NBytesReceived += u32NBytes;
+    }
+    else
+    {
+        m_oStatistics.m_u64NDatagramsSent += u32NDatagrams;
+        m_oStatistics.m_u64NBytesSent += u32NBytes;
+    }
+}
+
+void cInterruptibleBlockingUDPSocket::countInterruption()
+{
+    //On the asio path a timeout also shows up as operation_aborted, hence the flag from callback_timeOut()
+    if(m_bError)
+    {
+        if(m_bTimedOut || m_oLastError == boost::asio::error::timed_out)
+            m_oStatistics.m_u64NTimeouts++;
+        else if(m_oLastError == boost::asio::error::operation_aborted)
+            m_oStatistics.m_u64NCancellations++;
+    }
+
+    m_bTimedOut = false;
+}
+
+bool cInterruptibleBlockingUDPSocket::finishTransfer(bool bReceived)
+{
+    if(!m_bError)
+        countTransfer(bReceived, m_u32NDatagramsLastTransferred, m_u32NBytesLastTransferred);
+
+    countInterruption();
+
+    return !m_bError;
+}
+
+bool cInterruptibleBlockingUDPSocket::setDropCountingEnabled(bool bEnabled)
+{
+#ifdef SO_RXQ_OVFL
+    boost::system::error_code oEC;
+    m_oSocket.set_option( boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_RXQ_OVFL>(bEnabled), oEC );
+
+    if(oEC)
+    {
+        m_oLastError = oEC;
+        cout << "cInterruptibleBlockingUDPSocket::setDropCountingEnabled(): Error setting SO_RXQ_OVFL: " << oEC.message() << endl;
+        return false;
+    }
+
+    m_bDropCounting = bEnabled;
+    return true;
+#else
+    cout << "cInterruptibleBlockingUDPSocket::setDropCountingEnabled(): Kernel drop counting is not supported on this platform." << endl;
+    return !bEnabled;
+#endif
+}
+
+uint32_t cInterruptibleBlockingUDPSocket::getNKernelDrops() const
+{
+    return m_oStatistics.m_u32NKernelDrops;
+}
+
+cInterruptibleBlockingUDPSocket::cStatistics cInterruptibleBlockingUDPSocket::getStatistics() const
+{
+    cStatistics oStatistics = m_oStatistics;
+
+    boost::system::error_code oEC;
+    boost::asio::socket_base::receive_buffer_size oReceiveBufferSize;
+    m_oSocket.get_option(oReceiveBufferSize, oEC);
+    if(!oEC)
+        oStatistics.m_u32ReceiveBufferSize_B = oReceiveBufferSize.value();
+
+    return oStatistics;
+}
+
+void cInterruptibleBlockingUDPSocket::resetStatistics()
+{
+    //The kernel's drop counter can't be reset so keep the last value seen
+    uint32_t u32NKernelDrops = m_oStatistics.m_u32NKernelDrops;
+
+    m_oStatistics = cStatistics();
+    m_oStatistics.m_u32NKernelDrops = u32NKernelDrops;
+}
+
+void cInterruptibleBlockingUDPSocket::cancelCurrrentOperations()
+{
+    m_oResolver.cancelCurrrentOperations();
+
+#ifdef __linux__
+    if(m_pFastPathWaiter)
+        m_pFastPathWaiter->cancel();
+
+    if(m_pIOUring)
+        m_pIOUring->cancel();
+
+    if(m_pZeroCopyTracker)
+        m_pZeroCopyTracker->cancel();
+#endif
+
+    m_oWaiter.cancel();
+}
+
+void cInterruptibleBlockingUDPSocket::cancelIO()
+{
+    try
+    {
+        m_oSocket.cancel();
+        m_oTimer.cancel();
+    }
+    catch(boost::system::system_error &e)
+    {
+        //Catch special conditions where socket is trying to be opened etc.
+        //Prevents crash.
+    }
+}
+
+boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::createEndpoint(string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms)
+{
+    boost::asio::ip::address oAddress;
+
+    //Throw on failure as the synchronous resolver used to
+    if(!m_oResolver.resolve(strHostAddress, oAddress, u32Timeout_ms))
+        throw boost::system::system_error(m_oResolver.getLastError());
+
+    return boost::asio::ip::udp::endpoint(oAddress, u16Port);
+}
+
+std::string cInterruptibleBlockingUDPSocket::getEndpointHostAddress(boost::asio::ip::udp::endpoint oEndpoint) const
+{
+    return oEndpoint.address().to_string();
+}
+
+uint16_t cInterruptibleBlockingUDPSocket::getEndpointPort(boost::asio::ip::udp::endpoint oEndpoint) const
+{
+    return oEndpoint.port();
+}
+
+boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::getLocalEndpoint() const
+{
+    return m_oLocalEndpoint;
+}
+
+std::string cInterruptibleBlockingUDPSocket::getLocalInterface() const
+{
+    return getEndpointHostAddress(m_oLocalEndpoint);
+}
+
+uint16_t cInterruptibleBlockingUDPSocket::getLocalPort() const
+{
+    return getEndpointPort(m_oLocalEndpoint);
+}
+
+boost::asio::ip::udp::endpoint cInterruptibleBlockingUDPSocket::getPeerEndpoint() const
+{
+    return m_oPeerEndpoint;
+}
+
+std::string cInterruptibleBlockingUDPSocket::getPeerAddress() const
+{
+    return getEndpointHostAddress(m_oPeerEndpoint);
+}
+
+uint16_t cInterruptibleBlockingUDPSocket::getPeerPort() const
 {
     return getEndpointPort(m_oPeerEndpoint);
 }
@@ -361,6 +2009,11 @@ uint32_t cInterruptibleBlockingUDPSocket::getNBytesLastTransferred() const
     return m_u32NBytesLastTransferred;
 }
 
+uint32_t cInterruptibleBlockingUDPSocket::getNDatagramsLastTransferred() const
+{
+    return m_u32NDatagramsLastTransferred;
+}
+
 boost::system::error_code cInterruptibleBlockingUDPSocket::getLastError() const
 {
     return m_oLastError;
@@ -17,40 +17,196 @@ typedef unsigned __int64 uint64_t;
 #include <inttypes.h>
 #endif
 
+#include <vector>
+#include <utility> //Needed before asio's coroutine support (std::exchange)
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
 //Library includes:
 #ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/scoped_ptr.hpp>
 #endif
 
 //Local includes
+#include "SocketReadinessWaiter.h"
+#include "BlockingOperationWaiter.h"
+#include "ZeroCopySendTracker.h"
+#include "IOUring.h"
+#include "InterruptibleBlockingResolver.h"
+#include "CancellationToken.h"
+#include "AsyncReadinessWaiter.h"
 
 class cInterruptibleBlockingUDPSocket
 {
 
 public:
+    //Caller-owned buffer description for batched receiving. The socket fills in the number of bytes and sender
+    class cReceiveSlot
+    {
+    public:
+        cReceiveSlot(char *cpBuffer = NULL, uint32_t u32BufferSize = 0);
+
+        char                            *m_cpBuffer;
+        uint32_t                        m_u32BufferSize;
+
+        //Filled in by receiveBatch()
+        uint32_t                        m_u32NBytesReceived;
+        boost::asio::ip::udp::endpoint  m_oPeerEndpoint;
+        int64_t                         m_i64Timestamp_ns;    //Kernel receive time in ns since the epoch. 0 unless kernel timestamps are enabled
+        uint32_t                        m_u32SegmentSize_B;   //Size of each datagram when GRO has coalesced several into the buffer. Otherwise equal to m_u32NBytesReceived
+        bool                            m_bTruncated;         //The datagram (or with GRO the coalesced datagrams) did not fit into the buffer. The rest was discarded.
+    };
+
+    //One datagram for batched sending. Without an endpoint the datagram goes to the connected peer
+    class cSendEntry
+    {
+    public:
+        cSendEntry(const char *cpBuffer = NULL, uint32_t u32NBytes = 0);
+        cSendEntry(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint);
+
+        const char                      *m_cpBuffer;
+        uint32_t                        m_u32NBytes;
+
+        bool                            m_bUsePeerEndpoint;
+        boost::asio::ip::udp::endpoint  m_oPeerEndpoint;
+    };
+
+    //Counters accumulated since the socket was created or resetStatistics() was called
+    class cStatistics
+    {
+    public:
+        cStatistics();
+
+        uint64_t                        m_u64NDatagramsReceived;
+        uint64_t                        m_u64NBytesReceived;
+        uint64_t                        m_u64NDatagramsSent;
+        uint64_t                        m_u64NBytesSent;
+
+        uint64_t                        m_u64NTimeouts;
+        uint64_t                        m_u64NCancellations;     //Operations ended by cancelCurrrentOperations()
+
+        uint32_t                        m_u32NKernelDrops;       //Kernel drop counter as of the last datagram received. Requires drop counting to be enabled
+        uint32_t                        m_u32ReceiveBufferSize_B; //Effective SO_RCVBUF, read back from the kernel
+    };
+
     cInterruptibleBlockingUDPSocket(const std::string &strName = "");
+    //Uses an externally owned io_service, which the owner must keep running. See cInterruptibleBlockingTCPSocket.
+    cInterruptibleBlockingUDPSocket(boost::asio::io_service &oIOService, const std::string &strName = "");
     cInterruptibleBlockingUDPSocket(const std::string &strLocalInterface, uint16_t u16LocalPort, const std::string &strPeerAddress = "", uint16_t u16PeerPort = 60001, const std::string &strName = "");
 
     ~cInterruptibleBlockingUDPSocket();
 
-    bool                            openAndBind(const std::string &strLocalAddress, uint16_t u16LocalPort);
+    //bReusePort sets SO_REUSEPORT so that several sockets can bind the same port and have the kernel spread traffic across them.
+    //Failing to set it fails the call, unlike a receive buffer smaller than requested, which only gets a warning.
+    bool                            openAndBind(const std::string &strLocalAddress, uint16_t u16LocalPort, bool bReusePort = false);
     bool                            openBindAndConnect(const std::string &strLocalAddress, uint16_t u16LocalPort, const std::string &strPeerAddress, uint16_t u16PeerPort);
     void                            close();
 
+    //Multicast. An empty interface address lets the kernel choose the interface.
+    //To receive group traffic bind to the group address or 0.0.0.0 on the group's port.
+    bool                            joinMulticastGroup(const std::string &strGroupAddress, const std::string &strInterfaceAddress = "");
+    bool                            leaveMulticastGroup(const std::string &strGroupAddress, const std::string &strInterfaceAddress = "");
+    bool                            joinSourceSpecificMulticastGroup(const std::string &strGroupAddress, const std::string &strSourceAddress, const std::string &strInterfaceAddress = "");
+    bool                            leaveSourceSpecificMulticastGroup(const std::string &strGroupAddress, const std::string &strSourceAddress, const std::string &strInterfaceAddress = "");
+    bool                            setMulticastInterface(const std::string &strInterfaceAddress); //Outgoing multicast interface
+
     bool                            send(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
     bool                            sendTo(const char *cpBuffer, uint32_t u32NBytes, const std::string &strPeerAddress, uint16_t u16PeerPort, uint32_t u32Timeout_ms = 0);
     bool                            sendTo(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms = 0);
 
+    //Send all entries using as few system calls as possible (sendmmsg on Linux). Returns true only if every entry was sent.
+    //getNDatagramsLastTransferred() reports how many went out, also on failure.
+    bool                            sendBatch(const std::vector<cSendEntry> &voEntries, uint32_t u32Timeout_ms = 0);
+    bool                            sendToMany(const char *cpBuffer, uint32_t u32NBytes, const std::vector<boost::asio::ip::udp::endpoint> &voPeerEndpoints, uint32_t u32Timeout_ms = 0); //Same payload to each endpoint
+
     bool                            receive(char *cpBuffer, uint32_t u32NBytes, uint32_t u32Timeout_ms = 0);
     bool                            receiveFrom(char *cpBuffer, uint32_t u32NBytes, std::string &strPeerAddress, uint16_t &u16PeerPort, uint32_t u32Timeout_ms = 0);
     bool                            receiveFrom(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms = 0);
 
+    //Receive up to voSlots.size() datagrams in a single blocking call (recvmmsg on Linux).
+    //Blocks until at least 1 datagram is available. Only the first getNDatagramsLastTransferred() slots are valid on return.
+    bool                            receiveBatch(std::vector<cReceiveSlot> &voSlots, uint32_t u32Timeout_ms = 0);
+
+    //Kernel software receive timestamps (SO_TIMESTAMPNS), in ns since the epoch (CLOCK_REALTIME).
+    //receiveFromTimestamped() enables them on first use. Once enabled receiveBatch() also fills them in.
+    bool                            setKernelTimestampsEnabled(bool bEnabled = true);
+    bool                            receiveFromTimestamped(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t u32Timeout_ms = 0);
+
+    //Generic receive offload (UDP_GRO, Linux): the kernel may merge consecutive datagrams of one flow into a single buffer.
+    //Every datagram in it is u32SegmentSize_B long except possibly the last, which may be shorter. Use a 64 kB buffer.
+    //receiveCoalesced() enables GRO on first use. Once enabled receiveBatch() also reports segment sizes.
+    //A buffer too small for what the kernel coalesced fails with message_size, with the part that fit in the buffer.
+    bool                            setGROEnabled(bool bEnabled = true);
+    bool                            receiveCoalesced(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t &u32SegmentSize_B, uint32_t u32Timeout_ms = 0);
+
+    //Generic segmentation offload (UDP_SEGMENT, Linux): send a large buffer as consecutive datagrams of u32SegmentSize_B bytes
+    //(the last may be shorter) with one system call per ~64 kB. The segment size must fit within the path MTU.
+    //Falls back to sendBatch() where UDP_SEGMENT is unavailable: not compiled in, or refused by the kernel or device at run time
+    //(EINVAL, ENOPROTOOPT, EIO), after which the socket no longer tries it. getNDatagramsLastTransferred() reports datagrams sent.
+    bool                            sendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, uint32_t u32Timeout_ms = 0);
+    bool                            sendToSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms = 0);
+
+    //Kernel drop counting (SO_RXQ_OVFL, Linux): each received datagram carries the socket's total count of datagrams dropped
+    //for lack of receive buffer space, as it was when that datagram was queued. So drops show up with the first datagram
+    //to arrive after them. When enabled all receive calls read it (receive() / receiveFrom() then use recvmsg).
+    bool                            setDropCountingEnabled(bool bEnabled = true);
+    uint32_t                        getNKernelDrops() const;
+
+    //Snapshot of the counters. Only approximate while another thread is transferring on this socket.
+    cStatistics                     getStatistics() const;
+    void                            resetStatistics();
+
     void                            cancelCurrrentOperations();
 
+    //Fast path (Linux only): transfers are first attempted directly with non-blocking system calls and only if the socket
+    //isn't ready is there a wait, using ppoll() on the socket plus an eventfd for cancelCurrrentOperations(). This avoids
+    //the io_service reset / run and timer setup on every call. API, timeouts and interruptibility are unchanged.
+    //Only change while no other operation is in progress. Returns false if not supported.
+    bool                            setFastPathEnabled(bool bEnabled);
+    bool                            isFastPathEnabled() const;
+
+    //io_uring backend (Linux only, see cIOUring): send / sendTo / receive / receiveFrom and the waits of the other calls
+    //are each one submission, linked to a timeout, so a call on a ready socket costs a single system call. With
+    //u32NReceiveBuffers a multishot receive stays armed into that many buffers: datagrams arriving between calls are
+    //received already and each receive just copies one out. Longer datagrams than u32MaxDatagramSize_B are then truncated,
+    //and the calls that bypass the ring (batches, timestamps, coalescing, drop counting) don't see datagrams it holds.
+    //Takes precedence over the fast path. Only change while no other operation is in progress. Returns false, leaving
+    //the current path in use, if the kernel doesn't support it (multishot receive needs 5.19 or later).
+    bool                            setIOUringEnabled(bool bEnabled, uint32_t u32NReceiveBuffers = 0, uint32_t u32MaxDatagramSize_B = 2048);
+    bool                            isIOUringEnabled() const;
+
+    //Zero copy sends (Linux only, SO_ZEROCOPY): send() / sendTo() payloads of at least u32Threshold_B are sent from the
+    //caller's buffer without copying it into the kernel. The call still returns once the datagram is queued, but the
+    //buffer must not be modified or freed until getNZeroCopySendsPending() is 0 or waitForZeroCopyCompletions() has
+    //returned true. Can't be disabled while sends are pending.
+    bool                            setZeroCopyEnabled(bool bEnabled, uint32_t u32Threshold_B = 32 * 1024);
+    bool                            isZeroCopyEnabled() const;
+    bool                            waitForZeroCopyCompletions(uint32_t u32Timeout_ms = 0);
+    uint32_t                        getNZeroCopySendsPending();
+    //Sends for which the kernel copied after all (e.g. over loopback or to a device without scatter gather)
+    uint64_t                        getNZeroCopySendsCopied() const;
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+    //Coroutine versions (C++20) of sendTo() / receiveFrom() for sockets on a shared io_service, awaited by coroutines
+    //spawned on it. They make the system calls of the fast path, zero copy included, and report results and statistics
+    //as the blocking calls do, but timeouts report timed_out. pToken (if given) cancels the call from any thread, ending
+    //only this call. Waits go to the io_service rather than the fast path waiter or io_uring, which would block the
+    //thread, so don't combine asyncReceiveFrom() with a multishot receive. Fail with operation_not_supported on a private
+    //io_service.
+    boost::asio::awaitable<bool>    asyncSendTo(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+    boost::asio::awaitable<bool>    asyncReceiveFrom(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, uint32_t u32Timeout_ms = 0, cCancellationToken *pToken = NULL);
+#endif
+
     //Some utility functions
-    boost::asio::ip::udp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port);
+    //Throws boost::system::system_error if the host can't be resolved. Dotted addresses and previously resolved names
+    //(see cEndpointResolverCache) return without a lookup. Lookups honour the timeout and cancelCurrrentOperations().
+    boost::asio::ip::udp::endpoint  createEndpoint(std::string strHostAddress, uint16_t u16Port, uint32_t u32Timeout_ms = 0);
     std::string                     getEndpointHostAddress(boost::asio::ip::udp::endpoint oEndpoint) const;
     uint16_t                        getEndpointPort(boost::asio::ip::udp::endpoint oEndpoint) const;
 
@@ -66,6 +222,7 @@ public:
     std::string                     getName() const;
 
     uint32_t                        getNBytesLastTransferred() const;
+    uint32_t                        getNDatagramsLastTransferred() const;
     boost::system::error_code       getLastError() const;
 
     //Pass through some boost socket functionality:
@@ -73,8 +230,11 @@ public:
     boost::asio::ip::udp::socket*   getBoostSocketPointer();
 
 private:
+    //Private io_service. Not created when the socket uses a shared one.
+    boost::scoped_ptr<boost::asio::io_service> m_pOwnedIOService;
+
     //The serial port and io service for the port
-    boost::asio::io_service         m_oIOService;
+    boost::asio::io_service         &m_oIOService;
     boost::asio::ip::udp::socket    m_oSocket;
     boost::asio::ip::udp::endpoint  m_oLocalEndpoint;
     boost::asio::ip::udp::endpoint  m_oPeerEndpoint;
@@ -82,21 +242,115 @@ private:
     //Timer for deterining timeouts
     boost::asio::deadline_timer     m_oTimer;
 
-    boost::asio::ip::udp::resolver  m_oResolver;
+    //Runs (or waits for) the asynchronous operations behind each blocking call
+    cBlockingOperationWaiter        m_oWaiter;
+
+    //Readiness waits of the coroutine calls, per direction
+    cAsyncReadinessWaiter           m_oAsyncSendReadiness;
+    cAsyncReadinessWaiter           m_oAsyncReceiveReadiness;
+
+    //Cached, interruptible host name resolution for createEndpoint()
+    cInterruptibleBlockingResolver  m_oResolver;
 
     //Flag for determining read errors
     bool                            m_bError;
 
     //Info about about last transaction
     uint32_t                        m_u32NBytesLastTransferred;
+    uint32_t                        m_u32NDatagramsLastTransferred;
     boost::system::error_code       m_oLastError;
 
+#ifdef __linux__
+    //Message headers for recvmmsg / sendmmsg. Kept as members so that batched calls don't allocate
+    std::vector<mmsghdr>            m_voReceiveBatchHeaders;
+    std::vector<iovec>              m_voReceiveBatchIOVecs;
+    std::vector<char>               m_vcReceiveBatchControl;
+    std::vector<mmsghdr>            m_voSendBatchHeaders;
+    std::vector<iovec>              m_voSendBatchIOVecs;
+#endif
+    std::vector<cSendEntry>         m_voFanOutEntries;
+
+    //Ancillary data requested from the kernel on receive
+    bool                            m_bKernelTimestamps;
+    bool                            m_bGRO;
+    bool                            m_bDropCounting;
+
+    //Set once the kernel or device refused UDP_SEGMENT. Segmented sends then go through sendBatch().
+    bool                            m_bSegmentationRefused;
+
+    cStatistics                     m_oStatistics;
+    bool                            m_bTimedOut; //Set by callback_timeOut() to tell timeouts from cancellations
+
+#ifdef __linux__
+    //Only exists while the fast path is enabled
+    boost::scoped_ptr<cSocketReadinessWaiter> m_pFastPathWaiter;
+
+    //Only exists while the io_uring backend is enabled
+    boost::scoped_ptr<cIOUring>     m_pIOUring;
+
+    //Only exists while zero copy sends are enabled
+    boost::scoped_ptr<cZeroCopySendTracker> m_pZeroCopyTracker;
+#endif
+
     //Optional label for this socket. May be useful for debugging.
     std::string                     m_strName;
 
     //Internal callback functions for serial port
     void                            callback_complete(const boost::system::error_code& oError, uint32_t u32NBytesTransferred);
     void                            callback_timeOut(const boost::system::error_code& oError);
+    void                            callback_ready(const boost::system::error_code& oError);
+
+    //Abort the asynchronous operations in progress (see cBlockingOperationWaiter)
+    void                            cancelIO();
+
+    //Record the outcome of a single datagram transfer, for finishTransfer()
+    void                            setTransferResult(const boost::system::error_code& oError, uint32_t u32NBytesTransferred);
+
+    //Statistics bookkeeping. finishTransfer() is called once a single datagram transfer completes and returns its success
+    void                            countTransfer(bool bReceived, uint32_t u32NDatagrams, uint32_t u32NBytes);
+    void                            countInterruption();
+    bool                            finishTransfer(bool bReceived);
+
+    bool                            changeSourceSpecificMembership(int iOption, const std::string &strGroupAddress, const std::string &strSourceAddress, const std::string &strInterfaceAddress);
+
+    //Wait (interruptibly) for the socket to become readable / writable without transferring any data.
+    //The timeout is counted from oStartTime so that calls which wait repeatedly keep to their overall timeout.
+    bool                            waitUntilReady(bool bForWriting, uint32_t u32Timeout_ms, const boost::posix_time::ptime &oStartTime);
+
+    //Attempt to transfer without blocking. Return false with would_block if the kernel can't take / give anything
+    bool                            tryReceiveBatch(std::vector<cReceiveSlot> &voSlots);
+    bool                            trySendBatch(const std::vector<cSendEntry> &voEntries, uint32_t u32FirstEntry);
+    //Single recvmsg based receive with ancillary data, waiting as necessary
+    bool                            receiveMessage(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B, uint32_t u32Timeout_ms);
+    bool                            tryReceiveMessage(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint &oPeerEndpoint, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B);
+    bool                            trySendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint);
+
+    bool                            sendSegmented(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+    bool                            sendSegmentsSeparately(const char *cpBuffer, uint32_t u32NBytes, uint32_t u32SegmentSize_B, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+
+    //The single datagram system calls of the fast path and the coroutine calls, without waiting. A NULL endpoint uses the
+    //connected peer. trySendDatagram() clears bZeroCopy (set up by prepareZeroCopySend()) if the kernel can't take
+    //another zero copy send.
+    bool                            prepareZeroCopySend(uint32_t u32NBytes);
+    boost::system::error_code       trySendDatagram(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint, bool &bZeroCopy, uint32_t &u32NBytesSent);
+    boost::system::error_code       tryReceiveDatagram(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t &u32NBytesReceived);
+
+#ifdef __linux__
+    //Fast path equivalents of send / sendTo and receive / receiveFrom. A NULL endpoint uses the connected peer.
+    bool                            fastSend(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+    bool                            fastReceive(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+
+    //io_uring equivalents of the same
+    bool                            ioUringSend(const char *cpBuffer, uint32_t u32NBytes, const boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+    bool                            ioUringReceive(char *cpBuffer, uint32_t u32NBytes, boost::asio::ip::udp::endpoint *pPeerEndpoint, uint32_t u32Timeout_ms);
+
+    //Extract ancillary data (timestamps, GRO segment size) from a received message. The segment size is 0 if not coalesced
+    void                            parseControlMessages(const msghdr &oHeader, int64_t &i64Timestamp_ns, uint32_t &u32SegmentSize_B);
+
+    //Called after each readiness wait. Completions left on the error queue would keep POLLERR set, so that the wait
+    //returned at once and the transfer loops spun on EAGAIN.
+    void                            reapZeroCopyCompletions();
+#endif
 
 };
 
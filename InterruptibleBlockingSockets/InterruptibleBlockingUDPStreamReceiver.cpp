@@ -0,0 +1,308 @@
+
+//System includes
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPStreamReceiver.h"
+
+using namespace std;
+
+cInterruptibleBlockingUDPStreamReceiver::cPacketView::cPacketView() :
+    m_cpData(NULL),
+    m_u32NBytes(0)
+{
+}
+
+cInterruptibleBlockingUDPStreamReceiver::cInterruptibleBlockingUDPStreamReceiver(const string &strName) :
+    m_oSocket(strName),
+    m_bStopRequested(false),
+    m_i32CPUCore(-1),
+    m_u32NSlots(0),
+    m_u32SlotSize_B(0),
+    m_u32MaxBatchSize(0),
+    m_u64WriteIndex(0),
+    m_u64ReleaseIndex(0),
+    m_u64ConsumeIndex(0),
+    m_u32HighWaterMark(0),
+    m_u64NOverruns(0),
+    m_bConsumerWaiting(false),
+    m_u32CancelCount(0),
+    m_strName(strName)
+{
+}
+
+cInterruptibleBlockingUDPStreamReceiver::~cInterruptibleBlockingUDPStreamReceiver()
+{
+    stop();
+}
+
+bool cInterruptibleBlockingUDPStreamReceiver::start(const string &strLocalAddress, uint16_t u16LocalPort, uint32_t u32NSlots, uint32_t u32SlotSize_B,
+                                                    int32_t i32CPUCore, uint32_t u32MaxBatchSize, bool bReusePort)
+{
+    stop();
+
+    if(!u32NSlots || !u32SlotSize_B || !u32MaxBatchSize)
+    {
+        cout << "cInterruptibleBlockingUDPStreamReceiver::start(): Ring dimensions and batch size must be non-zero." << endl;
+        return false;
+    }
+
+    if(!m_oSocket.openAndBind(strLocalAddress, u16LocalPort, bReusePort))
+        return false;
+
+    //Allocate and touch all ring memory up front so that the receive thread never allocates or page faults
+    m_u32NSlots = u32NSlots;
+    m_u32SlotSize_B = u32SlotSize_B;
+    m_u32MaxBatchSize = u32MaxBatchSize;
+    m_i32CPUCore = i32CPUCore;
+
+    m_vcRingBuffer.assign((uint64_t)u32NSlots * u32SlotSize_B, 0);
+
+    m_voRingSlots.clear();
+    for(uint32_t u32SlotNo = 0; u32SlotNo < u32NSlots; u32SlotNo++)
+        m_voRingSlots.push_back(cInterruptibleBlockingUDPSocket::cReceiveSlot(&m_vcRingBuffer[(uint64_t)u32SlotNo * u32SlotSize_B], u32SlotSize_B));
+
+    m_voBatchSlots.reserve(u32MaxBatchSize);
+
+    //When the ring is full datagrams are drained into a single scratch buffer and discarded
+    m_vcDiscardBuffer.assign(u32SlotSize_B, 0);
+    m_voDiscardSlots.assign(u32MaxBatchSize, cInterruptibleBlockingUDPSocket::cReceiveSlot(&m_vcDiscardBuffer.front(), u32SlotSize_B));
+
+    m_u64WriteIndex = 0;
+    m_u64ReleaseIndex = 0;
+    m_u64ConsumeIndex = 0;
+    m_u32HighWaterMark = 0;
+    m_u64NOverruns = 0;
+
+    m_bStopRequested = false;
+    m_pReceiveThread.reset(new boost::thread(&cInterruptibleBlockingUDPStreamReceiver::receiveThreadFunction, this));
+
+    return true;
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::stop()
+{
+    if(!m_pReceiveThread)
+        return;
+
+    m_bStopRequested = true;
+
+    //The cancel can land just before the receive thread enters its wait, so repeat it until the thread has exited
+    do
+    {
+        m_oSocket.cancelCurrrentOperations();
+    }
+    while(!m_pReceiveThread->timed_join(boost::posix_time::milliseconds(10)));
+
+    m_pReceiveThread.reset();
+
+    m_oSocket.close();
+
+    //Wake any consumer still waiting for data
+    cancelCurrrentOperations();
+}
+
+bool cInterruptibleBlockingUDPStreamReceiver::isRunning() const
+{
+    return m_pReceiveThread && !m_bStopRequested;
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::receiveThreadFunction()
+{
+    pinCurrentThread();
+
+    cout << "cInterruptibleBlockingUDPStreamReceiver::receiveThreadFunction(): Receive thread for \"" << m_strName << "\" started." << endl;
+
+    while(!m_bStopRequested)
+    {
+        uint64_t u64WriteIndex = m_u64WriteIndex.load(boost::memory_order_relaxed);
+        uint64_t u64NFreeSlots = m_u32NSlots - (u64WriteIndex - m_u64ReleaseIndex.load(boost::memory_order_acquire));
+
+        if(!u64NFreeSlots)
+        {
+            //Consumer is behind. Keep the kernel buffer drained and count what is lost.
+            if(m_oSocket.receiveBatch(m_voDiscardSlots))
+                m_u64NOverruns.fetch_add(m_oSocket.getNDatagramsLastTransferred(), boost::memory_order_relaxed);
+
+            continue;
+        }
+
+        //Receive straight into the contiguous run of free slots following the write position
+        uint32_t u32FirstSlot = u64WriteIndex % m_u32NSlots;
+        uint32_t u32NSlots = min<uint64_t>(min<uint64_t>(u64NFreeSlots, m_u32NSlots - u32FirstSlot), m_u32MaxBatchSize);
+
+        m_voBatchSlots.assign(m_voRingSlots.begin() + u32FirstSlot, m_voRingSlots.begin() + u32FirstSlot + u32NSlots);
+
+        if(!m_oSocket.receiveBatch(m_voBatchSlots))
+        {
+            //Typically a cancel from stop(). Anything else (e.g. ICMP errors) is transient for UDP.
+            continue;
+        }
+
+        uint32_t u32NReceived = m_oSocket.getNDatagramsLastTransferred();
+
+        for(uint32_t u32SlotNo = 0; u32SlotNo < u32NReceived; u32SlotNo++)
+        {
+            m_voRingSlots[u32FirstSlot + u32SlotNo].m_u32NBytesReceived = m_voBatchSlots[u32SlotNo].m_u32NBytesReceived;
+            m_voRingSlots[u32FirstSlot + u32SlotNo].m_oPeerEndpoint = m_voBatchSlots[u32SlotNo].m_oPeerEndpoint;
+        }
+
+        //Publish the new packets to the consumer
+        m_u64WriteIndex.store(u64WriteIndex + u32NReceived, boost::memory_order_release);
+
+        uint32_t u32Occupancy = u64WriteIndex + u32NReceived - m_u64ReleaseIndex.load(boost::memory_order_acquire);
+        if(u32Occupancy > m_u32HighWaterMark.load(boost::memory_order_relaxed))
+            m_u32HighWaterMark.store(u32Occupancy, boost::memory_order_relaxed);
+
+        notifyConsumer();
+    }
+
+    cout << "cInterruptibleBlockingUDPStreamReceiver::receiveThreadFunction(): Receive thread for \"" << m_strName << "\" exiting." << endl;
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::pinCurrentThread()
+{
+    if(m_i32CPUCore < 0)
+        return;
+
+#ifdef __linux__
+    cpu_set_t oCPUSet;
+    CPU_ZERO(&oCPUSet);
+    CPU_SET(m_i32CPUCore, &oCPUSet);
+
+    int iResult = pthread_setaffinity_np(pthread_self(), sizeof(oCPUSet), &oCPUSet);
+    if(iResult)
+    {
+        cout << "cInterruptibleBlockingUDPStreamReceiver::pinCurrentThread(): Unable to pin receive thread to core " << m_i32CPUCore
+             << ": " << boost::system::error_code(iResult, boost::system::system_category()).message() << endl;
+    }
+#else
+    cout << "cInterruptibleBlockingUDPStreamReceiver::pinCurrentThread(): Thread pinning is not supported on this platform." << endl;
+#endif
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::notifyConsumer()
+{
+    //Orders the release store of the write index before the load of the flag. Without it the load may be done first,
+    //miss a consumer that set the flag and then saw the old index, and leave it asleep with packets in the ring.
+    boost::atomic_thread_fence(boost::memory_order_seq_cst);
+
+    if(!m_bConsumerWaiting.load())
+        return;
+
+    boost::lock_guard<boost::mutex> oLock(m_oConsumerMutex);
+    m_oConsumerCondition.notify_all();
+}
+
+bool cInterruptibleBlockingUDPStreamReceiver::getNextPacket(cPacketView &oPacket, uint32_t u32Timeout_ms)
+{
+    if(m_u64ConsumeIndex == m_u64WriteIndex.load(boost::memory_order_acquire))
+    {
+        //Ring is empty. Sleep until the receive thread publishes something, we time out or are cancelled.
+        uint32_t u32CancelCount = m_u32CancelCount.load();
+        boost::system_time oDeadline = boost::get_system_time() + boost::posix_time::milliseconds(u32Timeout_ms);
+
+        boost::unique_lock<boost::mutex> oLock(m_oConsumerMutex);
+        m_bConsumerWaiting = true;
+
+        while(m_u64ConsumeIndex == m_u64WriteIndex.load())
+        {
+            if(u32CancelCount != m_u32CancelCount.load() || !isRunning())
+            {
+                m_bConsumerWaiting = false;
+                return false;
+            }
+
+            if(u32Timeout_ms)
+            {
+                if(!m_oConsumerCondition.timed_wait(oLock, oDeadline) && m_u64ConsumeIndex == m_u64WriteIndex.load())
+                {
+                    m_bConsumerWaiting = false;
+                    return false;
+                }
+            }
+            else
+            {
+                m_oConsumerCondition.wait(oLock);
+            }
+        }
+
+        m_bConsumerWaiting = false;
+    }
+
+    const cInterruptibleBlockingUDPSocket::cReceiveSlot &oSlot = m_voRingSlots[m_u64ConsumeIndex % m_u32NSlots];
+
+    oPacket.m_cpData = oSlot.m_cpBuffer;
+    oPacket.m_u32NBytes = oSlot.m_u32NBytesReceived;
+    oPacket.m_oPeerEndpoint = oSlot.m_oPeerEndpoint;
+
+    m_u64ConsumeIndex++;
+
+    return true;
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::releasePackets(uint32_t u32NPackets)
+{
+    //Only packets that have been handed out can be released
+    uint64_t u64ReleaseIndex = m_u64ReleaseIndex.load(boost::memory_order_relaxed);
+    uint64_t u64NHeld = m_u64ConsumeIndex - u64ReleaseIndex;
+
+    if(u32NPackets > u64NHeld)
+        u32NPackets = u64NHeld;
+
+    m_u64ReleaseIndex.store(u64ReleaseIndex + u32NPackets, boost::memory_order_release);
+}
+
+void cInterruptibleBlockingUDPStreamReceiver::cancelCurrrentOperations()
+{
+    m_u32CancelCount++;
+
+    boost::lock_guard<boost::mutex> oLock(m_oConsumerMutex);
+    m_oConsumerCondition.notify_all();
+}
+
+cInterruptibleBlockingUDPSocket& cInterruptibleBlockingUDPStreamReceiver::getSocket()
+{
+    return m_oSocket;
+}
+
+std::string cInterruptibleBlockingUDPStreamReceiver::getName() const
+{
+    return m_strName;
+}
+
+uint32_t cInterruptibleBlockingUDPStreamReceiver::getNSlots() const
+{
+    return m_u32NSlots;
+}
+
+uint32_t cInterruptibleBlockingUDPStreamReceiver::getSlotSize_B() const
+{
+    return m_u32SlotSize_B;
+}
+
+uint32_t cInterruptibleBlockingUDPStreamReceiver::getOccupancy() const
+{
+    return m_u64WriteIndex.load() - m_u64ReleaseIndex.load();
+}
+
+uint32_t cInterruptibleBlockingUDPStreamReceiver::getHighWaterMark() const
+{
+    return m_u32HighWaterMark.load();
+}
+
+uint64_t cInterruptibleBlockingUDPStreamReceiver::getNPacketsReceived() const
+{
+    return m_u64WriteIndex.load();
+}
+
+uint64_t cInterruptibleBlockingUDPStreamReceiver::getNOverruns() const
+{
+    return m_u64NOverruns.load();
+}
@@ -0,0 +1,130 @@
+#ifndef INTERRUPTIBLE_BLOCKING_UDP_STREAM_RECEIVER_H
+#define INTERRUPTIBLE_BLOCKING_UDP_STREAM_RECEIVER_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingUDPSocket.h"
+
+//Owns a UDP socket and a receive thread (optionally pinned to a CPU core) which continuously drains the socket into a
+//pre-allocated single-producer / single-consumer ring of fixed size slots. Datagrams are received directly into the ring
+//and handed to the (single) consumer thread as views which remain valid until released. If the consumer falls behind
+//and the ring fills up, newly arriving datagrams are discarded and counted as overruns rather than being left to
+//overflow the kernel buffer.
+
+class cInterruptibleBlockingUDPStreamReceiver
+{
+public:
+    //Read-only view of a datagram in the ring. Valid until released with releasePackets()
+    class cPacketView
+    {
+    public:
+        cPacketView();
+
+        const char                      *m_cpData;
+        uint32_t                        m_u32NBytes;
+        boost::asio::ip::udp::endpoint  m_oPeerEndpoint;
+    };
+
+    cInterruptibleBlockingUDPStreamReceiver(const std::string &strName = "");
+    ~cInterruptibleBlockingUDPStreamReceiver();
+
+    //i32CPUCore < 0 leaves the receive thread unpinned. bReusePort allows several receivers to share the port (see cInterruptibleBlockingUDPReceiverGroup)
+    bool                                start(const std::string &strLocalAddress, uint16_t u16LocalPort, uint32_t u32NSlots, uint32_t u32SlotSize_B,
+                                              int32_t i32CPUCore = -1, uint32_t u32MaxBatchSize = 64, bool bReusePort = false);
+    void                                stop();
+
+    bool                                isRunning() const;
+
+    //Consumer side. Packets are handed out in arrival order and must be released in the same order.
+    //Several packets may be held at once.
+    bool                                getNextPacket(cPacketView &oPacket, uint32_t u32Timeout_ms = 0);
+    void                                releasePackets(uint32_t u32NPackets = 1);
+
+    //Wake any consumer blocked in getNextPacket(). It returns false.
+    void                                cancelCurrrentOperations();
+
+    //Access to the underlying socket e.g. for setting further options. Do not receive on it directly while running.
+    cInterruptibleBlockingUDPSocket&    getSocket();
+
+    //Some accessors
+    std::string                         getName() const;
+
+    uint32_t                            getNSlots() const;
+    uint32_t                            getSlotSize_B() const;
+    uint32_t                            getOccupancy() const;      //Slots received but not yet released
+    uint32_t                            getHighWaterMark() const;  //Highest occupancy seen since start()
+    uint64_t                            getNPacketsReceived() const;
+    uint64_t                            getNOverruns() const;      //Datagrams discarded because the ring was full
+
+private:
+    cInterruptibleBlockingUDPSocket     m_oSocket;
+
+    boost::scoped_ptr<boost::thread>    m_pReceiveThread;
+    boost::atomic<bool>                 m_bStopRequested;
+    int32_t                             m_i32CPUCore;
+
+    //Ring storage. Slot n's buffer starts at n * m_u32SlotSize_B in m_vcRingBuffer
+    std::vector<char>                   m_vcRingBuffer;
+    std::vector<cInterruptibleBlockingUDPSocket::cReceiveSlot> m_voRingSlots;
+    uint32_t                            m_u32NSlots;
+    uint32_t                            m_u32SlotSize_B;
+    uint32_t                            m_u32MaxBatchSize;
+
+    //Monotonic packet counters. Slot index is counter % m_u32NSlots.
+    //Written by the receive thread:
+    boost::atomic<uint64_t>             m_u64WriteIndex;
+    //Written by the consumer:
+    boost::atomic<uint64_t>             m_u64ReleaseIndex;
+    uint64_t                            m_u64ConsumeIndex;
+
+    //Receive thread scratch
+    std::vector<cInterruptibleBlockingUDPSocket::cReceiveSlot> m_voBatchSlots;
+    std::vector<char>                   m_vcDiscardBuffer;
+    std::vector<cInterruptibleBlockingUDPSocket::cReceiveSlot> m_voDiscardSlots;
+
+    //Statistics
+    boost::atomic<uint32_t>             m_u32HighWaterMark;
+    boost::atomic<uint64_t>             m_u64NOverruns;
+
+    //The consumer only sleeps on the condition when the ring is empty. The receive thread only takes the mutex if
+    //the consumer has flagged that it is waiting.
+    boost::mutex                        m_oConsumerMutex;
+    boost::condition_variable           m_oConsumerCondition;
+    boost::atomic<bool>                 m_bConsumerWaiting;
+    boost::atomic<uint32_t>             m_u32CancelCount;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+
+    void                                receiveThreadFunction();
+    void                                pinCurrentThread();
+    void                                notifyConsumer();
+};
+
+#endif // INTERRUPTIBLE_BLOCKING_UDP_STREAM_RECEIVER_H
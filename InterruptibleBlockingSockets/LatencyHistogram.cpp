@@ -0,0 +1,233 @@
+
+//System includes
+#include <cmath>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#ifdef _WIN32
+#include <boost/date_time/posix_time/posix_time.hpp>
+#endif
+#endif
+
+//Local includes
+#include "LatencyHistogram.h"
+
+using namespace std;
+
+//Each power of 2 range is divided into 2^SUB_BUCKET_BITS linear buckets
+static const uint32_t SUB_BUCKET_BITS = 4;
+static const uint32_t NSUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+static const uint32_t NBUCKETS = (64 - SUB_BUCKET_BITS + 1) * NSUB_BUCKETS;
+
+cLatencyHistogram::cLatencyHistogram(const string &strName) :
+    m_vu64Buckets(NBUCKETS, 0),
+    m_strName(strName)
+{
+    reset();
+}
+
+void cLatencyHistogram::addSample(int64_t i64Latency_ns)
+{
+    if(i64Latency_ns < 0)
+    {
+        m_u64NNegativeSamples++;
+        i64Latency_ns = 0;
+    }
+
+    m_vu64Buckets[getBucketIndex(i64Latency_ns)]++;
+
+    if(!m_u64NSamples || i64Latency_ns < m_i64Min_ns)
+        m_i64Min_ns = i64Latency_ns;
+    if(!m_u64NSamples || i64Latency_ns > m_i64Max_ns)
+        m_i64Max_ns = i64Latency_ns;
+
+    m_u64NSamples++;
+    m_dSum_ns += i64Latency_ns;
+    m_dSumOfSquares_ns2 += (double)i64Latency_ns * i64Latency_ns;
+}
+
+void cLatencyHistogram::addKernelTimestamp(int64_t i64KernelTimestamp_ns)
+{
+    //A zero timestamp means the kernel didn't supply one (timestamps not enabled)
+    if(!i64KernelTimestamp_ns)
+        return;
+
+    addSample(getCurrentTime_ns() - i64KernelTimestamp_ns);
+}
+
+void cLatencyHistogram::merge(const cLatencyHistogram &oOther)
+{
+    if(!oOther.m_u64NSamples)
+        return;
+
+    for(uint32_t u32BucketNo = 0; u32BucketNo < NBUCKETS; u32BucketNo++)
+        m_vu64Buckets[u32BucketNo] += oOther.m_vu64Buckets[u32BucketNo];
+
+    if(!m_u64NSamples || oOther.m_i64Min_ns < m_i64Min_ns)
+        m_i64Min_ns = oOther.m_i64Min_ns;
+    if(!m_u64NSamples || oOther.m_i64Max_ns > m_i64Max_ns)
+        m_i64Max_ns = oOther.m_i64Max_ns;
+
+    m_u64NSamples += oOther.m_u64NSamples;
+    m_u64NNegativeSamples += oOther.m_u64NNegativeSamples;
+    m_dSum_ns += oOther.m_dSum_ns;
+    m_dSumOfSquares_ns2 += oOther.m_dSumOfSquares_ns2;
+}
+
+void cLatencyHistogram::reset()
+{
+    m_vu64Buckets.assign(NBUCKETS, 0);
+
+    m_u64NSamples = 0;
+    m_u64NNegativeSamples = 0;
+    m_i64Min_ns = 0;
+    m_i64Max_ns = 0;
+    m_dSum_ns = 0.0;
+    m_dSumOfSquares_ns2 = 0.0;
+}
+
+uint64_t cLatencyHistogram::getNSamples() const
+{
+    return m_u64NSamples;
+}
+
+uint64_t cLatencyHistogram::getNNegativeSamples() const
+{
+    return m_u64NNegativeSamples;
+}
+
+int64_t cLatencyHistogram::getMin_ns() const
+{
+    return m_i64Min_ns;
+}
+
+int64_t cLatencyHistogram::getMax_ns() const
+{
+    return m_i64Max_ns;
+}
+
+double cLatencyHistogram::getMean_ns() const
+{
+    if(!m_u64NSamples)
+        return 0.0;
+
+    return m_dSum_ns / m_u64NSamples;
+}
+
+double cLatencyHistogram::getStandardDeviation_ns() const
+{
+    if(m_u64NSamples < 2)
+        return 0.0;
+
+    double dMean_ns = getMean_ns();
+    double dVariance_ns2 = m_dSumOfSquares_ns2 / m_u64NSamples - dMean_ns * dMean_ns;
+
+    return dVariance_ns2 > 0.0 ? sqrt(dVariance_ns2) : 0.0;
+}
+
+int64_t cLatencyHistogram::getPercentile_ns(double dPercentile) const
+{
+    if(!m_u64NSamples)
+        return 0;
+
+    if(dPercentile <= 0.0)
+        return m_i64Min_ns;
+    if(dPercentile >= 100.0)
+        return m_i64Max_ns;
+
+    uint64_t u64TargetCount = (uint64_t)ceil(dPercentile / 100.0 * m_u64NSamples);
+    uint64_t u64CumulativeCount = 0;
+
+    for(uint32_t u32BucketNo = 0; u32BucketNo < NBUCKETS; u32BucketNo++)
+    {
+        u64CumulativeCount += m_vu64Buckets[u32BucketNo];
+
+        if(u64CumulativeCount >= u64TargetCount)
+        {
+            //Report the middle of the bucket, limited to the observed range
+            uint64_t u64Lower = getBucketLowerBound(u32BucketNo);
+            uint64_t u64Upper = u32BucketNo + 1 < NBUCKETS ? getBucketLowerBound(u32BucketNo + 1) : u64Lower;
+            int64_t i64Value = u64Lower + (u64Upper - u64Lower) / 2;
+
+            if(i64Value < m_i64Min_ns)
+                return m_i64Min_ns;
+            if(i64Value > m_i64Max_ns)
+                return m_i64Max_ns;
+
+            return i64Value;
+        }
+    }
+
+    return m_i64Max_ns;
+}
+
+std::string cLatencyHistogram::getName() const
+{
+    return m_strName;
+}
+
+void cLatencyHistogram::print(std::ostream &oStream) const
+{
+    oStream << "Latency histogram \"" << m_strName << "\": " << m_u64NSamples << " samples";
+    if(m_u64NNegativeSamples)
+        oStream << " (" << m_u64NNegativeSamples << " negative)";
+    oStream << std::endl;
+
+    if(!m_u64NSamples)
+        return;
+
+    oStream << "    min " << m_i64Min_ns / 1000.0 << " us, mean " << getMean_ns() / 1000.0
+            << " us, max " << m_i64Max_ns / 1000.0 << " us, jitter (std dev) " << getStandardDeviation_ns() / 1000.0 << " us" << std::endl;
+    oStream << "    p50 " << getPercentile_ns(50.0) / 1000.0 << " us, p90 " << getPercentile_ns(90.0) / 1000.0
+            << " us, p99 " << getPercentile_ns(99.0) / 1000.0 << " us, p99.9 " << getPercentile_ns(99.9) / 1000.0
+            << " us, p99.99 " << getPercentile_ns(99.99) / 1000.0 << " us" << std::endl;
+}
+
+int64_t cLatencyHistogram::getCurrentTime_ns()
+{
+#ifndef _WIN32
+    timespec oNow;
+    clock_gettime(CLOCK_REALTIME, &oNow);
+
+    return (int64_t)oNow.tv_sec * 1000000000LL + oNow.tv_nsec;
+#else
+    boost::posix_time::time_duration oSinceEpoch = boost::posix_time::microsec_clock::universal_time() - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1));
+
+    return oSinceEpoch.total_microseconds() * 1000LL;
+#endif
+}
+
+uint32_t cLatencyHistogram::getBucketIndex(uint64_t u64Value)
+{
+    if(u64Value < NSUB_BUCKETS)
+        return u64Value;
+
+    //Position of the most significant bit
+#ifdef __GNUC__
+    uint32_t u32MSB = 63 - __builtin_clzll(u64Value);
+#else
+    uint32_t u32MSB = 0;
+    for(uint64_t u64Shifted = u64Value; u64Shifted >>= 1; )
+        u32MSB++;
+#endif
+
+    //The SUB_BUCKET_BITS bits below the MSB select the linear sub-bucket
+    uint32_t u32SubBucket = (u64Value >> (u32MSB - SUB_BUCKET_BITS)) & (NSUB_BUCKETS - 1);
+
+    return (u32MSB - SUB_BUCKET_BITS + 1) * NSUB_BUCKETS + u32SubBucket;
+}
+
+uint64_t cLatencyHistogram::getBucketLowerBound(uint32_t u32BucketIndex)
+{
+    if(u32BucketIndex < NSUB_BUCKETS)
+        return u32BucketIndex;
+
+    uint32_t u32MSB = u32BucketIndex / NSUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t u64SubBucket = u32BucketIndex % NSUB_BUCKETS;
+
+    return (NSUB_BUCKETS + u64SubBucket) << (u32MSB - SUB_BUCKET_BITS);
+}
@@ -0,0 +1,78 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+//Library includes
+
+//Local includes
+
+//Log-linear histogram of latencies in ns, intended for the kernel receive timestamps returned by the socket classes.
+//Each power of 2 range is split into 16 linear sub-buckets so any value is recorded with better than ~6% resolution
+//and a fixed ~1000 counters cover the full 64 bit range. Recording is O(1) and does not allocate.
+//Not thread safe: use one histogram per thread and merge().
+
+class cLatencyHistogram
+{
+public:
+    cLatencyHistogram(const std::string &strName = "");
+
+    void                            addSample(int64_t i64Latency_ns);
+
+    //Record now (CLOCK_REALTIME, the clock used by SO_TIMESTAMPNS) minus the kernel timestamp
+    void                            addKernelTimestamp(int64_t i64KernelTimestamp_ns);
+
+    void                            merge(const cLatencyHistogram &oOther);
+    void                            reset();
+
+    //Statistics
+    uint64_t                        getNSamples() const;
+    uint64_t                        getNNegativeSamples() const; //Samples < 0 (clock steps). Recorded as 0.
+    int64_t                         getMin_ns() const;
+    int64_t                         getMax_ns() const;
+    double                          getMean_ns() const;
+    double                          getStandardDeviation_ns() const; //Jitter
+    int64_t                         getPercentile_ns(double dPercentile) const; //dPercentile in [0, 100]
+
+    std::string                     getName() const;
+
+    void                            print(std::ostream &oStream) const;
+
+    static int64_t                  getCurrentTime_ns();
+
+private:
+    std::vector<uint64_t>           m_vu64Buckets;
+
+    uint64_t                        m_u64NSamples;
+    uint64_t                        m_u64NNegativeSamples;
+    int64_t                         m_i64Min_ns;
+    int64_t                         m_i64Max_ns;
+    double                          m_dSum_ns;
+    double                          m_dSumOfSquares_ns2;
+
+    //Optional label. May be useful for debugging.
+    std::string                     m_strName;
+
+    static uint32_t                 getBucketIndex(uint64_t u64Value);
+    static uint64_t                 getBucketLowerBound(uint32_t u32BucketIndex);
+};
+
+#endif // LATENCY_HISTOGRAM_H
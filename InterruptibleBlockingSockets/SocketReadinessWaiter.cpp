@@ -0,0 +1,136 @@
+
+#ifdef __linux__
+
+//System includes
+#include <iostream>
+#include <cerrno>
+
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/error.hpp>
+#endif
+
+//Local includes
+#include "SocketReadinessWaiter.h"
+
+using namespace std;
+
+cSocketReadinessWaiter::cSocketReadinessWaiter() :
+    m_iEventFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if(m_iEventFD < 0)
+        cout << "cSocketReadinessWaiter::cSocketReadinessWaiter(): Unable to create eventfd. Waits will not be interruptible." << endl;
+}
+
+cSocketReadinessWaiter::~cSocketReadinessWaiter()
+{
+    if(m_iEventFD >= 0)
+        close(m_iEventFD);
+}
+
+boost::system::error_code cSocketReadinessWaiter::wait(int iFD, bool bForWriting, int64_t i64Deadline_ns)
+{
+    return waitForEvents(iFD, bForWriting ? POLLOUT : POLLIN, i64Deadline_ns);
+}
+
+boost::system::error_code cSocketReadinessWaiter::waitForError(int iFD, int64_t i64Deadline_ns)
+{
+    //POLLERR is always reported so no events need to be requested
+    return waitForEvents(iFD, 0, i64Deadline_ns);
+}
+
+boost::system::error_code cSocketReadinessWaiter::waitForEvents(int iFD, short sEvents, int64_t i64Deadline_ns)
+{
+    pollfd aoPollFDs[2];
+    aoPollFDs[0].fd = iFD;
+    aoPollFDs[0].events = sEvents;
+    aoPollFDs[0].revents = 0;
+    aoPollFDs[1].fd = m_iEventFD;
+    aoPollFDs[1].events = POLLIN;
+    aoPollFDs[1].revents = 0;
+
+    //Discard any cancel that arrived while nobody was waiting (the asio path does the same with io_service::reset())
+    clearCancel();
+
+    for(;;)
+    {
+        timespec oTimeout;
+        timespec *pTimeout = NULL;
+
+        if(i64Deadline_ns)
+        {
+            int64_t i64Remaining_ns = i64Deadline_ns - getCurrentTime_ns();
+            if(i64Remaining_ns <= 0)
+                return boost::asio::error::timed_out;
+
+            oTimeout.tv_sec = i64Remaining_ns / 1000000000LL;
+            oTimeout.tv_nsec = i64Remaining_ns % 1000000000LL;
+            pTimeout = &oTimeout;
+        }
+
+        int iResult = ppoll(aoPollFDs, m_iEventFD >= 0 ? 2 : 1, pTimeout, NULL);
+
+        if(iResult < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return boost::system::error_code(errno, boost::asio::error::get_system_category());
+        }
+
+        if(!iResult)
+            continue; //Re-evaluates the deadline above
+
+        if(aoPollFDs[1].revents)
+        {
+            clearCancel();
+            return boost::asio::error::operation_aborted;
+        }
+
+        //Readiness, error or hang up. In all cases the caller's system call reports the outcome.
+        return boost::system::error_code();
+    }
+}
+
+void cSocketReadinessWaiter::cancel()
+{
+    if(m_iEventFD < 0)
+        return;
+
+    uint64_t u64Increment = 1;
+    ssize_t iResult = write(m_iEventFD, &u64Increment, sizeof(u64Increment));
+    (void)iResult; //Only fails if the counter would overflow, in which case a cancel is already pending
+}
+
+void cSocketReadinessWaiter::clearCancel()
+{
+    if(m_iEventFD < 0)
+        return;
+
+    uint64_t u64Count;
+    ssize_t iResult = read(m_iEventFD, &u64Count, sizeof(u64Count));
+    (void)iResult; //EAGAIN if no cancel was pending
+}
+
+int64_t cSocketReadinessWaiter::getDeadline_ns(uint32_t u32Timeout_ms)
+{
+    if(!u32Timeout_ms)
+        return 0;
+
+    return getCurrentTime_ns() + (int64_t)u32Timeout_ms * 1000000LL;
+}
+
+int64_t cSocketReadinessWaiter::getCurrentTime_ns()
+{
+    timespec oNow;
+    clock_gettime(CLOCK_MONOTONIC, &oNow);
+
+    return (int64_t)oNow.tv_sec * 1000000000LL + oNow.tv_nsec;
+}
+
+#endif // __linux__
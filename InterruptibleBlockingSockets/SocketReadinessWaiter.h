@@ -0,0 +1,52 @@
+#ifndef SOCKET_READINESS_WAITER_H
+#define SOCKET_READINESS_WAITER_H
+
+//Support for the fast path of the socket classes (see setFastPathEnabled()). Linux only.
+//
+//Waits for a socket to become readable or writable with ppoll(), together with an eventfd which cancel() signals
+//from any thread. This gives the same timeout / interrupt behaviour as running an io_service with a deadline_timer
+//but without handlers, timers or epoll registration, so a socket which is already ready costs no more than the
+//system call itself.
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/system/error_code.hpp>
+#endif
+
+//Local includes
+
+class cSocketReadinessWaiter
+{
+public:
+    cSocketReadinessWaiter();
+    ~cSocketReadinessWaiter();
+
+    //Returns success once the descriptor is ready (or has an error / hang up condition for the following system call to
+    //report), timed_out once the deadline passes and operation_aborted if cancel() is called during the wait.
+    //A deadline of 0 waits indefinitely.
+    boost::system::error_code       wait(int iFD, bool bForWriting, int64_t i64Deadline_ns);
+    //As wait() but only returns for an error condition, such as a pending error queue message (see cZeroCopySendTracker)
+    boost::system::error_code       waitForError(int iFD, int64_t i64Deadline_ns);
+
+    //Interrupt a wait in progress on another thread. A cancel issued while no wait is in progress is discarded.
+    void                            cancel();
+
+    //Deadline for a timeout starting now, on the clock used by wait(). A timeout of 0 gives a deadline of 0 (none).
+    static int64_t                  getDeadline_ns(uint32_t u32Timeout_ms);
+    static int64_t                  getCurrentTime_ns(); //CLOCK_MONOTONIC
+
+private:
+    int                             m_iEventFD;
+
+    void                            clearCancel();
+    boost::system::error_code       waitForEvents(int iFD, short sEvents, int64_t i64Deadline_ns);
+};
+
+#endif // __linux__
+
+#endif // SOCKET_READINESS_WAITER_H
@@ -0,0 +1,1048 @@
+#ifdef __linux__
+
+//System includes
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/bind.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#endif
+
+//Local includes
+#include "TCPEventEngine.h"
+#include "SocketReadinessWaiter.h"
+
+using namespace std;
+
+namespace
+{
+    const uint32_t MAX_EVENTS_PER_WAIT = 256;
+    const uint32_t MIN_READ_SIZE_B = 4 * 1024;
+    //Reads per readiness event before moving on to the other connections
+    const uint32_t MAX_READS_PER_EVENT = 4;
+    //epoll data of the loop's eventfd. Connection IDs start at 1.
+    const uint64_t EVENT_FD_ID = 0;
+
+    bool setNonBlocking(int iFD, bool bNonBlocking)
+    {
+        int iFlags = fcntl(iFD, F_GETFL, 0);
+        if(iFlags < 0)
+            return false;
+
+        iFlags = bNonBlocking ? (iFlags | O_NONBLOCK) : (iFlags & ~O_NONBLOCK);
+
+        return fcntl(iFD, F_SETFL, iFlags) == 0;
+    }
+
+    boost::system::error_code getErrno()
+    {
+        return boost::system::error_code(errno, boost::asio::error::get_system_category());
+    }
+}
+
+cTCPEventEngine::cEvent::cEvent() :
+    m_eType(LINE),
+    m_u64ConnectionID(0)
+{
+}
+
+cTCPEventEngine::cConnection::cConnection(uint64_t u64ID, int iFD, cLoop *pLoop) :
+    m_u64ID(u64ID),
+    m_iFD(iFD),
+    m_pLoop(pLoop),
+    m_bConnecting(false),
+    m_bWaitingToWrite(false),
+    m_u32InputStart(0),
+    m_u32InputEnd(0),
+    m_u32SearchOffset(0),
+    m_i64IdleTimeout_ns(0),
+    m_i64Deadline_ns(0),
+    m_i64ScheduledDeadline_ns(0),
+    m_u32OutputStart(0),
+    m_bWritePosted(false),
+    m_bCloseRequested(false),
+    m_bClosed(false)
+{
+}
+
+cTCPEventEngine::cLoop::cLoop() :
+    m_iEpollFD(epoll_create1(EPOLL_CLOEXEC)),
+    m_iEventFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+}
+
+cTCPEventEngine::cLoop::~cLoop()
+{
+    if(m_iEpollFD >= 0)
+        ::close(m_iEpollFD);
+
+    if(m_iEventFD >= 0)
+        ::close(m_iEventFD);
+}
+
+cTCPEventEngine::cRelease::cRelease() :
+    m_iFD(-1),
+    m_bDone(false)
+{
+}
+
+cTCPEventEngine::cTCPEventEngine(const string &strName) :
+    m_u32NextLoopNo(0),
+    m_bStopRequested(false),
+    m_u32MaxLineLength_B(0),
+    m_u64NextConnectionID(1),
+    m_u32CancelCount(0),
+    m_u64NLinesReceived(0),
+    m_u64NBytesReceived(0),
+    m_u64NBytesSent(0),
+    m_u64NTimeouts(0),
+    m_strName(strName)
+{
+}
+
+cTCPEventEngine::~cTCPEventEngine()
+{
+    stop();
+}
+
+bool cTCPEventEngine::start(const string &strDelimiter, uint32_t u32NThreads, const boost::function<void (const cEvent &oEvent)> &fnEventHandler,
+                            uint32_t u32MaxLineLength_B)
+{
+    stop();
+
+    if(strDelimiter.empty() || !u32NThreads || !u32MaxLineLength_B)
+    {
+        cout << "cTCPEventEngine::start(): Need a delimiter, at least one thread and a maximum line length." << endl;
+        return false;
+    }
+
+    m_strDelimiter = strDelimiter;
+    m_u32MaxLineLength_B = u32MaxLineLength_B;
+    m_fnEventHandler = fnEventHandler;
+    m_bStopRequested = false;
+
+    for(uint32_t u32LoopNo = 0; u32LoopNo < u32NThreads; u32LoopNo++)
+    {
+        boost::shared_ptr<cLoop> pLoop(new cLoop());
+
+        epoll_event oEvent;
+        memset(&oEvent, 0, sizeof(oEvent));
+        oEvent.events = EPOLLIN;
+        oEvent.data.u64 = EVENT_FD_ID;
+
+        if(pLoop->m_iEpollFD < 0 || pLoop->m_iEventFD < 0 || epoll_ctl(pLoop->m_iEpollFD, EPOLL_CTL_ADD, pLoop->m_iEventFD, &oEvent) != 0)
+        {
+            cout << "cTCPEventEngine::start(): Unable to set up epoll: " << strerror(errno) << endl;
+            stop();
+            return false;
+        }
+
+        m_vpLoops.push_back(pLoop);
+    }
+
+    for(uint32_t u32LoopNo = 0; u32LoopNo < m_vpLoops.size(); u32LoopNo++)
+        m_vpLoops[u32LoopNo]->m_pThread.reset(new boost::thread(boost::bind(&cTCPEventEngine::eventThreadFunction, this, m_vpLoops[u32LoopNo].get())));
+
+    return true;
+}
+
+void cTCPEventEngine::stop()
+{
+    if(m_vpLoops.empty())
+        return;
+
+    m_bStopRequested = true;
+
+    //Releases waiting for their command
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oReleaseMutex);
+        m_oReleaseCondition.notify_all();
+    }
+
+    for(uint32_t u32LoopNo = 0; u32LoopNo < m_vpLoops.size(); u32LoopNo++)
+    {
+        cLoop &oLoop = *m_vpLoops[u32LoopNo];
+
+        if(!oLoop.m_pThread)
+            continue;
+
+        uint64_t u64Value = 1;
+        if(write(oLoop.m_iEventFD, &u64Value, sizeof(u64Value)) < 0)
+            cout << "cTCPEventEngine::stop(): Unable to wake event thread: " << strerror(errno) << endl;
+
+        oLoop.m_pThread->join();
+        oLoop.m_pThread.reset();
+    }
+
+    //The event threads are gone, so whatever is left is ours
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+
+        for(map<uint64_t, boost::shared_ptr<cConnection> >::iterator itConnection = m_oConnections.begin(); itConnection != m_oConnections.end(); ++itConnection)
+        {
+            cConnection &oConnection = *itConnection->second;
+
+            boost::lock_guard<boost::mutex> oOutputLock(oConnection.m_oOutputMutex);
+            if(!oConnection.m_bClosed)
+            {
+                ::close(oConnection.m_iFD);
+                oConnection.m_bClosed = true;
+            }
+        }
+
+        m_oConnections.clear();
+    }
+
+    //Commands still queued may hold connections and releases
+    m_vpLoops.clear();
+
+    //Waiters for events that won't come
+    cancelCurrrentOperations();
+}
+
+bool cTCPEventEngine::isRunning() const
+{
+    return !m_vpLoops.empty() && !m_bStopRequested;
+}
+
+uint64_t cTCPEventEngine::connect(const boost::asio::ip::tcp::endpoint &oPeerEndpoint, uint32_t u32ConnectTimeout_ms, uint32_t u32IdleTimeout_ms)
+{
+    if(!isRunning())
+    {
+        cout << "cTCPEventEngine::connect(): Not running." << endl;
+        return 0;
+    }
+
+    if(!oPeerEndpoint.address().is_v4())
+    {
+        cout << "cTCPEventEngine::connect(): " << oPeerEndpoint << " is not an IPv4 address." << endl;
+        return 0;
+    }
+
+    int iFD = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(iFD < 0)
+    {
+        cout << "cTCPEventEngine::connect(): Unable to create socket: " << strerror(errno) << endl;
+        return 0;
+    }
+
+    //Completion (also an immediate one) is reported by epoll as the socket becoming writable
+    if(::connect(iFD, oPeerEndpoint.data(), oPeerEndpoint.size()) != 0 && errno != EINPROGRESS)
+    {
+        cout << "cTCPEventEngine::connect(): Unable to connect to " << oPeerEndpoint << ": " << strerror(errno) << endl;
+        ::close(iFD);
+        return 0;
+    }
+
+    uint64_t u64ConnectionID = addConnection(iFD, true, "", (int64_t)u32ConnectTimeout_ms * 1000000, (int64_t)u32IdleTimeout_ms * 1000000);
+    if(!u64ConnectionID)
+        ::close(iFD);
+
+    return u64ConnectionID;
+}
+
+uint64_t cTCPEventEngine::adoptSocket(cInterruptibleBlockingTCPSocket &oSocket, uint32_t u32IdleTimeout_ms)
+{
+    if(!isRunning())
+    {
+        cout << "cTCPEventEngine::adoptSocket(): Not running." << endl;
+        return 0;
+    }
+
+    int iFD;
+    string strUnreadData;
+
+    if(!oSocket.detachDescriptor(iFD, strUnreadData))
+        return 0;
+
+    if(!setNonBlocking(iFD, true))
+    {
+        cout << "cTCPEventEngine::adoptSocket(): Unable to make socket non-blocking: " << strerror(errno) << endl;
+        ::close(iFD);
+        return 0;
+    }
+
+    uint64_t u64ConnectionID = addConnection(iFD, false, strUnreadData, 0, (int64_t)u32IdleTimeout_ms * 1000000);
+    if(!u64ConnectionID)
+        ::close(iFD);
+
+    return u64ConnectionID;
+}
+
+bool cTCPEventEngine::releaseToSocket(uint64_t u64ConnectionID, cInterruptibleBlockingTCPSocket &oSocket, uint32_t u32Timeout_ms)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return false;
+
+    //Shared with the command, which may outlive this call if the engine is stopped meanwhile
+    boost::shared_ptr<cRelease> pRelease(new cRelease());
+
+    post(pConnection->m_pLoop, boost::bind(&cTCPEventEngine::processRelease, this, u64ConnectionID, pRelease));
+
+    {
+        boost::unique_lock<boost::mutex> oLock(m_oReleaseMutex);
+
+        //stop() notifies as well, as the command may never run
+        while(!pRelease->m_bDone && !m_bStopRequested)
+            m_oReleaseCondition.wait(oLock);
+
+        if(!pRelease->m_bDone)
+            return false;
+    }
+
+    if(pRelease->m_iFD < 0)
+        return false;
+
+    if(!oSocket.attachDescriptor(pRelease->m_iFD, pRelease->m_strUnreadData))
+    {
+        ::close(pRelease->m_iFD);
+        return false;
+    }
+
+    if(!pRelease->m_strUnsentData.empty())
+        return oSocket.write(pRelease->m_strUnsentData, u32Timeout_ms);
+
+    return true;
+}
+
+bool cTCPEventEngine::send(uint64_t u64ConnectionID, const char *cpData, uint32_t u32NBytes)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return false;
+
+    cConnection &oConnection = *pConnection;
+    bool bPost;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(oConnection.m_oOutputMutex);
+
+        if(oConnection.m_bClosed || oConnection.m_bCloseRequested)
+            return false;
+
+        //Drop what has been sent once it is the larger part
+        if(oConnection.m_u32OutputStart && oConnection.m_u32OutputStart >= oConnection.m_vcOutput.size() / 2)
+        {
+            oConnection.m_vcOutput.erase(oConnection.m_vcOutput.begin(), oConnection.m_vcOutput.begin() + oConnection.m_u32OutputStart);
+            oConnection.m_u32OutputStart = 0;
+        }
+
+        oConnection.m_vcOutput.insert(oConnection.m_vcOutput.end(), cpData, cpData + u32NBytes);
+
+        //One write command covers everything queued until it runs
+        bPost = !oConnection.m_bWritePosted;
+        oConnection.m_bWritePosted = true;
+    }
+
+    if(bPost)
+        post(oConnection.m_pLoop, boost::bind(&cTCPEventEngine::processWrite, this, u64ConnectionID));
+
+    return true;
+}
+
+bool cTCPEventEngine::send(uint64_t u64ConnectionID, const string &strData)
+{
+    return send(u64ConnectionID, strData.data(), strData.length());
+}
+
+void cTCPEventEngine::setIdleTimeout(uint64_t u64ConnectionID, uint32_t u32IdleTimeout_ms)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return;
+
+    post(pConnection->m_pLoop, boost::bind(&cTCPEventEngine::processSetIdleTimeout, this, u64ConnectionID, (int64_t)u32IdleTimeout_ms * 1000000));
+}
+
+void cTCPEventEngine::close(uint64_t u64ConnectionID)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return;
+
+    cConnection &oConnection = *pConnection;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(oConnection.m_oOutputMutex);
+
+        if(oConnection.m_bClosed || oConnection.m_bCloseRequested)
+            return;
+
+        oConnection.m_bCloseRequested = true;
+    }
+
+    //The write command closes once the output is drained
+    post(oConnection.m_pLoop, boost::bind(&cTCPEventEngine::processWrite, this, u64ConnectionID));
+}
+
+bool cTCPEventEngine::getNextEvent(cEvent &oEvent, uint32_t u32Timeout_ms)
+{
+    uint32_t u32CancelCount = m_u32CancelCount.load();
+    boost::system_time oDeadline = boost::get_system_time() + boost::posix_time::milliseconds(u32Timeout_ms);
+
+    boost::unique_lock<boost::mutex> oLock(m_oEventsMutex);
+
+    while(m_dqEvents.empty())
+    {
+        if(u32CancelCount != m_u32CancelCount.load())
+            return false;
+
+        if(u32Timeout_ms)
+        {
+            if(!m_oEventsCondition.timed_wait(oLock, oDeadline) && m_dqEvents.empty())
+                return false;
+        }
+        else
+        {
+            m_oEventsCondition.wait(oLock);
+        }
+    }
+
+    oEvent = m_dqEvents.front();
+    m_dqEvents.pop_front();
+
+    return true;
+}
+
+void cTCPEventEngine::cancelCurrrentOperations()
+{
+    m_u32CancelCount++;
+
+    boost::lock_guard<boost::mutex> oLock(m_oEventsMutex);
+    m_oEventsCondition.notify_all();
+}
+
+string cTCPEventEngine::getName() const
+{
+    return m_strName;
+}
+
+uint32_t cTCPEventEngine::getNConnections()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+    return m_oConnections.size();
+}
+
+uint32_t cTCPEventEngine::getNEventsQueued()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oEventsMutex);
+    return m_dqEvents.size();
+}
+
+uint64_t cTCPEventEngine::getNLinesReceived() const
+{
+    return m_u64NLinesReceived.load();
+}
+
+uint64_t cTCPEventEngine::getNBytesReceived() const
+{
+    return m_u64NBytesReceived.load();
+}
+
+uint64_t cTCPEventEngine::getNBytesSent() const
+{
+    return m_u64NBytesSent.load();
+}
+
+uint64_t cTCPEventEngine::getNTimeouts() const
+{
+    return m_u64NTimeouts.load();
+}
+
+void cTCPEventEngine::eventThreadFunction(cLoop *pLoop)
+{
+    vector<epoll_event> voEvents(MAX_EVENTS_PER_WAIT);
+    vector<uint64_t> vu64ExpiredIDs;
+    deque<boost::function<void ()> > dqCommands;
+
+    while(!m_bStopRequested)
+    {
+        int iTimeout_ms = pLoop->m_oTimerWheel.getTimeToNextTick_ms(cSocketReadinessWaiter::getCurrentTime_ns());
+
+        int iNEvents = epoll_wait(pLoop->m_iEpollFD, &voEvents[0], voEvents.size(), iTimeout_ms);
+        if(iNEvents < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            cout << "cTCPEventEngine::eventThreadFunction(): epoll_wait() failed: " << strerror(errno) << endl;
+            break;
+        }
+
+        for(int iEventNo = 0; iEventNo < iNEvents; iEventNo++)
+        {
+            uint64_t u64ConnectionID = voEvents[iEventNo].data.u64;
+
+            if(u64ConnectionID == EVENT_FD_ID)
+            {
+                uint64_t u64Value;
+                if(read(pLoop->m_iEventFD, &u64Value, sizeof(u64Value)) < 0 && errno != EAGAIN)
+                    cout << "cTCPEventEngine::eventThreadFunction(): Unable to read eventfd: " << strerror(errno) << endl;
+                continue;
+            }
+
+            //An earlier event in this batch may have closed it
+            map<uint64_t, cConnection*>::iterator itConnection = pLoop->m_oConnections.find(u64ConnectionID);
+            if(itConnection == pLoop->m_oConnections.end())
+                continue;
+
+            cConnection &oConnection = *itConnection->second;
+            uint32_t u32Events = voEvents[iEventNo].events;
+
+            if(oConnection.m_bConnecting)
+            {
+                handleConnected(oConnection);
+                continue;
+            }
+
+            if(u32Events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                handleReadable(oConnection);
+
+                if(pLoop->m_oConnections.find(u64ConnectionID) == pLoop->m_oConnections.end())
+                    continue;
+            }
+
+            if(u32Events & EPOLLOUT)
+                handleWritable(oConnection);
+        }
+
+        {
+            boost::lock_guard<boost::mutex> oLock(pLoop->m_oMutex);
+            dqCommands.swap(pLoop->m_dqCommands);
+        }
+
+        for(uint32_t u32CommandNo = 0; u32CommandNo < dqCommands.size(); u32CommandNo++)
+            dqCommands[u32CommandNo]();
+
+        dqCommands.clear();
+
+        int64_t i64Now_ns = cSocketReadinessWaiter::getCurrentTime_ns();
+
+        vu64ExpiredIDs.clear();
+        pLoop->m_oTimerWheel.expire(i64Now_ns, vu64ExpiredIDs);
+
+        for(uint32_t u32TimerNo = 0; u32TimerNo < vu64ExpiredIDs.size(); u32TimerNo++)
+            handleTimer(*pLoop, vu64ExpiredIDs[u32TimerNo], i64Now_ns);
+    }
+}
+
+void cTCPEventEngine::post(cLoop *pLoop, const boost::function<void ()> &fnCommand)
+{
+    bool bWake;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(pLoop->m_oMutex);
+
+        //Otherwise a wake up is already pending for the earlier commands
+        bWake = pLoop->m_dqCommands.empty();
+        pLoop->m_dqCommands.push_back(fnCommand);
+    }
+
+    if(bWake)
+    {
+        uint64_t u64Value = 1;
+        if(write(pLoop->m_iEventFD, &u64Value, sizeof(u64Value)) < 0)
+            cout << "cTCPEventEngine::post(): Unable to wake event thread: " << strerror(errno) << endl;
+    }
+}
+
+boost::shared_ptr<cTCPEventEngine::cConnection> cTCPEventEngine::findConnection(uint64_t u64ConnectionID)
+{
+    boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+
+    map<uint64_t, boost::shared_ptr<cConnection> >::iterator itConnection = m_oConnections.find(u64ConnectionID);
+    if(itConnection == m_oConnections.end())
+        return boost::shared_ptr<cConnection>();
+
+    return itConnection->second;
+}
+
+uint64_t cTCPEventEngine::addConnection(int iFD, bool bConnecting, const string &strUnreadData, int64_t i64Timeout_ns, int64_t i64IdleTimeout_ns)
+{
+    uint64_t u64ConnectionID = m_u64NextConnectionID++;
+    cLoop *pLoop = m_vpLoops[m_u32NextLoopNo++ % m_vpLoops.size()].get();
+
+    boost::shared_ptr<cConnection> pConnection(new cConnection(u64ConnectionID, iFD, pLoop));
+    pConnection->m_bConnecting = bConnecting;
+    pConnection->m_i64IdleTimeout_ns = i64IdleTimeout_ns;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+        m_oConnections[u64ConnectionID] = pConnection;
+    }
+
+    post(pLoop, boost::bind(&cTCPEventEngine::registerConnection, this, pConnection, strUnreadData, i64Timeout_ns));
+
+    return u64ConnectionID;
+}
+
+void cTCPEventEngine::registerConnection(boost::shared_ptr<cConnection> pConnection, string strUnreadData, int64_t i64Timeout_ns)
+{
+    cConnection &oConnection = *pConnection;
+    cLoop &oLoop = *oConnection.m_pLoop;
+
+    oLoop.m_oConnections[oConnection.m_u64ID] = &oConnection;
+
+    epoll_event oEvent;
+    memset(&oEvent, 0, sizeof(oEvent));
+    oEvent.events = oConnection.m_bConnecting ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+    oEvent.data.u64 = oConnection.m_u64ID;
+
+    if(epoll_ctl(oLoop.m_iEpollFD, EPOLL_CTL_ADD, oConnection.m_iFD, &oEvent) != 0)
+    {
+        boost::system::error_code oError = getErrno();
+        cout << "cTCPEventEngine::registerConnection(): Unable to add socket to epoll: " << oError.message() << endl;
+
+        if(oConnection.m_bConnecting)
+        {
+            uint64_t u64ConnectionID = oConnection.m_u64ID;
+            closeConnection(oConnection, boost::system::error_code());
+            deliver(cEvent::CONNECTED, u64ConnectionID, oError);
+        }
+        else
+        {
+            closeConnection(oConnection, oError);
+        }
+
+        return;
+    }
+
+    oConnection.m_bWaitingToWrite = oConnection.m_bConnecting;
+
+    int64_t i64Now_ns = cSocketReadinessWaiter::getCurrentTime_ns();
+
+    if(oConnection.m_bConnecting)
+    {
+        if(i64Timeout_ns)
+            setDeadline(oConnection, i64Now_ns + i64Timeout_ns);
+
+        return;
+    }
+
+    if(oConnection.m_i64IdleTimeout_ns)
+        setDeadline(oConnection, i64Now_ns + oConnection.m_i64IdleTimeout_ns);
+
+    if(!strUnreadData.empty())
+    {
+        oConnection.m_vcInput.assign(strUnreadData.begin(), strUnreadData.end());
+        oConnection.m_u32InputEnd = strUnreadData.length();
+
+        deliverLines(oConnection);
+    }
+}
+
+void cTCPEventEngine::handleConnected(cConnection &oConnection)
+{
+    int iError = 0;
+    socklen_t iLength = sizeof(iError);
+
+    if(getsockopt(oConnection.m_iFD, SOL_SOCKET, SO_ERROR, &iError, &iLength) != 0)
+        iError = errno;
+
+    epoll_event oEvent;
+    memset(&oEvent, 0, sizeof(oEvent));
+    oEvent.events = EPOLLIN | EPOLLRDHUP;
+    oEvent.data.u64 = oConnection.m_u64ID;
+
+    if(!iError && epoll_ctl(oConnection.m_pLoop->m_iEpollFD, EPOLL_CTL_MOD, oConnection.m_iFD, &oEvent) != 0)
+        iError = errno;
+
+    if(iError)
+    {
+        uint64_t u64ConnectionID = oConnection.m_u64ID;
+        closeConnection(oConnection, boost::system::error_code());
+        deliver(cEvent::CONNECTED, u64ConnectionID, boost::system::error_code(iError, boost::asio::error::get_system_category()));
+        return;
+    }
+
+    oConnection.m_bConnecting = false;
+    oConnection.m_bWaitingToWrite = false;
+
+    //The connect timeout ends and the idle timeout starts
+    oConnection.m_i64Deadline_ns = 0;
+    if(oConnection.m_i64IdleTimeout_ns)
+        setDeadline(oConnection, cSocketReadinessWaiter::getCurrentTime_ns() + oConnection.m_i64IdleTimeout_ns);
+
+    deliver(cEvent::CONNECTED, oConnection.m_u64ID);
+
+    //Data may have been queued while connecting
+    handleWritable(oConnection);
+}
+
+void cTCPEventEngine::handleReadable(cConnection &oConnection)
+{
+    bool bReceived = false;
+
+    for(uint32_t u32ReadNo = 0; u32ReadNo < MAX_READS_PER_EVENT; u32ReadNo++)
+    {
+        if(oConnection.m_u32InputStart == oConnection.m_u32InputEnd)
+        {
+            oConnection.m_u32InputStart = 0;
+            oConnection.m_u32InputEnd = 0;
+        }
+
+        //Make room by moving the partial line to the front before growing the buffer
+        if(oConnection.m_vcInput.size() - oConnection.m_u32InputEnd < MIN_READ_SIZE_B)
+        {
+            if(oConnection.m_u32InputStart)
+            {
+                memmove(&oConnection.m_vcInput[0], &oConnection.m_vcInput[oConnection.m_u32InputStart], oConnection.m_u32InputEnd - oConnection.m_u32InputStart);
+                oConnection.m_u32InputEnd -= oConnection.m_u32InputStart;
+                oConnection.m_u32InputStart = 0;
+            }
+
+            if(oConnection.m_vcInput.size() - oConnection.m_u32InputEnd < MIN_READ_SIZE_B)
+                oConnection.m_vcInput.resize(max<size_t>(oConnection.m_vcInput.size() * 2, oConnection.m_u32InputEnd + MIN_READ_SIZE_B));
+        }
+
+        ssize_t iNBytes = recv(oConnection.m_iFD, &oConnection.m_vcInput[oConnection.m_u32InputEnd], oConnection.m_vcInput.size() - oConnection.m_u32InputEnd, MSG_DONTWAIT);
+
+        if(iNBytes > 0)
+        {
+            oConnection.m_u32InputEnd += iNBytes;
+            m_u64NBytesReceived += iNBytes;
+            bReceived = true;
+
+            if(!deliverLines(oConnection))
+                return;
+
+            continue;
+        }
+
+        if(iNBytes == 0)
+        {
+            closeConnection(oConnection, boost::asio::error::eof);
+            return;
+        }
+
+        if(errno == EINTR)
+            continue;
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+
+        closeConnection(oConnection, getErrno());
+        return;
+    }
+
+    //Only moves the deadline. The timer wheel entry is checked against it when it fires.
+    if(bReceived && oConnection.m_i64IdleTimeout_ns)
+        setDeadline(oConnection, cSocketReadinessWaiter::getCurrentTime_ns() + oConnection.m_i64IdleTimeout_ns);
+}
+
+bool cTCPEventEngine::deliverLines(cConnection &oConnection)
+{
+    for(;;)
+    {
+        uint32_t u32NBytesBuffered = oConnection.m_u32InputEnd - oConnection.m_u32InputStart;
+        if(!u32NBytesBuffered)
+            break;
+
+        const char *cpStart = &oConnection.m_vcInput[oConnection.m_u32InputStart];
+        const char *cpEnd = cpStart + u32NBytesBuffered;
+
+        const char *cpDelimiter = cInterruptibleBlockingTCPSocket::findDelimiter(cpStart + oConnection.m_u32SearchOffset, cpEnd, m_strDelimiter);
+
+        if(!cpDelimiter)
+        {
+            //A delimiter may straddle the end of what we have so far
+            oConnection.m_u32SearchOffset = u32NBytesBuffered >= m_strDelimiter.length() ? u32NBytesBuffered - m_strDelimiter.length() + 1 : 0;
+            break;
+        }
+
+        uint32_t u32LineLength_B = cpDelimiter - cpStart + m_strDelimiter.length();
+
+        cEvent oEvent;
+        oEvent.m_eType = cEvent::LINE;
+        oEvent.m_u64ConnectionID = oConnection.m_u64ID;
+        oEvent.m_strData.assign(cpStart, u32LineLength_B);
+
+        oConnection.m_u32InputStart += u32LineLength_B;
+        oConnection.m_u32SearchOffset = 0;
+
+        m_u64NLinesReceived++;
+        deliver(oEvent);
+    }
+
+    if(oConnection.m_u32InputEnd - oConnection.m_u32InputStart > m_u32MaxLineLength_B)
+    {
+        closeConnection(oConnection, boost::asio::error::message_size);
+        return false;
+    }
+
+    return true;
+}
+
+void cTCPEventEngine::handleWritable(cConnection &oConnection)
+{
+    bool bWaitForWrite = false;
+    bool bClose = false;
+    boost::system::error_code oError;
+
+    {
+        boost::lock_guard<boost::mutex> oLock(oConnection.m_oOutputMutex);
+
+        oConnection.m_bWritePosted = false;
+
+        while(oConnection.m_u32OutputStart < oConnection.m_vcOutput.size())
+        {
+            ssize_t iNBytes = ::send(oConnection.m_iFD, &oConnection.m_vcOutput[oConnection.m_u32OutputStart], oConnection.m_vcOutput.size() - oConnection.m_u32OutputStart,
+                                     MSG_DONTWAIT | MSG_NOSIGNAL);
+
+            if(iNBytes > 0)
+            {
+                oConnection.m_u32OutputStart += iNBytes;
+                m_u64NBytesSent += iNBytes;
+                continue;
+            }
+
+            if(iNBytes < 0 && errno == EINTR)
+                continue;
+
+            if(iNBytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                bWaitForWrite = true;
+                break;
+            }
+
+            oError = iNBytes < 0 ? getErrno() : boost::asio::error::connection_reset;
+            break;
+        }
+
+        if(!bWaitForWrite && !oError)
+        {
+            oConnection.m_vcOutput.clear();
+            oConnection.m_u32OutputStart = 0;
+
+            bClose = oConnection.m_bCloseRequested;
+        }
+    }
+
+    if(oError)
+    {
+        closeConnection(oConnection, oError);
+        return;
+    }
+
+    if(bClose)
+    {
+        closeConnection(oConnection, boost::asio::error::operation_aborted);
+        return;
+    }
+
+    updateEpoll(oConnection, bWaitForWrite);
+}
+
+void cTCPEventEngine::handleTimer(cLoop &oLoop, uint64_t u64ConnectionID, int64_t i64Now_ns)
+{
+    map<uint64_t, cConnection*>::iterator itConnection = oLoop.m_oConnections.find(u64ConnectionID);
+    if(itConnection == oLoop.m_oConnections.end())
+        return;
+
+    cConnection &oConnection = *itConnection->second;
+
+    //The earliest entry is due by now, so this is it or a later duplicate
+    if(oConnection.m_i64ScheduledDeadline_ns && oConnection.m_i64ScheduledDeadline_ns <= i64Now_ns)
+        oConnection.m_i64ScheduledDeadline_ns = 0;
+
+    if(!oConnection.m_i64Deadline_ns)
+        return;
+
+    //Activity moved the deadline since the entry was made
+    if(oConnection.m_i64Deadline_ns > i64Now_ns)
+    {
+        setDeadline(oConnection, oConnection.m_i64Deadline_ns);
+        return;
+    }
+
+    if(oConnection.m_bConnecting)
+    {
+        closeConnection(oConnection, boost::system::error_code());
+        deliver(cEvent::CONNECTED, u64ConnectionID, boost::asio::error::timed_out);
+        return;
+    }
+
+    m_u64NTimeouts++;
+
+    oConnection.m_i64Deadline_ns = 0;
+    if(oConnection.m_i64IdleTimeout_ns)
+        setDeadline(oConnection, i64Now_ns + oConnection.m_i64IdleTimeout_ns);
+
+    deliver(cEvent::TIMED_OUT, u64ConnectionID, boost::asio::error::timed_out);
+}
+
+void cTCPEventEngine::processWrite(uint64_t u64ConnectionID)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return;
+
+    //Writes wait until the connect has finished
+    if(pConnection->m_bConnecting)
+        return;
+
+    handleWritable(*pConnection);
+}
+
+void cTCPEventEngine::processRelease(uint64_t u64ConnectionID, boost::shared_ptr<cRelease> pRelease)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+
+    if(pConnection && !pConnection->m_bConnecting)
+    {
+        cConnection &oConnection = *pConnection;
+        cLoop &oLoop = *oConnection.m_pLoop;
+
+        epoll_ctl(oLoop.m_iEpollFD, EPOLL_CTL_DEL, oConnection.m_iFD, NULL);
+        oLoop.m_oConnections.erase(u64ConnectionID);
+
+        {
+            boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+            m_oConnections.erase(u64ConnectionID);
+        }
+
+        {
+            boost::lock_guard<boost::mutex> oLock(oConnection.m_oOutputMutex);
+
+            oConnection.m_bClosed = true;
+
+            if(oConnection.m_u32OutputStart < oConnection.m_vcOutput.size())
+                pRelease->m_strUnsentData.assign(&oConnection.m_vcOutput[oConnection.m_u32OutputStart], oConnection.m_vcOutput.size() - oConnection.m_u32OutputStart);
+        }
+
+        if(oConnection.m_u32InputStart < oConnection.m_u32InputEnd)
+            pRelease->m_strUnreadData.assign(&oConnection.m_vcInput[oConnection.m_u32InputStart], oConnection.m_u32InputEnd - oConnection.m_u32InputStart);
+
+        if(setNonBlocking(oConnection.m_iFD, false))
+        {
+            pRelease->m_iFD = oConnection.m_iFD;
+        }
+        else
+        {
+            cout << "cTCPEventEngine::processRelease(): Unable to make socket blocking: " << strerror(errno) << endl;
+            ::close(oConnection.m_iFD);
+        }
+    }
+
+    boost::lock_guard<boost::mutex> oLock(m_oReleaseMutex);
+    pRelease->m_bDone = true;
+    m_oReleaseCondition.notify_all();
+}
+
+void cTCPEventEngine::processSetIdleTimeout(uint64_t u64ConnectionID, int64_t i64IdleTimeout_ns)
+{
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+    if(!pConnection)
+        return;
+
+    cConnection &oConnection = *pConnection;
+    oConnection.m_i64IdleTimeout_ns = i64IdleTimeout_ns;
+
+    //The connect timeout stays in force until connected
+    if(oConnection.m_bConnecting)
+        return;
+
+    oConnection.m_i64Deadline_ns = 0;
+    if(i64IdleTimeout_ns)
+        setDeadline(oConnection, cSocketReadinessWaiter::getCurrentTime_ns() + i64IdleTimeout_ns);
+}
+
+void cTCPEventEngine::setDeadline(cConnection &oConnection, int64_t i64Deadline_ns)
+{
+    oConnection.m_i64Deadline_ns = i64Deadline_ns;
+
+    //A later deadline is picked up when the earlier entry fires
+    if(!oConnection.m_i64ScheduledDeadline_ns || i64Deadline_ns < oConnection.m_i64ScheduledDeadline_ns)
+    {
+        oConnection.m_pLoop->m_oTimerWheel.schedule(oConnection.m_u64ID, i64Deadline_ns);
+        oConnection.m_i64ScheduledDeadline_ns = i64Deadline_ns;
+    }
+}
+
+void cTCPEventEngine::updateEpoll(cConnection &oConnection, bool bWaitForWrite)
+{
+    if(oConnection.m_bWaitingToWrite == bWaitForWrite)
+        return;
+
+    epoll_event oEvent;
+    memset(&oEvent, 0, sizeof(oEvent));
+    oEvent.events = EPOLLIN | EPOLLRDHUP | (bWaitForWrite ? (uint32_t)EPOLLOUT : 0u);
+    oEvent.data.u64 = oConnection.m_u64ID;
+
+    if(epoll_ctl(oConnection.m_pLoop->m_iEpollFD, EPOLL_CTL_MOD, oConnection.m_iFD, &oEvent) != 0)
+    {
+        closeConnection(oConnection, getErrno());
+        return;
+    }
+
+    oConnection.m_bWaitingToWrite = bWaitForWrite;
+}
+
+void cTCPEventEngine::closeConnection(cConnection &oConnection, const boost::system::error_code &oError)
+{
+    uint64_t u64ConnectionID = oConnection.m_u64ID;
+    cLoop &oLoop = *oConnection.m_pLoop;
+
+    //Keeps oConnection alive until we are done with it
+    boost::shared_ptr<cConnection> pConnection = findConnection(u64ConnectionID);
+
+    epoll_ctl(oLoop.m_iEpollFD, EPOLL_CTL_DEL, oConnection.m_iFD, NULL);
+    oLoop.m_oConnections.erase(u64ConnectionID);
+
+    {
+        boost::lock_guard<boost::mutex> oLock(m_oConnectionsMutex);
+        m_oConnections.erase(u64ConnectionID);
+    }
+
+    {
+        boost::lock_guard<boost::mutex> oLock(oConnection.m_oOutputMutex);
+
+        ::close(oConnection.m_iFD);
+        oConnection.m_bClosed = true;
+        oConnection.m_vcOutput.clear();
+        oConnection.m_u32OutputStart = 0;
+    }
+
+    //After the removal, so that the handler sees the connection gone
+    if(oError)
+        deliver(cEvent::CLOSED, u64ConnectionID, oError);
+}
+
+void cTCPEventEngine::deliver(const cEvent &oEvent)
+{
+    if(m_fnEventHandler)
+    {
+        m_fnEventHandler(oEvent);
+        return;
+    }
+
+    boost::lock_guard<boost::mutex> oLock(m_oEventsMutex);
+
+    m_dqEvents.push_back(oEvent);
+    m_oEventsCondition.notify_one();
+}
+
+void cTCPEventEngine::deliver(cEvent::eType eType, uint64_t u64ConnectionID, const boost::system::error_code &oError)
+{
+    cEvent oEvent;
+    oEvent.m_eType = eType;
+    oEvent.m_u64ConnectionID = u64ConnectionID;
+    oEvent.m_oError = oError;
+
+    deliver(oEvent);
+}
+
+#endif // __linux__
@@ -0,0 +1,236 @@
+#ifndef TCP_EVENT_ENGINE_H
+#define TCP_EVENT_ENGINE_H
+
+//Event driven handling of many TCP connections on a few threads. Linux only.
+//
+//Each cInterruptibleBlockingTCPSocket call blocks its thread, so talking to thousands of peers at once takes thousands
+//of threads. The engine instead spreads connections over a small number of event threads, each waiting on its own
+//epoll set. Incoming data is split into lines at a delimiter exactly as readUntil() does, and each line is delivered as
+//an event, either to a handler called on the event thread or to a queue read with getNextEvent(). Sends are queued and
+//written as the socket accepts them. Per-connection timeouts are kept in a timer wheel per thread.
+//
+//Connections are identified by IDs, which are never reused. Connections can be made by the engine, or taken over from
+//a connected cInterruptibleBlockingTCPSocket with adoptSocket() and handed back with releaseToSocket() for code that
+//still wants synchronous calls.
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/system/error_code.hpp>
+#endif
+
+//Local includes
+#include "InterruptibleBlockingTCPSocket.h"
+#include "TimerWheel.h"
+
+class cTCPEventEngine
+{
+public:
+    class cEvent
+    {
+    public:
+        enum eType
+        {
+            LINE,       //m_strData holds one line including the delimiter
+            CONNECTED,  //connect() finished. On an error (e.g. timed_out) the connection is already gone.
+            TIMED_OUT,  //Nothing received for the idle timeout. The connection stays open and the timeout restarts.
+            CLOSED      //By the peer (eof), an error, an overlong line (message_size) or close() (operation_aborted)
+        };
+
+        cEvent();
+
+        eType                           m_eType;
+        uint64_t                        m_u64ConnectionID;
+        std::string                     m_strData;
+        boost::system::error_code       m_oError;
+    };
+
+    cTCPEventEngine(const std::string &strName = "");
+    ~cTCPEventEngine();
+
+    //Starts the event threads. With fnEventHandler events are passed to it on the event thread of their connection,
+    //so it must not block (calls to this class other than releaseToSocket() are fine). Without it they are queued for
+    //getNextEvent(). Lines longer than u32MaxLineLength_B without a delimiter close the connection.
+    bool                                start(const std::string &strDelimiter = "\n", uint32_t u32NThreads = 1,
+                                              const boost::function<void (const cEvent &oEvent)> &fnEventHandler = boost::function<void (const cEvent &oEvent)>(),
+                                              uint32_t u32MaxLineLength_B = 64 * 1024);
+    //Closes all connections without further events
+    void                                stop();
+
+    bool                                isRunning() const;
+
+    //Starts a connect without waiting for it and returns the new connection's ID (0 if it couldn't be started). A
+    //CONNECTED event follows. The timeouts of 0 disable them. The idle timeout starts once connected.
+    //Host names must be resolved beforehand (e.g. with cInterruptibleBlockingResolver) because a lookup can block for
+    //seconds and connect() may be called from a handler on an event thread. IPv4 only, as the socket classes.
+    uint64_t                            connect(const boost::asio::ip::tcp::endpoint &oPeerEndpoint, uint32_t u32ConnectTimeout_ms = 0,
+                                                uint32_t u32IdleTimeout_ms = 0);
+    //Takes over the connection of a blocking socket, which is left closed. Data it had read but not consumed yet is
+    //framed first. Returns the connection's ID or 0 on failure.
+    uint64_t                            adoptSocket(cInterruptibleBlockingTCPSocket &oSocket, uint32_t u32IdleTimeout_ms = 0);
+    //Hands a connection to a blocking socket, sending any data still queued with it. Received data not yet delivered
+    //as a line is returned by the socket's next reads. No more events follow for the connection. Not from the handler.
+    bool                                releaseToSocket(uint64_t u64ConnectionID, cInterruptibleBlockingTCPSocket &oSocket, uint32_t u32Timeout_ms = 0);
+
+    //Queue data for sending. Returns false if the connection is unknown or closed.
+    bool                                send(uint64_t u64ConnectionID, const char *cpData, uint32_t u32NBytes);
+    bool                                send(uint64_t u64ConnectionID, const std::string &strData);
+    void                                setIdleTimeout(uint64_t u64ConnectionID, uint32_t u32IdleTimeout_ms);
+    //Closes the connection once queued data has been sent. A CLOSED event (operation_aborted) follows.
+    void                                close(uint64_t u64ConnectionID);
+
+    //Queue based delivery (no handler given to start()). A timeout of 0 waits indefinitely.
+    bool                                getNextEvent(cEvent &oEvent, uint32_t u32Timeout_ms = 0);
+    //Wake any thread blocked in getNextEvent(). It returns false.
+    void                                cancelCurrrentOperations();
+
+    //Some accessors
+    std::string                         getName() const;
+
+    uint32_t                            getNConnections();
+    uint32_t                            getNEventsQueued();
+    uint64_t                            getNLinesReceived() const;
+    uint64_t                            getNBytesReceived() const;
+    uint64_t                            getNBytesSent() const;
+    uint64_t                            getNTimeouts() const;
+
+private:
+    class cLoop;
+
+    class cConnection
+    {
+    public:
+        cConnection(uint64_t u64ID, int iFD, cLoop *pLoop);
+
+        uint64_t                        m_u64ID;
+        int                             m_iFD;
+        cLoop                           *m_pLoop;
+
+        //Event thread only
+        bool                            m_bConnecting;
+        bool                            m_bWaitingToWrite;  //EPOLLOUT registered
+        std::vector<char>               m_vcInput;
+        uint32_t                        m_u32InputStart;
+        uint32_t                        m_u32InputEnd;
+        uint32_t                        m_u32SearchOffset;
+        int64_t                         m_i64IdleTimeout_ns;
+        int64_t                         m_i64Deadline_ns;   //0 for none
+        //Earliest deadline the connection is in the timer wheel for (0 if not in it). Later entries may also be there.
+        int64_t                         m_i64ScheduledDeadline_ns;
+
+        //Shared with sending threads under m_oOutputMutex
+        boost::mutex                    m_oOutputMutex;
+        std::vector<char>               m_vcOutput;
+        uint32_t                        m_u32OutputStart;
+        bool                            m_bWritePosted;
+        bool                            m_bCloseRequested;
+        bool                            m_bClosed;
+    };
+
+    class cLoop
+    {
+    public:
+        cLoop();
+        ~cLoop();
+
+        int                             m_iEpollFD;
+        int                             m_iEventFD;
+        boost::scoped_ptr<boost::thread> m_pThread;
+
+        //Work for the event thread, posted from other threads
+        boost::mutex                    m_oMutex;
+        std::deque<boost::function<void ()> > m_dqCommands;
+
+        //Event thread only
+        cTimerWheel                     m_oTimerWheel;
+        std::map<uint64_t, cConnection*> m_oConnections;
+    };
+
+    class cRelease
+    {
+    public:
+        cRelease();
+
+        int                             m_iFD;
+        std::string                     m_strUnreadData;
+        std::string                     m_strUnsentData;
+        bool                            m_bDone;
+    };
+
+    std::vector<boost::shared_ptr<cLoop> > m_vpLoops;
+    boost::atomic<uint32_t>             m_u32NextLoopNo;
+    boost::atomic<bool>                 m_bStopRequested;
+
+    std::string                         m_strDelimiter;
+    uint32_t                            m_u32MaxLineLength_B;
+    boost::function<void (const cEvent &oEvent)> m_fnEventHandler;
+
+    //All connections by ID, for the calls made from other threads
+    std::map<uint64_t, boost::shared_ptr<cConnection> > m_oConnections;
+    boost::mutex                        m_oConnectionsMutex;
+    boost::atomic<uint64_t>             m_u64NextConnectionID;
+
+    //Queue based delivery
+    std::deque<cEvent>                  m_dqEvents;
+    boost::mutex                        m_oEventsMutex;
+    boost::condition_variable           m_oEventsCondition;
+    boost::atomic<uint32_t>             m_u32CancelCount;
+
+    //Signalled when a release has been done by the event thread
+    boost::mutex                        m_oReleaseMutex;
+    boost::condition_variable           m_oReleaseCondition;
+
+    //Statistics
+    boost::atomic<uint64_t>             m_u64NLinesReceived;
+    boost::atomic<uint64_t>             m_u64NBytesReceived;
+    boost::atomic<uint64_t>             m_u64NBytesSent;
+    boost::atomic<uint64_t>             m_u64NTimeouts;
+
+    //Optional label. May be useful for debugging.
+    std::string                         m_strName;
+
+    void                                eventThreadFunction(cLoop *pLoop);
+
+    //Run fnCommand on the loop's event thread
+    void                                post(cLoop *pLoop, const boost::function<void ()> &fnCommand);
+    boost::shared_ptr<cConnection>      findConnection(uint64_t u64ConnectionID);
+    uint64_t                            addConnection(int iFD, bool bConnecting, const std::string &strUnreadData, int64_t i64Timeout_ns, int64_t i64IdleTimeout_ns);
+
+    //Event thread functions
+    void                                registerConnection(boost::shared_ptr<cConnection> pConnection, std::string strUnreadData, int64_t i64Timeout_ns);
+    void                                handleConnected(cConnection &oConnection);
+    void                                handleReadable(cConnection &oConnection);
+    bool                                deliverLines(cConnection &oConnection);
+    void                                handleWritable(cConnection &oConnection);
+    void                                handleTimer(cLoop &oLoop, uint64_t u64ConnectionID, int64_t i64Now_ns);
+    void                                processWrite(uint64_t u64ConnectionID);
+    void                                processRelease(uint64_t u64ConnectionID, boost::shared_ptr<cRelease> pRelease);
+    void                                processSetIdleTimeout(uint64_t u64ConnectionID, int64_t i64IdleTimeout_ns);
+    void                                setDeadline(cConnection &oConnection, int64_t i64Deadline_ns);
+    void                                updateEpoll(cConnection &oConnection, bool bWaitForWrite);
+    //Removes the connection and closes its descriptor, with a CLOSED event unless oError is empty
+    void                                closeConnection(cConnection &oConnection, const boost::system::error_code &oError);
+
+    void                                deliver(const cEvent &oEvent);
+    void                                deliver(cEvent::eType eType, uint64_t u64ConnectionID, const boost::system::error_code &oError = boost::system::error_code());
+};
+
+#endif // __linux__
+
+#endif // TCP_EVENT_ENGINE_H
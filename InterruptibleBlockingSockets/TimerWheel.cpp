@@ -0,0 +1,104 @@
+
+//System includes
+
+//Library includes
+
+//Local includes
+#include "TimerWheel.h"
+
+using namespace std;
+
+cTimerWheel::cTimer::cTimer(uint64_t u64ID, int64_t i64Deadline_ns) :
+    m_u64ID(u64ID),
+    m_i64Deadline_ns(i64Deadline_ns)
+{
+}
+
+cTimerWheel::cTimerWheel(uint32_t u32NSlots, uint32_t u32Tick_ms) :
+    m_vvoSlots(u32NSlots ? u32NSlots : 1),
+    m_i64Tick_ns((int64_t)(u32Tick_ms ? u32Tick_ms : 1) * 1000000),
+    m_i64CurrentTick(-1),
+    m_u32NTimers(0)
+{
+}
+
+void cTimerWheel::schedule(uint64_t u64ID, int64_t i64Deadline_ns)
+{
+    int64_t i64Tick = i64Deadline_ns / m_i64Tick_ns;
+
+    //Ticks already processed won't be looked at again until the next revolution
+    if(m_i64CurrentTick >= 0 && i64Tick <= m_i64CurrentTick)
+        i64Tick = m_i64CurrentTick + 1;
+
+    m_vvoSlots[i64Tick % m_vvoSlots.size()].push_back(cTimer(u64ID, i64Deadline_ns));
+    m_u32NTimers++;
+}
+
+void cTimerWheel::expire(int64_t i64Now_ns, vector<uint64_t> &vu64ExpiredIDs)
+{
+    //Only whole ticks are processed. Timers later in the current tick wait for the next call after it ends.
+    int64_t i64LastTick = i64Now_ns / m_i64Tick_ns - 1;
+
+    if(i64LastTick <= m_i64CurrentTick)
+        return;
+
+    if(!m_u32NTimers)
+    {
+        m_i64CurrentTick = i64LastTick;
+        return;
+    }
+
+    //After a long wait (or on the first call, with timers scheduled before the wheel knew the time) every slot is due,
+    //but each only needs looking at once
+    if(m_i64CurrentTick < 0 || i64LastTick - m_i64CurrentTick >= (int64_t)m_vvoSlots.size())
+    {
+        for(uint32_t u32SlotNo = 0; u32SlotNo < m_vvoSlots.size(); u32SlotNo++)
+            expireSlot(u32SlotNo, i64Now_ns, vu64ExpiredIDs);
+    }
+    else
+    {
+        for(int64_t i64Tick = m_i64CurrentTick + 1; i64Tick <= i64LastTick; i64Tick++)
+            expireSlot(i64Tick % m_vvoSlots.size(), i64Now_ns, vu64ExpiredIDs);
+    }
+
+    m_i64CurrentTick = i64LastTick;
+}
+
+void cTimerWheel::expireSlot(uint32_t u32SlotNo, int64_t i64Now_ns, vector<uint64_t> &vu64ExpiredIDs)
+{
+    vector<cTimer> &voSlot = m_vvoSlots[u32SlotNo];
+
+    //Timers for later revolutions are kept, compacted to the front
+    uint32_t u32NKept = 0;
+
+    for(uint32_t u32TimerNo = 0; u32TimerNo < voSlot.size(); u32TimerNo++)
+    {
+        if(voSlot[u32TimerNo].m_i64Deadline_ns <= i64Now_ns)
+        {
+            vu64ExpiredIDs.push_back(voSlot[u32TimerNo].m_u64ID);
+            m_u32NTimers--;
+        }
+        else
+        {
+            voSlot[u32NKept++] = voSlot[u32TimerNo];
+        }
+    }
+
+    voSlot.erase(voSlot.begin() + u32NKept, voSlot.end());
+}
+
+int32_t cTimerWheel::getTimeToNextTick_ms(int64_t i64Now_ns) const
+{
+    if(!m_u32NTimers)
+        return -1;
+
+    int64_t i64Remaining_ns = (i64Now_ns / m_i64Tick_ns + 1) * m_i64Tick_ns - i64Now_ns;
+
+    //Round up so that the wait doesn't end just before the tick
+    return (i64Remaining_ns + 999999) / 1000000;
+}
+
+uint32_t cTimerWheel::getNTimers() const
+{
+    return m_u32NTimers;
+}
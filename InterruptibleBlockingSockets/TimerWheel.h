@@ -0,0 +1,70 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+//Hashed timer wheel for the per-connection timeouts of cTCPEventEngine. Scheduling and expiring are O(1) per timer
+//regardless of how many are pending, which a sorted structure can't offer with thousands of connections. Deadlines
+//further away than one revolution stay in their slot until a later pass reaches them.
+//
+//Timers can't be cancelled. The owner checks each expired ID against its current deadline and reschedules or ignores
+//it, so that activity on a connection costs no more than updating a number. Not thread safe.
+
+//System includes
+#ifdef _WIN32
+#include <stdint.h>
+
+#ifndef int64_t
+typedef __int64 int64_t;
+#endif
+
+#ifndef uint64_t
+typedef unsigned __int64 uint64_t;
+#endif
+
+#else
+#include <inttypes.h>
+#endif
+
+#include <vector>
+
+//Library includes:
+
+//Local includes
+
+class cTimerWheel
+{
+public:
+    cTimerWheel(uint32_t u32NSlots = 512, uint32_t u32Tick_ms = 10);
+
+    //Deadlines are in nanoseconds on any monotonic clock, as long as expire() is given the same one
+    void                            schedule(uint64_t u64ID, int64_t i64Deadline_ns);
+
+    //Appends the IDs of all timers due by i64Now_ns. They may fire up to one tick late, never early. Call regularly, also
+    //while no timers are pending, so that the wheel knows the current time when the next one is scheduled.
+    void                            expire(int64_t i64Now_ns, std::vector<uint64_t> &vu64ExpiredIDs);
+
+    //Time until the next tick, for the owner's wait. -1 if no timers are pending.
+    int32_t                         getTimeToNextTick_ms(int64_t i64Now_ns) const;
+
+    uint32_t                        getNTimers() const;
+
+private:
+    class cTimer
+    {
+    public:
+        cTimer(uint64_t u64ID, int64_t i64Deadline_ns);
+
+        uint64_t                    m_u64ID;
+        int64_t                     m_i64Deadline_ns;
+    };
+
+    std::vector<std::vector<cTimer> > m_vvoSlots;
+    int64_t                         m_i64Tick_ns;
+
+    //Last whole tick processed by expire(). -1 until expire() is first called.
+    int64_t                         m_i64CurrentTick;
+    uint32_t                        m_u32NTimers;
+
+    void                            expireSlot(uint32_t u32SlotNo, int64_t i64Now_ns, std::vector<uint64_t> &vu64ExpiredIDs);
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,131 @@
+
+#ifdef __linux__
+
+//System includes
+#include <cerrno>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+//Library includes
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/asio/error.hpp>
+#include <boost/thread/locks.hpp>
+#endif
+
+//Local includes
+#include "ZeroCopySendTracker.h"
+
+using namespace std;
+
+cZeroCopySendTracker::cZeroCopySendTracker(uint32_t u32Threshold_B) :
+    m_u32Threshold_B(u32Threshold_B),
+    m_u32NSent(0),
+    m_u32NCompleted(0),
+    m_u64NCopied(0)
+{
+}
+
+boost::system::error_code cZeroCopySendTracker::enable(int iFD)
+{
+    int iEnable = 1;
+    if(setsockopt(iFD, SOL_SOCKET, SO_ZEROCOPY, &iEnable, sizeof(iEnable)))
+        return boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+    return boost::system::error_code();
+}
+
+bool cZeroCopySendTracker::isWorthwhile(uint32_t u32NBytes) const
+{
+    return u32NBytes && u32NBytes >= m_u32Threshold_B;
+}
+
+void cZeroCopySendTracker::countSend()
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    m_u32NSent++;
+}
+
+void cZeroCopySendTracker::reap(int iFD)
+{
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    //Held while draining so that a completion taken off the queue is counted before getNPending() can look
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+
+    for(;;)
+    {
+        char acControl[128];
+
+        msghdr oHeader;
+        memset(&oHeader, 0, sizeof(oHeader));
+        oHeader.msg_control = acControl;
+        oHeader.msg_controllen = sizeof(acControl);
+
+        if(recvmsg(iFD, &oHeader, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            //EAGAIN once the queue is empty
+            return;
+        }
+
+        for(cmsghdr *pMessage = CMSG_FIRSTHDR(&oHeader); pMessage; pMessage = CMSG_NXTHDR(&oHeader, pMessage))
+        {
+            if(!(pMessage->cmsg_level == SOL_IP && pMessage->cmsg_type == IP_RECVERR) &&
+               !(pMessage->cmsg_level == SOL_IPV6 && pMessage->cmsg_type == IPV6_RECVERR))
+                continue;
+
+            sock_extended_err oError;
+            memcpy(&oError, CMSG_DATA(pMessage), sizeof(oError));
+
+            if(oError.ee_errno || oError.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            //Sends ee_info to ee_data inclusive have completed
+            uint32_t u32NCompleted = oError.ee_data - oError.ee_info + 1;
+            m_u32NCompleted += u32NCompleted;
+
+            if(oError.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                m_u64NCopied += u32NCompleted;
+        }
+    }
+#else
+    (void)iFD;
+#endif
+}
+
+boost::system::error_code cZeroCopySendTracker::waitForCompletions(int iFD, int64_t i64Deadline_ns)
+{
+    for(;;)
+    {
+        reap(iFD);
+
+        if(!getNPending())
+            return boost::system::error_code();
+
+        boost::system::error_code oError = m_oWaiter.waitForError(iFD, i64Deadline_ns);
+        if(oError)
+            return oError;
+    }
+}
+
+void cZeroCopySendTracker::cancel()
+{
+    m_oWaiter.cancel();
+}
+
+uint32_t cZeroCopySendTracker::getNPending() const
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    return m_u32NSent - m_u32NCompleted;
+}
+
+uint64_t cZeroCopySendTracker::getNCopied() const
+{
+    boost::lock_guard<boost::mutex> oLock(m_oMutex);
+    return m_u64NCopied;
+}
+
+#endif // __linux__
@@ -0,0 +1,77 @@
+#ifndef ZERO_COPY_SEND_TRACKER_H
+#define ZERO_COPY_SEND_TRACKER_H
+
+//Support for zero copy sends of the socket classes (see setZeroCopyEnabled()). Linux only.
+//
+//With MSG_ZEROCOPY the kernel sends straight from the caller's pages instead of copying them, so the buffer must stay
+//untouched until the kernel reports the send complete. Completions arrive on the socket's error queue as ranges of
+//send numbers. This class counts the sends and completions so that callers can tell when their buffers are free again.
+//
+//Queued completions keep POLLERR set on the socket, which wakes every readiness wait on it, including a read waiting
+//for data. reap() may therefore be called from the reading thread as well as the writing one.
+
+#ifdef __linux__
+
+//System includes
+#include <inttypes.h>
+
+#include <sys/socket.h>
+
+//Older C libraries lack the definitions. The kernel rejects them at run time if it doesn't support them either.
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+//Library includes:
+#ifndef Q_MOC_RUN //Qt's MOC and Boost have some issues don't let MOC process boost headers
+#include <boost/system/error_code.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
+//Local includes
+#include "SocketReadinessWaiter.h"
+
+class cZeroCopySendTracker
+{
+public:
+    cZeroCopySendTracker(uint32_t u32Threshold_B);
+
+    //Turns on SO_ZEROCOPY for the socket. Fails if the kernel doesn't support it (needs 4.14+ for TCP, 5.0+ for UDP).
+    static boost::system::error_code enable(int iFD);
+
+    //Below the threshold copying is cheaper than pinning pages and handling the completion
+    bool                            isWorthwhile(uint32_t u32NBytes) const;
+
+    //Count a MSG_ZEROCOPY send accepted by the kernel (returned > 0). Each such call uses one send number.
+    void                            countSend();
+
+    //Collect the completions queued so far without waiting
+    void                            reap(int iFD);
+    //Wait until all counted sends have completed. A deadline of 0 waits indefinitely. Interrupted by cancel().
+    boost::system::error_code       waitForCompletions(int iFD, int64_t i64Deadline_ns);
+    void                            cancel();
+
+    uint32_t                        getNPending() const;
+    //Completed sends for which the kernel had to copy after all (always the case over loopback)
+    uint64_t                        getNCopied() const;
+
+private:
+    cSocketReadinessWaiter          m_oWaiter;
+
+    uint32_t                        m_u32Threshold_B;
+
+    //Guards the counters below
+    mutable boost::mutex            m_oMutex;
+    //Send numbers wrap around the same way as the kernel's
+    uint32_t                        m_u32NSent;
+    uint32_t                        m_u32NCompleted;
+    uint64_t                        m_u64NCopied;
+};
+
+#endif // __linux__
+
+#endif // ZERO_COPY_SEND_TRACKER_H